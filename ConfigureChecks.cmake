@@ -65,6 +65,55 @@ if(CMAKE_SYSTEM_NAME STREQUAL "Linux")
 		}"
 		HAVE_LINUX_IF_BONDING_H
 	)
+	#
+	# dumpcap's --fanout needs TPACKET_V3 rings (Linux 3.2 and later).
+	#
+	check_c_source_compiles(
+		"#include <sys/socket.h>
+		#include <linux/if_packet.h>
+		int main(void)
+		{
+			struct tpacket_req3 req;
+			int version = TPACKET_V3;
+			int fanout = PACKET_FANOUT;
+			(void)req; (void)version; (void)fanout;
+			return 0;
+		}"
+		HAVE_TPACKET_V3
+	)
+	#
+	# dumpcap's --compress writes capture files through an fopencookie()
+	# stream.
+	#
+	check_c_source_compiles(
+		"#define _GNU_SOURCE
+		#include <stdio.h>
+		int main(void)
+		{
+			cookie_io_functions_t io_functions = { 0 };
+			return fopencookie(NULL, \"wb\", io_functions) == NULL;
+		}"
+		HAVE_FOPENCOOKIE
+	)
+	#
+	# dumpcap's --direct-io writes capture files with O_DIRECT, through
+	# an fopencookie() stream, into fallocate()d space.
+	#
+	check_c_source_compiles(
+		"#define _GNU_SOURCE
+		#include <stdio.h>
+		#include <stdlib.h>
+		#include <fcntl.h>
+		int main(void)
+		{
+			cookie_io_functions_t io_functions = { 0 };
+			void *buf;
+			(void)fopencookie(NULL, \"wb\", io_functions);
+			(void)posix_memalign(&buf, 4096, 4096);
+			return fallocate(0, FALLOC_FL_KEEP_SIZE, 0, 0) + O_DIRECT;
+		}"
+		HAVE_DIRECT_IO
+	)
 endif()
 
 #Functions
@@ -111,6 +160,8 @@ endif()
 check_function_exists("getifaddrs"       HAVE_GETIFADDRS)
 check_function_exists("issetugid"        HAVE_ISSETUGID)
 check_function_exists("mkstemps"         HAVE_MKSTEMPS)
+check_function_exists("mmap"             HAVE_MMAP)
+check_function_exists("pread"            HAVE_PREAD)
 check_function_exists("setresgid"        HAVE_SETRESGID)
 check_function_exists("setresuid"        HAVE_SETRESUID)
 check_function_exists("strptime"         HAVE_STRPTIME)
@@ -127,6 +178,8 @@ check_struct_has_member("struct sockaddr" sa_len         sys/socket.h HAVE_STRUC
 check_struct_has_member("struct stat"     st_flags       sys/stat.h   HAVE_STRUCT_STAT_ST_FLAGS)
 check_struct_has_member("struct stat"     st_birthtime   sys/stat.h   HAVE_STRUCT_STAT_ST_BIRTHTIME)
 check_struct_has_member("struct stat"     __st_birthtime sys/stat.h   HAVE_STRUCT_STAT___ST_BIRTHTIME)
+check_struct_has_member("struct stat"     st_mtim        sys/stat.h   HAVE_STRUCT_STAT_ST_MTIM)
+check_struct_has_member("struct stat"     st_mtimespec   sys/stat.h   HAVE_STRUCT_STAT_ST_MTIMESPEC)
 check_struct_has_member("struct tm"       tm_zone        time.h       HAVE_STRUCT_TM_TM_ZONE)
 
 #Symbols but NOT enums or types
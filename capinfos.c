@@ -73,6 +73,8 @@
 #include <wsutil/report_message.h>
 #include <wsutil/str_util.h>
 #include <wsutil/file_util.h>
+#include <wsutil/clopts_common.h>
+#include <wsutil/frame_index.h>
 
 #include <wsutil/wsgcrypt.h>
 
@@ -100,6 +102,20 @@
  */
 
 static gboolean continue_after_wtap_open_offline_failure = TRUE;
+static gboolean read_ahead = FALSE;
+
+/*
+ * With --threads, files are opened and read by a pool of threads, and
+ * the main thread reports on them in the order in which they were given.
+ */
+static guint n_threads = 0;
+
+/*
+ * With --use-index, the packet counts and times are taken from a file's
+ * sidecar index, if it has an up-to-date one, rather than by reading
+ * every packet.
+ */
+static gboolean use_index = FALSE;
 
 /*
  * table report variables
@@ -155,11 +171,6 @@ static gboolean cap_file_hashes    = TRUE;  /* Calculate file hashes */
 #define HASH_STR_SIZE (65) /* Max hash size * 2 + '\0' */
 #define HASH_BUF_SIZE (1024 * 1024)
 
-
-static gchar file_sha256[HASH_STR_SIZE];
-static gchar file_rmd160[HASH_STR_SIZE];
-static gchar file_sha1[HASH_STR_SIZE];
-
 /*
  * If we have at least two packets with time stamps, and they're not in
  * order - i.e., the later packet has a time stamp older than the earlier
@@ -212,6 +223,10 @@ typedef struct _capture_info {
   GArray        *interface_packet_counts;  /* array of per_packet interface_id counts; one entry per file IDB */
   guint32        pkt_interface_id_unknown; /* counts if packet interface_id didn't match a known one */
   GArray        *idb_info_strings;       /* array of IDB info strings */
+
+  gchar          file_sha256[HASH_STR_SIZE];
+  gchar          file_rmd160[HASH_STR_SIZE];
+  gchar          file_sha1[HASH_STR_SIZE];
 } capture_info;
 
 static char *decimal_point;
@@ -687,9 +702,9 @@ print_stats(const gchar *filename, capture_info *cf_info)
     }
   }
   if (cap_file_hashes) {
-    printf     ("SHA256:              %s\n", file_sha256);
-    printf     ("RIPEMD160:           %s\n", file_rmd160);
-    printf     ("SHA1:                %s\n", file_sha1);
+    printf     ("SHA256:              %s\n", cf_info->file_sha256);
+    printf     ("RIPEMD160:           %s\n", cf_info->file_rmd160);
+    printf     ("SHA1:                %s\n", cf_info->file_sha1);
   }
   if (cap_order)          printf     ("Strict time order:   %s\n", order_string(cf_info->order));
 
@@ -943,17 +958,17 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
   if (cap_file_hashes) {
     putsep();
     putquote();
-    printf("%s", file_sha256);
+    printf("%s", cf_info->file_sha256);
     putquote();
 
     putsep();
     putquote();
-    printf("%s", file_rmd160);
+    printf("%s", cf_info->file_rmd160);
     putquote();
 
     putsep();
     putquote();
-    printf("%s", file_sha1);
+    printf("%s", cf_info->file_sha1);
     putquote();
   }
 
@@ -1048,150 +1063,228 @@ cleanup_capture_info(capture_info *cf_info)
   cf_info->idb_info_strings = NULL;
 }
 
-static int
-process_cap_file(wtap *wth, const char *filename)
+/* Account for a record's time stamp, if it has one */
+static void
+count_record_time(capture_info *cf_info, gboolean has_ts, const nstime_t *ts,
+                  int tsprec, nstime_t *prev_time)
+{
+  if (has_ts) {
+    if (cf_info->packet_count == 0) {
+      cf_info->start_time = *ts;
+      cf_info->start_time_tsprec = tsprec;
+      cf_info->stop_time  = *ts;
+      cf_info->stop_time_tsprec = tsprec;
+      *prev_time = *ts;
+    }
+    if (nstime_cmp(ts, prev_time) < 0) {
+      cf_info->order = NOT_IN_ORDER;
+    }
+    if (nstime_cmp(ts, &cf_info->start_time) < 0) {
+      cf_info->start_time = *ts;
+      cf_info->start_time_tsprec = tsprec;
+    }
+    if (nstime_cmp(ts, &cf_info->stop_time) > 0) {
+      cf_info->stop_time = *ts;
+      cf_info->stop_time_tsprec = tsprec;
+    }
+    *prev_time = *ts;
+  } else {
+    cf_info->times_known = FALSE; /* at least one packet has no time stamp */
+    if (cf_info->order != NOT_IN_ORDER)
+      cf_info->order = ORDER_UNKNOWN;
+  }
+}
+
+/* Account for a packet's length and captured length */
+static void
+count_packet(capture_info *cf_info, guint32 len, guint32 caplen)
+{
+  cf_info->packet_bytes += len;
+  cf_info->packet_count++;
+
+  /* If caplen < len for a rcd, then presumably           */
+  /* 'Limit packet capture length' was done for this rcd. */
+  /* Keep track as to the min/max actual snapshot lengths */
+  /*  seen for this file.                                 */
+  if (caplen < len) {
+    if (caplen < cf_info->snaplen_min_inferred)
+      cf_info->snaplen_min_inferred = caplen;
+    if (caplen > cf_info->snaplen_max_inferred)
+      cf_info->snaplen_max_inferred = caplen;
+  }
+}
+
+/*
+ * The sidecar index only has the lengths and time stamps of the packets,
+ * so it's no use if we're to report their encapsulations or interfaces.
+ */
+static gboolean
+index_has_infos(wtap *wth)
+{
+  if (!long_report)
+    return TRUE;
+  if (cap_file_encap && wtap_file_encap(wth) == WTAP_ENCAP_PER_PACKET)
+    return FALSE;
+  if (cap_file_idb)
+    return FALSE;
+  return TRUE;
+}
+
+/*
+ * Count the packets from the file's sidecar index, as written by sharkd,
+ * rather than by reading the file.  Returns FALSE if the file doesn't
+ * have an index, or its index is out of date.
+ */
+static gboolean
+count_packets_from_index(const char *filename, capture_info *cf_info)
+{
+  frame_index_key           key;
+  gchar                    *index_name;
+  GMappedFile              *mapped;
+  frame_index               index;
+  const frame_index_record *records;
+  guint32                   i;
+  nstime_t                  ts;
+  nstime_t                  prev_time;
+
+  if (!frame_index_key_for_file(filename, &key))
+    return FALSE;
+
+  index_name = g_strdup_printf("%s.idx", filename);
+  mapped = frame_index_map(index_name, &key, &index);
+  g_free(index_name);
+  if (mapped == NULL)
+    return FALSE;
+
+  records = index.records;
+  nstime_set_zero(&prev_time);
+  for (i = 0; i < index.count; i++) {
+    ts.secs = (time_t)records[i].secs;
+    ts.nsecs = records[i].nsecs;
+    count_record_time(cf_info, (records[i].flags & FRAME_INDEX_HAS_TS) != 0,
+                      &ts, records[i].tsprec, &prev_time);
+    /* as when reading the file, other records count only for the times */
+    if (records[i].rec_type == REC_TYPE_PACKET)
+      count_packet(cf_info, records[i].pkt_len, records[i].cap_len);
+  }
+
+  g_mapped_file_unref(mapped);
+  return TRUE;
+}
+
+/*
+ * Gather the infos for a file.  Returns TRUE if there are infos to
+ * report, in which case they have to be freed with
+ * cleanup_capture_info(), and sets *status to the exit status for
+ * the file.
+ */
+static gboolean
+process_cap_file(wtap *wth, const char *filename, capture_info *cf_info,
+                 int *status)
 {
-  int                   status = 0;
-  int                   err;
-  gchar                *err_info;
+  int                   err = 0;
+  gchar                *err_info = NULL;
   gint64                size;
   gint64                data_offset;
 
-  guint32               packet = 0;
-  gint64                bytes  = 0;
-  guint32               snaplen_min_inferred = 0xffffffff;
-  guint32               snaplen_max_inferred =          0;
   wtap_rec             *rec;
-  capture_info          cf_info;
-  gboolean              have_times = TRUE;
-  nstime_t              start_time;
-  int                   start_time_tsprec;
-  nstime_t              stop_time;
-  int                   stop_time_tsprec;
-  nstime_t              cur_time;
   nstime_t              prev_time;
   gboolean              know_order = FALSE;
-  order_t               order = IN_ORDER;
   guint                 i;
   wtapng_iface_descriptions_t *idb_info;
 
   g_assert(wth != NULL);
   g_assert(filename != NULL);
 
-  nstime_set_zero(&start_time);
-  start_time_tsprec = WTAP_TSPREC_UNKNOWN;
-  nstime_set_zero(&stop_time);
-  stop_time_tsprec = WTAP_TSPREC_UNKNOWN;
-  nstime_set_zero(&cur_time);
+  *status = 0;
+
+  cf_info->packet_count = 0;
+  cf_info->packet_bytes = 0;
+  cf_info->snaplen_min_inferred = 0xffffffff;
+  cf_info->snaplen_max_inferred =          0;
+  cf_info->times_known = TRUE;
+  nstime_set_zero(&cf_info->start_time);
+  cf_info->start_time_tsprec = WTAP_TSPREC_UNKNOWN;
+  nstime_set_zero(&cf_info->stop_time);
+  cf_info->stop_time_tsprec = WTAP_TSPREC_UNKNOWN;
+  cf_info->order = IN_ORDER;
   nstime_set_zero(&prev_time);
 
-  cf_info.shb = wtap_file_get_shb(wth);
+  cf_info->shb = wtap_file_get_shb(wth);
 
-  cf_info.encap_counts = g_new0(int,WTAP_NUM_ENCAP_TYPES);
+  cf_info->encap_counts = g_new0(int,WTAP_NUM_ENCAP_TYPES);
 
   idb_info = wtap_file_get_idb_info(wth);
 
   g_assert(idb_info->interface_data != NULL);
 
-  cf_info.num_interfaces = idb_info->interface_data->len;
-  cf_info.interface_packet_counts  = g_array_sized_new(FALSE, TRUE, sizeof(guint32), cf_info.num_interfaces);
-  g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
-  cf_info.pkt_interface_id_unknown = 0;
+  cf_info->num_interfaces = idb_info->interface_data->len;
+  cf_info->interface_packet_counts  = g_array_sized_new(FALSE, TRUE, sizeof(guint32), cf_info->num_interfaces);
+  g_array_set_size(cf_info->interface_packet_counts, cf_info->num_interfaces);
+  cf_info->pkt_interface_id_unknown = 0;
 
   g_free(idb_info);
   idb_info = NULL;
 
   /* Tally up data that we need to parse through the file to find */
-  while (wtap_read(wth, &err, &err_info, &data_offset))  {
-    rec = wtap_get_rec(wth);
-    if (rec->presence_flags & WTAP_HAS_TS) {
-      prev_time = cur_time;
-      cur_time = rec->ts;
-      if (packet == 0) {
-        start_time = rec->ts;
-        start_time_tsprec = rec->tsprec;
-        stop_time  = rec->ts;
-        stop_time_tsprec = rec->tsprec;
-        prev_time  = rec->ts;
-      }
-      if (nstime_cmp(&cur_time, &prev_time) < 0) {
-        order = NOT_IN_ORDER;
-      }
-      if (nstime_cmp(&cur_time, &start_time) < 0) {
-        start_time = cur_time;
-        start_time_tsprec = rec->tsprec;
-      }
-      if (nstime_cmp(&cur_time, &stop_time) > 0) {
-        stop_time = cur_time;
-        stop_time_tsprec = rec->tsprec;
-      }
-    } else {
-      have_times = FALSE; /* at least one packet has no time stamp */
-      if (order != NOT_IN_ORDER)
-        order = ORDER_UNKNOWN;
-    }
-
-    if (rec->rec_type == REC_TYPE_PACKET) {
-      bytes += rec->rec_header.packet_header.len;
-      packet++;
-
-      /* If caplen < len for a rcd, then presumably           */
-      /* 'Limit packet capture length' was done for this rcd. */
-      /* Keep track as to the min/max actual snapshot lengths */
-      /*  seen for this file.                                 */
-      if (rec->rec_header.packet_header.caplen < rec->rec_header.packet_header.len) {
-        if (rec->rec_header.packet_header.caplen < snaplen_min_inferred)
-          snaplen_min_inferred = rec->rec_header.packet_header.caplen;
-        if (rec->rec_header.packet_header.caplen > snaplen_max_inferred)
-          snaplen_max_inferred = rec->rec_header.packet_header.caplen;
-      }
-
-      if ((rec->rec_header.packet_header.pkt_encap > 0) &&
-          (rec->rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-        cf_info.encap_counts[rec->rec_header.packet_header.pkt_encap] += 1;
-      } else {
-        fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
-                rec->rec_header.packet_header.pkt_encap, packet, filename);
-      }
-
-      /* Packet interface_id info */
-      if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
-        /* cf_info.num_interfaces is size, not index, so it's one more than max index */
-        if (rec->rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
-          /*
-           * OK, re-fetch the number of interfaces, as there might have
-           * been an interface that was in the middle of packets, and
-           * grow the array to be big enough for the new number of
-           * interfaces.
-           */
-          idb_info = wtap_file_get_idb_info(wth);
-
-          cf_info.num_interfaces = idb_info->interface_data->len;
-          g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
-
-          g_free(idb_info);
-          idb_info = NULL;
-        }
-        if (rec->rec_header.packet_header.interface_id < cf_info.num_interfaces) {
-          g_array_index(cf_info.interface_packet_counts, guint32,
-                        rec->rec_header.packet_header.interface_id) += 1;
-        }
-        else {
-          cf_info.pkt_interface_id_unknown += 1;
+  if (!use_index || !index_has_infos(wth) ||
+      !count_packets_from_index(filename, cf_info)) {
+    while (wtap_read(wth, &err, &err_info, &data_offset))  {
+      rec = wtap_get_rec(wth);
+      count_record_time(cf_info, (rec->presence_flags & WTAP_HAS_TS) != 0,
+                        &rec->ts, rec->tsprec, &prev_time);
+
+      if (rec->rec_type == REC_TYPE_PACKET) {
+        count_packet(cf_info, rec->rec_header.packet_header.len,
+                     rec->rec_header.packet_header.caplen);
+
+        if ((rec->rec_header.packet_header.pkt_encap > 0) &&
+            (rec->rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
+          cf_info->encap_counts[rec->rec_header.packet_header.pkt_encap] += 1;
+        } else {
+          fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
+                  rec->rec_header.packet_header.pkt_encap, cf_info->packet_count, filename);
         }
-      }
-      else {
-        /* it's for interface_id 0 */
-        if (cf_info.num_interfaces != 0) {
-          g_array_index(cf_info.interface_packet_counts, guint32, 0) += 1;
+
+        /* Packet interface_id info */
+        if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
+          /* cf_info->num_interfaces is size, not index, so it's one more than max index */
+          if (rec->rec_header.packet_header.interface_id >= cf_info->num_interfaces) {
+            /*
+             * OK, re-fetch the number of interfaces, as there might have
+             * been an interface that was in the middle of packets, and
+             * grow the array to be big enough for the new number of
+             * interfaces.
+             */
+            idb_info = wtap_file_get_idb_info(wth);
+
+            cf_info->num_interfaces = idb_info->interface_data->len;
+            g_array_set_size(cf_info->interface_packet_counts, cf_info->num_interfaces);
+
+            g_free(idb_info);
+            idb_info = NULL;
+          }
+          if (rec->rec_header.packet_header.interface_id < cf_info->num_interfaces) {
+            g_array_index(cf_info->interface_packet_counts, guint32,
+                          rec->rec_header.packet_header.interface_id) += 1;
+          }
+          else {
+            cf_info->pkt_interface_id_unknown += 1;
+          }
         }
         else {
-          cf_info.pkt_interface_id_unknown += 1;
+          /* it's for interface_id 0 */
+          if (cf_info->num_interfaces != 0) {
+            g_array_index(cf_info->interface_packet_counts, guint32, 0) += 1;
+          }
+          else {
+            cf_info->pkt_interface_id_unknown += 1;
+          }
         }
       }
-    }
 
-  } /* while */
+    } /* while */
+  }
 
   /*
    * Get IDB info strings.
@@ -1200,12 +1293,12 @@ process_cap_file(wtap *wth, const char *filename)
    */
   idb_info = wtap_file_get_idb_info(wth);
 
-  cf_info.idb_info_strings = g_array_sized_new(FALSE, FALSE, sizeof(gchar*), cf_info.num_interfaces);
-  cf_info.num_interfaces = idb_info->interface_data->len;
-  for (i = 0; i < cf_info.num_interfaces; i++) {
+  cf_info->idb_info_strings = g_array_sized_new(FALSE, FALSE, sizeof(gchar*), cf_info->num_interfaces);
+  cf_info->num_interfaces = idb_info->interface_data->len;
+  for (i = 0; i < cf_info->num_interfaces; i++) {
     const wtap_block_t if_descr = g_array_index(idb_info->interface_data, wtap_block_t, i);
     gchar *s = wtap_get_debug_if_descr(if_descr, 21, "\n");
-    g_array_append_val(cf_info.idb_info_strings, s);
+    g_array_append_val(cf_info->idb_info_strings, s);
   }
 
   g_free(idb_info);
@@ -1214,16 +1307,17 @@ process_cap_file(wtap *wth, const char *filename)
   if (err != 0) {
     fprintf(stderr,
         "capinfos: An error occurred after reading %u packets from \"%s\".\n",
-        packet, filename);
+        cf_info->packet_count, filename);
     cfile_read_failure_message("capinfos", filename, err, err_info);
     if (err == WTAP_ERR_SHORT_READ) {
         /* Don't give up completely with this one. */
-        status = 1;
+        *status = 1;
         fprintf(stderr,
           "  (will continue anyway, checksums might be incorrect)\n");
     } else {
-        cleanup_capture_info(&cf_info);
-        return 1;
+        cleanup_capture_info(cf_info);
+        *status = 1;
+        return FALSE;
     }
   }
 
@@ -1233,74 +1327,52 @@ process_cap_file(wtap *wth, const char *filename)
     fprintf(stderr,
         "capinfos: Can't get size of \"%s\": %s.\n",
         filename, g_strerror(err));
-    cleanup_capture_info(&cf_info);
-    return 1;
+    cleanup_capture_info(cf_info);
+    *status = 1;
+    return FALSE;
   }
 
-  cf_info.filesize = size;
+  cf_info->filesize = size;
 
   /* File Type */
-  cf_info.file_type = wtap_file_type_subtype(wth);
-  cf_info.iscompressed = wtap_iscompressed(wth);
+  cf_info->file_type = wtap_file_type_subtype(wth);
+  cf_info->iscompressed = wtap_iscompressed(wth);
 
   /* File Encapsulation */
-  cf_info.file_encap = wtap_file_encap(wth);
+  cf_info->file_encap = wtap_file_encap(wth);
 
-  cf_info.file_tsprec = wtap_file_tsprec(wth);
+  cf_info->file_tsprec = wtap_file_tsprec(wth);
 
   /* Packet size limit (snaplen) */
-  cf_info.snaplen = wtap_snapshot_length(wth);
-  if (cf_info.snaplen > 0)
-    cf_info.snap_set = TRUE;
+  cf_info->snaplen = wtap_snapshot_length(wth);
+  if (cf_info->snaplen > 0)
+    cf_info->snap_set = TRUE;
   else
-    cf_info.snap_set = FALSE;
-
-  cf_info.snaplen_min_inferred = snaplen_min_inferred;
-  cf_info.snaplen_max_inferred = snaplen_max_inferred;
-
-  /* # of packets */
-  cf_info.packet_count = packet;
+    cf_info->snap_set = FALSE;
 
   /* File Times */
-  cf_info.times_known = have_times;
-  cf_info.start_time = start_time;
-  cf_info.start_time_tsprec = start_time_tsprec;
-  cf_info.stop_time = stop_time;
-  cf_info.stop_time_tsprec = stop_time_tsprec;
-  nstime_delta(&cf_info.duration, &stop_time, &start_time);
+  nstime_delta(&cf_info->duration, &cf_info->stop_time, &cf_info->start_time);
   /* Duration precision is the higher of the start and stop time precisions. */
-  if (cf_info.stop_time_tsprec > cf_info.start_time_tsprec)
-    cf_info.duration_tsprec = cf_info.stop_time_tsprec;
+  if (cf_info->stop_time_tsprec > cf_info->start_time_tsprec)
+    cf_info->duration_tsprec = cf_info->stop_time_tsprec;
   else
-    cf_info.duration_tsprec = cf_info.start_time_tsprec;
-  cf_info.know_order = know_order;
-  cf_info.order = order;
+    cf_info->duration_tsprec = cf_info->start_time_tsprec;
+  cf_info->know_order = know_order;
 
-  /* Number of packet bytes */
-  cf_info.packet_bytes = bytes;
+  cf_info->data_rate   = 0.0;
+  cf_info->packet_rate = 0.0;
+  cf_info->packet_size = 0.0;
 
-  cf_info.data_rate   = 0.0;
-  cf_info.packet_rate = 0.0;
-  cf_info.packet_size = 0.0;
-
-  if (packet > 0) {
-    double delta_time = nstime_to_sec(&stop_time) - nstime_to_sec(&start_time);
+  if (cf_info->packet_count > 0) {
+    double delta_time = nstime_to_sec(&cf_info->stop_time) - nstime_to_sec(&cf_info->start_time);
     if (delta_time > 0.0) {
-      cf_info.data_rate   = (double)bytes  / delta_time; /* Data rate per second */
-      cf_info.packet_rate = (double)packet / delta_time; /* packet rate per second */
+      cf_info->data_rate   = (double)cf_info->packet_bytes / delta_time; /* Data rate per second */
+      cf_info->packet_rate = (double)cf_info->packet_count / delta_time; /* packet rate per second */
     }
-    cf_info.packet_size = (double)bytes / packet;                  /* Avg packet size      */
-  }
-
-  if (long_report) {
-    print_stats(filename, &cf_info);
-  } else {
-    print_stats_table(filename, &cf_info);
+    cf_info->packet_size = (double)cf_info->packet_bytes / cf_info->packet_count; /* Avg packet size      */
   }
 
-  cleanup_capture_info(&cf_info);
-
-  return status;
+  return TRUE;
 }
 
 static void
@@ -1358,6 +1430,12 @@ print_usage(FILE *output)
   fprintf(output, "  -C cancel processing if file open fails (default is to continue)\n");
   fprintf(output, "  -A generate all infos (default)\n");
   fprintf(output, "  -K disable displaying the capture comment\n");
+  fprintf(output, "  --read-ahead\n");
+  fprintf(output, "     read the files ahead on other threads\n");
+  fprintf(output, "  --threads <n>\n");
+  fprintf(output, "     process n files at a time\n");
+  fprintf(output, "  --use-index\n");
+  fprintf(output, "     take packet counts and times from sidecar indexes where possible\n");
   fprintf(output, "\n");
   fprintf(output, "Options are processed from left to right order with later options superceding\n");
   fprintf(output, "or adding to earlier options.\n");
@@ -1397,28 +1475,161 @@ hash_to_str(const unsigned char *hash, size_t length, char *str) {
   }
 }
 
+/*
+ * Compute the file's hashes.  All of them are computed with one handle,
+ * in one pass over the file.
+ */
+static void
+hash_file(const char *filename, capture_info *cf_info)
+{
+  FILE  *fh;
+  char  *hash_buf;
+  gcry_md_hd_t hd = NULL;
+  size_t hash_bytes;
+
+  g_strlcpy(cf_info->file_sha256, "<unknown>", HASH_STR_SIZE);
+  g_strlcpy(cf_info->file_rmd160, "<unknown>", HASH_STR_SIZE);
+  g_strlcpy(cf_info->file_sha1, "<unknown>", HASH_STR_SIZE);
+
+  fh = ws_fopen(filename, "rb");
+  if (!fh)
+    return;
+
+  gcry_md_open(&hd, GCRY_MD_SHA256, 0);
+  if (hd) {
+    gcry_md_enable(hd, GCRY_MD_RMD160);
+    gcry_md_enable(hd, GCRY_MD_SHA1);
+    hash_buf = (char *)g_malloc(HASH_BUF_SIZE);
+    while((hash_bytes = fread(hash_buf, 1, HASH_BUF_SIZE, fh)) > 0) {
+      gcry_md_write(hd, hash_buf, hash_bytes);
+    }
+    gcry_md_final(hd);
+    hash_to_str(gcry_md_read(hd, GCRY_MD_SHA256), HASH_SIZE_SHA256, cf_info->file_sha256);
+    hash_to_str(gcry_md_read(hd, GCRY_MD_RMD160), HASH_SIZE_RMD160, cf_info->file_rmd160);
+    hash_to_str(gcry_md_read(hd, GCRY_MD_SHA1), HASH_SIZE_SHA1, cf_info->file_sha1);
+    g_free(hash_buf);
+    gcry_md_close(hd);
+  }
+  fclose(fh);
+}
+
+/*
+ * A file to report on.  The file is kept open until it's been reported
+ * on, as its infos point into the wtap.
+ */
+typedef struct {
+  const char   *filename;
+  wtap         *wth;            /* NULL if the file couldn't be opened */
+  int           err;            /* why it couldn't be opened */
+  gchar        *err_info;
+  gboolean      have_info;      /* cf_info has been filled in */
+  int           status;
+  capture_info  cf_info;
+  gboolean      done;           /* processed by the thread pool */
+} file_job_t;
+
+/*
+ * With --threads, at most this many files per thread are processed
+ * ahead of the one being reported on, so that the infos for files
+ * after a big one don't pile up.
+ */
+#define FILE_JOBS_PER_THREAD 4
+
+static GMutex file_jobs_mtx;
+static GCond file_jobs_cond;
+
+static void
+process_file(file_job_t *job)
+{
+  if (cap_file_hashes)
+    hash_file(job->filename, &job->cf_info);
+
+  job->wth = wtap_open_offline(job->filename, WTAP_TYPE_AUTO, &job->err, &job->err_info, FALSE);
+  if (!job->wth)
+    return;
+
+  if (read_ahead)
+    wtap_set_read_ahead(job->wth);
+  job->have_info = process_cap_file(job->wth, job->filename, &job->cf_info, &job->status);
+}
+
+static void
+process_file_job(gpointer data, gpointer user_data _U_)
+{
+  file_job_t *job = (file_job_t *)data;
+
+  process_file(job);
+
+  g_mutex_lock(&file_jobs_mtx);
+  job->done = TRUE;
+  g_cond_broadcast(&file_jobs_cond);
+  g_mutex_unlock(&file_jobs_mtx);
+}
+
+/*
+ * Report on a processed file, and close it.  Returns 2 if the file
+ * couldn't be opened, otherwise the exit status for the file.
+ */
+static int
+report_file(file_job_t *job, gboolean first)
+{
+  if (!job->wth) {
+    cfile_open_failure_message("capinfos", job->filename, job->err, job->err_info);
+    job->err_info = NULL;
+    return 2;
+  }
+
+  if (!first && long_report)
+    printf("\n");
+  if (job->have_info) {
+    if (long_report) {
+      print_stats(job->filename, &job->cf_info);
+    } else {
+      print_stats_table(job->filename, &job->cf_info);
+    }
+    cleanup_capture_info(&job->cf_info);
+    job->have_info = FALSE;
+  }
+
+  wtap_close(job->wth);
+  job->wth = NULL;
+  return job->status;
+}
+
+/* Free whatever is left of a file that wasn't reported on */
+static void
+discard_file(file_job_t *job)
+{
+  if (job->have_info)
+    cleanup_capture_info(&job->cf_info);
+  if (job->wth)
+    wtap_close(job->wth);
+  g_free(job->err_info);
+}
+
 int
 main(int argc, char *argv[])
 {
   GString *comp_info_str;
   GString *runtime_info_str;
   char  *init_progfile_dir_error;
-  wtap  *wth;
-  int    err;
-  gchar *err_info;
   int    opt;
   int    overall_error_status = EXIT_SUCCESS;
   static const struct option long_options[] = {
       {"help", no_argument, NULL, 'h'},
       {"version", no_argument, NULL, 'v'},
+      {"read-ahead", no_argument, NULL, 0x8100},
+      {"threads", required_argument, NULL, 0x8101},
+      {"use-index", no_argument, NULL, 0x8102},
       {0, 0, 0, 0 }
   };
 
   int status = 0;
-  FILE  *fh;
-  char  *hash_buf = NULL;
-  gcry_md_hd_t hd = NULL;
-  size_t hash_bytes;
+  int n_files;
+  int i;
+  int n_queued = 0;
+  file_job_t *jobs = NULL;
+  GThreadPool *pool = NULL;
 
   /* Set the C-language locale to the native environment. */
   setlocale(LC_ALL, "");
@@ -1564,6 +1775,18 @@ main(int argc, char *argv[])
         cap_comment = FALSE;
         break;
 
+      case 0x8100:
+        read_ahead = TRUE;
+        break;
+
+      case 0x8101:
+        n_threads = get_positive_int(optarg, "thread count");
+        break;
+
+      case 0x8102:
+        use_index = TRUE;
+        break;
+
       case 'F':
         if (report_all_infos) disable_all_infos();
         cap_file_more_info = TRUE;
@@ -1662,64 +1885,54 @@ main(int argc, char *argv[])
     print_stats_table_header();
   }
 
+  /* This initializes gcrypt, which has to be done before any threads use it */
   if (cap_file_hashes) {
     gcry_check_version(NULL);
-    gcry_md_open(&hd, GCRY_MD_SHA256, 0);
-    if (hd) {
-      gcry_md_enable(hd, GCRY_MD_RMD160);
-      gcry_md_enable(hd, GCRY_MD_SHA1);
-    }
-    hash_buf = (char *)g_malloc(HASH_BUF_SIZE);
   }
 
+  n_files = argc - optind;
+  jobs = g_new0(file_job_t, n_files);
+  for (i = 0; i < n_files; i++)
+    jobs[i].filename = argv[optind + i];
+
+  if (n_threads > 1 && n_files > 1)
+    pool = g_thread_pool_new(process_file_job, NULL, (gint)n_threads, FALSE, NULL);
+
   overall_error_status = 0;
 
-  for (opt = optind; opt < argc; opt++) {
+  for (i = 0; i < n_files; i++) {
 
-    g_strlcpy(file_sha256, "<unknown>", HASH_STR_SIZE);
-    g_strlcpy(file_rmd160, "<unknown>", HASH_STR_SIZE);
-    g_strlcpy(file_sha1, "<unknown>", HASH_STR_SIZE);
+    if (pool) {
+      while (n_queued < n_files && (guint)(n_queued - i) < n_threads * FILE_JOBS_PER_THREAD)
+        g_thread_pool_push(pool, &jobs[n_queued++], NULL);
 
-    if (cap_file_hashes) {
-      fh = ws_fopen(argv[opt], "rb");
-      if (fh && hd) {
-        while((hash_bytes = fread(hash_buf, 1, HASH_BUF_SIZE, fh)) > 0) {
-          gcry_md_write(hd, hash_buf, hash_bytes);
-        }
-        gcry_md_final(hd);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_SHA256), HASH_SIZE_SHA256, file_sha256);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_RMD160), HASH_SIZE_RMD160, file_rmd160);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_SHA1), HASH_SIZE_SHA1, file_sha1);
-      }
-      if (fh) fclose(fh);
-      if (hd) gcry_md_reset(hd);
+      g_mutex_lock(&file_jobs_mtx);
+      while (!jobs[i].done)
+        g_cond_wait(&file_jobs_cond, &file_jobs_mtx);
+      g_mutex_unlock(&file_jobs_mtx);
+    } else {
+      process_file(&jobs[i]);
     }
 
-    wth = wtap_open_offline(argv[opt], WTAP_TYPE_AUTO, &err, &err_info, FALSE);
-
-    if (!wth) {
-      cfile_open_failure_message("capinfos", argv[opt], err, err_info);
+    status = report_file(&jobs[i], i == 0);
+    if (status == 2) {
       overall_error_status = 2; /* remember that an error has occurred */
       if (!continue_after_wtap_open_offline_failure)
-        goto exit;
-    }
-
-    if (wth) {
-      if ((opt > optind) && (long_report))
-        printf("\n");
-      status = process_cap_file(wth, argv[opt]);
-
-      wtap_close(wth);
-      if (status) {
-        overall_error_status = status;
-        goto exit;
-      }
+        break;
+    } else if (status) {
+      overall_error_status = status;
+      break;
     }
   }
 
+  /* Don't start on any more files, but let the ones under way finish */
+  if (pool)
+    g_thread_pool_free(pool, TRUE, TRUE);
+  for (i = 0; i < n_files; i++)
+    discard_file(&jobs[i]);
+
 exit:
-  g_free(hash_buf);
-  gcry_md_close(hd);
+  g_free(jobs);
   wtap_cleanup();
   free_progdirs();
   return overall_error_status;
@@ -0,0 +1,471 @@
+/* capture_fanout.c
+ * Capture from a Linux network interface through several AF_PACKET
+ * sockets in a fanout group, each with a TPACKET_V3 ring
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_TPACKET_V3
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#include <glib.h>
+
+#include "caputils/capture_fanout.h"
+
+/*
+ * A block is handed to its worker when it's full, or when this many
+ * milliseconds have passed since its first packet.
+ */
+#define FANOUT_BLOCK_TIMEOUT    100
+
+/* The smallest block; blocks are bigger if a packet wouldn't fit */
+#define FANOUT_MIN_BLOCK_SIZE   (128 * 1024)
+
+/*
+ * struct sock_fprog; <linux/filter.h> can't be included along with
+ * <pcap/bpf.h>, but a struct bpf_insn is laid out like a struct
+ * sock_filter.
+ */
+struct fanout_fprog {
+	unsigned short   len;
+	struct bpf_insn *filter;
+};
+
+typedef struct {
+	int      fd;
+	guint8  *map;
+	guint    block_size;
+	guint    block_nr;
+	guint    next;          /* next block to hand out */
+	guint    handed_out;    /* number of blocks handed out */
+	gint     released;      /* number of blocks given back, by the writer */
+	guint32  received;      /* statistics so far */
+	guint32  dropped;
+} fanout_ring_t;
+
+struct capture_fanout {
+	int              ifindex;
+	guint            snaplen;
+	guint            num_workers;
+	fanout_ring_t   *rings;
+	guint8          *vlan_buf;      /* for a packet with its VLAN tag put back */
+	GMutex           err_mtx;
+	char             errbuf[256];
+};
+
+static void
+fanout_set_error(capture_fanout_t *fanout, int err)
+{
+	/* Keep the first error, from whichever worker got it */
+	g_mutex_lock(&fanout->err_mtx);
+	if (fanout->errbuf[0] == '\0') {
+		if (err == ENETDOWN) {
+			/* What libpcap says, which dumpcap knows isn't a bug */
+			g_strlcpy(fanout->errbuf, "The interface went down",
+			    sizeof fanout->errbuf);
+		} else {
+			g_snprintf(fanout->errbuf, sizeof fanout->errbuf,
+			    "poll: %s", g_strerror(err));
+		}
+	}
+	g_mutex_unlock(&fanout->err_mtx);
+}
+
+capture_fanout_t *
+capture_fanout_open(const char *iface, guint num_workers, int snaplen,
+    gboolean promisc, guint buffer_size, char *errmsg, size_t errmsg_len)
+{
+	capture_fanout_t   *fanout;
+	fanout_ring_t      *ring;
+	struct ifreq        ifr;
+	struct packet_mreq  mreq;
+	struct tpacket_req3 req;
+	int                 version = TPACKET_V3;
+	guint               frame_size, block_size, block_nr, i;
+
+	fanout = g_new0(capture_fanout_t, 1);
+	g_mutex_init(&fanout->err_mtx);
+	fanout->snaplen = snaplen;
+	fanout->num_workers = num_workers;
+	fanout->rings = g_new0(fanout_ring_t, num_workers);
+	for (i = 0; i < num_workers; i++)
+		fanout->rings[i].fd = -1;
+	fanout->vlan_buf = (guint8 *)g_malloc(snaplen + 4);
+
+	fanout->ifindex = if_nametoindex(iface);
+	if (fanout->ifindex == 0) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "%s isn't a local network interface, so it can't be captured on with fanout.",
+		    iface);
+		goto fail;
+	}
+
+	/*
+	 * Each ring holds buffer_size bytes, in blocks at least big enough
+	 * for a packet of snaplen bytes with its headers.
+	 */
+	frame_size = (guint)TPACKET_ALIGN(TPACKET3_HDRLEN + 16 + snaplen);
+	block_size = FANOUT_MIN_BLOCK_SIZE;
+	while (block_size < frame_size + TPACKET_ALIGN(sizeof(struct tpacket_block_desc)))
+		block_size <<= 1;
+	block_nr = MAX(buffer_size / block_size, 2);
+
+	memset(&req, 0, sizeof req);
+	req.tp_block_size = block_size;
+	req.tp_block_nr = block_nr;
+	req.tp_frame_size = frame_size;
+	req.tp_frame_nr = (block_size / frame_size) * block_nr;
+	req.tp_retire_blk_tov = FANOUT_BLOCK_TIMEOUT;
+
+	for (i = 0; i < num_workers; i++) {
+		ring = &fanout->rings[i];
+
+		/* With protocol 0, the socket gets no packets until it's bound */
+		ring->fd = socket(AF_PACKET, SOCK_RAW, 0);
+		if (ring->fd == -1) {
+			g_snprintf(errmsg, (gulong)errmsg_len,
+			    "Couldn't open a packet socket: %s.", g_strerror(errno));
+			goto fail;
+		}
+
+		if (i == 0) {
+			memset(&ifr, 0, sizeof ifr);
+			g_strlcpy(ifr.ifr_name, iface, sizeof ifr.ifr_name);
+			if (ioctl(ring->fd, SIOCGIFHWADDR, &ifr) == -1) {
+				g_snprintf(errmsg, (gulong)errmsg_len,
+				    "Couldn't get the link-layer type of %s: %s.",
+				    iface, g_strerror(errno));
+				goto fail;
+			}
+			if (ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER &&
+			    ifr.ifr_hwaddr.sa_family != ARPHRD_LOOPBACK) {
+				g_snprintf(errmsg, (gulong)errmsg_len,
+				    "%s isn't an Ethernet interface; only Ethernet interfaces can be captured on with fanout.",
+				    iface);
+				goto fail;
+			}
+
+			/* The interface stays promiscuous while the socket is open */
+			if (promisc) {
+				memset(&mreq, 0, sizeof mreq);
+				mreq.mr_ifindex = fanout->ifindex;
+				mreq.mr_type = PACKET_MR_PROMISC;
+				if (setsockopt(ring->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP,
+				    &mreq, sizeof mreq) == -1) {
+					g_snprintf(errmsg, (gulong)errmsg_len,
+					    "Couldn't put %s in promiscuous mode: %s.",
+					    iface, g_strerror(errno));
+					goto fail;
+				}
+			}
+		}
+
+		if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof version) == -1 ||
+		    setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof req) == -1) {
+			g_snprintf(errmsg, (gulong)errmsg_len,
+			    "Couldn't set up a TPACKET_V3 ring of %u blocks of %u bytes: %s.",
+			    block_nr, block_size, g_strerror(errno));
+			goto fail;
+		}
+		ring->map = (guint8 *)mmap(NULL, (size_t)block_size * block_nr,
+		    PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+		if (ring->map == MAP_FAILED) {
+			ring->map = NULL;
+			g_snprintf(errmsg, (gulong)errmsg_len,
+			    "Couldn't map a packet ring: %s.", g_strerror(errno));
+			goto fail;
+		}
+		ring->block_size = block_size;
+		ring->block_nr = block_nr;
+	}
+	return fanout;
+
+fail:
+	capture_fanout_close(fanout);
+	return NULL;
+}
+
+gboolean
+capture_fanout_set_filter(capture_fanout_t *fanout,
+    const struct bpf_program *fcode)
+{
+	struct fanout_fprog prog;
+	guint               i;
+
+	prog.len = (unsigned short)fcode->bf_len;
+	prog.filter = fcode->bf_insns;
+	for (i = 0; i < fanout->num_workers; i++) {
+		if (setsockopt(fanout->rings[i].fd, SOL_SOCKET, SO_ATTACH_FILTER,
+		    &prog, sizeof prog) == -1) {
+			g_strlcpy(fanout->errbuf, g_strerror(errno),
+			    sizeof fanout->errbuf);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+gboolean
+capture_fanout_start(capture_fanout_t *fanout, char *errmsg, size_t errmsg_len)
+{
+	struct sockaddr_ll sll;
+	int                arg;
+	guint16            group_id;
+	guint              i;
+#ifdef PACKET_FANOUT_FLAG_UNIQUEID
+	socklen_t          len;
+#endif
+
+	memset(&sll, 0, sizeof sll);
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_ALL);
+	sll.sll_ifindex = fanout->ifindex;
+
+	/*
+	 * Flows are kept on one socket by hashing their addresses and ports.
+	 * We don't ask the kernel to reassemble IP fragments first, as we'd
+	 * then capture the reassembled packets rather than what was on the
+	 * wire; a fragment after the first has no ports, so it may end up on
+	 * another socket than the rest of its flow.
+	 */
+#ifdef PACKET_FANOUT_FLAG_UNIQUEID
+	/* The kernel picks a group ID that no other group uses */
+	group_id = 0;
+#else
+	group_id = (guint16)getpid();
+#endif
+	for (i = 0; i < fanout->num_workers; i++) {
+		if (bind(fanout->rings[i].fd, (struct sockaddr *)&sll, sizeof sll) == -1) {
+			g_snprintf(errmsg, (gulong)errmsg_len,
+			    "Couldn't bind a packet socket: %s.", g_strerror(errno));
+			return FALSE;
+		}
+
+		arg = group_id | (PACKET_FANOUT_HASH << 16);
+#ifdef PACKET_FANOUT_FLAG_UNIQUEID
+		if (i == 0)
+			arg |= PACKET_FANOUT_FLAG_UNIQUEID << 16;
+#endif
+		if (setsockopt(fanout->rings[i].fd, SOL_PACKET, PACKET_FANOUT,
+		    &arg, sizeof arg) == -1) {
+			g_snprintf(errmsg, (gulong)errmsg_len,
+			    "Couldn't add a packet socket to a fanout group: %s.",
+			    g_strerror(errno));
+			return FALSE;
+		}
+#ifdef PACKET_FANOUT_FLAG_UNIQUEID
+		if (i == 0) {
+			len = sizeof arg;
+			if (getsockopt(fanout->rings[i].fd, SOL_PACKET, PACKET_FANOUT,
+			    &arg, &len) == -1) {
+				g_snprintf(errmsg, (gulong)errmsg_len,
+				    "Couldn't get the ID of a fanout group: %s.",
+				    g_strerror(errno));
+				return FALSE;
+			}
+			group_id = (guint16)arg;
+		}
+#endif
+	}
+	return TRUE;
+}
+
+int
+capture_fanout_next_block(capture_fanout_t *fanout, guint worker,
+    int timeout, capture_fanout_block_t **blockp)
+{
+	fanout_ring_t             *ring = &fanout->rings[worker];
+	struct tpacket_block_desc *block;
+	struct pollfd              pfd;
+	int                        err;
+	socklen_t                  len;
+
+	/*
+	 * If every block is waiting to be written, the next one is still
+	 * ours, whatever its status says.
+	 */
+	if (ring->handed_out - (guint)g_atomic_int_get(&ring->released) == ring->block_nr) {
+		g_usleep(1000);
+		return 0;
+	}
+
+	block = (struct tpacket_block_desc *)(ring->map + (gsize)ring->next * ring->block_size);
+	if (!(g_atomic_int_get((gint *)&block->hdr.bh1.block_status) & TP_STATUS_USER)) {
+		pfd.fd = ring->fd;
+		pfd.events = POLLIN | POLLERR;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, timeout) == -1) {
+			if (errno == EINTR)
+				return 0;
+			fanout_set_error(fanout, errno);
+			return -1;
+		}
+		if (pfd.revents & POLLERR) {
+			err = 0;
+			len = sizeof err;
+			getsockopt(ring->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+			fanout_set_error(fanout, err != 0 ? err : EIO);
+			return -1;
+		}
+		if (!(g_atomic_int_get((gint *)&block->hdr.bh1.block_status) & TP_STATUS_USER))
+			return 0;
+	}
+
+	ring->next = (ring->next + 1) % ring->block_nr;
+	ring->handed_out++;
+	*blockp = (capture_fanout_block_t *)block;
+	return 1;
+}
+
+guint
+capture_fanout_block_packets(const capture_fanout_block_t *block)
+{
+	return ((const struct tpacket_block_desc *)block)->hdr.bh1.num_pkts;
+}
+
+guint
+capture_fanout_block_length(const capture_fanout_block_t *block)
+{
+	return ((const struct tpacket_block_desc *)block)->hdr.bh1.blk_len;
+}
+
+/* Put the VLAN tag the kernel took out of a packet back after its MAC addresses */
+static const u_char *
+fanout_insert_vlan_tag(capture_fanout_t *fanout, const struct tpacket3_hdr *hdr,
+    const u_char *pd, struct pcap_pkthdr *phdr)
+{
+	guint8  *buf = fanout->vlan_buf;
+	guint16  tpid = ETH_P_8021Q;
+
+#ifdef TP_STATUS_VLAN_TPID_VALID
+	if (hdr->tp_status & TP_STATUS_VLAN_TPID_VALID)
+		tpid = hdr->hv1.tp_vlan_tpid;
+#endif
+	memcpy(buf, pd, 2 * ETH_ALEN);
+	buf[2 * ETH_ALEN] = (guint8)(tpid >> 8);
+	buf[2 * ETH_ALEN + 1] = (guint8)tpid;
+	buf[2 * ETH_ALEN + 2] = (guint8)(hdr->hv1.tp_vlan_tci >> 8);
+	buf[2 * ETH_ALEN + 3] = (guint8)hdr->hv1.tp_vlan_tci;
+	memcpy(buf + 2 * ETH_ALEN + 4, pd + 2 * ETH_ALEN, phdr->caplen - 2 * ETH_ALEN);
+
+	phdr->len += 4;
+	phdr->caplen = MIN(phdr->caplen + 4, fanout->snaplen);
+	return buf;
+}
+
+void
+capture_fanout_block_foreach(capture_fanout_t *fanout,
+    capture_fanout_block_t *block, pcap_handler callback, u_char *user)
+{
+	struct tpacket_block_desc *desc = (struct tpacket_block_desc *)block;
+	const struct tpacket3_hdr *hdr;
+	struct pcap_pkthdr         phdr;
+	const u_char              *pd;
+	guint                      i;
+
+	hdr = (const struct tpacket3_hdr *)((guint8 *)desc + desc->hdr.bh1.offset_to_first_pkt);
+	for (i = 0; i < desc->hdr.bh1.num_pkts; i++) {
+		phdr.ts.tv_sec = hdr->tp_sec;
+		phdr.ts.tv_usec = hdr->tp_nsec;         /* nanoseconds */
+		phdr.caplen = MIN(hdr->tp_snaplen, fanout->snaplen);
+		phdr.len = hdr->tp_len;
+		pd = (const u_char *)hdr + hdr->tp_mac;
+
+		if ((hdr->hv1.tp_vlan_tci != 0 || (hdr->tp_status & TP_STATUS_VLAN_VALID)) &&
+		    phdr.caplen >= 2 * ETH_ALEN)
+			pd = fanout_insert_vlan_tag(fanout, hdr, pd, &phdr);
+
+		callback(user, &phdr, pd);
+		hdr = (const struct tpacket3_hdr *)((const guint8 *)hdr + hdr->tp_next_offset);
+	}
+}
+
+void
+capture_fanout_release_block(capture_fanout_t *fanout, guint worker,
+    capture_fanout_block_t *block)
+{
+	struct tpacket_block_desc *desc = (struct tpacket_block_desc *)block;
+
+	g_atomic_int_set((gint *)&desc->hdr.bh1.block_status, TP_STATUS_KERNEL);
+	g_atomic_int_inc(&fanout->rings[worker].released);
+}
+
+void
+capture_fanout_get_stats(capture_fanout_t *fanout, guint32 *received,
+    guint32 *dropped)
+{
+	struct tpacket_stats_v3 stats;
+	socklen_t               len;
+	guint                   i;
+
+	*received = 0;
+	*dropped = 0;
+	for (i = 0; i < fanout->num_workers; i++) {
+		/* Getting the statistics resets them */
+		len = sizeof stats;
+		if (getsockopt(fanout->rings[i].fd, SOL_PACKET, PACKET_STATISTICS,
+		    &stats, &len) == 0) {
+			fanout->rings[i].received += stats.tp_packets;
+			fanout->rings[i].dropped += stats.tp_drops;
+		}
+		*received += fanout->rings[i].received;
+		*dropped += fanout->rings[i].dropped;
+	}
+}
+
+const char *
+capture_fanout_geterr(capture_fanout_t *fanout)
+{
+	return fanout->errbuf;
+}
+
+void
+capture_fanout_close(capture_fanout_t *fanout)
+{
+	guint i;
+
+	for (i = 0; i < fanout->num_workers; i++) {
+		if (fanout->rings[i].map != NULL)
+			munmap(fanout->rings[i].map,
+			    (size_t)fanout->rings[i].block_size * fanout->rings[i].block_nr);
+		if (fanout->rings[i].fd != -1)
+			close(fanout->rings[i].fd);
+	}
+	g_free(fanout->rings);
+	g_free(fanout->vlan_buf);
+	g_mutex_clear(&fanout->err_mtx);
+	g_free(fanout);
+}
+
+#endif /* HAVE_TPACKET_V3 */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
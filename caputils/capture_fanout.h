@@ -0,0 +1,121 @@
+/* capture_fanout.h
+ * Capture from a Linux network interface through several AF_PACKET
+ * sockets in a fanout group, each with a TPACKET_V3 ring
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CAPTURE_FANOUT_H__
+#define __CAPTURE_FANOUT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#ifdef HAVE_TPACKET_V3
+
+#include <wsutil/wspcap.h>
+
+/*
+ * The kernel spreads the interface's packets over the sockets, keeping
+ * the packets of a flow on one socket, so that each socket can be read
+ * by its own "worker" thread.  Each socket has a ring of blocks of
+ * packets, which is mapped into our memory; the packets of a block are
+ * written straight from the ring, and the block is then given back to the
+ * kernel.
+ *
+ * Only Ethernet (and loopback) interfaces are supported; the packets are
+ * DLT_EN10MB, with nanosecond time stamps.
+ */
+typedef struct capture_fanout capture_fanout_t;
+typedef struct capture_fanout_block capture_fanout_block_t;
+
+/**
+ * Open the sockets for capturing on an interface. Nothing is captured
+ * until capture_fanout_start() is called.
+ *
+ * @param iface the interface
+ * @param num_workers the number of sockets
+ * @param snaplen the snapshot length
+ * @param promisc TRUE to put the interface in promiscuous mode
+ * @param buffer_size the size of each socket's ring, in bytes
+ * @return NULL, with an error message in errmsg, on failure
+ */
+extern capture_fanout_t *capture_fanout_open(const char *iface,
+    guint num_workers, int snaplen, gboolean promisc, guint buffer_size,
+    char *errmsg, size_t errmsg_len);
+
+/**
+ * Filter the packets of every socket with a compiled capture filter.
+ * On failure, capture_fanout_geterr() describes the error.
+ */
+extern gboolean capture_fanout_set_filter(capture_fanout_t *fanout,
+    const struct bpf_program *fcode);
+
+/** Start capturing, with the sockets in one fanout group */
+extern gboolean capture_fanout_start(capture_fanout_t *fanout,
+    char *errmsg, size_t errmsg_len);
+
+/**
+ * Wait up to timeout milliseconds for the next block of a worker's
+ * socket; called only by that worker. Blocks are handed out in order, and
+ * must be given back in the same order.
+ *
+ * @return 1 with the block in *blockp, 0 if there isn't one yet, or -1 on
+ * an error, which capture_fanout_geterr() describes
+ */
+extern int capture_fanout_next_block(capture_fanout_t *fanout, guint worker,
+    int timeout, capture_fanout_block_t **blockp);
+
+/** The number of packets in a block */
+extern guint capture_fanout_block_packets(const capture_fanout_block_t *block);
+
+/** The number of bytes in a block */
+extern guint capture_fanout_block_length(const capture_fanout_block_t *block);
+
+/**
+ * Call a pcap_dispatch()-style callback for each packet in a block.
+ * VLAN tags that the kernel took out of the packets are put back. Only
+ * one thread at a time may call this.
+ */
+extern void capture_fanout_block_foreach(capture_fanout_t *fanout,
+    capture_fanout_block_t *block, pcap_handler callback, u_char *user);
+
+/** Give a block back to the kernel */
+extern void capture_fanout_release_block(capture_fanout_t *fanout,
+    guint worker, capture_fanout_block_t *block);
+
+/** Get the number of packets received and dropped by all the sockets */
+extern void capture_fanout_get_stats(capture_fanout_t *fanout,
+    guint32 *received, guint32 *dropped);
+
+/** The error capture_fanout_set_filter() or capture_fanout_next_block() failed with */
+extern const char *capture_fanout_geterr(capture_fanout_t *fanout);
+
+/** Close the sockets; all blocks must have been given back */
+extern void capture_fanout_close(capture_fanout_t *fanout);
+
+#endif /* HAVE_TPACKET_V3 */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_FANOUT_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -61,11 +61,13 @@
 #include "caputils/capture_ifinfo.h"
 #include "caputils/capture-pcap-util.h"
 #include "caputils/capture-pcap-util-int.h"
+#include "caputils/capture_fanout.h"
 #ifdef _WIN32
 #include "caputils/capture-wpcap.h"
 #endif /* _WIN32 */
 
 #include "writecap/pcapio.h"
+#include "writecap/bulkwrite.h"
 
 #ifdef _WIN32
 #include <wsutil/unicode-utils.h>
@@ -95,6 +97,7 @@
 #include "wsutil/str_util.h"
 #include "wsutil/inet_addr.h"
 #include "wsutil/time_util.h"
+#include "wsutil/spsc_ring.h"
 
 #include "caputils/ws80211_utils.h"
 
@@ -124,9 +127,15 @@ FILE *debug_log;   /* for logging debug messages to  */
                    /*  is defined                    */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static gint64 pcap_queue_bytes;
-static gint64 pcap_queue_packets;
+/*
+ * In threaded mode, each thread that reads packets passes them to the
+ * writer through its own queue, a ring buffer of pcap_queue_elements;
+ * when all the queues are empty, the writer waits on pcap_queue_cond.
+ */
+static GPtrArray *pcap_queues;  /* of spsc_ring_t */
+static GMutex pcap_queue_mtx;
+static GCond pcap_queue_cond;
+static gint pcap_queue_writer_waiting;
 static gint64 pcap_queue_byte_limit = 0;
 static gint64 pcap_queue_packet_limit = 0;
 
@@ -237,6 +246,18 @@ typedef struct _pcapng_pipe_info {
 
 struct _loop_data; /* forward declaration so we can use it in the cap_pipe_dispatch function pointer */
 
+#ifdef HAVE_TPACKET_V3
+/*
+ * A thread reading the blocks of one of the sockets of a fanout capture.
+ */
+typedef struct _fanout_reader {
+    struct _capture_src         *pcap_src;
+    guint                        worker;                 /**< The socket it reads */
+    GThread                     *tid;
+    spsc_ring_t                 *queue;                  /**< Its blocks, for the writer */
+} fanout_reader;
+#endif
+
 /*
  * A source of packets from which we're capturing.
  */
@@ -251,6 +272,7 @@ typedef struct _capture_src {
     gboolean                     pcap_err;
     guint                        interface_id;
     GThread                     *tid;
+    spsc_ring_t                 *queue;                  /**< Packets read by tid, for the writer */
     int                          snaplen;
     int                          linktype;
     gboolean                     ts_nsec;                /**< TRUE if we're using nanosecond precision. */
@@ -287,6 +309,10 @@ typedef struct _capture_src {
     GMutex                      *cap_pipe_read_mtx;
     GAsyncQueue                 *cap_pipe_pending_q, *cap_pipe_done_q;
 #endif
+#ifdef HAVE_TPACKET_V3
+    capture_fanout_t            *fanout;                 /**< Non-NULL if we're capturing with --fanout; pcap_h is then a "dead" handle */
+    fanout_reader               *fanout_readers;         /**< One per socket */
+#endif
 } capture_src;
 
 /*
@@ -310,15 +336,25 @@ typedef struct _loop_data {
     guint32   autostop_files;
 } loop_data;
 
+/*
+ * A packet or pcapng block in a queue; its data follows it.
+ */
 typedef struct _pcap_queue_element {
     capture_src        *pcap_src;
     union {
         struct pcap_pkthdr  phdr;
         struct pcapng_block_header_s  bh;
+#ifdef HAVE_TPACKET_V3
+        struct {
+            guint                    worker;
+            capture_fanout_block_t  *block;     /**< Still in the socket's ring; no data follows */
+        } fanout;
+#endif
     } u;
-    u_char             *pd;
 } pcap_queue_element;
 
+#define PCAP_QUEUE_ELEMENT_DATA(queue_element) ((u_char *)((queue_element) + 1))
+
 /*
  * Standard secondary message for unexpected errors.
  */
@@ -368,6 +404,24 @@ static gboolean need_timeout_workaround;
 
 #define WRITER_THREAD_TIMEOUT 100000 /* usecs */
 
+/* The most elements the writer takes from one queue before going on to the next */
+#define WRITER_BATCH_SIZE 256
+
+/* The smallest size of a queue if there's no byte limit */
+#define PCAP_QUEUE_MIN_SIZE (16 * 1024 * 1024)
+
+#ifdef HAVE_TPACKET_V3
+#define FANOUT_READ_TIMEOUT   250 /* msecs */
+#endif
+
+/*
+ * values 128..65535 are capture options, 65536 is used by
+ * ui/commandline.c, so start dumpcap-specific options 1000 after this
+ */
+#define LONGOPT_FANOUT (65536+1000)
+#define LONGOPT_DIRECT_IO (65536+1001)
+#define LONGOPT_COMPRESS (65536+1002)
+
 static void
 console_log_handler(const char *log_domain, GLogLevelFlags log_level,
                     const char *message, gpointer user_data _U_);
@@ -376,6 +430,11 @@ console_log_handler(const char *log_domain, GLogLevelFlags log_level,
 static capture_options global_capture_opts;
 static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
+#ifdef HAVE_TPACKET_V3
+static guint fanout_workers = 0;
+#endif
+static gboolean direct_io = FALSE;
+static wtap_compression_type compression_type = WTAP_UNCOMPRESSED;
 static guint64 start_time;
 
 static void capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
@@ -384,6 +443,9 @@ static void capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_p
                                          const u_char *pd);
 static void capture_loop_write_pcapng_cb(capture_src *pcap_src, const struct pcapng_block_header_s *bh, const u_char *pd);
 static void capture_loop_queue_pcapng_cb(capture_src *pcap_src, const struct pcapng_block_header_s *bh, const u_char *pd);
+#ifdef HAVE_TPACKET_V3
+static int capture_loop_write_fanout_block(pcap_queue_element *queue_element);
+#endif
 static void capture_loop_get_errmsg(char *errmsg, int errmsglen, const char *fname,
                                     int err, gboolean is_close);
 
@@ -462,12 +524,22 @@ print_usage(FILE *output)
     fprintf(output, "  --capture-comment <comment>\n");
     fprintf(output, "                           add a capture comment to the output file\n");
     fprintf(output, "                           (only for pcapng)\n");
+#ifdef HAVE_DIRECT_IO
+    fprintf(output, "  --direct-io              write the output file(s) with O_DIRECT, bypassing\n");
+    fprintf(output, "                           the page cache\n");
+#endif
+    fprintf(output, "  --compress <type>        compress the output file(s) with the given type of\n");
+    fprintf(output, "                           compression: zstd or lz4; default is none\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -N <packet_limit>        maximum number of packets buffered within dumpcap\n");
     fprintf(output, "  -C <byte_limit>          maximum number of bytes used for buffering packets\n");
     fprintf(output, "                           within dumpcap\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
+#ifdef HAVE_TPACKET_V3
+    fprintf(output, "  --fanout <workers>       capture on each interface with this many sockets\n");
+    fprintf(output, "                           and threads (Ethernet only)\n");
+#endif
     fprintf(output, "  -q                       don't report packet capture counts\n");
     fprintf(output, "  -v                       print version information and exit\n");
     fprintf(output, "  -h                       display this help and exit\n");
@@ -2490,6 +2562,82 @@ pcapng_pipe_dispatch(loop_data *ld, capture_src *pcap_src, char *errmsg, int err
     return -1;
 }
 
+/* pcap_geterr() for a capture device, which might be captured on with fanout */
+static char *
+capture_src_geterr(capture_src *pcap_src)
+{
+#ifdef HAVE_TPACKET_V3
+    if (pcap_src->fanout != NULL)
+        return (char *)capture_fanout_geterr(pcap_src->fanout);
+#endif
+    return pcap_geterr(pcap_src->pcap_h);
+}
+
+/* pcap_stats() for a capture device, which might be captured on with fanout */
+static int
+capture_src_stats(capture_src *pcap_src, struct pcap_stat *stats)
+{
+#ifdef HAVE_TPACKET_V3
+    if (pcap_src->fanout != NULL) {
+        guint32 received, dropped;
+
+        capture_fanout_get_stats(pcap_src->fanout, &received, &dropped);
+        stats->ps_recv = received;
+        stats->ps_drop = dropped;
+        stats->ps_ifdrop = 0;
+        return 0;
+    }
+#endif
+    return pcap_stats(pcap_src->pcap_h, stats);
+}
+
+#ifdef HAVE_TPACKET_V3
+/** Open an interface for capturing with fanout.
+ *  Returns TRUE if it succeeds, FALSE otherwise. */
+static gboolean
+capture_loop_open_fanout(interface_options *interface_opts, capture_src *pcap_src,
+                         char *errmsg, size_t errmsg_len)
+{
+    int   snaplen;
+    guint buffer_size;
+
+    if (interface_opts->monitor_mode) {
+        g_snprintf(errmsg, (gulong) errmsg_len,
+                   "Monitor mode can't be used when capturing with fanout.");
+        return FALSE;
+    }
+    if (interface_opts->linktype != -1 && interface_opts->linktype != DLT_EN10MB) {
+        g_snprintf(errmsg, (gulong) errmsg_len,
+                   "Only Ethernet can be captured with fanout.");
+        return FALSE;
+    }
+
+    if (interface_opts->has_snaplen)
+        snaplen = interface_opts->snaplen;
+    else
+        snaplen = WTAP_MAX_PACKET_SIZE_STANDARD;
+#ifdef CAN_SET_CAPTURE_BUFFER_SIZE
+    buffer_size = interface_opts->buffer_size;
+#else
+    buffer_size = DEFAULT_CAPTURE_BUFFER_SIZE;
+#endif
+
+    /* Each socket gets a ring as big as the buffer we'd otherwise ask for */
+    pcap_src->fanout = capture_fanout_open(interface_opts->name, fanout_workers,
+                                           snaplen, interface_opts->promisc_mode,
+                                           buffer_size * 1024 * 1024,
+                                           errmsg, errmsg_len);
+    if (pcap_src->fanout == NULL)
+        return FALSE;
+
+    /* A handle with which to compile the capture filter */
+    pcap_src->pcap_h = pcap_open_dead(DLT_EN10MB, snaplen);
+    pcap_src->linktype = DLT_EN10MB;
+    pcap_src->ts_nsec = TRUE;
+    return TRUE;
+}
+#endif
+
 /** Open the capture input file (pcap or capture pipe).
  *  Returns TRUE if it succeeds, FALSE otherwise. */
 static gboolean
@@ -2592,6 +2740,14 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
         g_array_append_val(ld->pcaps, pcap_src);
 
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_open_input : %s", interface_opts->name);
+#ifdef HAVE_TPACKET_V3
+        if (fanout_workers > 0) {
+            if (!capture_loop_open_fanout(interface_opts, pcap_src, errmsg, errmsg_len)) {
+                return FALSE;
+            }
+            continue;
+        }
+#endif
         pcap_src->pcap_h = open_capture_device(capture_opts, interface_opts,
             CAP_READ_TIMEOUT, &open_err_str);
 
@@ -2745,6 +2901,14 @@ static void capture_loop_close_input(loop_data *ld)
             }
 	} else {
 	    /* Capture device.  If open, close the pcap_t. */
+#ifdef HAVE_TPACKET_V3
+            if (pcap_src->fanout != NULL) {
+                capture_fanout_close(pcap_src->fanout);
+                pcap_src->fanout = NULL;
+                g_free(pcap_src->fanout_readers);
+                pcap_src->fanout_readers = NULL;
+            }
+#endif
             if (pcap_src->pcap_h != NULL) {
                 g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_close_input: closing %p", (void *)pcap_src->pcap_h);
                 pcap_close(pcap_src->pcap_h);
@@ -2764,15 +2928,17 @@ static void capture_loop_close_input(loop_data *ld)
 
 /* init the capture filter */
 static initfilter_status_t
-capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
+capture_loop_init_filter(capture_src *pcap_src,
                          const gchar * name, const gchar * cfilter)
 {
+    pcap_t            *pcap_h = pcap_src->pcap_h;
     struct bpf_program fcode;
+    gboolean           set;
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_filter: %s", cfilter);
 
     /* capture filters only work on real interfaces */
-    if (cfilter && !from_cap_pipe) {
+    if (cfilter && !pcap_src->from_cap_pipe) {
         /* A capture filter was specified; set it up. */
         if (!compile_capture_filter(name, pcap_h, &fcode, cfilter)) {
             /* Treat this specially - our caller might try to compile this
@@ -2780,7 +2946,14 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
                the display and capture filter syntaxes are different. */
             return INITFILTER_BAD_FILTER;
         }
-        if (pcap_setfilter(pcap_h, &fcode) < 0) {
+#ifdef HAVE_TPACKET_V3
+        /* With fanout, pcap_h is only used to compile the filter */
+        if (pcap_src->fanout != NULL)
+            set = capture_fanout_set_filter(pcap_src->fanout, &fcode);
+        else
+#endif
+            set = pcap_setfilter(pcap_h, &fcode) == 0;
+        if (!set) {
 #ifdef HAVE_PCAP_FREECODE
             pcap_freecode(&fcode);
 #endif
@@ -2795,6 +2968,18 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
 }
 
 
+/*
+ * With --direct-io, space for each capture file is allocated when it's
+ * opened, if we know how big it's going to get.
+ */
+static gint64
+capture_loop_prealloc_size(capture_options *capture_opts)
+{
+    if (!direct_io || !capture_opts->has_autostop_filesize)
+        return 0;
+    return (gint64)capture_opts->autostop_filesize * 1000;
+}
+
 /* set up to write to the already-opened capture output file/files */
 static gboolean
 capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *errmsg, int errmsg_len)
@@ -2817,11 +3002,15 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     /* Set up to write to the capture file. */
     if (capture_opts->multi_files_on) {
         ld->pdh = ringbuf_init_libpcap_fdopen(&err);
-    } else {
+    } else if (capture_opts->output_to_pipe && compression_type == WTAP_UNCOMPRESSED) {
         ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
         if (ld->pdh == NULL) {
             err = errno;
         }
+    } else {
+        ld->pdh = bulkwrite_fdopen(ld->save_file_fd, direct_io,
+                                   capture_loop_prealloc_size(capture_opts),
+                                   compression_type, &err);
     }
     if (ld->pdh) {
         pcap_src = g_array_index(ld->pcaps, capture_src *, 0);
@@ -2937,7 +3126,7 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
                     guint64 isb_ifrecv, isb_ifdrop;
                     struct pcap_stat stats;
 
-                    if (pcap_stats(pcap_src->pcap_h, &stats) >= 0) {
+                    if (capture_src_stats(pcap_src, &stats) >= 0) {
                         isb_ifrecv = pcap_src->received;
                         isb_ifdrop = stats.ps_drop + pcap_src->dropped + pcap_src->flushed;
                    } else {
@@ -3224,7 +3413,10 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
                 /* ringbuffer is enabled */
                 *save_file_fd = ringbuf_init(capfile_name,
                                              (capture_opts->has_ring_num_files) ? capture_opts->ring_num_files : 0,
-                                             capture_opts->group_read_access);
+                                             capture_opts->group_read_access,
+                                             direct_io,
+                                             capture_loop_prealloc_size(capture_opts),
+                                             compression_type);
 
                 /* we need the ringbuf name */
                 if (*save_file_fd != -1) {
@@ -3427,6 +3619,143 @@ do_file_switch_or_stop(capture_options *capture_opts,
     return TRUE;
 }
 
+/* create the queue through which a source's packets go to the writer */
+static spsc_ring_t *
+pcap_queue_new(capture_src *pcap_src, interface_options *interface_opts _U_)
+{
+    gsize size;
+    gsize max_element;
+
+    if (pcap_queue_byte_limit > 0) {
+        size = (gsize)pcap_queue_byte_limit;
+    } else {
+        /*
+         * With only a packet limit, the queue can't grow as it could
+         * when packets were queued one by one, so make it as big as the
+         * capture buffer, but no smaller than PCAP_QUEUE_MIN_SIZE;
+         * packets that don't fit are dropped.
+         */
+#ifdef CAN_SET_CAPTURE_BUFFER_SIZE
+        size = (gsize)interface_opts->buffer_size * 1024 * 1024;
+#else
+        size = (gsize)DEFAULT_CAPTURE_BUFFER_SIZE * 1024 * 1024;
+#endif
+        size = MAX(size, PCAP_QUEUE_MIN_SIZE);
+    }
+
+    /* Make sure there's room for the biggest element before the limits are reached */
+    max_element = sizeof(pcap_queue_element) +
+        (pcap_src->from_cap_pipe ? pcap_src->cap_pipe_max_pkt_size : (guint)pcap_snapshot(pcap_src->pcap_h));
+    return spsc_ring_new(size + 2 * max_element);
+}
+
+/* get space in a queue for an element with len bytes of data, unless the
+   queue has reached its limits */
+static pcap_queue_element *
+pcap_queue_reserve(spsc_ring_t *queue, guint32 len)
+{
+    guint32 queue_bytes, queue_packets;
+
+    spsc_ring_used(queue, &queue_bytes, &queue_packets);
+    if (((pcap_queue_byte_limit > 0) && (queue_bytes >= pcap_queue_byte_limit)) ||
+        ((pcap_queue_packet_limit > 0) && (queue_packets >= pcap_queue_packet_limit))) {
+        return NULL;
+    }
+    return (pcap_queue_element *)spsc_ring_reserve(queue, (guint32)sizeof(pcap_queue_element) + len);
+}
+
+/* hand the element just reserved to the writer, waking it up if it's waiting */
+static void
+pcap_queue_commit(spsc_ring_t *queue)
+{
+    spsc_ring_commit(queue);
+    if (g_atomic_int_get(&pcap_queue_writer_waiting)) {
+        g_mutex_lock(&pcap_queue_mtx);
+        g_cond_signal(&pcap_queue_cond);
+        g_mutex_unlock(&pcap_queue_mtx);
+    }
+}
+
+/* are there elements in any of the queues? */
+static gboolean
+pcap_queues_pending(void)
+{
+    guint32 len;
+    guint   i;
+
+    for (i = 0; i < pcap_queues->len; i++) {
+        if (spsc_ring_peek((spsc_ring_t *)g_ptr_array_index(pcap_queues, i), &len) != NULL)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* write a batch of elements from a queue; returns the number of packets */
+static int
+capture_loop_write_queue(spsc_ring_t *queue)
+{
+    pcap_queue_element *queue_element;
+    guint32             len;
+    int                 inpkts = 0;
+    int                 n;
+
+    for (n = 0; n < WRITER_BATCH_SIZE; n++) {
+        queue_element = (pcap_queue_element *)spsc_ring_peek(queue, &len);
+        if (queue_element == NULL)
+            break;
+#ifdef HAVE_TPACKET_V3
+        if (queue_element->pcap_src->fanout != NULL) {
+            inpkts += capture_loop_write_fanout_block(queue_element);
+        } else
+#endif
+        if (queue_element->pcap_src->from_pcapng) {
+            capture_loop_write_pcapng_cb(queue_element->pcap_src,
+                                         &queue_element->u.bh,
+                                         PCAP_QUEUE_ELEMENT_DATA(queue_element));
+            inpkts++;
+        } else {
+            capture_loop_write_packet_cb((u_char *)queue_element->pcap_src,
+                                         &queue_element->u.phdr,
+                                         PCAP_QUEUE_ELEMENT_DATA(queue_element));
+            inpkts++;
+        }
+        spsc_ring_consume(queue);
+    }
+    /* Let the reader reuse the space of the whole batch at once */
+    if (n > 0)
+        spsc_ring_release(queue);
+    return inpkts;
+}
+
+/* write what's in the queues, taking a batch from each in turn; if
+   they're all empty, wait up to timeout microseconds for more.
+   Returns the number of packets written. */
+static int
+capture_loop_write_queued(gint64 timeout)
+{
+    int   inpkts = 0;
+    guint i;
+
+    for (i = 0; i < pcap_queues->len; i++) {
+        inpkts += capture_loop_write_queue((spsc_ring_t *)g_ptr_array_index(pcap_queues, i));
+    }
+    if (inpkts == 0 && timeout > 0) {
+        /*
+         * A reader signals us only if it sees that we're waiting, so
+         * look at the queues again after saying that we are.
+         */
+        g_mutex_lock(&pcap_queue_mtx);
+        g_atomic_int_set(&pcap_queue_writer_waiting, 1);
+        if (!pcap_queues_pending()) {
+            g_cond_wait_until(&pcap_queue_cond, &pcap_queue_mtx,
+                              g_get_monotonic_time() + timeout);
+        }
+        g_atomic_int_set(&pcap_queue_writer_waiting, 0);
+        g_mutex_unlock(&pcap_queue_mtx);
+    }
+    return inpkts;
+}
+
 static void *
 pcap_read_handler(void* arg)
 {
@@ -3448,6 +3777,57 @@ pcap_read_handler(void* arg)
     return (NULL);
 }
 
+#ifdef HAVE_TPACKET_V3
+static void *
+fanout_read_handler(void *arg)
+{
+    fanout_reader          *reader = (fanout_reader *)arg;
+    capture_src            *pcap_src = reader->pcap_src;
+    capture_fanout_block_t *block;
+    pcap_queue_element     *queue_element;
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Started fanout thread %u for interface %d.",
+          reader->worker, pcap_src->interface_id);
+
+    while (global_ld.go) {
+        switch (capture_fanout_next_block(pcap_src->fanout, reader->worker,
+                                          FANOUT_READ_TIMEOUT, &block)) {
+
+        case 1:
+            /*
+             * Queue the whole block; the writer writes its packets
+             * straight from the ring.  The queue limits don't apply:
+             * if the writer falls behind, the ring fills up and the
+             * kernel drops packets, which it counts.
+             */
+            while ((queue_element = (pcap_queue_element *)spsc_ring_reserve(reader->queue,
+                    (guint32)sizeof(pcap_queue_element))) == NULL && global_ld.go) {
+                g_usleep(1000);
+            }
+            if (queue_element == NULL) {
+                capture_fanout_release_block(pcap_src->fanout, reader->worker, block);
+                break;
+            }
+            queue_element->pcap_src = pcap_src;
+            queue_element->u.fanout.worker = reader->worker;
+            queue_element->u.fanout.block = block;
+            pcap_queue_commit(reader->queue);
+            break;
+
+        case -1:
+            /* Error, probably "The interface went down" */
+            global_ld.go = FALSE;
+            pcap_src->pcap_err = TRUE;
+            break;
+        }
+    }
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Stopped fanout thread %u for interface %d.",
+          reader->worker, pcap_src->interface_id);
+    g_thread_exit(NULL);
+    return (NULL);
+}
+#endif
+
 /* Do the low-level work of a capture.
    Returns TRUE if it succeeds, FALSE otherwise. */
 static gboolean
@@ -3513,8 +3893,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
          * is NULL. This might be a bug in WPCap. Therefore we provide an empty
          * string.
          */
-        switch (capture_loop_init_filter(pcap_src->pcap_h, pcap_src->from_cap_pipe,
-                                         interface_opts->name,
+        switch (capture_loop_init_filter(pcap_src, interface_opts->name,
                                          interface_opts->cfilter?interface_opts->cfilter:"")) {
 
         case INITFILTER_NO_ERROR:
@@ -3528,10 +3907,17 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
         case INITFILTER_OTHER_ERROR:
             g_snprintf(errmsg, sizeof(errmsg), "Can't install filter (%s).",
-                       pcap_geterr(pcap_src->pcap_h));
+                       capture_src_geterr(pcap_src));
             g_snprintf(secondary_errmsg, sizeof(secondary_errmsg), "%s", please_report);
             goto error;
         }
+#ifdef HAVE_TPACKET_V3
+        /* Now that the sockets are filtering, let the packets in */
+        if (pcap_src->fanout != NULL &&
+            !capture_fanout_start(pcap_src->fanout, errmsg, sizeof(errmsg))) {
+            goto error;
+        }
+#endif
     }
 
     /* If we're supposed to write to a capture file, open it for output
@@ -3606,11 +3992,29 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     /* WOW, everything is prepared! */
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
-        pcap_queue = g_async_queue_new();
-        pcap_queue_bytes = 0;
-        pcap_queue_packets = 0;
+        pcap_queues = g_ptr_array_new_with_free_func((GDestroyNotify)spsc_ring_free);
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+#ifdef HAVE_TPACKET_V3
+            if (pcap_src->fanout != NULL) {
+                guint worker;
+
+                pcap_src->fanout_readers = g_new(fanout_reader, fanout_workers);
+                for (worker = 0; worker < fanout_workers; worker++) {
+                    pcap_src->fanout_readers[worker].pcap_src = pcap_src;
+                    pcap_src->fanout_readers[worker].worker = worker;
+                    /* Room for a great many blocks, as each is one small element */
+                    pcap_src->fanout_readers[worker].queue = spsc_ring_new(1024 * 1024);
+                    g_ptr_array_add(pcap_queues, pcap_src->fanout_readers[worker].queue);
+                    pcap_src->fanout_readers[worker].tid = g_thread_new("Capture fanout read",
+                        fanout_read_handler, &pcap_src->fanout_readers[worker]);
+                }
+                continue;
+            }
+#endif
+            interface_opts = &g_array_index(capture_opts->ifaces, interface_options, i);
+            pcap_src->queue = pcap_queue_new(pcap_src, interface_opts);
+            g_ptr_array_add(pcap_queues, pcap_src->queue);
             /* XXX - Add an interface name here? */
             pcap_src->tid = g_thread_new("Capture read", pcap_read_handler, pcap_src);
         }
@@ -3618,44 +4022,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     while (global_ld.go) {
         /* dispatch incoming packets */
         if (use_threads) {
-            pcap_queue_element *queue_element;
-
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-            if (queue_element) {
-                if (queue_element->pcap_src->from_pcapng) {
-                    pcap_queue_bytes -= queue_element->u.bh.block_total_length;
-                    pcap_queue_packets -= 1;
-                } else {
-                    pcap_queue_bytes -= queue_element->u.phdr.caplen;
-                    pcap_queue_packets -= 1;
-                }
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element) {
-                if (queue_element->pcap_src->from_pcapng) {
-                    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                        "Dequeued a block of length %d captured on interface %d.",
-                        queue_element->u.bh.block_total_length, queue_element->pcap_src->interface_id);
-
-                    capture_loop_write_pcapng_cb(queue_element->pcap_src,
-                                                &queue_element->u.bh,
-                                                queue_element->pd);
-                } else {
-                    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                        "Dequeued a packet of length %d captured on interface %d.",
-                        queue_element->u.phdr.caplen, queue_element->pcap_src->interface_id);
-
-                    capture_loop_write_packet_cb((u_char *) queue_element->pcap_src,
-                                                &queue_element->u.phdr,
-                                                queue_element->pd);
-                }
-                g_free(queue_element->pd);
-                g_free(queue_element);
-                inpkts = 1;
-            } else {
-                inpkts = 0;
-            }
+            inpkts = capture_loop_write_queued(WRITER_THREAD_TIMEOUT);
         } else {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, 0);
             inpkts = capture_loop_dispatch(&global_ld, errmsg,
@@ -3764,40 +4131,39 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop stopping ...");
     if (use_threads) {
-        pcap_queue_element *queue_element;
-
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+#ifdef HAVE_TPACKET_V3
+            if (pcap_src->fanout != NULL) {
+                guint worker;
+
+                for (worker = 0; worker < fanout_workers; worker++) {
+                    g_thread_join(pcap_src->fanout_readers[worker].tid);
+                }
+                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Fanout threads of interface %u terminated.",
+                      pcap_src->interface_id);
+                continue;
+            }
+#endif
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Waiting for thread of interface %u...",
                   pcap_src->interface_id);
             g_thread_join(pcap_src->tid);
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Thread of interface %u terminated.",
                   pcap_src->interface_id);
         }
-        while (1) {
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_try_pop_unlocked(pcap_queue);
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->u.phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element == NULL) {
-                break;
-            }
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                  "Dequeued a packet of length %d captured on interface %d.",
-                  queue_element->u.phdr.caplen, queue_element->pcap_src->interface_id);
-            capture_loop_write_packet_cb((u_char *)queue_element->pcap_src,
-                                         &queue_element->u.phdr,
-                                         queue_element->pd);
-            g_free(queue_element->pd);
-            g_free(queue_element);
-            global_ld.inpkts_to_sync_pipe += 1;
+        /* Write what's left in the queues, or, as we've stopped, count it as flushed */
+        while (pcap_queues_pending()) {
+            global_ld.inpkts_to_sync_pipe += capture_loop_write_queued(0);
             if (capture_opts->output_to_pipe) {
                 fflush(global_ld.pdh);
             }
         }
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            pcap_src->queue = NULL;
+        }
+        g_ptr_array_free(pcap_queues, TRUE);
+        pcap_queues = NULL;
     }
 
 
@@ -3833,7 +4199,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                These should *not* be reported to the Wireshark developers. */
             char *cap_err_str;
 
-            cap_err_str = pcap_geterr(pcap_src->pcap_h);
+            cap_err_str = capture_src_geterr(pcap_src);
             if (strcmp(cap_err_str, "recvfrom: Network is down") == 0 ||
                 strcmp(cap_err_str, "The interface went down") == 0 ||
                 strcmp(cap_err_str, "read: Device not configured") == 0 ||
@@ -3912,14 +4278,14 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
              * platforms; initialize it to 0 to handle that.
              */
             stats->ps_ifdrop = 0;
-            if (pcap_stats(pcap_src->pcap_h, stats) >= 0) {
+            if (capture_src_stats(pcap_src, stats) >= 0) {
                 *stats_known = TRUE;
                 /* Let the parent process know. */
                 pcap_dropped += stats->ps_drop;
             } else {
                 g_snprintf(errmsg, sizeof(errmsg),
                            "Can't get packet-drop statistics: %s",
-                           pcap_geterr(pcap_src->pcap_h));
+                           capture_src_geterr(pcap_src));
                 report_capture_error(errmsg, please_report);
             }
         }
@@ -4137,6 +4503,27 @@ capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
     }
 }
 
+#ifdef HAVE_TPACKET_V3
+/* a block of packets was captured with fanout, write them and give the block back */
+static int
+capture_loop_write_fanout_block(pcap_queue_element *queue_element)
+{
+    capture_src *pcap_src = queue_element->pcap_src;
+    int          inpkts;
+
+    inpkts = capture_fanout_block_packets(queue_element->u.fanout.block);
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+          "Dequeued a block of %d packets captured on interface %d.",
+          inpkts, pcap_src->interface_id);
+
+    capture_fanout_block_foreach(pcap_src->fanout, queue_element->u.fanout.block,
+                                 capture_loop_write_packet_cb, (u_char *)pcap_src);
+    capture_fanout_release_block(pcap_src->fanout, queue_element->u.fanout.worker,
+                                 queue_element->u.fanout.block);
+    return inpkts;
+}
+#endif
+
 /* one packet was captured, queue it */
 static void
 capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
@@ -4144,7 +4531,6 @@ capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
 {
     capture_src        *pcap_src = (capture_src *) (void *) pcap_src_p;
     pcap_queue_element *queue_element;
-    gboolean            limit_reached;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4154,49 +4540,19 @@ capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
+    queue_element = pcap_queue_reserve(pcap_src->queue, phdr->caplen);
     if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.phdr = *phdr;
-    queue_element->pd = (u_char *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
         pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
-        pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_src->interface_id);
-    } else {
-        pcap_src->received++;
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-              "Queued a packet of length %d captured on interface %u.",
-              phdr->caplen, pcap_src->interface_id);
+        return;
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    queue_element->pcap_src = pcap_src;
+    queue_element->u.phdr = *phdr;
+    memcpy(PCAP_QUEUE_ELEMENT_DATA(queue_element), pd, phdr->caplen);
+    pcap_queue_commit(pcap_src->queue);
+    pcap_src->received++;
 }
 
 /* one pcapng block was captured, queue it */
@@ -4204,7 +4560,6 @@ static void
 capture_loop_queue_pcapng_cb(capture_src *pcap_src, const struct pcapng_block_header_s *bh, const u_char *pd)
 {
     pcap_queue_element *queue_element;
-    gboolean            limit_reached;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4214,49 +4569,19 @@ capture_loop_queue_pcapng_cb(capture_src *pcap_src, const struct pcapng_block_he
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
+    queue_element = pcap_queue_reserve(pcap_src->queue, bh->block_total_length);
     if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.bh = *bh;
-    queue_element->pd = (u_char *)g_malloc(bh->block_total_length);
-    if (queue_element->pd == NULL) {
         pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, bh->block_total_length);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += bh->block_total_length;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
-        pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               bh->block_total_length, pcap_src->interface_id);
-    } else {
-        pcap_src->received++;
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-              "Queued a packet of length %d captured on interface %u.",
-              bh->block_total_length, pcap_src->interface_id);
+        return;
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    queue_element->pcap_src = pcap_src;
+    queue_element->u.bh = *bh;
+    memcpy(PCAP_QUEUE_ELEMENT_DATA(queue_element), pd, bh->block_total_length);
+    pcap_queue_commit(pcap_src->queue);
+    pcap_src->received++;
 }
 
 static int
@@ -4339,6 +4664,9 @@ main(int argc, char *argv[])
     static const struct option long_options[] = {
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
+        {"fanout", required_argument, NULL, LONGOPT_FANOUT},
+        {"direct-io", no_argument, NULL, LONGOPT_DIRECT_IO},
+        {"compress", required_argument, NULL, LONGOPT_COMPRESS},
         LONGOPT_CAPTURE_COMMON
         {0, 0, 0, 0 }
     };
@@ -4808,6 +5136,40 @@ main(int argc, char *argv[])
         case 'N':
             pcap_queue_packet_limit = get_positive_int(optarg, "packet_limit");
             break;
+        case LONGOPT_FANOUT:
+#ifdef HAVE_TPACKET_V3
+            fanout_workers = get_positive_int(optarg, "number of fanout workers");
+            use_threads = TRUE;
+#else
+            cmdarg_err("Capturing with fanout isn't supported on this platform.");
+            arg_error = TRUE;
+#endif
+            break;
+        case LONGOPT_DIRECT_IO:
+#ifdef HAVE_DIRECT_IO
+            direct_io = TRUE;
+#else
+            cmdarg_err("Writing with O_DIRECT isn't supported on this platform.");
+            arg_error = TRUE;
+#endif
+            break;
+        case LONGOPT_COMPRESS:
+            if (strcmp(optarg, "none") == 0) {
+                compression_type = WTAP_UNCOMPRESSED;
+            } else if (strcmp(optarg, "zstd") == 0) {
+                compression_type = WTAP_ZSTD_COMPRESSED;
+            } else if (strcmp(optarg, "lz4") == 0) {
+                compression_type = WTAP_LZ4_COMPRESSED;
+            } else {
+                cmdarg_err("\"%s\" isn't a valid compression type; it must be zstd, lz4 or none.", optarg);
+                arg_error = TRUE;
+                break;
+            }
+            if (!bulkwrite_can_compress(compression_type)) {
+                cmdarg_err("Writing %s-compressed files isn't supported on this platform.", optarg);
+                arg_error = TRUE;
+            }
+            break;
         default:
             cmdarg_err("Invalid Option: %s", argv[optind-1]);
             /* FALLTHROUGH */
@@ -4834,6 +5196,10 @@ main(int argc, char *argv[])
             arg_error = TRUE;
         }
     }
+    if (direct_io && compression_type != WTAP_UNCOMPRESSED) {
+        cmdarg_err("--direct-io can't be used with --compress.");
+        arg_error = TRUE;
+    }
 
     if ((pcap_queue_byte_limit > 0) || (pcap_queue_packet_limit > 0)) {
         use_threads = TRUE;
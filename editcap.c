@@ -99,6 +99,14 @@ struct select_item {
 
 /*
  * Duplicate frame detection
+ *
+ * The digests of the frames in the duplicate window are kept in
+ * fd_hash[], a ring in the order in which the frames were read, and
+ * fd_hash_index maps each digest to the newest entry in the ring with
+ * that digest, so that checking a frame doesn't mean comparing it with
+ * every frame in the window.  The ring holds <dup window> entries for
+ * -d and -D; for -w it grows to hold however many frames fall within
+ * the time window.
  */
 typedef struct _fd_hash_t {
     guint8     digest[16];
@@ -107,13 +115,24 @@ typedef struct _fd_hash_t {
 } fd_hash_t;
 
 #define DEFAULT_DUP_DEPTH       5   /* Used with -d */
-#define MAX_DUP_DEPTH     1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
+#define MAX_DUP_DEPTH     1000000   /* the maximum window for de-duplication with -D */
+#define INITIAL_DUP_TIME_DEPTH 1024 /* initial size of fd_hash[] with -w */
+
+static fd_hash_t  *fd_hash       = NULL;
+static guint       fd_hash_size  = 0;     /* number of entries allocated */
+static guint       fd_hash_first = 0;     /* oldest entry in use */
+static guint       fd_hash_count = 0;     /* number of entries in use */
+static GHashTable *fd_hash_index = NULL;
+static int         dup_window    = DEFAULT_DUP_DEPTH;
+static int         cur_dup_entry = 0;
 
-static fd_hash_t fd_hash[MAX_DUP_DEPTH];
-static int       dup_window    = DEFAULT_DUP_DEPTH;
-static int       cur_dup_entry = 0;
+/* The keys and values of fd_hash_index are fd_hash[] indices plus 1 */
+#define FD_HASH_KEY(i)      GUINT_TO_POINTER((guint)(i) + 1)
+#define FD_HASH_ENTRY(key)  (GPOINTER_TO_UINT(key) - 1)
 
 static guint32   ignored_bytes  = 0;  /* Used with -I */
+static gboolean  ignore_ttl     = FALSE;  /* Used with --ignore-ttl */
+static gboolean  read_ahead     = FALSE;  /* Used with --read-ahead */
 
 #define ONE_BILLION 1000000000
 
@@ -158,6 +177,7 @@ static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE
 static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE_PCAP; /* default to pcap     */
 #endif
 static int                    out_frame_type            = -2; /* Leave frame type alone */
+static wtap_compression_type  out_compression_type      = WTAP_UNCOMPRESSED;
 static int                    verbose                   = 0;  /* Not so verbose         */
 static struct time_adjustment time_adj                  = {{0, 0}, 0}; /* no adjustment */
 static nstime_t               relative_time_window      = {0, 0}; /* de-dup time window */
@@ -573,48 +593,127 @@ remove_vlan_info(const wtap_packet_header *phdr, guint8* fd, guint32* len) {
     }
 }
 
+static guint
+fd_hash_hash(gconstpointer key)
+{
+    const fd_hash_t *entry = &fd_hash[FD_HASH_ENTRY(key)];
+    guint32 val;
+
+    /* the digest is already well mixed */
+    memcpy(&val, entry->digest, sizeof val);
+    return val ^ entry->len;
+}
+
 static gboolean
-is_duplicate(guint8* fd, guint32 len) {
-    int i;
+fd_hash_equal(gconstpointer a, gconstpointer b)
+{
+    const fd_hash_t *entry_a = &fd_hash[FD_HASH_ENTRY(a)];
+    const fd_hash_t *entry_b = &fd_hash[FD_HASH_ENTRY(b)];
 
-    /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
-    guint32 offset = ignored_bytes;
-    guint32 new_len;
-    guint8 *new_fd;
+    return entry_a->len == entry_b->len
+        && memcmp(entry_a->digest, entry_b->digest, 16) == 0;
+}
 
-    if (len <= ignored_bytes) {
-        offset = 0;
-    }
+static void
+fd_hash_init(guint size)
+{
+    fd_hash_size  = size > 0 ? size : 1;
+    fd_hash       = g_new0(fd_hash_t, fd_hash_size);
+    fd_hash_first = 0;
+    fd_hash_count = 0;
+    fd_hash_index = g_hash_table_new(fd_hash_hash, fd_hash_equal);
+}
 
-    new_fd  = &fd[offset];
-    new_len = len - (offset);
+static void
+fd_hash_cleanup(void)
+{
+    if (fd_hash_index != NULL)
+        g_hash_table_destroy(fd_hash_index);
+    g_free(fd_hash);
+    fd_hash_index = NULL;
+    fd_hash = NULL;
+}
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
+/* Drop the oldest entry from the ring. */
+static void
+fd_hash_expire(void)
+{
+    gpointer key = FD_HASH_KEY(fd_hash_first);
 
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+    /* If it's the newest entry with its digest, no entry left in the
+     * ring has that digest; otherwise the index refers to a newer one. */
+    if (g_hash_table_lookup(fd_hash_index, key) == key)
+        g_hash_table_remove(fd_hash_index, key);
 
-    fd_hash[cur_dup_entry].len = len;
+    fd_hash_first = (fd_hash_first + 1) % fd_hash_size;
+    fd_hash_count--;
+}
 
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
+/* Double the size of the ring, moving the entries to the start of it. */
+static void
+fd_hash_grow(void)
+{
+    fd_hash_t *new_hash = g_new0(fd_hash_t, fd_hash_size * 2);
+    guint i;
 
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
-        }
-    }
+    for (i = 0; i < fd_hash_count; i++)
+        new_hash[i] = fd_hash[(fd_hash_first + i) % fd_hash_size];
+    g_free(fd_hash);
+    fd_hash = new_hash;
+    fd_hash_size *= 2;
+    fd_hash_first = 0;
+
+    /* The entries have moved, so index them again, oldest first */
+    g_hash_table_remove_all(fd_hash_index);
+    for (i = 0; i < fd_hash_count; i++)
+        g_hash_table_replace(fd_hash_index, FD_HASH_KEY(i), FD_HASH_KEY(i));
+}
 
-    return FALSE;
+/*
+ * Find the IP header in a frame, for --ignore-ttl; returns its offset,
+ * or -1 if the frame isn't an IP packet over Ethernet or raw IP.
+ */
+static int
+find_ip_header(int encap, const guint8 *fd, guint32 len)
+{
+    guint32 offset;
+    guint16 etype;
+
+    switch (encap) {
+        case WTAP_ENCAP_ETHERNET:
+            offset = 12;
+            while (len >= offset + 2
+                   && (pntoh16(fd + offset) == ETHERTYPE_VLAN
+                       || pntoh16(fd + offset) == ETHERTYPE_IEEE_802_1AD
+                       || pntoh16(fd + offset) == ETHERTYPE_QINQ_OLD))
+                offset += VLAN_SIZE;
+            if (len < offset + 2)
+                return -1;
+            etype = pntoh16(fd + offset);
+            if (etype != ETHERTYPE_IP && etype != ETHERTYPE_IPv6)
+                return -1;
+            return offset + 2;
+        case WTAP_ENCAP_RAW_IP:
+        case WTAP_ENCAP_RAW_IP4:
+        case WTAP_ENCAP_RAW_IP6:
+            return 0;
+        default:
+            return -1;
+    }
 }
 
-static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
-    int i;
+/*
+ * Add an entry for the current frame to the ring, making it
+ * cur_dup_entry, and calculate its digest.
+ */
+static fd_hash_t *
+fd_hash_add(int encap, guint8* fd, guint32 len)
+{
+    fd_hash_t *entry;
+    guint8 saved[3];
+    guint8 *masked[3];
+    int n_masked = 0, i;
+    int ip_offset;
 
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
     guint32 offset = ignored_bytes;
@@ -628,101 +727,116 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
     new_fd  = &fd[offset];
     new_len = len - (offset);
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
+    if (fd_hash_count == fd_hash_size)
+        fd_hash_expire();
+    cur_dup_entry = (fd_hash_first + fd_hash_count) % fd_hash_size;
+    fd_hash_count++;
+    entry = &fd_hash[cur_dup_entry];
+
+    /*
+     * Routers along the path change the TTL (and so the header checksum)
+     * or hop limit of the copies of a packet seen at different places;
+     * zero them out while calculating the digest (--ignore-ttl option).
+     */
+    if (ignore_ttl && (ip_offset = find_ip_header(encap, fd, len)) >= 0) {
+        if (len >= (guint32)ip_offset + 20 && (fd[ip_offset] >> 4) == 4) {
+            masked[n_masked++] = &fd[ip_offset + 8];    /* TTL */
+            masked[n_masked++] = &fd[ip_offset + 10];   /* header checksum */
+            masked[n_masked++] = &fd[ip_offset + 11];
+        } else if (len >= (guint32)ip_offset + 40 && (fd[ip_offset] >> 4) == 6) {
+            masked[n_masked++] = &fd[ip_offset + 7];    /* hop limit */
+        }
+    }
+    for (i = 0; i < n_masked; i++) {
+        saved[i] = *masked[i];
+        *masked[i] = 0;
+    }
 
     /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+    gcry_md_hash_buffer(GCRY_MD_MD5, entry->digest, new_fd, new_len);
 
-    fd_hash[cur_dup_entry].len = len;
-    fd_hash[cur_dup_entry].frame_time.secs = current->secs;
-    fd_hash[cur_dup_entry].frame_time.nsecs = current->nsecs;
+    for (i = 0; i < n_masked; i++)
+        *masked[i] = saved[i];
+
+    entry->len = len;
+    return entry;
+}
+
+/*
+ * Look up the newest earlier entry with the same digest as the current
+ * frame's, and make the current frame's entry the newest one with it.
+ */
+static fd_hash_t *
+fd_hash_lookup_and_insert(void)
+{
+    gpointer key = FD_HASH_KEY(cur_dup_entry);
+    gpointer prev;
+
+    prev = g_hash_table_lookup(fd_hash_index, key);
+    g_hash_table_replace(fd_hash_index, key, key);
+    return prev != NULL ? &fd_hash[FD_HASH_ENTRY(prev)] : NULL;
+}
+
+static gboolean
+is_duplicate(int encap, guint8* fd, guint32 len) {
+    /*
+     * The ring holds <dup window> entries, so once the current frame's
+     * entry is added the previous <dup window> - 1 frames are left in it.
+     */
+    fd_hash_add(encap, fd, len);
+
+    /* Look for duplicates */
+    return fd_hash_lookup_and_insert() != NULL;
+}
+
+static gboolean
+is_duplicate_rel_time(int encap, guint8* fd, guint32 len, const nstime_t *current) {
+    fd_hash_t *entry;
+    fd_hash_t *prev;
+    nstime_t delta;
 
     /*
-     * Look for relative time related duplicates.
-     * This is hopefully a reasonably efficient mechanism for
-     * finding duplicates by rel time in the fd_hash[] cache.
-     * We check starting from the most recently added hash
-     * entries and work backwards towards older packets.
-     * This approach allows the dup test to be terminated
-     * when the relative time of a cached entry is found to
-     * be beyond the dup time window.
+     * Expire the frames that are now beyond the dup time window.
      *
      * Of course this assumes that the input trace file is
      * "well-formed" in the sense that the packet timestamps are
      * in strict chronologically increasing order (which is NOT
      * always the case!!).
-     *
-     * The fd_hash[] table was deliberately created large (1,000,000).
-     * Looking for time related duplicates in large trace files with
-     * non-fractional dup time window values can potentially take
-     * a long time to complete.
      */
-
-    for (i = cur_dup_entry - 1;; i--) {
-        nstime_t delta;
-        int cmp;
-
-        if (i < 0)
-            i = dup_window - 1;
-
-        if (i == cur_dup_entry) {
-            /*
-             * We've decremented back to where we started.
-             * Check no more!
-             */
-            break;
-        }
-
-        if (nstime_is_unset(&(fd_hash[i].frame_time))) {
-            /*
-             * We've decremented to an unused fd_hash[] entry.
-             * Check no more!
-             */
+    while (fd_hash_count > 0) {
+        nstime_delta(&delta, current, &fd_hash[fd_hash_first].frame_time);
+        if (nstime_cmp(&delta, &relative_time_window) <= 0)
             break;
-        }
+        fd_hash_expire();
+    }
 
-        nstime_delta(&delta, current, &fd_hash[i].frame_time);
+    /* There's no limit on the number of frames in the window */
+    if (fd_hash_count == fd_hash_size)
+        fd_hash_grow();
 
-        if (delta.secs < 0 || delta.nsecs < 0) {
-            /*
-             * A negative delta implies that the current packet
-             * has an absolute timestamp less than the cached packet
-             * that it is being compared to.  This is NOT a normal
-             * situation since trace files usually have packets in
-             * chronological order (oldest to newest).
-             *
-             * There are several possible ways to deal with this:
-             * 1. 'continue' dup checking with the next cached frame.
-             * 2. 'break' from looking for a duplicate of the current frame.
-             * 3. Take the absolute value of the delta and see if that
-             * falls within the specifed dup time window.
-             *
-             * Currently this code does option 1.  But it would pretty
-             * easy to add yet-another-editcap-option to select one of
-             * the other behaviors for dealing with out-of-sequence
-             * packets.
-             */
-            continue;
-        }
+    entry = fd_hash_add(encap, fd, len);
+    entry->frame_time.secs = current->secs;
+    entry->frame_time.nsecs = current->nsecs;
 
-        cmp = nstime_cmp(&delta, &relative_time_window);
+    prev = fd_hash_lookup_and_insert();
+    if (prev == NULL)
+        return FALSE;
 
-        if (cmp > 0) {
-            /*
-             * The delta time indicates that we are now looking at
-             * cached packets beyond the specified dup time window.
-             * Check no more!
-             */
-            break;
-        } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-                   && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
-        }
+    nstime_delta(&delta, current, &prev->frame_time);
+
+    if (delta.secs < 0 || delta.nsecs < 0) {
+        /*
+         * A negative delta implies that the current packet
+         * has an absolute timestamp less than the cached packet
+         * that it is being compared to.  This is NOT a normal
+         * situation since trace files usually have packets in
+         * chronological order (oldest to newest); we don't treat
+         * the current packet as a duplicate.
+         */
+        return FALSE;
     }
 
-    return FALSE;
+    return nstime_cmp(&delta, &relative_time_window) <= 0;
 }
 
 static void
@@ -762,6 +876,9 @@ print_usage(FILE *output)
     fprintf(output, "                         example).\n");
     fprintf(output, "                         e.g. -I 26 in case of Ether/IP will ignore\n");
     fprintf(output, "                         ether(14) and IP header(20 - 4(src ip) - 4(dst ip)).\n");
+    fprintf(output, "  --ignore-ttl           ignore the IPv4 TTL and header checksum, or the IPv6\n");
+    fprintf(output, "                         hop limit, of Ethernet and raw IP frames during MD5\n");
+    fprintf(output, "                         hash calculation.\n");
     fprintf(output, "\n");
     fprintf(output, "           NOTE: The use of the 'Duplicate packet removal' options with\n");
     fprintf(output, "           other editcap options except -v may not always work as expected.\n");
@@ -809,8 +926,12 @@ print_usage(FILE *output)
     fprintf(output, "  -T <encap type>        set the output file encapsulation type; default is the\n");
     fprintf(output, "                         same as the input file. An empty \"-T\" option will\n");
     fprintf(output, "                         list the encapsulation types.\n");
+    fprintf(output, "  --compress <type>      compress the output file with the given type of\n");
+    fprintf(output, "                         compression: gzip, bgzf, zstd or lz4; default is\n");
+    fprintf(output, "                         none.\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
+    fprintf(output, "  --read-ahead           read the input file ahead on other threads.\n");
     fprintf(output, "  -h                     display this help and exit.\n");
     fprintf(output, "  -v                     verbose output.\n");
     fprintf(output, "                         If -v is used with any of the 'Duplicate Packet\n");
@@ -865,6 +986,17 @@ list_capture_types(FILE *stream) {
     g_free(captypes);
 }
 
+static void
+list_output_compression_types(FILE *stream) {
+    GSList *list, *elem;
+
+    list = wtap_get_all_output_compression_type_names_list();
+    fprintf(stream, "editcap: The available output compression types for the \"--compress\" flag are:\n");
+    for (elem = list; elem != NULL; elem = g_slist_next(elem))
+        fprintf(stream, "    %s\n", (const char *)elem->data);
+    g_slist_free(list);
+}
+
 static void
 list_encap_types(FILE *stream) {
     int i;
@@ -930,11 +1062,11 @@ editcap_dump_open(const char *filename, guint32 snaplen,
   if (strcmp(filename, "-") == 0) {
     /* Write to the standard output. */
     pdh = wtap_dump_open_stdout_ng(out_file_type_subtype, out_frame_type,
-                                   snaplen, FALSE /* compressed */,
+                                   snaplen, out_compression_type,
                                    shb_hdrs, idb_inf, nrb_hdrs, write_err);
   } else {
     pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                            snaplen, FALSE /* compressed */,
+                            snaplen, out_compression_type,
                             shb_hdrs, idb_inf, nrb_hdrs, write_err);
   }
   return pdh;
@@ -952,6 +1084,9 @@ main(int argc, char *argv[])
     int           opt;
     static const struct option long_options[] = {
         {"novlan", no_argument, NULL, 0x8100},
+        {"compress", required_argument, NULL, 0x8101},
+        {"ignore-ttl", no_argument, NULL, 0x8102},
+        {"read-ahead", no_argument, NULL, 0x8103},
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'V'},
         {0, 0, 0, 0 }
@@ -1043,6 +1178,31 @@ main(int argc, char *argv[])
             break;
         }
 
+        case 0x8101:
+        {
+            if (!wtap_name_to_compression_type(optarg, &out_compression_type) ||
+                !wtap_can_write_compression_type(out_compression_type)) {
+                fprintf(stderr, "editcap: \"%s\" isn't a supported output compression type\n",
+                        optarg);
+                list_output_compression_types(stderr);
+                ret = INVALID_OPTION;
+                goto clean_exit;
+            }
+            break;
+        }
+
+        case 0x8102:
+        {
+            ignore_ttl = TRUE;
+            break;
+        }
+
+        case 0x8103:
+        {
+            read_ahead = TRUE;
+            break;
+        }
+
         case 'a':
         {
             guint frame_number;
@@ -1259,7 +1419,6 @@ main(int argc, char *argv[])
         case 'w':
             dup_detect = FALSE;
             dup_detect_by_time = TRUE;
-            dup_window = MAX_DUP_DEPTH;
             if (!set_rel_time(optarg)) {
                 ret = INVALID_OPTION;
                 goto clean_exit;
@@ -1335,6 +1494,8 @@ main(int argc, char *argv[])
         ret = INVALID_FILE;
         goto clean_exit;
     }
+    if (read_ahead)
+        wtap_set_read_ahead(wth);
 
     if (verbose) {
         fprintf(stderr, "File %s is a %s capture file.\n", argv[optind],
@@ -1361,12 +1522,10 @@ main(int argc, char *argv[])
         if (keep_em == FALSE)
             max_packet_number = G_MAXUINT;
 
-        if (dup_detect || dup_detect_by_time) {
-            for (i = 0; i < dup_window; i++) {
-                memset(&fd_hash[i].digest, 0, 16);
-                fd_hash[i].len = 0;
-                nstime_set_unset(&fd_hash[i].frame_time);
-            }
+        if (dup_detect) {
+            fd_hash_init(dup_window);
+        } else if (dup_detect_by_time) {
+            fd_hash_init(INITIAL_DUP_TIME_DEPTH);
         }
 
         /* Read all of the packets in turn */
@@ -1642,7 +1801,8 @@ main(int argc, char *argv[])
 
                     /* suppress duplicates by packet window */
                     if (dup_detect) {
-                        if (is_duplicate(buf, rec->rec_header.packet_header.caplen)) {
+                        if (is_duplicate(rec->rec_header.packet_header.pkt_encap, buf,
+                                         rec->rec_header.packet_header.caplen)) {
                             if (verbose) {
                                 fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
                                         count,
@@ -1676,7 +1836,8 @@ main(int argc, char *argv[])
                             current.secs  = rec->ts.secs;
                             current.nsecs = rec->ts.nsecs;
 
-                            if (is_duplicate_rel_time(buf,
+                            if (is_duplicate_rel_time(rec->rec_header.packet_header.pkt_encap,
+                                                      buf,
                                                       rec->rec_header.packet_header.caplen,
                                                       &current)) {
                                 if (verbose) {
@@ -1873,6 +2034,7 @@ main(int argc, char *argv[])
     }
 
 clean_exit:
+    fd_hash_cleanup();
     wtap_block_array_free(shb_hdrs);
     wtap_block_array_free(nrb_hdrs);
     g_free(idb_inf);
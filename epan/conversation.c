@@ -158,6 +158,7 @@ conversation_create_from_template(conversation_t *conversation, const address *a
 		 * the handler of the new conversation as well.
 		 */
 		new_conversation_from_template->dissector_tree = conversation->dissector_tree;
+		new_conversation_from_template->shares_dissector_tree = TRUE;
 
 		return new_conversation_from_template;
 	}
@@ -442,6 +443,202 @@ conversation_match_no_addr2_or_port2(gconstpointer v, gconstpointer w)
 	return 0;
 }
 
+/*
+ * Eviction of conversations, for long-running single-pass captures.
+ *
+ * When eviction is enabled, each conversation is on a list for its
+ * endpoint type, ordered from least to most recently used; a
+ * conversation moves to the end of its list whenever it's found.  The
+ * idle conversations are at the start of each list, and the least
+ * recently used conversation overall is at the start of one of them.
+ *
+ * Only conversations of endpoint types whose dissectors have said they
+ * can be freed go on the lists, and a conversation is taken off its
+ * list, to be kept until the end of the file, as soon as another
+ * protocol attaches data to it that there's no routine to free, or
+ * sets its dissector; either usually means that protocol holds on to
+ * the conversation itself.
+ */
+#define NUM_ENDPOINT_TYPES	(ENDPOINT_IUUP + 1)
+
+typedef struct {
+	conversation_t *head;		/* least recently used */
+	conversation_t *tail;		/* most recently used */
+	nstime_t idle_timeout;		/* zero if there's none */
+} conversation_lru_t;
+
+static conversation_lru_t conversation_lru[NUM_ENDPOINT_TYPES];
+static gboolean conversation_evictable[NUM_ENDPOINT_TYPES];
+static gboolean conversation_eviction = FALSE;
+static guint conversation_max = 0;
+static nstime_t conversation_now;
+static conversation_eviction_stats_t conversation_evicted;
+
+/* Routines to free protocols' conversation data, indexed by protocol */
+typedef struct {
+	GDestroyNotify free_func;
+} conversation_proto_data_free_t;
+
+static wmem_map_t *conversation_proto_data_free_funcs = NULL;
+
+static const char *endpoint_type_names[NUM_ENDPOINT_TYPES] = {
+	"none", "sctp", "tcp", "udp", "dccp", "ipx", "ncp", "exchg", "ddp",
+	"sbccs", "idp", "tipc", "usb", "i2c", "ibqp", "bluetooth", "tdmop",
+	"dvbci", "iso14443", "isdn", "h223", "x25", "iax2", "dlci", "isup",
+	"bicc", "gsmtap", "iuup"
+};
+
+static conversation_lru_t *
+conversation_lru_for(const conversation_t *conv)
+{
+	endpoint_type etype = conv->key_ptr->etype;
+
+	if ((guint)etype >= NUM_ENDPOINT_TYPES)
+		etype = ENDPOINT_NONE;
+	return &conversation_lru[etype];
+}
+
+static void
+conversation_lru_append(conversation_t *conv)
+{
+	conversation_lru_t *lru = conversation_lru_for(conv);
+
+	conv->last_time = conversation_now;
+	conv->lru_prev = lru->tail;
+	conv->lru_next = NULL;
+	if (lru->tail != NULL)
+		lru->tail->lru_next = conv;
+	else
+		lru->head = conv;
+	lru->tail = conv;
+}
+
+static void
+conversation_lru_unlink(conversation_t *conv)
+{
+	conversation_lru_t *lru = conversation_lru_for(conv);
+
+	if (conv->lru_prev != NULL)
+		conv->lru_prev->lru_next = conv->lru_next;
+	else
+		lru->head = conv->lru_next;
+	if (conv->lru_next != NULL)
+		conv->lru_next->lru_prev = conv->lru_prev;
+	else
+		lru->tail = conv->lru_prev;
+	conv->lru_prev = conv->lru_next = NULL;
+}
+
+/*
+ * Conversations created before eviction was enabled, of endpoint types
+ * that can't be evicted, or that are being kept aren't on a list.
+ */
+static gboolean
+conversation_on_lru(const conversation_t *conv)
+{
+	return conv->lru_prev != NULL || conversation_lru_for(conv)->head == conv;
+}
+
+/*
+ * Note that a conversation has been used by the current frame.
+ */
+static void
+conversation_touch(conversation_t *conv)
+{
+	if (!conversation_eviction)
+		return;
+	if (!conversation_on_lru(conv) || conversation_lru_for(conv)->tail == conv)
+		return;
+	conversation_lru_unlink(conv);
+	conversation_lru_append(conv);
+}
+
+/*
+ * Take a conversation off its eviction list, so that it's kept until
+ * the end of the file.
+ */
+static void
+conversation_keep(conversation_t *conv)
+{
+	if (!conversation_eviction || !conversation_on_lru(conv))
+		return;
+	conversation_lru_unlink(conv);
+	conversation_evicted.current--;
+	conversation_evicted.kept++;
+}
+
+void
+conversation_set_idle_timeout(const endpoint_type etype, const guint seconds)
+{
+	DISSECTOR_ASSERT((guint)etype < NUM_ENDPOINT_TYPES);
+	conversation_lru[etype].idle_timeout.secs = seconds;
+	conversation_lru[etype].idle_timeout.nsecs = 0;
+	if (seconds != 0)
+		conversation_eviction = TRUE;
+}
+
+void
+conversation_set_idle_timeout_all(const guint seconds)
+{
+	guint i;
+
+	for (i = 0; i < NUM_ENDPOINT_TYPES; i++)
+		conversation_set_idle_timeout((endpoint_type)i, seconds);
+}
+
+void
+conversation_set_max_conversations(const guint max_conversations)
+{
+	conversation_max = max_conversations;
+	if (max_conversations != 0)
+		conversation_eviction = TRUE;
+}
+
+void
+conversation_register_proto_data_free(const int proto, GDestroyNotify free_func)
+{
+	conversation_proto_data_free_t *entry;
+
+	if (conversation_proto_data_free_funcs == NULL)
+		conversation_proto_data_free_funcs = wmem_map_new(wmem_epan_scope(), g_direct_hash, g_direct_equal);
+	entry = wmem_new(wmem_epan_scope(), conversation_proto_data_free_t);
+	entry->free_func = free_func;
+	wmem_map_insert(conversation_proto_data_free_funcs, GINT_TO_POINTER(proto), entry);
+}
+
+void
+conversation_register_evictable_endpoint(const endpoint_type etype)
+{
+	DISSECTOR_ASSERT((guint)etype < NUM_ENDPOINT_TYPES);
+	conversation_evictable[etype] = TRUE;
+}
+
+gboolean
+conversation_eviction_enabled(void)
+{
+	return conversation_eviction;
+}
+
+void
+conversation_get_eviction_stats(conversation_eviction_stats_t *stats)
+{
+	*stats = conversation_evicted;
+}
+
+gboolean
+conversation_endpoint_type_from_name(const char *name, endpoint_type *etype)
+{
+	guint i;
+
+	for (i = 0; i < NUM_ENDPOINT_TYPES; i++) {
+		if (g_ascii_strcasecmp(name, endpoint_type_names[i]) == 0) {
+			*etype = (endpoint_type)i;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 /**
  * Create a new hash tables for conversations.
  */
@@ -476,10 +673,21 @@ conversation_init(void)
  */
 void conversation_epan_reset(void)
 {
+	guint i;
+
 	/*
 	 * Start the conversation indices over at 0.
 	 */
 	new_index = 0;
+
+	/*
+	 * The conversations on the eviction lists were freed along with
+	 * the rest of the previous file's data.
+	 */
+	for (i = 0; i < NUM_ENDPOINT_TYPES; i++)
+		conversation_lru[i].head = conversation_lru[i].tail = NULL;
+	memset(&conversation_evicted, 0, sizeof conversation_evicted);
+	nstime_set_zero(&conversation_now);
 }
 
 /*
@@ -600,6 +808,116 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 	}
 }
 
+static wmem_map_t *
+conversation_hashtable_for_options(const guint options)
+{
+	if (options & NO_ADDR2) {
+		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
+			return conversation_hashtable_no_addr2_or_port2;
+		} else {
+			return conversation_hashtable_no_addr2;
+		}
+	} else {
+		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
+			return conversation_hashtable_no_port2;
+		} else {
+			return conversation_hashtable_exact;
+		}
+	}
+}
+
+static gboolean
+conversation_free_proto_data(const void *key, void *value, void *userdata _U_)
+{
+	conversation_proto_data_free_t *entry;
+
+	entry = (conversation_proto_data_free_t *)wmem_map_lookup(conversation_proto_data_free_funcs, key);
+	if (entry != NULL)
+		entry->free_func(value);
+	return FALSE;
+}
+
+/*
+ * Remove an evicted conversation from its hash table and free it.
+ */
+static void
+conversation_free(conversation_t *conv)
+{
+	wmem_map_t *hashtable = conversation_hashtable_for_options(conv->options);
+	conversation_t *chain_head;
+
+	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
+	if (chain_head != NULL) {
+		conversation_remove_from_hashtable(hashtable, conv);
+		if (chain_head == conv && conv->next != NULL) {
+			/*
+			 * The new head of the chain was inserted under
+			 * our key, which is about to be freed; use its own.
+			 */
+			wmem_map_remove(hashtable, conv->key_ptr);
+			wmem_map_insert(hashtable, conv->next->key_ptr, conv->next);
+		}
+	}
+
+	conversation_lru_unlink(conv);
+	conversation_evicted.current--;
+
+	if (conv->data_list != NULL) {
+		if (conversation_proto_data_free_funcs != NULL)
+			wmem_tree_foreach(conv->data_list, conversation_free_proto_data, NULL);
+		wmem_tree_destroy(conv->data_list, FALSE, FALSE);
+	}
+	/* A template's dissector tree is shared with the conversations
+	 * created from it */
+	if (!conv->shares_dissector_tree && !(conv->options & CONVERSATION_TEMPLATE))
+		wmem_tree_destroy(conv->dissector_tree, FALSE, FALSE);
+	free_address_wmem(wmem_file_scope(), &conv->key_ptr->addr1);
+	free_address_wmem(wmem_file_scope(), &conv->key_ptr->addr2);
+	wmem_free(wmem_file_scope(), conv->key_ptr);
+	wmem_free(wmem_file_scope(), conv);
+}
+
+void
+conversation_evict(const nstime_t *now)
+{
+	conversation_lru_t *lru, *oldest;
+	nstime_t idle;
+	guint i;
+
+	if (!conversation_eviction)
+		return;
+
+	if (now != NULL)
+		conversation_now = *now;
+
+	/* Free the conversations that have been idle for too long */
+	for (i = 0; i < NUM_ENDPOINT_TYPES; i++) {
+		lru = &conversation_lru[i];
+		if (nstime_is_zero(&lru->idle_timeout))
+			continue;
+		while (lru->head != NULL) {
+			nstime_delta(&idle, &conversation_now, &lru->head->last_time);
+			if (nstime_cmp(&idle, &lru->idle_timeout) <= 0)
+				break;
+			conversation_free(lru->head);
+			conversation_evicted.idle_evicted++;
+		}
+	}
+
+	/* If there are still too many, free the least recently used ones */
+	while (conversation_max != 0 && conversation_evicted.current > conversation_max) {
+		oldest = NULL;
+		for (i = 0; i < NUM_ENDPOINT_TYPES; i++) {
+			lru = &conversation_lru[i];
+			if (lru->head != NULL && (oldest == NULL ||
+			    nstime_cmp(&lru->head->last_time, &oldest->head->last_time) < 0))
+				oldest = lru;
+		}
+		conversation_free(oldest->head);
+		conversation_evicted.lru_evicted++;
+	}
+}
+
 /*
  * Given two address/port pairs for a packet, create a new conversation
  * to contain packets between those address/port pairs.
@@ -624,19 +942,7 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 		    setup_frame, address_to_str(wmem_packet_scope(), addr1), port1,
 		    address_to_str(wmem_packet_scope(), addr2), port2, etype));
 
-	if (options & NO_ADDR2) {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_addr2_or_port2;
-		} else {
-			hashtable = conversation_hashtable_no_addr2;
-		}
-	} else {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_port2;
-		} else {
-			hashtable = conversation_hashtable_exact;
-		}
-	}
+	hashtable = conversation_hashtable_for_options(options);
 
 	new_key = wmem_new(wmem_file_scope(), struct conversation_key);
 	if (addr1 != NULL) {
@@ -672,6 +978,12 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	conversation_insert_into_hashtable(hashtable, conversation);
 	DENDENT();
 
+	if (conversation_eviction && (guint)etype < NUM_ENDPOINT_TYPES &&
+	    conversation_evictable[etype]) {
+		conversation_lru_append(conversation);
+		conversation_evicted.current++;
+	}
+
 	return conversation;
 }
 
@@ -737,18 +1049,10 @@ conversation_set_addr2(conversation_t *conv, const address *addr)
 		return;
 
 	DINDENT();
-	if (conv->options & NO_PORT2) {
-		conversation_remove_from_hashtable(conversation_hashtable_no_addr2_or_port2, conv);
-	} else {
-		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
-	}
+	conversation_remove_from_hashtable(conversation_hashtable_for_options(conv->options), conv);
 	conv->options &= ~NO_ADDR2;
 	copy_address_wmem(wmem_file_scope(), &conv->key_ptr->addr2, addr);
-	if (conv->options & NO_PORT2) {
-		conversation_insert_into_hashtable(conversation_hashtable_no_port2, conv);
-	} else {
-		conversation_insert_into_hashtable(conversation_hashtable_exact, conv);
-	}
+	conversation_insert_into_hashtable(conversation_hashtable_for_options(conv->options), conv);
 	DENDENT();
 }
 
@@ -788,8 +1092,10 @@ conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, co
 	if (chain_head && (chain_head->setup_frame <= frame_num)) {
 		match = chain_head;
 
-		if((chain_head->last)&&(chain_head->last->setup_frame<=frame_num))
+		if((chain_head->last)&&(chain_head->last->setup_frame<=frame_num)) {
+			conversation_touch(chain_head->last);
 			return chain_head->last;
+		}
 
 		if((chain_head->latest_found)&&(chain_head->latest_found->setup_frame<=frame_num))
 			match = chain_head->latest_found;
@@ -801,8 +1107,10 @@ conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, co
 		}
 	}
 
-	if (match)
+	if (match) {
 		chain_head->latest_found = match;
+		conversation_touch(match);
+	}
 
 	return match;
 }
@@ -1195,6 +1503,11 @@ conversation_add_proto_data(conversation_t *conv, const int proto, void *proto_d
 		conv->data_list = wmem_tree_new(wmem_file_scope());
 
 	wmem_tree_insert32(conv->data_list, proto, proto_data);
+
+	/* We couldn't free it if we evicted the conversation */
+	if (conversation_eviction && (conversation_proto_data_free_funcs == NULL ||
+	    wmem_map_lookup(conversation_proto_data_free_funcs, GINT_TO_POINTER(proto)) == NULL))
+		conversation_keep(conv);
 }
 
 void *
@@ -1219,6 +1532,9 @@ conversation_set_dissector_from_frame_number(conversation_t *conversation,
 	const guint32 starting_frame_num, const dissector_handle_t handle)
 {
 	wmem_tree_insert32(conversation->dissector_tree, starting_frame_num, (void *)handle);
+
+	/* Whoever set it may be holding on to the conversation */
+	conversation_keep(conversation);
 }
 
 void
@@ -100,6 +100,10 @@ typedef struct conversation {
 								/** tree containing protocol dissector client associated with conversation */
 	guint	options;			/** wildcard flags */
 	conversation_key_t key_ptr;	/** pointer to the key for this conversation */
+	nstime_t last_time;		/** time of the latest frame in this conversation; only set when eviction is enabled */
+	struct conversation *lru_prev;	/** previous (less recently used) conversation on the eviction list */
+	struct conversation *lru_next;	/** next (more recently used) conversation on the eviction list */
+	gboolean shares_dissector_tree;	/** dissector_tree belongs to the template this was created from */
 } conversation_t;
 
 
@@ -247,6 +251,89 @@ wmem_map_t * get_conversation_hashtable_no_port2(void);
 WS_DLL_PUBLIC
 wmem_map_t *get_conversation_hashtable_no_addr2_or_port2(void);
 
+/**
+ * Conversation eviction statistics.
+ */
+typedef struct {
+	guint64 idle_evicted;		/** conversations freed because they were idle for too long */
+	guint64 lru_evicted;		/** least recently used conversations freed because there were too many */
+	guint	current;		/** conversations currently on the eviction lists */
+	guint64 kept;			/** conversations taken off the eviction lists, to be kept until the end of the file */
+} conversation_eviction_stats_t;
+
+/**
+ * Free conversations that haven't been seen for the given number of
+ * seconds of capture time, if they're of the given endpoint type.
+ * A timeout of 0, the default, means they're never freed for being idle.
+ *
+ * Eviction is meant for long-running single-pass captures, such as
+ * "tshark -i", that would otherwise keep every conversation they ever
+ * saw; it must be set up before the first frame is dissected, and
+ * can't be used if frames are dissected more than once, as a freed
+ * conversation can't be found again when an earlier frame is revisited.
+ *
+ * Only conversations of endpoint types registered with
+ * conversation_register_evictable_endpoint() are freed, and not those
+ * that have had their dissector set, or data attached by a protocol
+ * that hasn't registered a routine to free it.
+ */
+WS_DLL_PUBLIC void conversation_set_idle_timeout(const endpoint_type etype, const guint seconds);
+
+/**
+ * Set the idle timeout for conversations of every endpoint type.
+ */
+WS_DLL_PUBLIC void conversation_set_idle_timeout_all(const guint seconds);
+
+/**
+ * Free the least recently used conversations when there are more than
+ * the given number of them; 0, the default, means there's no limit.
+ * The same restrictions apply as for conversation_set_idle_timeout().
+ */
+WS_DLL_PUBLIC void conversation_set_max_conversations(const guint max_conversations);
+
+/**
+ * Register a routine to free a protocol's data, as added with
+ * conversation_add_proto_data(), when a conversation is evicted.
+ * Without one, a conversation the protocol adds data to isn't evicted.
+ *
+ * A freed conversation's memory can be reused for a new conversation,
+ * so a protocol that keys its own tables on conversation pointers must
+ * also remove its entries for the conversation here; it can keep a list
+ * of them in its conversation data while conversation_eviction_enabled()
+ * is TRUE.
+ */
+WS_DLL_PUBLIC void conversation_register_proto_data_free(const int proto, GDestroyNotify free_func);
+
+/**
+ * Allow conversations of an endpoint type to be evicted.  The dissector
+ * for the endpoint type calls this if it doesn't hold on to pointers to
+ * its conversations, other than in data freed by the routine it
+ * registers with conversation_register_proto_data_free().
+ */
+WS_DLL_PUBLIC void conversation_register_evictable_endpoint(const endpoint_type etype);
+
+/**
+ * Returns TRUE if conversations can be evicted.
+ */
+WS_DLL_PUBLIC gboolean conversation_eviction_enabled(void);
+
+/**
+ * Get the number of conversations evicted so far in this file.
+ */
+WS_DLL_PUBLIC void conversation_get_eviction_stats(conversation_eviction_stats_t *stats);
+
+/**
+ * Look up an endpoint type by its name (e.g. "tcp"), for command-line
+ * options.  Returns FALSE if there's no such endpoint type.
+ */
+WS_DLL_PUBLIC gboolean conversation_endpoint_type_from_name(const char *name, endpoint_type *etype);
+
+/**
+ * Free the conversations that are due to be evicted; called before each
+ * frame is first dissected, with the frame's time, or NULL if it has none.
+ */
+extern void conversation_evict(const nstime_t *now);
+
 /* Temporary function to handle port_type to endpoint_type conversion
    For now it's a 1-1 mapping, but the intention is to remove
    many of the port_type instances in favor of endpoint_type
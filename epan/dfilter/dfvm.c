@@ -8,6 +8,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "dfvm.h"
 
 #include <ftypes/ftypes-int.h>
@@ -72,6 +74,47 @@ dfvm_value_new(dfvm_value_type_t type)
 	return v;
 }
 
+static const char *
+field_cmp_name(dfvm_opcode_t op)
+{
+	switch (op) {
+		case FIELD_CMP_UINT:
+			return "FIELD_CMP_UINT";
+		case FIELD_CMP_SINT:
+			return "FIELD_CMP_SINT";
+		case FIELD_CMP_IPV4:
+			return "FIELD_CMP_IPV4";
+		case FIELD_CMP_BYTES:
+			return "FIELD_CMP_BYTES";
+		default:
+			g_assert_not_reached();
+			return NULL;
+	}
+}
+
+static const char *
+relation_name(dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_EQ:
+			return "==";
+		case ANY_NE:
+			return "!=";
+		case ANY_GT:
+			return ">";
+		case ANY_GE:
+			return ">=";
+		case ANY_LT:
+			return "<";
+		case ANY_LE:
+			return "<=";
+		case ANY_BITWISE_AND:
+			return "&";
+		default:
+			g_assert_not_reached();
+			return NULL;
+	}
+}
 
 void
 dfvm_dump(FILE *f, dfilter_t *df)
@@ -119,6 +162,10 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case FIELD_CMP_UINT:
+			case FIELD_CMP_SINT:
+			case FIELD_CMP_IPV4:
+			case FIELD_CMP_BYTES:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -259,6 +306,17 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					arg3->value.numeric);
 				break;
 
+			case FIELD_CMP_UINT:
+			case FIELD_CMP_SINT:
+			case FIELD_CMP_IPV4:
+			case FIELD_CMP_BYTES:
+				fprintf(f, "%05d %s\t%s %s reg#%u\n",
+					id, field_cmp_name(insn->op),
+					arg1->value.hfinfo->abbrev,
+					relation_name((dfvm_opcode_t)arg3->value.numeric),
+					arg2->value.numeric);
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -400,6 +458,157 @@ any_in_range(dfilter_t *df, int reg1, int reg2, int reg3)
 	return FALSE;
 }
 
+/* The FIELD_CMP_xxx tests: like READ_TREE followed by ANY_xxx against a
+ * constant, but without building the register list of fvalues and without
+ * calling through the ftype's comparison functions. The field's absence
+ * makes the test fail, as with the IF_FALSE_GOTO following READ_TREE. */
+#define FIELD_CMP_FOREACH(tree, hfinfo, fv, test)				\
+	G_STMT_START {								\
+		header_field_info	*hfi_;					\
+		GPtrArray		*finfos_;				\
+		guint			i_;					\
+										\
+		for (hfi_ = (hfinfo); hfi_; hfi_ = hfi_->same_name_next) {	\
+			finfos_ = proto_get_finfo_ptr_array((tree), hfi_->id);	\
+			if (finfos_ == NULL)					\
+				continue;					\
+			for (i_ = 0; i_ < finfos_->len; i_++) {			\
+				const fvalue_t *fv = &((field_info *)		\
+					g_ptr_array_index(finfos_, i_))->value;	\
+				if (test)					\
+					return TRUE;				\
+			}							\
+		}								\
+	} G_STMT_END
+
+static gboolean
+field_cmp_uint(proto_tree *tree, header_field_info *hfinfo, dfvm_opcode_t op, guint32 val)
+{
+	switch (op) {
+		case ANY_EQ:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.uinteger == val);
+			break;
+		case ANY_NE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.uinteger != val);
+			break;
+		case ANY_GT:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.uinteger > val);
+			break;
+		case ANY_GE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.uinteger >= val);
+			break;
+		case ANY_LT:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.uinteger < val);
+			break;
+		case ANY_LE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.uinteger <= val);
+			break;
+		case ANY_BITWISE_AND:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, (fv->value.uinteger & val) != 0);
+			break;
+		default:
+			g_assert_not_reached();
+	}
+	return FALSE;
+}
+
+static gboolean
+field_cmp_sint(proto_tree *tree, header_field_info *hfinfo, dfvm_opcode_t op, gint32 val)
+{
+	switch (op) {
+		case ANY_EQ:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.sinteger == val);
+			break;
+		case ANY_NE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.sinteger != val);
+			break;
+		case ANY_GT:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.sinteger > val);
+			break;
+		case ANY_GE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.sinteger >= val);
+			break;
+		case ANY_LT:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.sinteger < val);
+			break;
+		case ANY_LE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, fv->value.sinteger <= val);
+			break;
+		case ANY_BITWISE_AND:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, (fv->value.uinteger & (guint32)val) != 0);
+			break;
+		default:
+			g_assert_not_reached();
+	}
+	return FALSE;
+}
+
+/* Same semantics as the comparisons in ftype-ipv4.c: the less restrictive
+ * of the two netmasks applies to both addresses. */
+#define IPV4_MASKED(fv, c, op)								\
+	(((fv)->value.ipv4.addr & MIN((fv)->value.ipv4.nmask, (c)->nmask)) op		\
+	 ((c)->addr & MIN((fv)->value.ipv4.nmask, (c)->nmask)))
+
+static gboolean
+field_cmp_ipv4(proto_tree *tree, header_field_info *hfinfo, dfvm_opcode_t op, const ipv4_addr_and_mask *c)
+{
+	guint32 c_masked = c->addr & c->nmask;
+
+	switch (op) {
+		case ANY_EQ:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, IPV4_MASKED(fv, c, ==));
+			break;
+		case ANY_NE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, IPV4_MASKED(fv, c, !=));
+			break;
+		case ANY_GT:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, IPV4_MASKED(fv, c, >));
+			break;
+		case ANY_GE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, IPV4_MASKED(fv, c, >=));
+			break;
+		case ANY_LT:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, IPV4_MASKED(fv, c, <));
+			break;
+		case ANY_LE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv, IPV4_MASKED(fv, c, <=));
+			break;
+		case ANY_BITWISE_AND:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv,
+				((fv->value.ipv4.addr & fv->value.ipv4.nmask) & c_masked) != 0);
+			break;
+		default:
+			g_assert_not_reached();
+	}
+	return FALSE;
+}
+
+static gboolean
+field_cmp_bytes(proto_tree *tree, header_field_info *hfinfo, dfvm_opcode_t op, const GByteArray *c)
+{
+	switch (op) {
+		case ANY_EQ:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv,
+				fv->value.bytes->len == c->len &&
+				memcmp(fv->value.bytes->data, c->data, c->len) == 0);
+			break;
+		case ANY_NE:
+			FIELD_CMP_FOREACH(tree, hfinfo, fv,
+				fv->value.bytes->len != c->len ||
+				memcmp(fv->value.bytes->data, c->data, c->len) != 0);
+			break;
+		default:
+			g_assert_not_reached();
+	}
+	return FALSE;
+}
+
+/* The constant operand of a FIELD_CMP_xxx instruction. */
+static const fvalue_t *
+field_cmp_const(dfilter_t *df, dfvm_value_t *reg)
+{
+	return (const fvalue_t *)df->registers[reg->value.numeric]->data;
+}
 
 static void
 free_owned_register(gpointer data, gpointer user_data _U_)
@@ -579,6 +788,30 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg3->value.numeric);
 				break;
 
+			case FIELD_CMP_UINT:
+				accum = field_cmp_uint(tree, arg1->value.hfinfo,
+						(dfvm_opcode_t)insn->arg3->value.numeric,
+						insn->arg4->value.numeric);
+				break;
+
+			case FIELD_CMP_SINT:
+				accum = field_cmp_sint(tree, arg1->value.hfinfo,
+						(dfvm_opcode_t)insn->arg3->value.numeric,
+						(gint32)insn->arg4->value.numeric);
+				break;
+
+			case FIELD_CMP_IPV4:
+				accum = field_cmp_ipv4(tree, arg1->value.hfinfo,
+						(dfvm_opcode_t)insn->arg3->value.numeric,
+						&field_cmp_const(df, arg2)->value.ipv4);
+				break;
+
+			case FIELD_CMP_BYTES:
+				accum = field_cmp_bytes(tree, arg1->value.hfinfo,
+						(dfvm_opcode_t)insn->arg3->value.numeric,
+						field_cmp_const(df, arg2)->value.bytes);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -654,6 +887,10 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case FIELD_CMP_UINT:
+			case FIELD_CMP_SINT:
+			case FIELD_CMP_IPV4:
+			case FIELD_CMP_BYTES:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -60,7 +60,18 @@ typedef enum {
 	ANY_MATCHES,
 	MK_RANGE,
 	CALL_FUNCTION,
-	ANY_IN_RANGE
+	ANY_IN_RANGE,
+
+	/* Relations between a field and a constant of a simple type,
+	 * selected in gencode.c instead of READ_TREE + ANY_xxx: they
+	 * walk the field's finfos directly and compare the values
+	 * inline. arg1 is the HFINFO, arg2 the REGISTER holding the
+	 * constant, arg3 the ANY_xxx opcode of the relation, and arg4
+	 * (for integers) the constant itself as an INTEGER. */
+	FIELD_CMP_UINT,
+	FIELD_CMP_SINT,
+	FIELD_CMP_IPV4,
+	FIELD_CMP_BYTES
 
 } dfvm_opcode_t;
 
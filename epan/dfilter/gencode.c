@@ -252,12 +252,118 @@ gen_relation_regs(dfwork_t *dfw, dfvm_opcode_t op, int reg1, int reg2)
 	dfw_append_insn(dfw, insn);
 }
 
+/* Which FIELD_CMP_xxx instruction, if any, can compare values of ftype
+ * with op inline. */
+static gboolean
+field_cmp_opcode(ftenum_t ftype, dfvm_opcode_t op, dfvm_opcode_t *cmp_op)
+{
+	switch (ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+			*cmp_op = FIELD_CMP_UINT;
+			return TRUE;
+
+		case FT_FRAMENUM:
+			*cmp_op = FIELD_CMP_UINT;
+			return op != ANY_BITWISE_AND;
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			*cmp_op = FIELD_CMP_SINT;
+			return TRUE;
+
+		case FT_IPv4:
+			*cmp_op = FIELD_CMP_IPV4;
+			return TRUE;
+
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_ETHER:
+			*cmp_op = FIELD_CMP_BYTES;
+			return op == ANY_EQ || op == ANY_NE;
+
+		default:
+			return FALSE;
+	}
+}
+
+/* Generates a FIELD_CMP_xxx instruction for "field <op> constant" when all
+ * the fields of that name and the constant have a type that can be compared
+ * inline. Returns FALSE if the generic code has to be used. */
+static gboolean
+gen_relation_field_cmp(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	header_field_info	*hfinfo, *hfi;
+	fvalue_t		*fv;
+	dfvm_opcode_t		cmp_op, other_op;
+	dfvm_insn_t		*insn;
+	dfvm_value_t		*val;
+
+	if (stnode_type_id(st_arg1) != STTYPE_FIELD ||
+			stnode_type_id(st_arg2) != STTYPE_FVALUE)
+		return FALSE;
+
+	hfinfo = (header_field_info*)stnode_data(st_arg1);
+	fv = (fvalue_t *)stnode_data(st_arg2);
+
+	/* Rewind to find the first field of this name. */
+	while (hfinfo->same_name_prev_id != -1) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	}
+
+	if (!field_cmp_opcode(fvalue_type_ftenum(fv), op, &cmp_op))
+		return FALSE;
+	for (hfi = hfinfo; hfi; hfi = hfi->same_name_next) {
+		if (!field_cmp_opcode(hfi->type, op, &other_op) || other_op != cmp_op)
+			return FALSE;
+	}
+
+	insn = dfvm_insn_new(cmp_op);
+	val = dfvm_value_new(HFINFO);
+	val->value.hfinfo = hfinfo;
+	insn->arg1 = val;
+	val = dfvm_value_new(REGISTER);
+	val->value.numeric = dfw_append_put_fvalue(dfw, fv);
+	insn->arg2 = val;
+	val = dfvm_value_new(INTEGER);
+	val->value.numeric = op;
+	insn->arg3 = val;
+	if (cmp_op == FIELD_CMP_UINT) {
+		val = dfvm_value_new(INTEGER);
+		val->value.numeric = fvalue_get_uinteger(fv);
+		insn->arg4 = val;
+	}
+	else if (cmp_op == FIELD_CMP_SINT) {
+		val = dfvm_value_new(INTEGER);
+		val->value.numeric = (guint32)fvalue_get_sinteger(fv);
+		insn->arg4 = val;
+	}
+	dfw_append_insn(dfw, insn);
+
+	/* Record the FIELD_ID in hash of interesting fields. */
+	for (hfi = hfinfo; hfi; hfi = hfi->same_name_next) {
+		g_hash_table_insert(dfw->interesting_fields,
+			GINT_TO_POINTER(hfi->id),
+			GUINT_TO_POINTER(TRUE));
+	}
+
+	return TRUE;
+}
+
 static void
 gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
 {
 	dfvm_value_t	*jmp1 = NULL, *jmp2 = NULL;
 	int		reg1 = -1, reg2 = -1;
 
+	if (gen_relation_field_cmp(dfw, op, st_arg1, st_arg2))
+		return;
+
 	/* Create code for the LHS and RHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 	reg2 = gen_entity(dfw, st_arg2, &jmp2);
@@ -450,6 +556,17 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 			break;
 
 		case TEST_OP_NOT:
+			/* Fold "not not X" into "X". */
+			if (stnode_type_id(st_arg1) == STTYPE_TEST) {
+				test_op_t	inner_op;
+				stnode_t	*inner_arg1, *inner_arg2;
+
+				sttype_test_get(st_arg1, &inner_op, &inner_arg1, &inner_arg2);
+				if (inner_op == TEST_OP_NOT) {
+					gencode(dfw, inner_arg1);
+					break;
+				}
+			}
 			gencode(dfw, st_arg1);
 			insn = dfvm_insn_new(NOT);
 			dfw_append_insn(dfw, insn);
@@ -0,0 +1,192 @@
+/* dissector_profile.c
+ * Routines for measuring how much time and memory each protocol's
+ * dissectors use
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <glib.h>
+#include "packet.h"
+
+#include "dissector_profile.h"
+
+
+gboolean dissector_profile_active = FALSE;
+
+/* dissector_profile_t for each protocol called, by protocol ID */
+static GHashTable *profiles = NULL;
+
+/* The innermost call being profiled */
+static dissector_profile_frame_t *current_frame = NULL;
+
+/* Monotonic time in nanoseconds */
+static guint64
+profile_now(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (guint64)(now.QuadPart / freq.QuadPart) * G_GUINT64_CONSTANT(1000000000) +
+        (guint64)(now.QuadPart % freq.QuadPart) * G_GUINT64_CONSTANT(1000000000) / (guint64)freq.QuadPart;
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (guint64)now.tv_sec * G_GUINT64_CONSTANT(1000000000) + (guint64)now.tv_nsec;
+#endif
+}
+
+/* wmem memory allocated so far for the packet being dissected */
+static guint64
+profile_bytes(packet_info *pinfo)
+{
+    return wmem_get_alloc_bytes(wmem_packet_scope()) +
+        wmem_get_alloc_bytes(wmem_file_scope()) +
+        wmem_get_alloc_bytes(pinfo->pool);
+}
+
+void
+dissector_profile_start(void)
+{
+    if (profiles == NULL)
+        profiles = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    else
+        g_hash_table_remove_all(profiles);
+
+    current_frame = NULL;
+    dissector_profile_active = TRUE;
+}
+
+void
+dissector_profile_stop(void)
+{
+    dissector_profile_active = FALSE;
+}
+
+gboolean
+dissector_profile_is_active(void)
+{
+    return dissector_profile_active;
+}
+
+static gint
+compare_excl_ns(gconstpointer a, gconstpointer b)
+{
+    const dissector_profile_t *profile_a = *(const dissector_profile_t * const *)a;
+    const dissector_profile_t *profile_b = *(const dissector_profile_t * const *)b;
+
+    if (profile_a->excl_ns != profile_b->excl_ns)
+        return profile_a->excl_ns > profile_b->excl_ns ? -1 : 1;
+    return profile_a->proto_id - profile_b->proto_id;
+}
+
+GPtrArray *
+dissector_profile_get_results(void)
+{
+    GPtrArray *results = g_ptr_array_new();
+    GHashTableIter iter;
+    gpointer value;
+
+    if (profiles != NULL) {
+        g_hash_table_iter_init(&iter, profiles);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+            g_ptr_array_add(results, value);
+        g_ptr_array_sort(results, compare_excl_ns);
+    }
+    return results;
+}
+
+void
+dissector_profile_enter(dissector_profile_frame_t *frame, int proto_id,
+    packet_info *pinfo)
+{
+    dissector_profile_t *profile;
+
+    profile = (dissector_profile_t *)g_hash_table_lookup(profiles, GINT_TO_POINTER(proto_id));
+    if (profile == NULL) {
+        profile = g_new0(dissector_profile_t, 1);
+        profile->proto_id = proto_id;
+        g_hash_table_insert(profiles, GINT_TO_POINTER(proto_id), profile);
+    }
+
+    frame->parent = current_frame;
+    frame->profile = profile;
+    frame->child_ns = 0;
+    frame->child_bytes = 0;
+    profile->calls++;
+    profile->active++;
+    current_frame = frame;
+
+    frame->start_bytes = profile_bytes(pinfo);
+    frame->start_ns = profile_now();
+}
+
+void
+dissector_profile_leave(dissector_profile_frame_t *frame, packet_info *pinfo)
+{
+    guint64 elapsed = profile_now() - frame->start_ns;
+    guint64 bytes = profile_bytes(pinfo) - frame->start_bytes;
+    dissector_profile_t *profile = frame->profile;
+
+    /* If a protocol's dissector is called from inside itself, only
+     * count the outermost call in its inclusive time */
+    profile->active--;
+    if (profile->active == 0)
+        profile->incl_ns += elapsed;
+    profile->excl_ns += elapsed - frame->child_ns;
+    profile->excl_bytes += bytes - frame->child_bytes;
+
+    current_frame = frame->parent;
+    if (current_frame != NULL) {
+        current_frame->child_ns += elapsed;
+        current_frame->child_bytes += bytes;
+    }
+}
+
+void
+dissector_profile_heur_result(dissector_profile_frame_t *frame, gboolean accepted)
+{
+    frame->profile->heur_tries++;
+    if (accepted)
+        frame->profile->heur_accepts++;
+}
+
+void
+dissector_profile_cleanup(void)
+{
+    dissector_profile_active = FALSE;
+    current_frame = NULL;
+    if (profiles != NULL) {
+        g_hash_table_destroy(profiles);
+        profiles = NULL;
+    }
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,104 @@
+/* dissector_profile.h
+ * Routines for measuring how much time and memory each protocol's
+ * dissectors use
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __DISSECTOR_PROFILE_H__
+#define __DISSECTOR_PROFILE_H__
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ * While profiling is on, every call of a protocol's dissector through a
+ * handle or a heuristic table is timed, and the wmem memory it allocates
+ * in the packet, file and pinfo scopes is counted. Time and memory are
+ * "inclusive" of the dissectors it calls, or "exclusive" of them.
+ *
+ * The profiler keeps one set of results for the whole program, so it
+ * should only be used with one dissection session at a time.
+ */
+
+/** What the profiler measured for a protocol */
+typedef struct dissector_profile_s {
+    int      proto_id;
+    guint64  calls;          /**< calls, including heuristic tries */
+    guint64  heur_tries;     /**< calls as a heuristic dissector */
+    guint64  heur_accepts;   /**< heuristic calls that accepted the packet */
+    guint64  incl_ns;        /**< time spent, including called dissectors */
+    guint64  excl_ns;        /**< time spent, excluding called dissectors */
+    guint64  excl_bytes;     /**< wmem memory allocated, excluding called dissectors */
+
+    /* For the profiler's use */
+    guint    active;         /**< number of calls in progress */
+} dissector_profile_t;
+
+/** Discard any results, and start profiling */
+WS_DLL_PUBLIC void dissector_profile_start(void);
+
+/** Stop profiling, keeping the results */
+WS_DLL_PUBLIC void dissector_profile_stop(void);
+
+/** Is profiling on? */
+WS_DLL_PUBLIC gboolean dissector_profile_is_active(void);
+
+/**
+ * Get the results, sorted by exclusive time, longest first.
+ * The array should be freed with g_ptr_array_free(); its elements belong to
+ * the profiler, and are valid until profiling is started again.
+ */
+WS_DLL_PUBLIC GPtrArray *dissector_profile_get_results(void);
+
+/*** THE FOLLOWING SHOULD NOT BE USED BY ANY DISSECTORS!!! ***/
+
+/* A call being profiled; it lives on the stack of the caller */
+typedef struct dissector_profile_frame_s {
+    struct dissector_profile_frame_s *parent;
+    dissector_profile_t *profile;
+    guint64  start_ns;
+    guint64  start_bytes;
+    guint64  child_ns;
+    guint64  child_bytes;
+} dissector_profile_frame_t;
+
+extern gboolean dissector_profile_active;
+
+/* Called by packet.c around a dissector call, whether or not it returns
+ * normally, if dissector_profile_active is set. */
+extern void dissector_profile_enter(dissector_profile_frame_t *frame,
+    int proto_id, struct _packet_info *pinfo);
+extern void dissector_profile_leave(dissector_profile_frame_t *frame,
+    struct _packet_info *pinfo);
+extern void dissector_profile_heur_result(dissector_profile_frame_t *frame,
+    gboolean accepted);
+
+/* Cleanup internal structures */
+extern void dissector_profile_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __DISSECTOR_PROFILE_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -681,6 +681,52 @@ static const guint8 TRAILER_SIGNATURE[] = {0x8a, 0xe3, 0x13, 0x71, 0x02, 0xf4, 0
 static tvbuff_t *tvb_trailer_signature = NULL;
 
 static GSList *decode_dcerpc_bindings = NULL;
+
+/*
+ * The keys of the bind and call tables are conversation pointers, and an
+ * evicted conversation's memory can be reused for a new one; so while
+ * conversations can be evicted, each conversation's data is a list of
+ * the keys that refer to it, to be removed from the tables when it is.
+ */
+typedef struct _dcerpc_conv_key {
+    wmem_map_t             *map;
+    void                   *key;
+    struct _dcerpc_conv_key *next;
+} dcerpc_conv_key;
+
+static void
+dcerpc_track_conv_key(conversation_t *conv, wmem_map_t *map, void *key)
+{
+    dcerpc_conv_key *conv_key;
+
+    if (conv == NULL || !conversation_eviction_enabled())
+        return;
+
+    conv_key = wmem_new(wmem_file_scope(), dcerpc_conv_key);
+    conv_key->map = map;
+    conv_key->key = key;
+    conv_key->next = (dcerpc_conv_key *)conversation_get_proto_data(conv, proto_dcerpc);
+    conversation_add_proto_data(conv, proto_dcerpc, conv_key);
+}
+
+static void
+dcerpc_free_conv_keys(gpointer data)
+{
+    dcerpc_conv_key *conv_key, *next;
+    const void      *orig_key;
+
+    for (conv_key = (dcerpc_conv_key *)data; conv_key != NULL; conv_key = next) {
+        next = conv_key->next;
+        /* A key that was replaced by an equal one is no longer in the
+         * table; the one that replaced it is on the list too */
+        if (wmem_map_lookup_extended(conv_key->map, conv_key->key, &orig_key, NULL) &&
+            orig_key == conv_key->key)
+            wmem_map_remove(conv_key->map, conv_key->key);
+        wmem_free(wmem_file_scope(), conv_key->key);
+        wmem_free(wmem_file_scope(), conv_key);
+    }
+}
+
 /*
  * To keep track of ctx_id mappings.
  *
@@ -777,6 +823,7 @@ dcerpc_add_conv_to_bind_table(decode_dcerpc_bind_values_t *binding)
 
     /* add this entry to the bind table */
     wmem_map_insert(dcerpc_binds, key, bind_value);
+    dcerpc_track_conv_key(conv, dcerpc_binds, key);
 
     return bind_value;
 
@@ -4096,6 +4143,7 @@ dissect_dcerpc_cn_bind(tvbuff_t *tvb, gint offset, packet_info *pinfo,
 
             /* add this entry to the bind table */
             wmem_map_insert(dcerpc_binds, key, value);
+            dcerpc_track_conv_key(conv, dcerpc_binds, key);
         }
 
         if (i > 0)
@@ -4604,6 +4652,7 @@ dissect_dcerpc_cn_rqst(tvbuff_t *tvb, gint offset, packet_info *pinfo,
                     }
 
                     wmem_map_insert(dcerpc_cn_calls, call_key, call_value);
+                    dcerpc_track_conv_key(conv, dcerpc_cn_calls, call_key);
 
                     new_matched_key = (dcerpc_matched_key *)wmem_alloc(wmem_file_scope(), sizeof (dcerpc_matched_key));
                     *new_matched_key = matched_key;
@@ -6144,6 +6193,7 @@ dissect_dcerpc_dg_rqst(tvbuff_t *tvb, int offset, packet_info *pinfo,
         call_value->flags = 0;
 
         wmem_map_insert(dcerpc_dg_calls, call_key, call_value);
+        dcerpc_track_conv_key(conv, dcerpc_dg_calls, call_key);
 
         new_matched_key = (dcerpc_matched_key *)wmem_alloc(wmem_file_scope(), sizeof(dcerpc_matched_key));
         new_matched_key->frame = pinfo->num;
@@ -7087,6 +7137,7 @@ proto_register_dcerpc(void)
     dcerpc_matched = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), dcerpc_matched_hash, dcerpc_matched_equal);
 
     register_init_routine(decode_dcerpc_inject_bindings);
+    conversation_register_proto_data_free(proto_dcerpc, dcerpc_free_conv_keys);
 
     dcerpc_module = prefs_register_protocol(proto_dcerpc, NULL);
     prefs_register_bool_preference(dcerpc_module,
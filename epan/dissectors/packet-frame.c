@@ -192,6 +192,8 @@ register_frame_end_routine(packet_info *pinfo, void (*func)(void))
 
 typedef void (*void_func_t)(void);
 
+static const nstime_t no_shift_offset = { 0, 0 };
+
 static void
 call_frame_end_routine(gpointer routine, gpointer dummy _U_)
 {
@@ -211,6 +213,7 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 	const gchar *cap_plurality, *frame_plurality;
 	frame_data_t *fr_data = (frame_data_t*)data;
 	const color_filter_t *color_filter;
+	const nstime_t *shift_offset;
 
 	tree=parent_tree;
 
@@ -456,8 +459,11 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 								  " the valid range is 0-1000000000",
 								  (long) pinfo->abs_ts.nsecs);
 			}
+			shift_offset = epan_get_frame_shift_offset(pinfo->epan, pinfo->fd);
+			if (shift_offset == NULL)
+				shift_offset = &no_shift_offset;
 			item = proto_tree_add_time(fh_tree, hf_frame_shift_offset, tvb,
-					    0, 0, &(pinfo->fd->shift_offset));
+					    0, 0, shift_offset);
 			PROTO_ITEM_SET_GENERATED(item);
 
 			if (generate_epoch_time) {
@@ -1714,6 +1714,11 @@ proto_register_stun(void)
 void
 proto_reg_handoff_stun(void)
 {
+    /* A STUN message over UDP has the magic cookie, and the heuristic
+       doesn't accept ChannelData messages */
+    static const guint8 stun_guard_mask[]  = { 0xC0, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF };
+    static const guint8 stun_guard_value[] = { 0x00, 0x00, 0x00, 0x00, 0x21, 0x12, 0xA4, 0x42 };
+
     stun_tcp_handle = create_dissector_handle(dissect_stun_tcp, proto_stun);
     stun_udp_handle = create_dissector_handle(dissect_stun_udp, proto_stun);
 
@@ -1721,6 +1726,7 @@ proto_reg_handoff_stun(void)
     dissector_add_uint_with_preference("udp.port", UDP_PORT_STUN, stun_udp_handle);
 
     heur_dissector_add("udp", dissect_stun_heur, "STUN over UDP", "stun_udp", proto_stun, HEURISTIC_ENABLE);
+    heur_dissector_set_guard("stun_udp", STUN_HDR_LEN, sizeof stun_guard_mask, stun_guard_mask, stun_guard_value);
 
     data_handle = find_dissector("data");
 }
@@ -1449,6 +1449,43 @@ init_tcp_conversation_data(packet_info *pinfo)
     return tcpd;
 }
 
+static void
+free_tcp_flow_data(tcp_flow_t *flow)
+{
+    tcp_unacked_t *ual, *next;
+
+    wmem_tree_destroy(flow->multisegment_pdus, FALSE, TRUE);
+    if (flow->tcp_analyze_seq_info) {
+        for (ual = flow->tcp_analyze_seq_info->segments; ual; ual = next) {
+            next = ual->next;
+            wmem_free(wmem_file_scope(), ual);
+        }
+        wmem_free(wmem_file_scope(), flow->tcp_analyze_seq_info);
+    }
+    if (flow->process_info) {
+        wmem_free(wmem_file_scope(), flow->process_info->username);
+        wmem_free(wmem_file_scope(), flow->process_info->command);
+        wmem_free(wmem_file_scope(), flow->process_info);
+    }
+}
+
+/* Free the data of an evicted conversation */
+static void
+free_tcp_conversation_data(gpointer data)
+{
+    struct tcp_analysis *tcpd = (struct tcp_analysis *)data;
+
+    /* MPTCP connections refer to their subflows' data, so leave it
+     * to be freed with the rest of the file's data */
+    if (tcpd->mptcp_analysis)
+        return;
+
+    free_tcp_flow_data(&tcpd->flow1);
+    free_tcp_flow_data(&tcpd->flow2);
+    wmem_tree_destroy(tcpd->acked_table, FALSE, TRUE);
+    wmem_free(wmem_file_scope(), tcpd);
+}
+
 /* setup meta as well */
 static void
 mptcp_init_subflow(tcp_flow_t *flow)
@@ -7567,6 +7604,8 @@ proto_register_tcp(void)
         &tcp_display_process_info);
 
     register_init_routine(tcp_init);
+    conversation_register_proto_data_free(proto_tcp, free_tcp_conversation_data);
+    conversation_register_evictable_endpoint(ENDPOINT_TCP);
     reassembly_table_register(&tcp_reassembly_table,
                           &addresses_ports_reassembly_table_functions);
 
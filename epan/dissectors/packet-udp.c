@@ -227,6 +227,19 @@ init_udp_conversation_data(void)
   return udpd;
 }
 
+/* Free the data of an evicted conversation */
+static void
+free_udp_conversation_data(gpointer data)
+{
+  struct udp_analysis *udpd = (struct udp_analysis *)data;
+
+  wmem_free(wmem_file_scope(), udpd->flow1.username);
+  wmem_free(wmem_file_scope(), udpd->flow1.command);
+  wmem_free(wmem_file_scope(), udpd->flow2.username);
+  wmem_free(wmem_file_scope(), udpd->flow2.command);
+  wmem_free(wmem_file_scope(), udpd);
+}
+
 struct udp_analysis *
 get_udp_conversation_data(conversation_t *conv, packet_info *pinfo)
 {
@@ -1264,6 +1277,8 @@ proto_register_udp(void)
                          udp_port_to_display, follow_tvb_tap_listener);
 
   register_init_routine(udp_init);
+  conversation_register_proto_data_free(proto_udp, free_udp_conversation_data);
+  conversation_register_evictable_endpoint(ENDPOINT_UDP);
 
 }
 
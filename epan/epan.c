@@ -52,6 +52,7 @@
 #include "disabled_protos.h"
 #include "decode_as.h"
 #include "dissector_filters.h"
+#include "dissector_profile.h"
 #include "conversation_table.h"
 #include "reassemble.h"
 #include "srt_table.h"
@@ -311,6 +312,7 @@ epan_cleanup(void)
 	prefs_cleanup();
 	decode_clear_all();
 	conversation_filters_cleanup();
+	dissector_profile_cleanup();
 	reassembly_table_cleanup();
 	tap_cleanup();
 	packet_cleanup();
@@ -374,6 +376,15 @@ epan_get_user_comment(const epan_t *session, const frame_data *fd)
 	return NULL;
 }
 
+const nstime_t *
+epan_get_frame_shift_offset(const epan_t *session, const frame_data *fd)
+{
+	if (session->funcs.get_frame_shift_offset)
+		return session->funcs.get_frame_shift_offset(session->prov, fd);
+
+	return NULL;
+}
+
 const char *
 epan_get_interface_name(const epan_t *session, guint32 interface_id)
 {
@@ -517,6 +528,13 @@ epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols)
 		proto_tree_set_fake_protocols(edt->tree, fake_protocols);
 }
 
+void
+epan_dissect_record_fields(epan_dissect_t *edt, const gboolean record_fields)
+{
+	if (edt && edt->tree)
+		proto_tree_set_record_fields(edt->tree, record_fields);
+}
+
 void
 epan_dissect_run(epan_dissect_t *edt, int file_type_subtype,
 	wtap_rec *rec, tvbuff_t *tvb, frame_data *fd,
@@ -753,6 +771,14 @@ epan_get_compiled_version_info(GString *str)
 	g_string_append(str, "without LZ4");
 #endif /* HAVE_LZ4 */
 
+	/* Zstandard */
+	g_string_append(str, ", ");
+#ifdef HAVE_ZSTD
+	g_string_append(str, "with Zstandard");
+#else
+	g_string_append(str, "without Zstandard");
+#endif /* HAVE_ZSTD */
+
 	/* Snappy */
 	g_string_append(str, ", ");
 #ifdef HAVE_SNAPPY
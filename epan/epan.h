@@ -44,6 +44,7 @@ struct packet_provider_funcs {
 	const char *(*get_interface_name)(struct packet_provider_data *prov, guint32 interface_id);
 	const char *(*get_interface_description)(struct packet_provider_data *prov, guint32 interface_id);
 	const char *(*get_user_comment)(struct packet_provider_data *prov, const frame_data *fd);
+	const nstime_t *(*get_frame_shift_offset)(struct packet_provider_data *prov, const frame_data *fd);
 };
 
 #ifdef HAVE_PLUGINS
@@ -154,6 +155,9 @@ WS_DLL_PUBLIC const char *epan_get_interface_description(const epan_t *session,
 
 const nstime_t *epan_get_frame_ts(const epan_t *session, guint32 frame_num);
 
+/** How much the time stamp of the frame has been shifted, or NULL if not shifted */
+WS_DLL_PUBLIC const nstime_t *epan_get_frame_shift_offset(const epan_t *session, const frame_data *fd);
+
 WS_DLL_PUBLIC void epan_free(epan_t *session);
 
 WS_DLL_PUBLIC const gchar*
@@ -194,6 +198,13 @@ WS_DLL_PUBLIC
 void
 epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols);
 
+/** Indicate whether the values of fields should only be recorded during
+ * dissection, and decoded when they're looked up; see
+ * proto_tree_set_record_fields(). Only for an invisible protocol tree. */
+WS_DLL_PUBLIC
+void
+epan_dissect_record_fields(epan_dissect_t *edt, const gboolean record_fields);
+
 /** run a single packet dissection */
 WS_DLL_PUBLIC
 void
@@ -166,6 +166,7 @@ frame_data_init(frame_data *fdata, guint32 num, const wtap_rec *rec,
   fdata->flags.ref_time = 0;
   fdata->flags.ignored = 0;
   fdata->flags.has_ts = (rec->presence_flags & WTAP_HAS_TS) ? 1 : 0;
+  fdata->flags.rec_type = rec->rec_type;
   switch (rec->rec_type) {
 
   case REC_TYPE_PACKET:
@@ -201,8 +202,6 @@ frame_data_init(frame_data *fdata, guint32 num, const wtap_rec *rec,
   fdata->flags.has_user_comment = 0;
   fdata->flags.need_colorize = 0;
   fdata->color_filter = NULL;
-  fdata->shift_offset.secs = 0;
-  fdata->shift_offset.nsecs = 0;
   fdata->frame_ref_num = 0;
   fdata->prev_dis_num = 0;
 }
@@ -47,7 +47,14 @@ typedef enum {
 
 /** The frame number is the ordinal number of the frame in the capture, so
    it's 1-origin.  In various contexts, 0 as a frame number means "frame
-   number unknown". */
+   number unknown".
+
+   Every frame of a capture has one of these, held in flat chunks by
+   frame_data_sequence; the time shift offset lives in a side table there.
+   pfd and color_filter are only touched when a frame is dissected or
+   drawn, but are still kept here, as frame_datas are copied by value
+   (e.g. from a stack frame_data into the sequence after a read filter
+   pass) and pfd has to travel with the copy. */
 struct _color_filter; /* Forward */
 DIAG_OFF(pedantic)
 typedef struct _frame_data {
@@ -72,12 +79,12 @@ typedef struct _frame_data {
     unsigned int has_phdr_comment : 1; /** 1 = there's comment for this packet */
     unsigned int has_user_comment : 1; /** 1 = user set (also deleted) comment for this packet */
     unsigned int need_colorize  : 1; /**< 1 = need to (re-)calculate packet color */
+    unsigned int rec_type       : 4; /**< REC_TYPE_ of the record the frame came from */
   } flags;
 
   const struct _color_filter *color_filter;  /**< Per-packet matching color_filter_t object */
 
   nstime_t     abs_ts;       /**< Absolute timestamp */
-  nstime_t     shift_offset; /**< How much the abs_tm of the frame is shifted */
   guint32      frame_ref_num; /**< Previous reference frame (0 if this is one) */
   guint32      prev_dis_num; /**< Previous displayed frame (0 if first one) */
 } frame_data;
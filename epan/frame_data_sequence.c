@@ -10,43 +10,42 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <epan/packet.h>
 
+#include <wsutil/file_util.h>
+#include <wsutil/frame_index.h>
+
 #include "frame_data_sequence.h"
 
 /*
- * We store the frame_data structures in a radix tree, with 1024
- * elements per level.  The leaf nodes are arrays of 1024 frame_data
- * structures; the nodes above them are arrays of 1024 pointers to
- * the nodes below them.  The capture_file structure has a pointer
- * to the root node.
+ * We store the frame_data structures in fixed-size chunks of 4096
+ * frame_data structures each, and keep a directory of pointers to
+ * the chunks that is grown by doubling it.  Frames never move once
+ * added, so pointers to them stay valid, and finding a frame is a
+ * single directory lookup whatever the size of the capture.
  *
- * As frame numbers are 32 bits, and as 1024 is 2^10, that gives us
- * up to 4 levels of tree.
+ * Fields that only a few frames have, or that are only used by a
+ * few features, are kept in side tables here rather than in every
+ * frame_data structure.
  */
-#define LOG2_NODES_PER_LEVEL    10
-#define NODES_PER_LEVEL         (1<<LOG2_NODES_PER_LEVEL)
+#define LOG2_FRAMES_PER_CHUNK   12
+#define FRAMES_PER_CHUNK        (1<<LOG2_FRAMES_PER_CHUNK)
+
+#define CHUNK_INDEX(idx)        ((idx) >> LOG2_FRAMES_PER_CHUNK)
+#define CHUNK_OFFSET(idx)       ((idx) & (FRAMES_PER_CHUNK - 1))
 
 struct _frame_data_sequence {
   guint32      count;           /* Total number of frames */
-  void        *ptree_root;      /* Pointer to the root node */
+  frame_data **chunks;          /* Directory of chunks */
+  guint32      chunks_alloc;    /* Number of entries allocated in the directory */
+  nstime_t    *shift_offsets;   /* Time shift of each frame, if any frame has been shifted */
+  guint32      shift_offsets_len; /* Number of entries in shift_offsets */
 };
 
-/*
- * For a given frame number, calculate the indices into a level 3
- * node, a level 2 node, a level 1 node, and a leaf node.
- */
-#define LEVEL_3_INDEX(framenum) \
-        ((framenum) >> (3*LOG2_NODES_PER_LEVEL))
-#define LEVEL_2_INDEX(framenum) \
-        (((framenum) >> (2*LOG2_NODES_PER_LEVEL)) & (NODES_PER_LEVEL - 1))
-#define LEVEL_1_INDEX(framenum) \
-        (((framenum) >> (1*LOG2_NODES_PER_LEVEL)) & (NODES_PER_LEVEL - 1))
-#define LEAF_INDEX(framenum) \
-        (((framenum) >> (0*LOG2_NODES_PER_LEVEL)) & (NODES_PER_LEVEL - 1))
-
 frame_data_sequence *
 new_frame_data_sequence(void)
 {
@@ -54,7 +53,10 @@ new_frame_data_sequence(void)
 
   fds = (frame_data_sequence *)g_malloc(sizeof *fds);
   fds->count = 0;
-  fds->ptree_root = NULL;
+  fds->chunks = NULL;
+  fds->chunks_alloc = 0;
+  fds->shift_offsets = NULL;
+  fds->shift_offsets_len = 0;
   return fds;
 }
 
@@ -64,10 +66,7 @@ new_frame_data_sequence(void)
 frame_data *
 frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
 {
-  frame_data *leaf;
-  frame_data **level1;
-  frame_data ***level2;
-  frame_data ****level3;
+  guint32 chunk = CHUNK_INDEX(fds->count);
   frame_data *node;
 
   /*
@@ -77,96 +76,16 @@ frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
    * the last frame in the collection is fds->count, so its index value
    * is fds->count - 1.
    */
-  if (fds->count == 0) {
-    /* The tree is empty; allocate the first leaf node, which will be
-       the root node. */
-    leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
-    node = &leaf[0];
-    fds->ptree_root = leaf;
-  } else if (fds->count < NODES_PER_LEVEL) {
-    /* It's a 1-level tree, and is going to stay that way for now. */
-    leaf = (frame_data *)fds->ptree_root;
-    node = &leaf[fds->count];
-  } else if (fds->count == NODES_PER_LEVEL) {
-    /* It's a 1-level tree that will turn into a 2-level tree. */
-    level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
-    level1[0] = (frame_data *)fds->ptree_root;
-    leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
-    level1[1] = leaf;
-    node = &leaf[0];
-    fds->ptree_root = level1;
-  } else if (fds->count < NODES_PER_LEVEL*NODES_PER_LEVEL) {
-    /* It's a 2-level tree, and is going to stay that way for now. */
-    level1 = (frame_data **)fds->ptree_root;
-    leaf = level1[fds->count >> LOG2_NODES_PER_LEVEL];
-    if (leaf == NULL) {
-      leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
-      level1[fds->count >> LOG2_NODES_PER_LEVEL] = leaf;
-    }
-    node = &leaf[LEAF_INDEX(fds->count)];
-  } else if (fds->count == NODES_PER_LEVEL*NODES_PER_LEVEL) {
-    /* It's a 2-level tree that will turn into a 3-level tree */
-    level2 = (frame_data ***)g_malloc0((sizeof *level2)*NODES_PER_LEVEL);
-    level2[0] = (frame_data **)fds->ptree_root;
-    level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
-    level2[1] = level1;
-    leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
-    level1[0] = leaf;
-    node = &leaf[0];
-    fds->ptree_root = level2;
-  } else if (fds->count < NODES_PER_LEVEL*NODES_PER_LEVEL*NODES_PER_LEVEL) {
-    /* It's a 3-level tree, and is going to stay that way for now. */
-    level2 = (frame_data ***)fds->ptree_root;
-    level1 = level2[fds->count >> (LOG2_NODES_PER_LEVEL+LOG2_NODES_PER_LEVEL)];
-    if (level1 == NULL) {
-      level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
-      level2[fds->count >> (LOG2_NODES_PER_LEVEL+LOG2_NODES_PER_LEVEL)] = level1;
-    }
-    leaf = level1[LEVEL_1_INDEX(fds->count)];
-    if (leaf == NULL) {
-      leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
-      level1[LEVEL_1_INDEX(fds->count)] = leaf;
+  if (CHUNK_OFFSET(fds->count) == 0) {
+    /* We need a new chunk; make sure the directory has room for it. */
+    if (chunk == fds->chunks_alloc) {
+      fds->chunks_alloc = fds->chunks_alloc ? fds->chunks_alloc * 2 : 16;
+      fds->chunks = (frame_data **)g_realloc(fds->chunks,
+                                             (sizeof *fds->chunks)*fds->chunks_alloc);
     }
-    node = &leaf[LEAF_INDEX(fds->count)];
-  } else if (fds->count == NODES_PER_LEVEL*NODES_PER_LEVEL*NODES_PER_LEVEL) {
-    /* It's a 3-level tree that will turn into a 4-level tree */
-    level3 = (frame_data ****)g_malloc0((sizeof *level3)*NODES_PER_LEVEL);
-    level3[0] = (frame_data ***)fds->ptree_root;
-    level2 = (frame_data ***)g_malloc0((sizeof *level2)*NODES_PER_LEVEL);
-    level3[1] = level2;
-    level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
-    level2[0] = level1;
-    leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
-    level1[0] = leaf;
-    node = &leaf[0];
-    fds->ptree_root = level3;
-  } else {
-    /* fds->count is 2^32-1 at most, and NODES_PER_LEVEL^4
-       2^(LOG2_NODES_PER_LEVEL*4), and LOG2_NODES_PER_LEVEL is 10,
-       so fds->count is always less < NODES_PER_LEVEL^4.
-
-       XXX - we should fail if fds->count is 2^31-1, or should
-       make the frame numbers 64-bit and just let users run
-       themselves out of address space or swap space. :-) */
-    /* It's a 4-level tree, and is going to stay that way forever. */
-    level3 = (frame_data ****)fds->ptree_root;
-    level2 = level3[LEVEL_3_INDEX(fds->count)];
-    if (level2 == NULL) {
-      level2 = (frame_data ***)g_malloc0((sizeof *level2)*NODES_PER_LEVEL);
-      level3[LEVEL_3_INDEX(fds->count)] = level2;
-    }
-    level1 = level2[LEVEL_2_INDEX(fds->count)];
-    if (level1 == NULL) {
-      level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
-      level2[LEVEL_2_INDEX(fds->count)] = level1;
-    }
-    leaf = level1[LEVEL_1_INDEX(fds->count)];
-    if (leaf == NULL) {
-      leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
-      level1[LEVEL_1_INDEX(fds->count)] = leaf;
-    }
-    node = &leaf[LEAF_INDEX(fds->count)];
+    fds->chunks[chunk] = (frame_data *)g_malloc((sizeof *node)*FRAMES_PER_CHUNK);
   }
+  node = &fds->chunks[chunk][CHUNK_OFFSET(fds->count)];
   *node = *fdata;
   fds->count++;
   return node;
@@ -178,11 +97,6 @@ frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
 frame_data *
 frame_data_sequence_find(frame_data_sequence *fds, guint32 num)
 {
-  frame_data *leaf;
-  frame_data **level1;
-  frame_data ***level2;
-  frame_data ****level3;
-
   if (num == 0) {
     /* There is no frame number 0 */
     return NULL;
@@ -195,120 +109,216 @@ frame_data_sequence_find(frame_data_sequence *fds, guint32 num)
     return NULL;
   }
 
-  if (fds->count <= NODES_PER_LEVEL) {
-    /* It's a 1-level tree. */
-    leaf = (frame_data *)fds->ptree_root;
-    return &leaf[num];
-  }
-  if (fds->count <= NODES_PER_LEVEL*NODES_PER_LEVEL) {
-    /* It's a 2-level tree. */
-    level1 = (frame_data **)fds->ptree_root;
-    leaf = level1[num >> LOG2_NODES_PER_LEVEL];
-    return &leaf[LEAF_INDEX(num)];
-  }
-  if (fds->count <= NODES_PER_LEVEL*NODES_PER_LEVEL*NODES_PER_LEVEL) {
-    /* It's a 3-level tree. */
-    level2 = (frame_data ***)fds->ptree_root;
-    level1 = level2[num >> (LOG2_NODES_PER_LEVEL+LOG2_NODES_PER_LEVEL)];
-    leaf = level1[(num >> LOG2_NODES_PER_LEVEL) & (NODES_PER_LEVEL - 1)];
-    return &leaf[LEAF_INDEX(num)];
+  return &fds->chunks[CHUNK_INDEX(num)][CHUNK_OFFSET(num)];
+}
+
+/*
+ * Get the time shift of the specified frame, or NULL if it hasn't
+ * been shifted.
+ */
+const nstime_t *
+frame_data_sequence_get_shift_offset(frame_data_sequence *fds, guint32 num)
+{
+  if (num == 0 || num > fds->shift_offsets_len)
+    return NULL;
+  return &fds->shift_offsets[num - 1];
+}
+
+/*
+ * Get a modifiable time shift of the specified frame, allocating the
+ * side table on first use; NULL if there is no such frame.
+ */
+nstime_t *
+frame_data_sequence_shift_offset(frame_data_sequence *fds, guint32 num)
+{
+  if (num == 0 || num > fds->count)
+    return NULL;
+
+  if (num > fds->shift_offsets_len) {
+    fds->shift_offsets = (nstime_t *)g_realloc(fds->shift_offsets,
+                                               (sizeof *fds->shift_offsets)*fds->count);
+    memset(&fds->shift_offsets[fds->shift_offsets_len], 0,
+           (sizeof *fds->shift_offsets)*(fds->count - fds->shift_offsets_len));
+    fds->shift_offsets_len = fds->count;
   }
-  /* fds->count is 2^32-1 at most, and NODES_PER_LEVEL^4
-     2^(LOG2_NODES_PER_LEVEL*4), and LOG2_NODES_PER_LEVEL is 10,
-     so fds->count is always less < NODES_PER_LEVEL^4. */
-  /* It's a 4-level tree, and is going to stay that way forever. */
-  level3 = (frame_data ****)fds->ptree_root;
-  level2 = level3[num >> (LOG2_NODES_PER_LEVEL+LOG2_NODES_PER_LEVEL+LOG2_NODES_PER_LEVEL)];
-  level1 = level2[(num >> (LOG2_NODES_PER_LEVEL+LOG2_NODES_PER_LEVEL)) & (NODES_PER_LEVEL - 1)];
-  leaf = level1[(num >> LOG2_NODES_PER_LEVEL) & (NODES_PER_LEVEL - 1)];
-  return &leaf[LEAF_INDEX(num)];
+  return &fds->shift_offsets[num - 1];
 }
 
-/* recursively frees a frame_data radix level */
-static void
-free_frame_data_array(void *array, guint count, guint level, gboolean last)
+/*
+ * Free a frame_data_sequence and all the frame_data structures in it.
+ */
+void
+free_frame_data_sequence(frame_data_sequence *fds)
 {
-  guint i, level_count;
-
-  if (last) {
-    /* if we are the last in our given parent's row, we may not have
-     * exactly a full row, so do the bit twiddling to figure out exactly
-     * how many fields we have */
-    level_count = (count >> ((level - 1) * LOG2_NODES_PER_LEVEL)) &
-                  (NODES_PER_LEVEL - 1);
-    /* the above calculation rounds down, so make sure we count correctly
-     * if count is not an even multiple of NODES_PER_LEVEL */
-    if (count & ((1 << ((level - 1) * LOG2_NODES_PER_LEVEL)) - 1)) {
-      level_count++;
-    }
+  guint32 i, n_chunks;
+
+  for (i = 0; i < fds->count; i++) {
+    frame_data_destroy(&fds->chunks[CHUNK_INDEX(i)][CHUNK_OFFSET(i)]);
   }
-  else {
-    /* if we're not the last in our parent, then we're guaranteed to have
-     * a full array */
-    level_count = NODES_PER_LEVEL;
+
+  n_chunks = CHUNK_INDEX(fds->count + FRAMES_PER_CHUNK - 1);
+  for (i = 0; i < n_chunks; i++) {
+    g_free(fds->chunks[i]);
   }
+  g_free(fds->chunks);
+  g_free(fds->shift_offsets);
 
+  /* free the header struct */
+  g_free(fds);
+}
 
-  if (level > 1) {
-    /* recurse on every sub-array, passing on our own 'last' value
-     * specially to our last child */
-    frame_data **real_array = (frame_data **) array;
+/*
+ * Write a sidecar index of all the frames in a frame_data_sequence,
+ * and the fast seek points wiretap gathered while reading them, to
+ * the specified file; see wsutil/frame_index.h.
+ *
+ * Other processes may have the index mapped, so it's written to a
+ * temporary file that's then renamed over it; they keep the old one
+ * until they unmap it.
+ */
+gboolean
+frame_data_sequence_write_index(frame_data_sequence *fds, wtap *wth,
+                                const char *path, const frame_index_key *key)
+{
+  frame_index_header hdr;
+  frame_index_record rec;
+  frame_data *fdata;
+  guint8 *seek_points;
+  guint32 seek_point_size;
+  guint32 seek_point_count;
+  gchar *tmp_path;
+  int fd;
+  FILE *fp;
+  guint32 i;
 
-    for (i=0; i < level_count-1; i++) {
-      free_frame_data_array(real_array[i], count, level-1, FALSE);
-    }
+  seek_points = wtap_get_fast_seek_points(wth, &seek_point_size, &seek_point_count);
 
-    free_frame_data_array(real_array[level_count-1], count, level-1, last);
+  tmp_path = g_strdup_printf("%s.XXXXXX", path);
+  fd = g_mkstemp(tmp_path);
+  if (fd == -1) {
+    g_free(tmp_path);
+    g_free(seek_points);
+    return FALSE;
+  }
+  fp = ws_fdopen(fd, "wb");
+  if (fp == NULL) {
+    ws_close(fd);
+    goto fail_unlink;
   }
-  else if (level == 1) {
-    /* bottom level, so just clean up all the frame data */
-    frame_data *real_array = (frame_data *) array;
 
-    for (i=0; i < level_count; i++) {
-      frame_data_destroy(&real_array[i]);
-    }
+  memset(&hdr, 0, sizeof hdr);
+  hdr.magic = FRAME_INDEX_MAGIC;
+  hdr.version = FRAME_INDEX_VERSION;
+  hdr.record_size = (guint32)sizeof rec;
+  hdr.count = fds->count;
+  hdr.seek_point_size = seek_point_size;
+  hdr.seek_point_count = seek_point_count;
+  hdr.key = *key;
+  if (fwrite(&hdr, sizeof hdr, 1, fp) != 1)
+    goto fail;
+
+  memset(&rec, 0, sizeof rec);
+  for (i = 0; i < fds->count; i++) {
+    fdata = &fds->chunks[CHUNK_INDEX(i)][CHUNK_OFFSET(i)];
+    rec.file_off = fdata->file_off;
+    rec.secs = (gint64)fdata->abs_ts.secs;
+    rec.nsecs = fdata->abs_ts.nsecs;
+    rec.pkt_len = fdata->pkt_len;
+    rec.cap_len = fdata->cap_len;
+    rec.tsprec = fdata->tsprec;
+    rec.rec_type = fdata->flags.rec_type;
+    rec.flags = 0;
+    if (fdata->flags.has_ts)
+      rec.flags |= FRAME_INDEX_HAS_TS;
+    if (fdata->flags.has_phdr_comment)
+      rec.flags |= FRAME_INDEX_HAS_PHDR_COMMENT;
+    if (fwrite(&rec, sizeof rec, 1, fp) != 1)
+      goto fail;
   }
+  if (seek_point_count != 0 &&
+      fwrite(seek_points, seek_point_size, seek_point_count, fp) != seek_point_count)
+    goto fail;
+  g_free(seek_points);
+  seek_points = NULL;
+
+  if (fclose(fp) != 0)
+    goto fail_unlink;
+#ifdef _WIN32
+  /* rename() doesn't replace an existing file on Windows */
+  ws_unlink(path);
+#endif
+  if (ws_rename(tmp_path, path) != 0)
+    goto fail_unlink;
+  g_free(tmp_path);
+  return TRUE;
 
-  /* free the array itself */
-  g_free(array);
+fail:
+  fclose(fp);
+fail_unlink:
+  ws_unlink(tmp_path);
+  g_free(tmp_path);
+  g_free(seek_points);
+  return FALSE;
 }
 
 /*
- * Free a frame_data_sequence and all the frame_data structures in it.
+ * Read an index written by frame_data_sequence_write_index(), and
+ * build a frame_data_sequence from it, setting *count to the number
+ * of frames.  The index is mapped rather than read.  Returns NULL if
+ * there's no usable index for a capture file with the specified key.
+ *
+ * The frames come back not yet visited, just as if they'd been read
+ * from the capture file but not dissected.  The wiretap session gets
+ * the fast seek points in the index, so that seeking in a compressed
+ * file doesn't mean decompressing it from the start; an index with
+ * points that it can't use isn't used at all.
  */
-void
-free_frame_data_sequence(frame_data_sequence *fds)
+frame_data_sequence *
+frame_data_sequence_read_index(wtap *wth, const char *path,
+                               const frame_index_key *key, guint32 *count)
 {
-  guint   levels;
-
-  /* calculate how many levels we have */
-  if (fds->count == 0) {
-    /* The tree is empty; there are no levels. */
-    levels = 0;
-  } else if (fds->count <= NODES_PER_LEVEL) {
-    /* It's a 1-level tree. */
-    levels = 1;
-  } else if (fds->count <= NODES_PER_LEVEL*NODES_PER_LEVEL) {
-    /* It's a 2-level tree. */
-    levels = 2;
-  } else if (fds->count <= NODES_PER_LEVEL*NODES_PER_LEVEL*NODES_PER_LEVEL) {
-    /* It's a 3-level tree. */
-    levels = 3;
-  } else {
-    /* fds->count is 2^32-1 at most, and NODES_PER_LEVEL^4
-       2^(LOG2_NODES_PER_LEVEL*4), and LOG2_NODES_PER_LEVEL is 10,
-       so fds->count is always less < NODES_PER_LEVEL^4. */
-    /* It's a 4-level tree. */
-    levels = 4;
+  GMappedFile *mapped;
+  frame_index index;
+  const frame_index_record *rec;
+  frame_data_sequence *fds;
+  frame_data fdlocal;
+  guint32 cum_bytes = 0;
+  guint32 i;
+
+  mapped = frame_index_map(path, key, &index);
+  if (mapped == NULL)
+    return NULL;
+  if (index.seek_point_count != 0 &&
+      !wtap_set_fast_seek_points(wth, index.seek_points,
+                                 index.seek_point_size, index.seek_point_count)) {
+    g_mapped_file_unref(mapped);
+    return NULL;
   }
 
-  /* call the recursive free function */
-  if (levels > 0) {
-    free_frame_data_array(fds->ptree_root, fds->count, levels, TRUE);
+  fds = new_frame_data_sequence();
+  for (i = 0; i < index.count; i++) {
+    rec = &index.records[i];
+
+    memset(&fdlocal, 0, sizeof fdlocal);
+    fdlocal.num = i + 1;
+    fdlocal.file_off = rec->file_off;
+    fdlocal.pkt_len = rec->pkt_len;
+    fdlocal.cap_len = rec->cap_len;
+    cum_bytes += rec->pkt_len;
+    fdlocal.cum_bytes = cum_bytes;
+    fdlocal.tsprec = rec->tsprec;
+    fdlocal.abs_ts.secs = (time_t)rec->secs;
+    fdlocal.abs_ts.nsecs = rec->nsecs;
+    fdlocal.flags.encoding = PACKET_CHAR_ENC_CHAR_ASCII;
+    fdlocal.flags.has_ts = (rec->flags & FRAME_INDEX_HAS_TS) ? 1 : 0;
+    fdlocal.flags.has_phdr_comment = (rec->flags & FRAME_INDEX_HAS_PHDR_COMMENT) ? 1 : 0;
+    fdlocal.flags.rec_type = rec->rec_type;
+    frame_data_sequence_add(fds, &fdlocal);
   }
 
-  /* free the header struct */
-  g_free(fds);
+  g_mapped_file_unref(mapped);
+  *count = index.count;
+  return fds;
 }
 
 void
@@ -11,6 +11,9 @@
 #ifndef __FRAME_DATA_SEQUENCE_H__
 #define __FRAME_DATA_SEQUENCE_H__
 
+#include <wsutil/frame_index.h>
+#include <wiretap/wtap.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -28,11 +31,42 @@ WS_DLL_PUBLIC frame_data *frame_data_sequence_add(frame_data_sequence *fds,
 WS_DLL_PUBLIC frame_data *frame_data_sequence_find(frame_data_sequence *fds,
     guint32 num);
 
+/*
+ * Find the time shift offset of a frame; returns NULL if the frame
+ * has never been time shifted.
+ */
+WS_DLL_PUBLIC const nstime_t *frame_data_sequence_get_shift_offset(frame_data_sequence *fds,
+    guint32 num);
+
+/*
+ * Get a writable time shift offset for a frame, allocating the
+ * shift offset table if necessary.
+ */
+WS_DLL_PUBLIC nstime_t *frame_data_sequence_shift_offset(frame_data_sequence *fds,
+    guint32 num);
+
 /*
  * Free a frame_data_sequence and all the frame_data structures in it.
  */
 WS_DLL_PUBLIC void free_frame_data_sequence(frame_data_sequence *fds);
 
+/*
+ * Write a sidecar index of the frames in a frame_data_sequence, and
+ * the fast seek points of the wiretap session they were read from,
+ * for a capture file with the specified key; see
+ * frame_index_key_for_file().
+ */
+WS_DLL_PUBLIC gboolean frame_data_sequence_write_index(frame_data_sequence *fds,
+    wtap *wth, const char *path, const frame_index_key *key);
+
+/*
+ * Build a frame_data_sequence from a sidecar index, and give the
+ * wiretap session the fast seek points in it; returns NULL if there's
+ * no index for a capture file with the specified key.
+ */
+WS_DLL_PUBLIC frame_data_sequence *frame_data_sequence_read_index(wtap *wth,
+    const char *path, const frame_index_key *key, guint32 *count);
+
 WS_DLL_PUBLIC void find_and_mark_frame_depended_upon(gpointer data, gpointer user_data);
 
 
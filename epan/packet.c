@@ -32,6 +32,8 @@
 #include "wmem/wmem.h"
 
 #include <epan/exceptions.h>
+#include <epan/conversation.h>
+#include <epan/dissector_profile.h>
 #include <epan/reassemble.h>
 #include <epan/stream.h>
 #include <epan/expert.h>
@@ -149,6 +151,11 @@ destroy_depend_dissector_list(void *data)
 struct heur_dissector_list {
 	protocol_t	*protocol;
 	GSList		*dissectors;
+	/* With the adaptive_heuristic_order preference, the entries in
+	   "dissectors", most accepts first; built when first needed */
+	GPtrArray	*by_accepts;
+	guint32		 active_frame;	/* the frame being dissected when "active" was set */
+	guint		 active;	/* dissector_try_heuristic() calls in progress for it */
 };
 
 static GHashTable *heur_dissector_lists = NULL;
@@ -172,6 +179,8 @@ destroy_heuristic_dissector_list(void *data)
 	GSList **list = &(dissector_list->dissectors);
 
 	g_slist_free_full(*list, destroy_heuristic_dissector_entry);
+	if (dissector_list->by_accepts != NULL)
+		g_ptr_array_free(dissector_list->by_accepts, TRUE);
 	g_slice_free(struct heur_dissector_list, dissector_list);
 }
 
@@ -545,6 +554,15 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 
 	frame_delta_abs_time(edt->session, fd, fd->frame_ref_num, &edt->pi.rel_ts);
 
+	/*
+	 * Free old conversations and reassemblies, if we've been asked
+	 * to, before this frame can refer to them.
+	 */
+	if (!fd->flags.visited) {
+		conversation_evict(fd->flags.has_ts ? &fd->abs_ts : NULL);
+		reassembly_tables_evict(fd->num);
+	}
+
 	/* pkt comment use first user, later from rec */
 	if (fd->flags.has_user_comment)
 		frame_dissector_data.pkt_comment = epan_get_user_comment(edt->session, fd);
@@ -674,12 +692,27 @@ struct dissector_handle {
  * The only time this function will return 0 is if it is a new style dissector
  * and if the dissector rejected the packet.
  */
+static int
+call_dissector_func(dissector_handle_t handle, tvbuff_t *tvb,
+		    packet_info *pinfo, proto_tree *tree, void *data)
+{
+	if (handle->dissector_type == DISSECTOR_TYPE_SIMPLE) {
+		return ((dissector_t)handle->dissector_func)(tvb, pinfo, tree, data);
+	}
+	else if (handle->dissector_type == DISSECTOR_TYPE_CALLBACK) {
+		return ((dissector_cb_t)handle->dissector_func)(tvb, pinfo, tree, data, handle->dissector_data);
+	}
+	g_assert_not_reached();
+	return 0;
+}
+
 static int
 call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
 			      packet_info *pinfo, proto_tree *tree, void *data)
 {
-	const char *saved_proto;
-	int         len;
+	const char   *saved_proto;
+	volatile int  len;
+	dissector_profile_frame_t profile_frame;
 
 	saved_proto = pinfo->current_proto;
 
@@ -688,14 +721,23 @@ call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
 			proto_get_protocol_short_name(handle->protocol);
 	}
 
-	if (handle->dissector_type == DISSECTOR_TYPE_SIMPLE) {
-		len = ((dissector_t)handle->dissector_func)(tvb, pinfo, tree, data);
-	}
-	else if (handle->dissector_type == DISSECTOR_TYPE_CALLBACK) {
-		len = ((dissector_cb_t)handle->dissector_func)(tvb, pinfo, tree, data, handle->dissector_data);
-	}
-	else {
-		g_assert_not_reached();
+	if (G_UNLIKELY(dissector_profile_active) && handle->protocol != NULL) {
+		/*
+		 * Account for the time spent in the dissector even if
+		 * it throws an exception.
+		 */
+		dissector_profile_enter(&profile_frame, proto_get_id(handle->protocol), pinfo);
+		TRY {
+			len = call_dissector_func(handle, tvb, pinfo, tree, data);
+		}
+		CATCH_ALL {
+			dissector_profile_leave(&profile_frame, pinfo);
+			RETHROW;
+		}
+		ENDTRY;
+		dissector_profile_leave(&profile_frame, pinfo);
+	} else {
+		len = call_dissector_func(handle, tvb, pinfo, tree, data);
 	}
 	pinfo->current_proto = saved_proto;
 
@@ -2513,6 +2555,19 @@ has_heur_dissector_list(const gchar *name) {
 	return (find_heur_dissector_list(name) != NULL);
 }
 
+/*
+ * Forget the adaptive order of a list whose entries have changed; it'll
+ * be rebuilt from the entries' accept counts when next needed.
+ */
+static void
+heur_dissector_list_reset_order(heur_dissector_list_t sub_dissectors)
+{
+	if (sub_dissectors->by_accepts != NULL) {
+		g_ptr_array_free(sub_dissectors->by_accepts, TRUE);
+		sub_dissectors->by_accepts = NULL;
+	}
+}
+
 heur_dtbl_entry_t* find_heur_dissector_by_unique_short_name(const char *short_name)
 {
 	return (heur_dtbl_entry_t*)g_hash_table_lookup(heuristic_short_names, short_name);
@@ -2576,12 +2631,17 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	hdtbl_entry->short_name = g_strdup(short_name);
 	hdtbl_entry->list_name = g_strdup(name);
 	hdtbl_entry->enabled   = (enable == HEURISTIC_ENABLE);
+	hdtbl_entry->guard_min_length = 0;
+	hdtbl_entry->guard_len = 0;
+	hdtbl_entry->tries     = 0;
+	hdtbl_entry->accepts   = 0;
 
 	/* do the table insertion */
 	g_hash_table_insert(heuristic_short_names, (gpointer)hdtbl_entry->short_name, hdtbl_entry);
 
 	sub_dissectors->dissectors = g_slist_prepend(sub_dissectors->dissectors,
 	    (gpointer)hdtbl_entry);
+	heur_dissector_list_reset_order(sub_dissectors);
 
 	/* XXX - could be optimized to pass hdtbl_entry directly */
 	proto_add_heuristic_dissector(hdtbl_entry->protocol, hdtbl_entry->short_name);
@@ -2627,7 +2687,92 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 		g_slice_free(heur_dtbl_entry_t, found_entry->data);
 		sub_dissectors->dissectors = g_slist_delete_link(sub_dissectors->dissectors,
 		    found_entry);
+		heur_dissector_list_reset_order(sub_dissectors);
+	}
+}
+
+void
+heur_dissector_set_guard(const char *short_name, guint min_length,
+			 guint guard_len, const guint8 *mask, const guint8 *value)
+{
+	heur_dtbl_entry_t *hdtbl_entry = find_heur_dissector_by_unique_short_name(short_name);
+	guint              i;
+
+	/* sanity check */
+	g_assert(hdtbl_entry != NULL);
+	g_assert(guard_len <= HEUR_GUARD_MAX_LEN);
+
+	hdtbl_entry->guard_min_length = min_length;
+	hdtbl_entry->guard_len = guard_len;
+	for (i = 0; i < guard_len; i++) {
+		hdtbl_entry->guard_mask[i] = mask[i];
+		hdtbl_entry->guard_value[i] = value[i] & mask[i];
+	}
+}
+
+/*
+ * Does the entry's guard rule out this packet?
+ */
+static inline gboolean
+heur_guard_rejects(const heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb)
+{
+	const guint8 *bytes;
+	guint         i;
+
+	if (tvb_reported_length(tvb) < hdtbl_entry->guard_min_length)
+		return TRUE;
+	if (hdtbl_entry->guard_len == 0 ||
+	    tvb_captured_length(tvb) < hdtbl_entry->guard_len)
+		return FALSE;
+
+	bytes = tvb_get_ptr(tvb, 0, hdtbl_entry->guard_len);
+	for (i = 0; i < hdtbl_entry->guard_len; i++) {
+		if ((bytes[i] & hdtbl_entry->guard_mask[i]) != hdtbl_entry->guard_value[i])
+			return TRUE;
 	}
+	return FALSE;
+}
+
+static gint
+compare_heur_accepts(gconstpointer a, gconstpointer b)
+{
+	const heur_dtbl_entry_t *hdtbl_entry_a = *(const heur_dtbl_entry_t * const *)a;
+	const heur_dtbl_entry_t *hdtbl_entry_b = *(const heur_dtbl_entry_t * const *)b;
+
+	if (hdtbl_entry_a->accepts == hdtbl_entry_b->accepts)
+		return 0;
+	return hdtbl_entry_a->accepts > hdtbl_entry_b->accepts ? -1 : 1;
+}
+
+static void
+heur_dissector_list_build_order(heur_dissector_list_t sub_dissectors)
+{
+	GSList *entry;
+
+	sub_dissectors->by_accepts = g_ptr_array_sized_new(g_slist_length(sub_dissectors->dissectors));
+	for (entry = sub_dissectors->dissectors; entry != NULL; entry = g_slist_next(entry))
+		g_ptr_array_add(sub_dissectors->by_accepts, entry->data);
+	/* g_ptr_array_sort() is stable, so ties stay in list order */
+	g_ptr_array_sort(sub_dissectors->by_accepts, compare_heur_accepts);
+}
+
+/*
+ * Move an entry that has just accepted a packet ahead of the entries
+ * that have accepted fewer; one step of an insertion sort keeps
+ * "by_accepts" sorted.
+ */
+static void
+heur_dissector_list_promote(heur_dissector_list_t sub_dissectors, guint i)
+{
+	gpointer *entries = sub_dissectors->by_accepts->pdata;
+	gpointer  hdtbl_entry = entries[i];
+
+	while (i > 0 &&
+	    ((heur_dtbl_entry_t *)entries[i - 1])->accepts < ((heur_dtbl_entry_t *)hdtbl_entry)->accepts) {
+		entries[i] = entries[i - 1];
+		i--;
+	}
+	entries[i] = hdtbl_entry;
 }
 
 gboolean
@@ -2641,9 +2786,12 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	guint16            saved_can_desegment;
 	guint              saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
+	guint              i;
+	gboolean           adaptive;
 	int                proto_id;
-	int                len;
+	volatile int       len;
 	int                saved_tree_count = tree ? tree->tree_data->count : 0;
+	dissector_profile_frame_t profile_frame;
 
 	/* can_desegment is set to 2 by anyone which offers this api/service.
 	   then everytime a subdissector is called it is decremented by one.
@@ -2665,11 +2813,39 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	saved_layers_len = wmem_list_count(pinfo->layers);
 	*heur_dtbl_entry = NULL;
 
-	for (entry = sub_dissectors->dissectors; entry != NULL;
-	    entry = g_slist_next(entry)) {
+	/*
+	 * With adaptive ordering, try the entries that have accepted the
+	 * most packets first, and keep count. The list may be used again,
+	 * e.g. for a tunneled packet, by a dissector we call; only the
+	 * outermost call reorders it, so the order doesn't change under an
+	 * outer loop. If a dissector throws an exception, "active" stays
+	 * raised until the next frame, which only delays reordering.
+	 */
+	adaptive = prefs.adaptive_heuristic_order;
+	if (adaptive) {
+		if (sub_dissectors->by_accepts == NULL)
+			heur_dissector_list_build_order(sub_dissectors);
+		if (sub_dissectors->active_frame != pinfo->num) {
+			sub_dissectors->active_frame = pinfo->num;
+			sub_dissectors->active = 0;
+		}
+		sub_dissectors->active++;
+	}
+
+	entry = sub_dissectors->dissectors;
+	for (i = 0; ; i++) {
+		if (adaptive) {
+			if (i >= sub_dissectors->by_accepts->len)
+				break;
+			hdtbl_entry = (heur_dtbl_entry_t *)g_ptr_array_index(sub_dissectors->by_accepts, i);
+		} else {
+			if (entry == NULL)
+				break;
+			hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+			entry = g_slist_next(entry);
+		}
 		/* XXX - why set this now and above? */
 		pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
-		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
 
 		if (hdtbl_entry->protocol != NULL &&
 			(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
@@ -2679,6 +2855,13 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			continue;
 		}
 
+		if (heur_guard_rejects(hdtbl_entry, tvb)) {
+			/*
+			 * The packet can't be for this dissector.
+			 */
+			continue;
+		}
+
 		if (hdtbl_entry->protocol != NULL) {
 			proto_id = proto_get_id(hdtbl_entry->protocol);
 			/* do NOT change this behavior - wslua uses the protocol short name set here in order
@@ -2696,7 +2879,22 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 
 		pinfo->heur_list_name = hdtbl_entry->list_name;
 
-		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+		if (G_UNLIKELY(dissector_profile_active) && hdtbl_entry->protocol != NULL) {
+			dissector_profile_enter(&profile_frame, proto_get_id(hdtbl_entry->protocol), pinfo);
+			TRY {
+				len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+			}
+			CATCH_ALL {
+				dissector_profile_leave(&profile_frame, pinfo);
+				dissector_profile_heur_result(&profile_frame, FALSE);
+				RETHROW;
+			}
+			ENDTRY;
+			dissector_profile_leave(&profile_frame, pinfo);
+			dissector_profile_heur_result(&profile_frame, len != 0);
+		} else {
+			len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+		}
 		if (hdtbl_entry->protocol != NULL &&
 			(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
 			/*
@@ -2709,6 +2907,16 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 				wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
 			}
 		}
+		/* Only learn from the first pass, so that re-dissecting a
+		   packet finds the same dissector as far as possible */
+		if (adaptive && !pinfo->fd->flags.visited) {
+			hdtbl_entry->tries++;
+			if (len) {
+				hdtbl_entry->accepts++;
+				if (sub_dissectors->active == 1)
+					heur_dissector_list_promote(sub_dissectors, i);
+			}
+		}
 		if (len) {
 			*heur_dtbl_entry = hdtbl_entry;
 			status = TRUE;
@@ -2716,6 +2924,9 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 		}
 	}
 
+	if (adaptive && sub_dissectors->active > 0)
+		sub_dissectors->active--;
+
 	pinfo->current_proto = saved_curr_proto;
 	pinfo->heur_list_name = saved_heur_list_name;
 	pinfo->can_desegment = saved_can_desegment;
@@ -2870,6 +3081,9 @@ register_heur_dissector_list(const char *name, const int proto)
 	sub_dissectors = g_slice_new(struct heur_dissector_list);
 	sub_dissectors->protocol  = find_protocol_by_id(proto);
 	sub_dissectors->dissectors = NULL;	/* initially empty */
+	sub_dissectors->by_accepts = NULL;
+	sub_dissectors->active_frame = 0;
+	sub_dissectors->active = 0;
 	g_hash_table_insert(heur_dissector_lists, (gpointer)name,
 			    (gpointer) sub_dissectors);
 	return sub_dissectors;
@@ -418,6 +418,9 @@ struct heur_dissector_list;
 typedef struct heur_dissector_list *heur_dissector_list_t;
 
 
+/* Maximum number of leading bytes a heuristic dissector's guard can check */
+#define HEUR_GUARD_MAX_LEN 8
+
 typedef struct heur_dtbl_entry {
 	heur_dissector_t dissector;
 	protocol_t *protocol; /* this entry's protocol */
@@ -425,6 +428,14 @@ typedef struct heur_dtbl_entry {
 	const gchar *display_name;     /* the string used to present heuristic to user */
 	gchar *short_name;     /* string used for "internal" use to uniquely identify heuristic */
 	gboolean enabled;
+	/* Guard checked before calling the dissector; see heur_dissector_set_guard() */
+	guint guard_min_length;
+	guint guard_len;
+	guint8 guard_mask[HEUR_GUARD_MAX_LEN];
+	guint8 guard_value[HEUR_GUARD_MAX_LEN];
+	/* Number of times the dissector was called, and accepted the packet */
+	guint64 tries;
+	guint64 accepts;
 } heur_dtbl_entry_t;
 
 /** A protocol uses this function to register a heuristic sub-dissector list.
@@ -467,6 +478,9 @@ WS_DLL_PUBLIC gboolean has_heur_dissector_list(const gchar *name);
 
 /** Try all the dissectors in a given heuristic dissector list. This is done,
  *  until we find one that recognizes the protocol.
+ *  Dissectors whose guard rules out the packet aren't called. The
+ *  dissectors are tried in the order they were added, most recent first,
+ *  or, with the adaptive_heuristic_order preference, most accepts first.
  *  Call this while the parent dissector running.
  *
  * @param sub_dissectors the sub-dissector list
@@ -507,6 +521,24 @@ WS_DLL_PUBLIC heur_dtbl_entry_t* find_heur_dissector_by_unique_short_name(const
 WS_DLL_PUBLIC void heur_dissector_add(const char *name, heur_dissector_t dissector,
     const char *display_name, const char *short_name, const int proto, heuristic_enable_e enable);
 
+/** Give a heuristic dissector a cheap test that a packet must pass before
+ *  the dissector is called. The packet's reported length must be at least
+ *  min_length, and each of its first guard_len bytes, ANDed with the byte
+ *  in mask, must equal the byte in value. The bytes aren't checked if
+ *  fewer than guard_len bytes were captured, so the guard must only reject
+ *  packets the dissector would always reject.
+ *  Call this in the proto_handoff function of the sub-dissector, after
+ *  heur_dissector_add().
+ *
+ * @param short_name the short name the sub-dissector was registered with
+ * @param min_length the minimum reported length of a packet
+ * @param guard_len the number of leading bytes to check, at most HEUR_GUARD_MAX_LEN
+ * @param mask the bits of each byte to check, or NULL if guard_len is 0
+ * @param value the value of the bits of each byte, or NULL if guard_len is 0
+ */
+WS_DLL_PUBLIC void heur_dissector_set_guard(const char *short_name, guint min_length,
+    guint guard_len, const guint8 *mask, const guint8 *value);
+
 /** Remove a sub-dissector from a heuristic dissector list.
  *  Call this in the prefs_reinit function of the sub-dissector.
  *
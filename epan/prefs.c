@@ -3599,6 +3599,13 @@ prefs_register_modules(void)
                                    "Currently only ICMP and ICMPv6 use this preference to add VLAN ID to conversation tracking",
                                    &prefs.strict_conversation_tracking_heuristics);
 
+    prefs_register_bool_preference(protocols_module, "adaptive_heuristic_order",
+                                   "Try the most successful heuristic dissectors first",
+                                   "Try the heuristic dissectors in each list in order of how many packets they have accepted,"
+                                   " instead of in the order they were registered. This can change which dissector is used"
+                                   " when more than one heuristic dissector would accept a packet.",
+                                   &prefs.adaptive_heuristic_order);
+
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
      * configuration screen within the preferences dialog
@@ -4113,6 +4120,7 @@ pre_init_prefs(void)
     prefs.st_sort_showfullname = FALSE;
     prefs.display_hidden_proto_items = FALSE;
     prefs.display_byte_fields_with_spaces = FALSE;
+    prefs.adaptive_heuristic_order = FALSE;
 }
 
 /*
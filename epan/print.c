@@ -2106,8 +2106,6 @@ void output_fields_free(output_fields_t* fields)
     g_free(fields);
 }
 
-#define COLUMN_FIELD_FILTER  "_ws.col."
-
 void output_fields_add(output_fields_t *fields, const gchar *field)
 {
     gchar *field_copy;
@@ -2291,6 +2289,63 @@ gboolean output_fields_has_cols(output_fields_t* fields)
     return fields->includes_col_fields;
 }
 
+const gchar *output_fields_get_field(output_fields_t* fields, gsize i)
+{
+    g_assert(fields);
+    g_assert(fields->fields && i < fields->fields->len);
+    return (const gchar *)g_ptr_array_index(fields->fields, i);
+}
+
+gchar output_fields_get_occurrence(output_fields_t* fields)
+{
+    g_assert(fields);
+    return fields->occurrence;
+}
+
+gboolean output_fields_can_prime(output_fields_t* fields)
+{
+    header_field_info *hfinfo;
+    gsize              i;
+
+    g_assert(fields);
+
+    if (fields->fields == NULL)
+        return TRUE;
+
+    for (i = 0; i < fields->fields->len; i++) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+
+        if (!strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER)))
+            continue;
+
+        /* Protocols are written with their summary line, which only a
+         * visible tree has */
+        for (hfinfo = proto_registrar_get_byname(field); hfinfo; hfinfo = hfinfo->same_name_next) {
+            if (hfinfo->type == FT_PROTOCOL)
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+void output_fields_prime_edt(output_fields_t* fields, epan_dissect_t *edt)
+{
+    header_field_info *hfinfo;
+    gsize              i;
+
+    g_assert(fields);
+
+    if (fields->fields == NULL)
+        return;
+
+    for (i = 0; i < fields->fields->len; i++) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+
+        for (hfinfo = proto_registrar_get_byname(field); hfinfo; hfinfo = hfinfo->same_name_next)
+            epan_dissect_prime_with_hfid(edt, hfinfo->id);
+    }
+}
+
 void write_fields_preamble(output_fields_t* fields, FILE *fh)
 {
     gsize i;
@@ -2450,6 +2505,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
     if (NULL == fields->field_values)
         fields->field_values = g_new0(GPtrArray*, fields->fields->len);  /* free'd in output_fields_free() */
 
+    proto_tree_decode_recorded_fields(edt->tree);
     proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_values,
                                 &data);
 
@@ -59,6 +59,9 @@ typedef enum {
 struct _output_fields;
 typedef struct _output_fields output_fields_t;
 
+/* Prefix of the names of fields that are columns */
+#define COLUMN_FIELD_FILTER  "_ws.col."
+
 typedef GSList* (*proto_node_children_grouper_func)(proto_node *node);
 
 WS_DLL_PUBLIC output_fields_t* output_fields_new(void);
@@ -69,6 +72,12 @@ WS_DLL_PUBLIC gsize output_fields_num_fields(output_fields_t* info);
 WS_DLL_PUBLIC gboolean output_fields_set_option(output_fields_t* info, gchar* option);
 WS_DLL_PUBLIC void output_fields_list_options(FILE *fh);
 WS_DLL_PUBLIC gboolean output_fields_has_cols(output_fields_t* info);
+/** Can the fields be written from an invisible protocol tree that has been
+ * primed with output_fields_prime_edt()? */
+WS_DLL_PUBLIC gboolean output_fields_can_prime(output_fields_t* info);
+/** Prime an epan_dissect_t with the fields, so that they're in its tree
+ * even if the tree isn't visible */
+WS_DLL_PUBLIC void output_fields_prime_edt(output_fields_t* info, epan_dissect_t *edt);
 
 /*
  * Higher-level packet-printing code.
@@ -126,8 +135,23 @@ WS_DLL_PUBLIC void write_fields_finale(output_fields_t* fields, FILE *fh);
 
 WS_DLL_PUBLIC gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt);
 
+/*
+ * Write the fields as an Apache Arrow IPC stream, with a column for each
+ * field and a row for each packet.
+ */
+typedef struct _arrow_writer arrow_writer_t;
+
+WS_DLL_PUBLIC arrow_writer_t *write_arrow_preamble(output_fields_t* fields, column_info *cinfo, FILE *fh);
+WS_DLL_PUBLIC void write_arrow_proto_tree(arrow_writer_t *writer, epan_dissect_t *edt, column_info *cinfo);
+/** Write any packets not yet written and the end of the stream, and free the writer */
+WS_DLL_PUBLIC void write_arrow_finale(arrow_writer_t *writer);
+
 extern void print_cache_field_handles(void);
 
+/* For print_arrow.c */
+extern const gchar *output_fields_get_field(output_fields_t* info, gsize i);
+extern gchar output_fields_get_occurrence(output_fields_t* info);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
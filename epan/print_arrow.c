@@ -0,0 +1,819 @@
+/* print_arrow.c
+ * Routines for writing the values of fields as an Apache Arrow IPC stream
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * The stream has a column for each field given with "-e", and a row for
+ * each packet. It's written in the Arrow IPC streaming format, described
+ * at https://arrow.apache.org/docs/format/Columnar.html: a Schema message
+ * describing the columns, a RecordBatch message for every ARROW_BATCH_ROWS
+ * packets, and an end-of-stream marker. Each message is a FlatBuffers
+ * table, followed by a body holding the columns' buffers.
+ *
+ * The few FlatBuffers tables we need are written here by hand, front to
+ * back, so that we don't depend on the FlatBuffers or Arrow libraries.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <epan/packet.h>
+#include <epan/epan_dissect.h>
+#include <epan/column.h>
+#include <epan/column-info.h>
+#include <epan/print.h>
+#include <ftypes/ftypes-int.h>
+
+#define ARROW_BATCH_ROWS    65536       /* packets in a RecordBatch */
+#define ARROW_MAX_DATA_LEN  (1U << 30)  /* start a new RecordBatch before a
+                                           column's variable-length data gets
+                                           near the limit of its 32-bit
+                                           offsets */
+
+/* Values from Arrow's Schema.fbs and Message.fbs */
+#define ARROW_METADATA_V5               4
+#define ARROW_HEADER_SCHEMA             1
+#define ARROW_HEADER_RECORD_BATCH       3
+
+#define ARROW_TYPE_INT                  2
+#define ARROW_TYPE_FLOATING_POINT       3
+#define ARROW_TYPE_BINARY               4
+#define ARROW_TYPE_UTF8                 5
+#define ARROW_TYPE_BOOL                 6
+#define ARROW_TYPE_TIMESTAMP            10
+#define ARROW_TYPE_FIXED_SIZE_BINARY    15
+#define ARROW_TYPE_DURATION             18
+
+#define ARROW_PRECISION_SINGLE          1
+#define ARROW_PRECISION_DOUBLE          2
+#define ARROW_TIME_UNIT_NANOSECOND      3
+
+typedef struct {
+    const gchar        *name;
+    header_field_info  *hfinfo;     /* first field with the name, if not a column */
+    int                 col;        /* column number for a "_ws.col." field, or -1 */
+    guint8              type;       /* ARROW_TYPE_ */
+    guint               width;      /* bytes per value, for fixed-width types */
+    gboolean            is_signed;
+    guint64             null_count;
+    GByteArray         *validity;
+    GByteArray         *offsets;    /* for Binary and Utf8 columns */
+    GByteArray         *data;
+} arrow_column_t;
+
+struct _arrow_writer {
+    FILE               *fh;
+    gboolean            last_occurrence;
+    guint               num_columns;
+    arrow_column_t     *columns;
+    guint               rows;       /* rows in the RecordBatch being built */
+};
+
+/* A field of a FlatBuffers table */
+typedef struct {
+    guint16     id;         /* position in the table's definition */
+    guint8      size;       /* 1, 2, 4 or 8 bytes */
+    gboolean    is_offset;  /* to a table, vector or string */
+    guint64     value;      /* for an offset, set to where it's written */
+} fb_field_t;
+
+static const guint8 zeroes[8];
+
+static void
+put_le(GByteArray *buf, guint64 value, guint size)
+{
+    guint8 bytes[8];
+    guint  i;
+
+    for (i = 0; i < size; i++) {
+        bytes[i] = (guint8)value;
+        value >>= 8;
+    }
+    g_byte_array_append(buf, bytes, size);
+}
+
+/* Pad so that something "len" bytes long, written next, ends aligned */
+static void
+fb_pad(GByteArray *fb, guint align, guint len)
+{
+    g_byte_array_append(fb, zeroes, (align - (fb->len + len) % align) % align);
+}
+
+static void
+fb_scalar(fb_field_t *field, guint16 id, guint8 size, guint64 value)
+{
+    field->id = id;
+    field->size = size;
+    field->is_offset = FALSE;
+    field->value = value;
+}
+
+static void
+fb_offset(fb_field_t *field, guint16 id)
+{
+    field->id = id;
+    field->size = 4;
+    field->is_offset = TRUE;
+    field->value = 0;
+}
+
+/* Point the offset written at "slot" at "target" */
+static void
+fb_set_offset(GByteArray *fb, guint slot, guint target)
+{
+    guint32 offset = GUINT32_TO_LE(target - slot);
+
+    memcpy(fb->data + slot, &offset, sizeof offset);
+}
+
+/*
+ * Write a table, preceded by its vtable, and return where the table is.
+ * The fields are laid out largest first, after an 8-aligned start, so that
+ * each is aligned to its size. The value of each offset field is set to
+ * where the offset is, to be filled in with fb_set_offset() once the thing
+ * it points to has been written.
+ */
+static guint
+fb_table(GByteArray *fb, fb_field_t *fields, guint num_fields)
+{
+    guint16  field_pos[8] = { 0 };
+    guint    num_ids = 0;
+    guint    inline_size = 4;
+    gboolean has_long = FALSE;
+    guint    vt_size, table, size, i;
+
+    for (i = 0; i < num_fields; i++) {
+        if (fields[i].size == 8)
+            has_long = TRUE;
+        if (fields[i].id >= num_ids)
+            num_ids = fields[i].id + 1;
+    }
+    if (has_long)
+        inline_size = 8;
+    for (size = 8; size > 0; size /= 2) {
+        for (i = 0; i < num_fields; i++) {
+            if (fields[i].size == size) {
+                field_pos[fields[i].id] = (guint16)inline_size;
+                inline_size += size;
+            }
+        }
+    }
+
+    vt_size = 4 + 2 * num_ids;
+    fb_pad(fb, 8, vt_size);
+    put_le(fb, vt_size, 2);
+    put_le(fb, inline_size, 2);
+    for (i = 0; i < num_ids; i++)
+        put_le(fb, field_pos[i], 2);
+
+    table = fb->len;
+    put_le(fb, vt_size, 4);     /* soffset back to the vtable */
+    if (has_long)
+        put_le(fb, 0, 4);
+    for (size = 8; size > 0; size /= 2) {
+        for (i = 0; i < num_fields; i++) {
+            if (fields[i].size != size)
+                continue;
+            if (fields[i].is_offset) {
+                fields[i].value = fb->len;
+                put_le(fb, 0, 4);
+            } else {
+                put_le(fb, fields[i].value, size);
+            }
+        }
+    }
+    return table;
+}
+
+/* Start a vector; its elements are written after this */
+static guint
+fb_vector(GByteArray *fb, guint count, guint align)
+{
+    guint vector;
+
+    fb_pad(fb, align, 4);
+    vector = fb->len;
+    put_le(fb, count, 4);
+    return vector;
+}
+
+static guint
+fb_string(GByteArray *fb, const gchar *str)
+{
+    guint len = (guint)strlen(str);
+    guint string;
+
+    fb_pad(fb, 4, 0);
+    string = fb->len;
+    put_le(fb, len, 4);
+    g_byte_array_append(fb, (const guint8 *)str, len + 1);
+    return string;
+}
+
+/* Start a Message, and return where the offset to its header is */
+static guint
+fb_message(GByteArray *fb, guint8 header_type, guint64 body_len)
+{
+    fb_field_t fields[4];
+    guint      message;
+
+    fb_scalar(&fields[0], 0, 2, ARROW_METADATA_V5);
+    fb_scalar(&fields[1], 1, 1, header_type);
+    fb_offset(&fields[2], 2);
+    fb_scalar(&fields[3], 3, 8, body_len);
+
+    put_le(fb, 0, 4);           /* offset to the root table */
+    message = fb_table(fb, fields, G_N_ELEMENTS(fields));
+    fb_set_offset(fb, 0, message);
+    return (guint)fields[2].value;
+}
+
+static void
+arrow_write_message(arrow_writer_t *w, GByteArray *fb, GByteArray *body)
+{
+    guint32 prefix[2];
+
+    fb_pad(fb, 8, 0);
+    prefix[0] = 0xFFFFFFFF;     /* continuation marker */
+    prefix[1] = GUINT32_TO_LE(fb->len);
+    fwrite(prefix, sizeof prefix, 1, w->fh);
+    fwrite(fb->data, 1, fb->len, w->fh);
+    if (body != NULL)
+        fwrite(body->data, 1, body->len, w->fh);
+}
+
+static guint
+arrow_write_type(GByteArray *fb, const arrow_column_t *column)
+{
+    fb_field_t fields[2];
+    guint      num_fields = 0;
+    guint      type;
+
+    switch (column->type) {
+
+    case ARROW_TYPE_INT:
+        fb_scalar(&fields[num_fields++], 0, 4, column->width * 8);
+        fb_scalar(&fields[num_fields++], 1, 1, column->is_signed);
+        break;
+
+    case ARROW_TYPE_FLOATING_POINT:
+        fb_scalar(&fields[num_fields++], 0, 2,
+                  column->width == 4 ? ARROW_PRECISION_SINGLE : ARROW_PRECISION_DOUBLE);
+        break;
+
+    case ARROW_TYPE_TIMESTAMP:
+        fb_scalar(&fields[num_fields++], 0, 2, ARROW_TIME_UNIT_NANOSECOND);
+        fb_offset(&fields[num_fields++], 1);
+        break;
+
+    case ARROW_TYPE_DURATION:
+        fb_scalar(&fields[num_fields++], 0, 2, ARROW_TIME_UNIT_NANOSECOND);
+        break;
+
+    case ARROW_TYPE_FIXED_SIZE_BINARY:
+        fb_scalar(&fields[num_fields++], 0, 4, column->width);
+        break;
+
+    default:
+        /* Binary, Utf8 and Bool have no parameters */
+        break;
+    }
+
+    type = fb_table(fb, fields, num_fields);
+    if (column->type == ARROW_TYPE_TIMESTAMP)
+        fb_set_offset(fb, (guint)fields[1].value, fb_string(fb, "UTC"));
+    return type;
+}
+
+static void
+arrow_write_field(GByteArray *fb, const arrow_column_t *column, guint slot)
+{
+    fb_field_t fields[5];
+
+    fb_offset(&fields[0], 0);                   /* name */
+    fb_scalar(&fields[1], 1, 1, TRUE);          /* nullable */
+    fb_scalar(&fields[2], 2, 1, column->type);  /* type_type */
+    fb_offset(&fields[3], 3);                   /* type */
+    fb_offset(&fields[4], 5);                   /* children */
+
+    fb_set_offset(fb, slot, fb_table(fb, fields, G_N_ELEMENTS(fields)));
+    fb_set_offset(fb, (guint)fields[0].value, fb_string(fb, column->name));
+    fb_set_offset(fb, (guint)fields[3].value, arrow_write_type(fb, column));
+    fb_set_offset(fb, (guint)fields[4].value, fb_vector(fb, 0, 4));
+}
+
+static void
+arrow_write_schema(arrow_writer_t *w)
+{
+    GByteArray *fb = g_byte_array_new();
+    fb_field_t  fields[1];
+    guint       header, slots, i;
+
+    header = fb_message(fb, ARROW_HEADER_SCHEMA, 0);
+
+    fb_offset(&fields[0], 1);                   /* fields */
+    fb_set_offset(fb, header, fb_table(fb, fields, G_N_ELEMENTS(fields)));
+
+    fb_set_offset(fb, (guint)fields[0].value, fb_vector(fb, w->num_columns, 4));
+    slots = fb->len;
+    for (i = 0; i < w->num_columns; i++)
+        put_le(fb, 0, 4);
+    for (i = 0; i < w->num_columns; i++)
+        arrow_write_field(fb, &w->columns[i], slots + 4 * i);
+
+    arrow_write_message(w, fb, NULL);
+    g_byte_array_free(fb, TRUE);
+}
+
+/* Add a buffer to a RecordBatch's body, and its Buffer to "buffers" */
+static void
+arrow_add_buffer(GByteArray *body, GByteArray *buffers, const GByteArray *buffer)
+{
+    put_le(buffers, body->len, 8);
+    put_le(buffers, buffer->len, 8);
+    g_byte_array_append(body, buffer->data, buffer->len);
+    fb_pad(body, 8, 0);
+}
+
+static void
+arrow_column_reset(arrow_column_t *column)
+{
+    column->null_count = 0;
+    g_byte_array_set_size(column->validity, 0);
+    g_byte_array_set_size(column->data, 0);
+    if (column->offsets != NULL) {
+        g_byte_array_set_size(column->offsets, 0);
+        put_le(column->offsets, 0, 4);
+    }
+}
+
+static void
+arrow_write_batch(arrow_writer_t *w)
+{
+    GByteArray     *fb = g_byte_array_new();
+    GByteArray     *body = g_byte_array_new();
+    GByteArray     *buffers = g_byte_array_new();
+    arrow_column_t *column;
+    fb_field_t      fields[3];
+    guint           header, i;
+
+    for (i = 0; i < w->num_columns; i++) {
+        column = &w->columns[i];
+        arrow_add_buffer(body, buffers, column->validity);
+        if (column->offsets != NULL)
+            arrow_add_buffer(body, buffers, column->offsets);
+        arrow_add_buffer(body, buffers, column->data);
+    }
+
+    header = fb_message(fb, ARROW_HEADER_RECORD_BATCH, body->len);
+
+    fb_scalar(&fields[0], 0, 8, w->rows);       /* length */
+    fb_offset(&fields[1], 1);                   /* nodes */
+    fb_offset(&fields[2], 2);                   /* buffers */
+    fb_set_offset(fb, header, fb_table(fb, fields, G_N_ELEMENTS(fields)));
+
+    fb_set_offset(fb, (guint)fields[1].value, fb_vector(fb, w->num_columns, 8));
+    for (i = 0; i < w->num_columns; i++) {
+        put_le(fb, w->rows, 8);
+        put_le(fb, w->columns[i].null_count, 8);
+    }
+    fb_set_offset(fb, (guint)fields[2].value, fb_vector(fb, buffers->len / 16, 8));
+    g_byte_array_append(fb, buffers->data, buffers->len);
+
+    arrow_write_message(w, fb, body);
+    g_byte_array_free(fb, TRUE);
+    g_byte_array_free(body, TRUE);
+    g_byte_array_free(buffers, TRUE);
+
+    for (i = 0; i < w->num_columns; i++)
+        arrow_column_reset(&w->columns[i]);
+    w->rows = 0;
+}
+
+/*
+ * Pick the column's type from the type of the field. Fields with the same
+ * name but different types, and the types Arrow has no equivalent for,
+ * are written as strings.
+ */
+static void
+arrow_column_set_type(arrow_column_t *column)
+{
+    header_field_info *hfinfo;
+
+    column->type = ARROW_TYPE_UTF8;
+    column->width = 0;
+    column->is_signed = FALSE;
+
+    if (column->hfinfo == NULL)
+        return;
+    for (hfinfo = column->hfinfo->same_name_next; hfinfo; hfinfo = hfinfo->same_name_next) {
+        if (hfinfo->type != column->hfinfo->type)
+            return;
+    }
+
+    switch (column->hfinfo->type) {
+
+    case FT_BOOLEAN:
+        column->type = ARROW_TYPE_BOOL;
+        break;
+
+    case FT_INT8:
+        column->is_signed = TRUE;
+        /* FALL THROUGH */
+    case FT_CHAR:
+    case FT_UINT8:
+        column->type = ARROW_TYPE_INT;
+        column->width = 1;
+        break;
+
+    case FT_INT16:
+        column->is_signed = TRUE;
+        /* FALL THROUGH */
+    case FT_UINT16:
+        column->type = ARROW_TYPE_INT;
+        column->width = 2;
+        break;
+
+    case FT_INT24:
+    case FT_INT32:
+        column->is_signed = TRUE;
+        /* FALL THROUGH */
+    case FT_UINT24:
+    case FT_UINT32:
+    case FT_FRAMENUM:
+    case FT_IPXNET:
+        column->type = ARROW_TYPE_INT;
+        column->width = 4;
+        break;
+
+    case FT_INT40:
+    case FT_INT48:
+    case FT_INT56:
+    case FT_INT64:
+        column->is_signed = TRUE;
+        /* FALL THROUGH */
+    case FT_UINT40:
+    case FT_UINT48:
+    case FT_UINT56:
+    case FT_UINT64:
+    case FT_EUI64:
+        column->type = ARROW_TYPE_INT;
+        column->width = 8;
+        break;
+
+    case FT_FLOAT:
+        column->type = ARROW_TYPE_FLOATING_POINT;
+        column->width = 4;
+        break;
+
+    case FT_DOUBLE:
+        column->type = ARROW_TYPE_FLOATING_POINT;
+        column->width = 8;
+        break;
+
+    case FT_ABSOLUTE_TIME:
+        column->type = ARROW_TYPE_TIMESTAMP;
+        column->width = 8;
+        break;
+
+    case FT_RELATIVE_TIME:
+        column->type = ARROW_TYPE_DURATION;
+        column->width = 8;
+        break;
+
+    case FT_IPv4:
+        column->type = ARROW_TYPE_FIXED_SIZE_BINARY;
+        column->width = 4;
+        break;
+
+    case FT_IPv6:
+        column->type = ARROW_TYPE_FIXED_SIZE_BINARY;
+        column->width = 16;
+        break;
+
+    case FT_ETHER:
+        column->type = ARROW_TYPE_FIXED_SIZE_BINARY;
+        column->width = 6;
+        break;
+
+    case FT_BYTES:
+    case FT_UINT_BYTES:
+    case FT_OID:
+    case FT_REL_OID:
+    case FT_SYSTEM_ID:
+    case FT_AX25:
+    case FT_VINES:
+        column->type = ARROW_TYPE_BINARY;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void
+arrow_bitmap_append(GByteArray *bitmap, guint row, gboolean set)
+{
+    if (row % 8 == 0)
+        g_byte_array_append(bitmap, zeroes, 1);
+    if (set)
+        bitmap->data[row / 8] |= 1 << (row % 8);
+}
+
+static void
+arrow_column_append_null(arrow_column_t *column, guint row)
+{
+    arrow_bitmap_append(column->validity, row, FALSE);
+    column->null_count++;
+
+    if (column->type == ARROW_TYPE_BOOL)
+        arrow_bitmap_append(column->data, row, FALSE);
+    else if (column->offsets != NULL)
+        put_le(column->offsets, column->data->len, 4);
+    else {
+        /* FixedSizeBinary values, such as IPv6 addresses, are wider
+           than put_le() handles */
+        guint len = column->data->len;
+
+        g_byte_array_set_size(column->data, len + column->width);
+        memset(column->data->data + len, 0, column->width);
+    }
+}
+
+static void
+arrow_column_append_bytes(arrow_column_t *column, guint row, const guint8 *bytes, guint len)
+{
+    if (column->offsets == NULL && len != column->width) {
+        arrow_column_append_null(column, row);
+        return;
+    }
+
+    arrow_bitmap_append(column->validity, row, TRUE);
+    g_byte_array_append(column->data, bytes, len);
+    if (column->offsets != NULL)
+        put_le(column->offsets, column->data->len, 4);
+}
+
+static void
+arrow_column_append_integer(arrow_column_t *column, guint row, guint64 value)
+{
+    arrow_bitmap_append(column->validity, row, TRUE);
+    put_le(column->data, value, column->width);
+}
+
+static void
+arrow_column_append_string(arrow_column_t *column, guint row, const gchar *str)
+{
+    arrow_column_append_bytes(column, row, (const guint8 *)str, (guint)strlen(str));
+}
+
+static void
+arrow_column_append_field(arrow_column_t *column, guint row, field_info *fi, epan_dissect_t *edt)
+{
+    fvalue_t       *fv = &fi->value;
+    const nstime_t *ts;
+    gfloat          f;
+    gdouble         d;
+    guint32         u32;
+    guint64         u64;
+    gchar          *str;
+
+    if (column->type == ARROW_TYPE_UTF8) {
+        str = get_node_field_value(fi, edt);
+        if (str != NULL)
+            arrow_column_append_string(column, row, str);
+        else
+            arrow_column_append_null(column, row);
+        g_free(str);
+        return;
+    }
+
+    switch (fi->hfinfo->type) {
+
+    case FT_BOOLEAN:
+        arrow_bitmap_append(column->validity, row, TRUE);
+        arrow_bitmap_append(column->data, row, fvalue_get_uinteger64(fv) != 0);
+        break;
+
+    case FT_CHAR:
+    case FT_UINT8:
+    case FT_UINT16:
+    case FT_UINT24:
+    case FT_UINT32:
+    case FT_FRAMENUM:
+    case FT_IPXNET:
+        arrow_column_append_integer(column, row, fvalue_get_uinteger(fv));
+        break;
+
+    case FT_UINT40:
+    case FT_UINT48:
+    case FT_UINT56:
+    case FT_UINT64:
+    case FT_EUI64:
+        arrow_column_append_integer(column, row, fvalue_get_uinteger64(fv));
+        break;
+
+    case FT_INT8:
+    case FT_INT16:
+    case FT_INT24:
+    case FT_INT32:
+        arrow_column_append_integer(column, row, (guint64)(gint64)fvalue_get_sinteger(fv));
+        break;
+
+    case FT_INT40:
+    case FT_INT48:
+    case FT_INT56:
+    case FT_INT64:
+        arrow_column_append_integer(column, row, (guint64)fvalue_get_sinteger64(fv));
+        break;
+
+    case FT_FLOAT:
+        f = (gfloat)fvalue_get_floating(fv);
+        memcpy(&u32, &f, sizeof u32);
+        arrow_column_append_integer(column, row, u32);
+        break;
+
+    case FT_DOUBLE:
+        d = fvalue_get_floating(fv);
+        memcpy(&u64, &d, sizeof u64);
+        arrow_column_append_integer(column, row, u64);
+        break;
+
+    case FT_ABSOLUTE_TIME:
+    case FT_RELATIVE_TIME:
+        ts = (const nstime_t *)fvalue_get(fv);
+        arrow_column_append_integer(column, row,
+            (guint64)((gint64)ts->secs * G_GINT64_CONSTANT(1000000000) + ts->nsecs));
+        break;
+
+    case FT_IPv4:
+        /* Already in network byte order */
+        u32 = fvalue_get_uinteger(fv);
+        arrow_column_append_bytes(column, row, (const guint8 *)&u32, 4);
+        break;
+
+    case FT_IPv6:
+        arrow_column_append_bytes(column, row, (const guint8 *)fvalue_get(fv), fvalue_length(fv));
+        break;
+
+    default:
+        /* The byte types */
+        if (fv->value.bytes != NULL)
+            arrow_column_append_bytes(column, row, fv->value.bytes->data, fv->value.bytes->len);
+        else
+            arrow_column_append_bytes(column, row, NULL, 0);
+        break;
+    }
+}
+
+/*
+ * The occurrence of the field to write. There's only one value per packet,
+ * so the "all occurrences" option writes the first. If fields with the
+ * same name are both in the packet, the first or last of the first of
+ * them found is used.
+ */
+static field_info *
+arrow_column_find_finfo(arrow_writer_t *w, arrow_column_t *column, epan_dissect_t *edt)
+{
+    header_field_info *hfinfo;
+    GPtrArray         *finfos;
+
+    for (hfinfo = column->hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+        finfos = proto_get_finfo_ptr_array(edt->tree, hfinfo->id);
+        if (finfos != NULL && finfos->len > 0)
+            return (field_info *)g_ptr_array_index(finfos, w->last_occurrence ? finfos->len - 1 : 0);
+    }
+    return NULL;
+}
+
+arrow_writer_t *
+write_arrow_preamble(output_fields_t *fields, column_info *cinfo, FILE *fh)
+{
+    arrow_writer_t *w;
+    arrow_column_t *column;
+    guint           i;
+    int             col;
+
+    g_assert(fields);
+    g_assert(fh);
+
+    w = g_new0(arrow_writer_t, 1);
+    w->fh = fh;
+    w->last_occurrence = output_fields_get_occurrence(fields) == 'l';
+    w->num_columns = (guint)output_fields_num_fields(fields);
+    w->columns = g_new0(arrow_column_t, w->num_columns);
+
+    for (i = 0; i < w->num_columns; i++) {
+        column = &w->columns[i];
+        column->name = output_fields_get_field(fields, i);
+        column->col = -1;
+
+        if (!strncmp(column->name, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER))) {
+            for (col = 0; cinfo != NULL && col < cinfo->num_cols; col++) {
+                if (get_column_visible(col) &&
+                    !strcmp(column->name + strlen(COLUMN_FIELD_FILTER), cinfo->columns[col].col_title)) {
+                    column->col = col;
+                    break;
+                }
+            }
+        } else {
+            column->hfinfo = proto_registrar_get_byname(column->name);
+        }
+        arrow_column_set_type(column);
+
+        column->validity = g_byte_array_sized_new(ARROW_BATCH_ROWS / 8);
+        if (column->type == ARROW_TYPE_BOOL) {
+            column->data = g_byte_array_sized_new(ARROW_BATCH_ROWS / 8);
+        } else if (column->width != 0) {
+            column->data = g_byte_array_sized_new(ARROW_BATCH_ROWS * column->width);
+        } else {
+            column->data = g_byte_array_new();
+            column->offsets = g_byte_array_sized_new((ARROW_BATCH_ROWS + 1) * 4);
+        }
+        arrow_column_reset(column);
+    }
+
+    arrow_write_schema(w);
+    return w;
+}
+
+void
+write_arrow_proto_tree(arrow_writer_t *w, epan_dissect_t *edt, column_info *cinfo)
+{
+    arrow_column_t *column;
+    field_info     *fi;
+    gboolean        batch_full = FALSE;
+    guint           i;
+
+    g_assert(w);
+    g_assert(edt);
+
+    for (i = 0; i < w->num_columns; i++) {
+        column = &w->columns[i];
+
+        if (column->col >= 0) {
+            if (cinfo != NULL && cinfo->columns[column->col].col_data != NULL)
+                arrow_column_append_string(column, w->rows, cinfo->columns[column->col].col_data);
+            else
+                arrow_column_append_null(column, w->rows);
+        } else if (column->hfinfo != NULL &&
+                   (fi = arrow_column_find_finfo(w, column, edt)) != NULL) {
+            arrow_column_append_field(column, w->rows, fi, edt);
+        } else {
+            arrow_column_append_null(column, w->rows);
+        }
+
+        if (column->offsets != NULL && column->data->len >= ARROW_MAX_DATA_LEN)
+            batch_full = TRUE;
+    }
+
+    w->rows++;
+    if (w->rows == ARROW_BATCH_ROWS || batch_full)
+        arrow_write_batch(w);
+}
+
+void
+write_arrow_finale(arrow_writer_t *w)
+{
+    guint32 eos[2];
+    guint   i;
+
+    g_assert(w);
+
+    if (w->rows > 0)
+        arrow_write_batch(w);
+
+    eos[0] = 0xFFFFFFFF;
+    eos[1] = 0;
+    fwrite(eos, sizeof eos, 1, w->fh);
+
+    for (i = 0; i < w->num_columns; i++) {
+        g_byte_array_free(w->columns[i].validity, TRUE);
+        g_byte_array_free(w->columns[i].data, TRUE);
+        if (w->columns[i].offsets != NULL)
+            g_byte_array_free(w->columns[i].offsets, TRUE);
+    }
+    g_free(w->columns);
+    g_free(w);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -735,6 +735,9 @@ proto_tree_reset(proto_tree *tree)
 		g_hash_table_remove_all(tree_data->interesting_hfids);
 	}
 
+	if (tree_data->pending_values)
+		g_array_set_size(tree_data->pending_values, 0);
+
 	/* Reset track of the number of children */
 	tree_data->count = 0;
 
@@ -759,6 +762,9 @@ proto_tree_free(proto_tree *tree)
 		g_hash_table_destroy(tree_data->interesting_hfids);
 	}
 
+	if (tree_data->pending_values)
+		g_array_free(tree_data->pending_values, TRUE);
+
 	g_slice_free(tree_data_t, tree_data);
 
 	g_slice_free(proto_tree, tree);
@@ -784,6 +790,12 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols)
 	PTREE_DATA(tree)->fake_protocols = fake_protocols;
 }
 
+void
+proto_tree_set_record_fields(proto_tree *tree, gboolean record_fields)
+{
+	PTREE_DATA(tree)->record_fields = record_fields;
+}
+
 /* Assume dissector set only its protocol fields.
    This function is called by dissectors and allows the speeding up of filtering
    in wireshark; if this function returns FALSE it is safe to reset tree to NULL
@@ -2078,6 +2090,140 @@ test_length(header_field_info *hfinfo, tvbuff_t *tvb,
 	tvb_ensure_bytes_exist(tvb, start, size);
 }
 
+/*
+ * A field whose value will be decoded when it's looked up.  By then
+ * the tvbuff the field came from may have been freed - dissectors free
+ * temporary tvbuffs, and tvbuffs backed by packet-scope memory go away
+ * when the packet scope is left - so the field's bytes are copied, with
+ * a terminating NUL, into the tree's pool, which lasts as long as the
+ * tree.
+ */
+typedef struct {
+	field_info   *fi;
+	const guint8 *data;
+	gint          length;
+	guint         encoding;
+} pending_value_t;
+
+/*
+ * Can we record this field, rather than decoding its value now?
+ * Only fields whose length is already known, and whose value can be
+ * decoded later without an exception or an expert info item, are
+ * recorded; the others aren't worth it.
+ */
+static inline gboolean
+can_record_field(const proto_tree *tree, const header_field_info *hfinfo,
+		 const guint encoding)
+{
+	const tree_data_t *tree_data = PTREE_DATA(tree);
+
+	if (!tree_data->record_fields || tree_data->visible)
+		return FALSE;
+
+	switch (hfinfo->type) {
+
+	case FT_BYTES:
+		return TRUE;
+
+	case FT_STRING:
+		return (encoding & ENC_CHARENCODING_MASK) == ENC_ASCII ||
+		       (encoding & ENC_CHARENCODING_MASK) == ENC_UTF_8;
+
+	default:
+		return FALSE;
+	}
+}
+
+/* Add an item to a proto_tree without decoding its value, which is
+   decoded from a copy of its bytes when the field is looked up. The
+   caller has checked with test_length() that the item's bytes are
+   there. */
+static proto_item *
+proto_tree_record_item(field_info *new_fi, proto_tree *tree,
+		       tvbuff_t *tvb, gint start, gint length,
+		       guint encoding)
+{
+	tree_data_t     *tree_data = PTREE_DATA(tree);
+	pending_value_t  pending;
+	guint8          *data;
+
+	if (tree_data->pending_values == NULL)
+		tree_data->pending_values = g_array_new(FALSE, FALSE, sizeof (pending_value_t));
+
+	data = (guint8 *)wmem_alloc(PNODE_POOL(tree), length + 1);
+	if (length > 0)
+		tvb_memcpy(tvb, data, start, length);
+	data[length] = '\0';
+
+	pending.fi       = new_fi;
+	pending.data     = data;
+	pending.length   = length;
+	pending.encoding = encoding;
+	g_array_append_val(tree_data->pending_values, pending);
+
+	FI_SET_FLAG(new_fi, FI_VALUE_PENDING);
+	FI_SET_FLAG(new_fi, (encoding & ENC_LITTLE_ENDIAN) ? FI_LITTLE_ENDIAN : FI_BIG_ENDIAN);
+
+	return proto_tree_add_node(tree, new_fi);
+}
+
+static void
+decode_pending_value(wmem_allocator_t *pool, const pending_value_t *pending)
+{
+	field_info *fi = pending->fi;
+
+	if (!FI_GET_FLAG(fi, FI_VALUE_PENDING))
+		return;
+	FI_RESET_FLAG(fi, FI_VALUE_PENDING);
+
+	switch (fi->hfinfo->type) {
+
+	case FT_BYTES:
+		proto_tree_set_bytes(fi, pending->data, pending->length);
+		break;
+
+	case FT_STRING:
+		/* As tvb_get_string_enc() would, for these encodings */
+		if ((pending->encoding & ENC_CHARENCODING_MASK) == ENC_UTF_8)
+			proto_tree_set_string(fi, (const char *)pending->data);
+		else
+			proto_tree_set_string(fi, (const char *)get_ascii_string(pool,
+			    pending->data, pending->length));
+		break;
+
+	default:
+		DISSECTOR_ASSERT_NOT_REACHED();
+	}
+}
+
+/* Decode the recorded values of a field, or of all fields if id is -1 */
+static void
+tree_data_decode_pending_values(tree_data_t *tree_data, const int id)
+{
+	GArray *pending_values = tree_data->pending_values;
+	guint   i;
+
+	if (pending_values == NULL || pending_values->len == 0)
+		return;
+
+	for (i = 0; i < pending_values->len; i++) {
+		const pending_value_t *pending = &g_array_index(pending_values, pending_value_t, i);
+
+		if (id == -1 || pending->fi->hfinfo->id == id)
+			decode_pending_value(tree_data->pinfo->pool, pending);
+	}
+
+	if (id == -1)
+		g_array_set_size(pending_values, 0);
+}
+
+void
+proto_tree_decode_recorded_fields(proto_tree *tree)
+{
+	if (tree)
+		tree_data_decode_pending_values(PTREE_DATA(tree), -1);
+}
+
 /* Add an item to a proto_tree, using the text label registered to that item;
    the item is extracted from the tvbuff handed to it. */
 static proto_item *
@@ -3164,6 +3310,9 @@ proto_tree_add_item_new(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *t
 
 	new_fi = new_field_info(tree, hfinfo, tvb, start, item_length);
 
+	if (can_record_field(tree, hfinfo, encoding))
+		return proto_tree_record_item(new_fi, tree, tvb, start, length, encoding);
+
 	return proto_tree_new_item(new_fi, tree, tvb, start, length, encoding);
 }
 
@@ -3218,7 +3367,10 @@ proto_tree_add_item_new_ret_length(proto_tree *tree, header_field_info *hfinfo,
 
 	new_fi = new_field_info(tree, hfinfo, tvb, start, item_length);
 
-	item = proto_tree_new_item(new_fi, tree, tvb, start, length, encoding);
+	if (can_record_field(tree, hfinfo, encoding))
+		item = proto_tree_record_item(new_fi, tree, tvb, start, length, encoding);
+	else
+		item = proto_tree_new_item(new_fi, tree, tvb, start, length, encoding);
 	*lenretval = new_fi->length;
 	return item;
 }
@@ -6246,6 +6398,10 @@ proto_tree_create_root(packet_info *pinfo)
 	/* Make sure that we fake protocols (if possible) */
 	pnode->tree_data->fake_protocols = TRUE;
 
+	/* Decode field values as they're added */
+	pnode->tree_data->record_fields = FALSE;
+	pnode->tree_data->pending_values = NULL;
+
 	/* Keep track of the number of children */
 	pnode->tree_data->count = 0;
 
@@ -9444,6 +9600,8 @@ proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 	if (!tree)
 		return NULL;
 
+	tree_data_decode_pending_values(PTREE_DATA(tree), id);
+
 	if (PTREE_DATA(tree)->interesting_hfids != NULL)
 		return (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
 					   GINT_TO_POINTER(id));
@@ -9517,6 +9675,7 @@ proto_find_finfo(proto_tree *tree, const int id)
 	ffdata.array = g_ptr_array_new();
 	ffdata.id = id;
 
+	proto_tree_decode_recorded_fields(tree);
 	proto_tree_traverse_pre_order(tree, find_finfo, &ffdata);
 
 	return ffdata.array;
@@ -9536,6 +9695,7 @@ proto_find_first_finfo(proto_tree *tree, const int id)
 	ffdata.array = g_ptr_array_new();
 	ffdata.id = id;
 
+	proto_tree_decode_recorded_fields(tree);
 	proto_tree_traverse_pre_order(tree, find_first_finfo, &ffdata);
 
 	return ffdata.array;
@@ -9564,6 +9724,7 @@ proto_all_finfos(proto_tree *tree)
 	ffdata.array = g_ptr_array_sized_new(512);
 	ffdata.id = 0;
 
+	proto_tree_decode_recorded_fields(tree);
 	proto_tree_traverse_pre_order(tree, every_finfo, &ffdata);
 
 	return ffdata.array;
@@ -725,6 +725,9 @@ typedef struct
 #define FI_BITS_SIZE(n)         (((n) & 63) << 8)
 /** The protocol field value is a varint */
 #define FI_VARINT               0x00004000
+/** The protocol field value was recorded but hasn't been decoded yet;
+ * see proto_tree_set_record_fields() */
+#define FI_VALUE_PENDING        0x00008000
 
 /** convenience macro to get field_info.flags */
 #define FI_GET_FLAG(fi, flag)   ((fi) ? ((fi)->flags & (flag)) : 0)
@@ -750,6 +753,8 @@ typedef struct {
     GHashTable  *interesting_hfids;
     gboolean     visible;
     gboolean     fake_protocols;
+    gboolean     record_fields;
+    GArray      *pending_values;    /* recorded fields whose values aren't decoded yet */
     gint         count;
     struct _packet_info *pinfo;
 } tree_data_t;
@@ -1013,6 +1018,23 @@ proto_tree_set_visible(proto_tree *tree, gboolean visible);
 extern void
 proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 
+/** Indicate whether the values of some fields added to an invisible tree
+ should only be recorded, and decoded when they're first looked up
+ (default = FALSE). This saves decoding the strings and byte arrays of
+ fields that a display filter or a tap doesn't get to, but any code that
+ reads field values from the tree must get the fields with
+ proto_get_finfo_ptr_array(), proto_find_finfo(), proto_find_first_finfo()
+ or proto_all_finfos(), or call proto_tree_decode_recorded_fields() first.
+ @param tree the tree to be set
+ @param record_fields TRUE if we should record fields */
+WS_DLL_PUBLIC void
+proto_tree_set_record_fields(proto_tree *tree, gboolean record_fields);
+
+/** Decode the values of all the fields recorded in a tree.
+ @param tree the tree */
+WS_DLL_PUBLIC void
+proto_tree_decode_recorded_fields(proto_tree *tree);
+
 /** Mark a field/protocol ID as "interesting".
  @param tree the tree to be set (currently ignored)
  @param hfid the interesting field id
@@ -10,6 +10,7 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <epan/packet.h>
@@ -422,6 +423,177 @@ reassembly_table_register(reassembly_table *table,
 	reassembly_table_list = g_list_prepend(reassembly_table_list, reg_table);
 }
 
+/*
+ * Eviction of old reassemblies, for long-running single-pass captures.
+ */
+static guint32 reassembly_max_age = 0;
+static guint reassembly_max_incomplete = 0;
+static guint32 reassembly_next_sweep = 0;
+static reassembly_eviction_stats_t reassembly_evicted;
+
+typedef struct {
+	guint32 threshold;		/* evict reassemblies last added to before this frame */
+	guint count;			/* number evicted */
+	GPtrArray *allocated_fragments;
+} reassembly_evict_ctx_t;
+
+typedef struct {
+	gpointer key;
+	guint32 frame;
+} reassembly_age_t;
+
+void
+reassembly_set_max_age(const guint32 frames)
+{
+	reassembly_max_age = frames;
+}
+
+void
+reassembly_set_max_incomplete(const guint max_incomplete)
+{
+	reassembly_max_incomplete = max_incomplete;
+}
+
+void
+reassembly_get_eviction_stats(reassembly_eviction_stats_t *stats)
+{
+	*stats = reassembly_evicted;
+}
+
+static gboolean
+free_old_fragments(gpointer key_arg, gpointer value, gpointer user_data)
+{
+	reassembly_evict_ctx_t *ctx = (reassembly_evict_ctx_t *)user_data;
+	fragment_head *fd_head = (fragment_head *)value;
+
+	/* fd_head->frame is the latest frame with a fragment */
+	if (fd_head->frame >= ctx->threshold)
+		return FALSE;
+	ctx->count++;
+	return free_all_fragments(key_arg, value, NULL);
+}
+
+static gboolean
+free_old_reassembled_fragments(gpointer key_arg, gpointer value,
+			       gpointer user_data)
+{
+	reassembly_evict_ctx_t *ctx = (reassembly_evict_ctx_t *)user_data;
+	fragment_head *fd_head = (fragment_head *)value;
+
+	/*
+	 * Every entry for a reassembled packet refers to the same
+	 * fd_head, so they're all removed together.
+	 */
+	if (MAX(fd_head->frame, fd_head->reassembled_in) >= ctx->threshold)
+		return FALSE;
+	if (fd_head->flags != FD_VISITED_FREE)
+		ctx->count++;
+	return free_all_reassembled_fragments(key_arg, value, ctx->allocated_fragments);
+}
+
+static void
+reassembly_table_evict_old(reassembly_table *table, const guint32 threshold)
+{
+	reassembly_evict_ctx_t ctx;
+
+	ctx.threshold = threshold;
+	ctx.count = 0;
+	if (table->fragment_table != NULL)
+		g_hash_table_foreach_remove(table->fragment_table,
+					    free_old_fragments, &ctx);
+	reassembly_evicted.incomplete_evicted += ctx.count;
+
+	ctx.count = 0;
+	if (table->reassembled_table != NULL) {
+		ctx.allocated_fragments = g_ptr_array_new();
+		g_hash_table_foreach_remove(table->reassembled_table,
+				free_old_reassembled_fragments, &ctx);
+		g_ptr_array_foreach(ctx.allocated_fragments, free_fragments, NULL);
+		g_ptr_array_free(ctx.allocated_fragments, TRUE);
+	}
+	reassembly_evicted.reassembled_evicted += ctx.count;
+}
+
+static int
+reassembly_age_compare(const void *a, const void *b)
+{
+	const reassembly_age_t *age_a = (const reassembly_age_t *)a;
+	const reassembly_age_t *age_b = (const reassembly_age_t *)b;
+
+	if (age_a->frame < age_b->frame)
+		return -1;
+	return age_a->frame > age_b->frame;
+}
+
+/*
+ * Free the incomplete reassemblies in a table with the oldest latest
+ * fragments, leaving "keep" of them.
+ */
+static void
+reassembly_table_evict_oldest(reassembly_table *table, const guint keep)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	reassembly_age_t *ages;
+	guint n_ages, i;
+
+	n_ages = g_hash_table_size(table->fragment_table);
+	ages = g_new(reassembly_age_t, n_ages);
+	i = 0;
+	g_hash_table_iter_init(&iter, table->fragment_table);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		ages[i].key = key;
+		ages[i].frame = ((fragment_head *)value)->frame;
+		i++;
+	}
+	qsort(ages, n_ages, sizeof ages[0], reassembly_age_compare);
+
+	for (i = 0; i + keep < n_ages; i++) {
+		value = g_hash_table_lookup(table->fragment_table, ages[i].key);
+		free_all_fragments(ages[i].key, value, NULL);
+		/* This frees the key */
+		g_hash_table_remove(table->fragment_table, ages[i].key);
+		reassembly_evicted.incomplete_evicted++;
+	}
+	g_free(ages);
+}
+
+void
+reassembly_tables_evict(const guint32 frame_num)
+{
+	register_reassembly_table_t *reg_table;
+	GList *entry;
+
+	if (reassembly_max_age != 0 && frame_num >= reassembly_next_sweep &&
+	    frame_num > reassembly_max_age) {
+		/*
+		 * Sweeping goes through every reassembly, so don't do it
+		 * for every frame; reassemblies are freed once they're
+		 * between max_age and 5/4 max_age frames old.
+		 */
+		for (entry = reassembly_table_list; entry != NULL; entry = entry->next) {
+			reg_table = (register_reassembly_table_t *)entry->data;
+			reassembly_table_evict_old(reg_table->table,
+			    frame_num - reassembly_max_age);
+		}
+		reassembly_next_sweep = frame_num + MAX(reassembly_max_age / 4, 1);
+	}
+
+	if (reassembly_max_incomplete != 0) {
+		for (entry = reassembly_table_list; entry != NULL; entry = entry->next) {
+			reg_table = (register_reassembly_table_t *)entry->data;
+			/*
+			 * Free a quarter of them at a time, so that we
+			 * don't sort the table for every new reassembly.
+			 */
+			if (reg_table->table->fragment_table != NULL &&
+			    g_hash_table_size(reg_table->table->fragment_table) > reassembly_max_incomplete)
+				reassembly_table_evict_oldest(reg_table->table,
+				    reassembly_max_incomplete - reassembly_max_incomplete / 4);
+		}
+	}
+}
+
 /*
  * Initialize a reassembly table, with specified functions.
  */
@@ -907,6 +1079,65 @@ MERGE_FRAG(fragment_head *fd_head, fragment_item *fd)
 	}
 	fd_i->next = fd;
 }
+
+/*
+ * Instead of copying the fragments of a completed reassembly into a new
+ * buffer, hand their tvbuffs over to a composite tvbuff, which is only
+ * flattened if a dissector asks for a pointer spanning two fragments;
+ * it then frees the fragments' tvbuffs.  Those are usually lazy clones
+ * of their frames, which read their frame's data back in when it's
+ * first accessed, so each one can hold a whole frame's worth.
+ *
+ * That's only done if the fragments fit together exactly: no gaps, no
+ * overlaps or retransmissions, nothing past len, and every fragment
+ * owning its data (not a subset of an earlier reassembly).  Anything
+ * else goes through the copying code, which flags those problems.
+ *
+ * by_seq is TRUE if the fragment offsets are block sequence numbers
+ * rather than byte offsets.  Returns NULL if the fragments weren't
+ * joined, in which case they're left untouched.
+ */
+static tvbuff_t *
+fragment_join_tvbs(fragment_head *fd_head, const guint32 len, const gboolean by_seq)
+{
+	fragment_item *fd_i;
+	tvbuff_t *joined = NULL;
+	guint32 pos = 0, seq = 0;
+	guint count = 0;
+
+	for (fd_i=fd_head->next; fd_i; fd_i=fd_i->next) {
+		if (by_seq && fd_i->offset != seq++)
+			return NULL;
+		if (!fd_i->len)
+			continue;
+		if ((!by_seq && fd_i->offset != pos) ||
+		    fd_i->len > len - pos ||
+		    !fd_i->tvb_data || (fd_i->flags & FD_SUBSET_TVB) ||
+		    tvb_captured_length(fd_i->tvb_data) != fd_i->len)
+			return NULL;
+		pos += fd_i->len;
+		count++;
+	}
+	if (pos != len || count == 0)
+		return NULL;
+
+	if (count > 1)
+		joined = tvb_new_owning_composite();
+	for (fd_i=fd_head->next; fd_i; fd_i=fd_i->next) {
+		if (!fd_i->len)
+			continue;
+		if (count == 1)
+			joined = fd_i->tvb_data;
+		else
+			tvb_composite_append(joined, fd_i->tvb_data);
+		fd_i->tvb_data = NULL;
+	}
+	if (count > 1)
+		tvb_composite_finalize(joined);
+
+	return joined;
+}
+
 /*
  * This function adds a new fragment to the fragment hash table.
  * If this is the first fragment seen for this datagram, a new entry
@@ -1134,125 +1365,128 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
-	data = (guint8 *) g_malloc(fd_head->datalen);
-	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
-
-	/* add all data fragments */
-	for (dfpos=0,fd_i=fd_head;fd_i;fd_i=fd_i->next) {
-		if (fd_i->len) {
-			/*
-			 * The loop above that calculates max also
-			 * ensures that the only gaps that exist here
-			 * are ones where a fragment starts past the
-			 * end of the reassembled datagram, and there's
-			 * a gap between the previous fragment and
-			 * that fragment.
-			 *
-			 * A "DESEGMENT_UNTIL_FIN" was involved wherein the
-			 * FIN packet had an offset less than the highest
-			 * fragment offset seen. [Seen from a fuzz-test:
-			 * bug #2470]).
-			 *
-			 * Note that the "overlap" compare must only be
-			 * done for fragments with (offset+len) <= fd_head->datalen
-			 * and thus within the newly g_malloc'd buffer.
-			 */
-			if (fd_i->offset + fd_i->len > dfpos) {
-				if (fd_i->offset >= fd_head->datalen) {
-					/*
-					 * Fragment starts after the end
-					 * of the reassembled packet.
-					 *
-					 * This can happen if the length was
-					 * set after the offending fragment
-					 * was added to the reassembly.
-					 *
-					 * Flag this fragment, but don't
-					 * try to extract any data from
-					 * it, as there's no place to put
-					 * it.
-					 *
-					 * XXX - add different flag value
-					 * for this.
-					 */
-					fd_i->flags    |= FD_TOOLONGFRAGMENT;
-					fd_head->flags |= FD_TOOLONGFRAGMENT;
-				} else if (dfpos < fd_i->offset) {
-					/*
-					 * XXX - can this happen?  We've
-					 * already rejected fragments that
-					 * start past the end of the
-					 * reassembled datagram, and
-					 * the loop that calculated max
-					 * should have ruled out gaps,
-					 * but could fd_i->offset +
-					 * fd_i->len overflow?
-					 */
-					fd_head->error = "dfpos < offset";
-				} else if (dfpos - fd_i->offset > fd_i->len)
-					fd_head->error = "dfpos - offset > len";
-				else if (!fd_head->tvb_data)
-					fd_head->error = "no data";
-				else {
-					fraglen = fd_i->len;
-					if (fd_i->offset + fraglen > fd_head->datalen) {
+	fd_head->tvb_data = fragment_join_tvbs(fd_head, fd_head->datalen, FALSE);
+	if (!fd_head->tvb_data) {
+		data = (guint8 *) g_malloc(fd_head->datalen);
+		fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+
+		/* add all data fragments */
+		for (dfpos=0,fd_i=fd_head;fd_i;fd_i=fd_i->next) {
+			if (fd_i->len) {
+				/*
+				 * The loop above that calculates max also
+				 * ensures that the only gaps that exist here
+				 * are ones where a fragment starts past the
+				 * end of the reassembled datagram, and there's
+				 * a gap between the previous fragment and
+				 * that fragment.
+				 *
+				 * A "DESEGMENT_UNTIL_FIN" was involved wherein the
+				 * FIN packet had an offset less than the highest
+				 * fragment offset seen. [Seen from a fuzz-test:
+				 * bug #2470]).
+				 *
+				 * Note that the "overlap" compare must only be
+				 * done for fragments with (offset+len) <= fd_head->datalen
+				 * and thus within the newly g_malloc'd buffer.
+				 */
+				if (fd_i->offset + fd_i->len > dfpos) {
+					if (fd_i->offset >= fd_head->datalen) {
 						/*
-						 * Fragment goes past the end
-						 * of the packet, as indicated
-						 * by the last fragment.
+						 * Fragment starts after the end
+						 * of the reassembled packet.
+						 *
+						 * This can happen if the length was
+						 * set after the offending fragment
+						 * was added to the reassembly.
 						 *
-						 * This can happen if the
-						 * length was set after the
-						 * offending fragment was
-						 * added to the reassembly.
+						 * Flag this fragment, but don't
+						 * try to extract any data from
+						 * it, as there's no place to put
+						 * it.
 						 *
-						 * Mark it as such, and only
-						 * copy from it what fits in
-						 * the packet.
+						 * XXX - add different flag value
+						 * for this.
 						 */
 						fd_i->flags    |= FD_TOOLONGFRAGMENT;
 						fd_head->flags |= FD_TOOLONGFRAGMENT;
-						fraglen = fd_head->datalen - fd_i->offset;
-					}
-					if (fd_i->offset < dfpos) {
-						guint32 cmp_len = MIN(fd_i->len,(dfpos-fd_i->offset));
-
-						fd_i->flags    |= FD_OVERLAP;
-						fd_head->flags |= FD_OVERLAP;
-						if ( memcmp(data + fd_i->offset,
-								tvb_get_ptr(fd_i->tvb_data, 0, cmp_len),
-								cmp_len)
-								 ) {
-							fd_i->flags    |= FD_OVERLAPCONFLICT;
-							fd_head->flags |= FD_OVERLAPCONFLICT;
-						}
-					}
-					if (fraglen < dfpos - fd_i->offset) {
+					} else if (dfpos < fd_i->offset) {
 						/*
-						 * XXX - can this happen?
+						 * XXX - can this happen?  We've
+						 * already rejected fragments that
+						 * start past the end of the
+						 * reassembled datagram, and
+						 * the loop that calculated max
+						 * should have ruled out gaps,
+						 * but could fd_i->offset +
+						 * fd_i->len overflow?
 						 */
-						fd_head->error = "fraglen < dfpos - offset";
-					} else {
-						memcpy(data+dfpos,
-							tvb_get_ptr(fd_i->tvb_data, (dfpos-fd_i->offset), fraglen-(dfpos-fd_i->offset)),
-							fraglen-(dfpos-fd_i->offset));
-						dfpos=MAX(dfpos, (fd_i->offset + fraglen));
+						fd_head->error = "dfpos < offset";
+					} else if (dfpos - fd_i->offset > fd_i->len)
+						fd_head->error = "dfpos - offset > len";
+					else if (!fd_head->tvb_data)
+						fd_head->error = "no data";
+					else {
+						fraglen = fd_i->len;
+						if (fd_i->offset + fraglen > fd_head->datalen) {
+							/*
+							 * Fragment goes past the end
+							 * of the packet, as indicated
+							 * by the last fragment.
+							 *
+							 * This can happen if the
+							 * length was set after the
+							 * offending fragment was
+							 * added to the reassembly.
+							 *
+							 * Mark it as such, and only
+							 * copy from it what fits in
+							 * the packet.
+							 */
+							fd_i->flags    |= FD_TOOLONGFRAGMENT;
+							fd_head->flags |= FD_TOOLONGFRAGMENT;
+							fraglen = fd_head->datalen - fd_i->offset;
+						}
+						if (fd_i->offset < dfpos) {
+							guint32 cmp_len = MIN(fd_i->len,(dfpos-fd_i->offset));
+
+							fd_i->flags    |= FD_OVERLAP;
+							fd_head->flags |= FD_OVERLAP;
+							if ( memcmp(data + fd_i->offset,
+									tvb_get_ptr(fd_i->tvb_data, 0, cmp_len),
+									cmp_len)
+									 ) {
+								fd_i->flags    |= FD_OVERLAPCONFLICT;
+								fd_head->flags |= FD_OVERLAPCONFLICT;
+							}
+						}
+						if (fraglen < dfpos - fd_i->offset) {
+							/*
+							 * XXX - can this happen?
+							 */
+							fd_head->error = "fraglen < dfpos - offset";
+						} else {
+							memcpy(data+dfpos,
+								tvb_get_ptr(fd_i->tvb_data, (dfpos-fd_i->offset), fraglen-(dfpos-fd_i->offset)),
+								fraglen-(dfpos-fd_i->offset));
+							dfpos=MAX(dfpos, (fd_i->offset + fraglen));
+						}
+					}
+				} else {
+					if (fd_i->offset + fd_i->len < fd_i->offset) {
+						/* Integer overflow? */
+						fd_head->error = "offset + len < offset";
 					}
 				}
-			} else {
-				if (fd_i->offset + fd_i->len < fd_i->offset) {
-					/* Integer overflow? */
-					fd_head->error = "offset + len < offset";
-				}
-			}
 
-			if (fd_i->flags & FD_SUBSET_TVB)
-				fd_i->flags &= ~FD_SUBSET_TVB;
-			else if (fd_i->tvb_data)
-				tvb_free(fd_i->tvb_data);
+				if (fd_i->flags & FD_SUBSET_TVB)
+					fd_i->flags &= ~FD_SUBSET_TVB;
+				else if (fd_i->tvb_data)
+					tvb_free(fd_i->tvb_data);
 
-			fd_i->tvb_data=NULL;
+				fd_i->tvb_data=NULL;
+			}
 		}
 	}
 
@@ -1577,32 +1811,35 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 
 	/* store old data in case the fd_i->data pointers refer to it */
 	old_tvb_data=fd_head->tvb_data;
-	data = (guint8 *) g_malloc(size);
-	fd_head->tvb_data = tvb_new_real_data(data, size, size);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
-	fd_head->len = size;		/* record size for caller	*/
+	fd_head->tvb_data = fragment_join_tvbs(fd_head, size, TRUE);
+	if (!fd_head->tvb_data) {
+		data = (guint8 *) g_malloc(size);
+		fd_head->tvb_data = tvb_new_real_data(data, size, size);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
 
-	/* add all data fragments */
-	last_fd=NULL;
-	for (fd_i=fd_head->next; fd_i; fd_i=fd_i->next) {
-		if (fd_i->len) {
-			if(!last_fd || last_fd->offset != fd_i->offset) {
-				/* First fragment or in-sequence fragment */
-				memcpy(data+dfpos, tvb_get_ptr(fd_i->tvb_data, 0, fd_i->len), fd_i->len);
-				dfpos += fd_i->len;
-			} else {
-				/* duplicate/retransmission/overlap */
-				fd_i->flags    |= FD_OVERLAP;
-				fd_head->flags |= FD_OVERLAP;
-				if(last_fd->len != fd_i->len
-				   || tvb_memeql(last_fd->tvb_data, 0, tvb_get_ptr(fd_i->tvb_data, 0, last_fd->len), last_fd->len) ) {
-					fd_i->flags    |= FD_OVERLAPCONFLICT;
-					fd_head->flags |= FD_OVERLAPCONFLICT;
+		/* add all data fragments */
+		last_fd=NULL;
+		for (fd_i=fd_head->next; fd_i; fd_i=fd_i->next) {
+			if (fd_i->len) {
+				if(!last_fd || last_fd->offset != fd_i->offset) {
+					/* First fragment or in-sequence fragment */
+					memcpy(data+dfpos, tvb_get_ptr(fd_i->tvb_data, 0, fd_i->len), fd_i->len);
+					dfpos += fd_i->len;
+				} else {
+					/* duplicate/retransmission/overlap */
+					fd_i->flags    |= FD_OVERLAP;
+					fd_head->flags |= FD_OVERLAP;
+					if(last_fd->len != fd_i->len
+					   || tvb_memeql(last_fd->tvb_data, 0, tvb_get_ptr(fd_i->tvb_data, 0, last_fd->len), last_fd->len) ) {
+						fd_i->flags    |= FD_OVERLAPCONFLICT;
+						fd_head->flags |= FD_OVERLAPCONFLICT;
+					}
 				}
 			}
+			last_fd=fd_i;
 		}
-		last_fd=fd_i;
 	}
+	fd_head->len = size;		/* record size for caller	*/
 
 	/* we have defragmented the pdu, now free all fragments*/
 	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
@@ -2808,6 +3045,9 @@ static void
 reassembly_table_init_reg_tables(void)
 {
 	g_list_foreach(reassembly_table_list, reassembly_table_init_reg_table, NULL);
+
+	reassembly_next_sweep = 0;
+	memset(&reassembly_evicted, 0, sizeof reassembly_evicted);
 }
 
 static void
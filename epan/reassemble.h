@@ -450,6 +450,50 @@ WS_DLL_PUBLIC gboolean
 show_fragment_seq_tree(fragment_head *ipfd_head, const fragment_items *fit,
     proto_tree *tree, packet_info *pinfo, tvbuff_t *tvb, proto_item **fi);
 
+/*
+ * Eviction of old reassemblies.
+ *
+ * A long-running single-pass capture, such as "tshark -i", would
+ * otherwise keep every reassembly it ever saw, including ones that will
+ * never be completed.  Eviction is off by default; it must be set up
+ * before the first frame is dissected, and can't be used if frames are
+ * dissected more than once.  It only applies to reassembly tables
+ * registered with reassembly_table_register().
+ */
+typedef struct {
+	guint64 incomplete_evicted;	/* reassemblies freed before being completed */
+	guint64 reassembled_evicted;	/* completed reassemblies freed */
+} reassembly_eviction_stats_t;
+
+/*
+ * Free reassemblies, complete or not, to which no fragment has been
+ * added in the given number of frames; 0, the default, means they're
+ * never freed for being old.
+ */
+WS_DLL_PUBLIC void
+reassembly_set_max_age(const guint32 frames);
+
+/*
+ * Free the incomplete reassemblies with the oldest latest fragments when
+ * a reassembly table has more than the given number of them; 0, the
+ * default, means there's no limit.
+ */
+WS_DLL_PUBLIC void
+reassembly_set_max_incomplete(const guint max_incomplete);
+
+/*
+ * Get the number of reassemblies evicted so far in this file.
+ */
+WS_DLL_PUBLIC void
+reassembly_get_eviction_stats(reassembly_eviction_stats_t *stats);
+
+/*
+ * Free the reassemblies that are due to be evicted; called before each
+ * frame is first dissected.
+ */
+extern void
+reassembly_tables_evict(const guint32 frame_num);
+
 /* Initialize internal structures
  */
 extern void reassembly_tables_init(void);
@@ -196,6 +196,7 @@ static void
 test_simple_fragment_add_seq(void)
 {
     fragment_head *fd_head, *fdh0;
+    const guint8 *ptr;
 
     printf("Starting test test_simple_fragment_add_seq\n");
 
@@ -275,6 +276,11 @@ test_simple_fragment_add_seq(void)
     ASSERT(!tvb_memeql(fd_head->tvb_data,50,data+15,60));
     ASSERT(!tvb_memeql(fd_head->tvb_data,110,data+5,60));
 
+    /* the fragments aren't copied, so check a pointer that spans two */
+    ptr = tvb_get_ptr(fd_head->tvb_data,40,20);
+    ASSERT(!memcmp(ptr,data+50,10));
+    ASSERT(!memcmp(ptr+10,data+15,10));
+
 #if 0
     print_fragment_table();
 #endif
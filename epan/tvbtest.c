@@ -16,8 +16,10 @@
 #include <string.h>
 
 #include "tvbuff.h"
+#include "tvbuff-int.h"
 #include "exceptions.h"
 #include "wsutil/pint.h"
+#include "wsutil/ws_mempbrk.h"
 
 gboolean failed = FALSE;
 
@@ -273,6 +275,67 @@ test(tvbuff_t *tvb, const gchar* name,
 	return TRUE;
 }
 
+/* Tests searching a tvbuff against searching the expected pattern.
+ * If "contiguous" is FALSE, the tvbuff must be searched without making
+ * its data contiguous.
+ * Returns TRUE if all tests succeed, FALSE if any test fails */
+gboolean
+test_search(tvbuff_t *tvb, const gchar* name,
+     const guint8* expected_data, guint expected_length, gboolean contiguous)
+{
+	static const guint8	needles[] = { 0, 3, 4, 130, 255 };
+	ws_mempbrk_pattern	pattern;
+	const guint8		*found;
+	gint			expected, result;
+	guchar			found_needle;
+	guint			i, offset, maxlength;
+
+	ws_mempbrk_compile(&pattern, "\x07\x80");
+
+	for (offset = 0; offset <= expected_length; offset += 5) {
+		for (maxlength = 0; maxlength <= expected_length - offset; maxlength += 7) {
+			for (i = 0; i < G_N_ELEMENTS(needles); i++) {
+				found = (const guint8 *)memchr(expected_data + offset, needles[i], maxlength);
+				expected = found ? (gint)(found - expected_data) : -1;
+				result = tvb_find_guint8(tvb, offset, maxlength, needles[i]);
+				if (result != expected) {
+					printf("13: Failed TVB=%s Offset=%u Length=%u Needle=%u "
+							"Found at %d, expected %d\n",
+							name, offset, maxlength, needles[i], result, expected);
+					failed = TRUE;
+					return FALSE;
+				}
+			}
+
+			found = NULL;
+			for (i = offset; i < offset + maxlength && found == NULL; i++) {
+				if (expected_data[i] == 0x07 || expected_data[i] == 0x80)
+					found = &expected_data[i];
+			}
+			expected = found ? (gint)(found - expected_data) : -1;
+			found_needle = 0;
+			result = tvb_ws_mempbrk_pattern_guint8(tvb, offset, maxlength, &pattern, &found_needle);
+			if (result != expected || (found != NULL && found_needle != *found)) {
+				printf("14: Failed TVB=%s Offset=%u Length=%u "
+						"pbrk found at %d, expected %d\n",
+						name, offset, maxlength, result, expected);
+				failed = TRUE;
+				return FALSE;
+			}
+		}
+	}
+
+	if (!contiguous && tvb->real_data != NULL) {
+		printf("15: Failed TVB=%s Searching made the data contiguous\n", name);
+		failed = TRUE;
+		return FALSE;
+	}
+
+	printf("Passed search TVB=%s\n", name);
+
+	return TRUE;
+}
+
 gboolean
 skip(tvbuff_t *tvb _U_, gchar* name,
 		guint8* expected_data _U_, guint expected_length _U_)
@@ -301,10 +364,12 @@ run_tests(void)
 	guint		subset_length[6];
 	guint		subset_reported_length[6];
 	guint8		temp;
-	guint8		*comp[6];
-	tvbuff_t	*tvb_comp[6];
-	guint		comp_length[6];
-	guint		comp_reported_length[6];
+	guint8		*comp[7];
+	tvbuff_t	*tvb_comp[7];
+	guint		comp_length[7];
+	guint		comp_reported_length[7];
+	guint8		*member;
+	tvbuff_t	*tvb_member;
 	int		len;
 
 	tvb_parent = tvb_new_real_data("", 0, 0);
@@ -464,6 +529,27 @@ run_tests(void)
 	tvb_composite_append(tvb_comp[5], tvb_comp[3]);
 	tvb_composite_finalize(tvb_comp[5]);
 
+	/* Many reals, owned by the composite */
+	printf("Making Composite 6\n");
+	tvb_comp[6]		= tvb_new_owning_composite();
+	comp_length[6]		= 0;
+	comp_reported_length[6]	= 0;
+	comp[6]			= (guint8*)g_malloc(64 * 4);
+	for (i = 0; i < 64; i++) {
+		member = g_new(guint8, 4);
+		for (j = 0; j < 4; j++) {
+			member[j] = 4 * i + j;
+			comp[6][comp_length[6] + j] = member[j];
+		}
+		/* only the last one has more reported than captured data */
+		tvb_member = tvb_new_real_data(member, 4, i == 63 ? 5 : 4);
+		tvb_set_free_cb(tvb_member, g_free);
+		tvb_composite_append(tvb_comp[6], tvb_member);
+		comp_length[6] += 4;
+		comp_reported_length[6] += i == 63 ? 5 : 4;
+	}
+	tvb_composite_finalize(tvb_comp[6]);
+
 	/* Test the "composite" tvbuff objects. */
 	test(tvb_comp[0], "Composite 0", comp[0], comp_length[0], comp_reported_length[0]);
 	test(tvb_comp[1], "Composite 1", comp[1], comp_length[1], comp_reported_length[1]);
@@ -471,6 +557,11 @@ run_tests(void)
 	test(tvb_comp[3], "Composite 3", comp[3], comp_length[3], comp_reported_length[3]);
 	test(tvb_comp[4], "Composite 4", comp[4], comp_length[4], comp_reported_length[4]);
 	test(tvb_comp[5], "Composite 5", comp[5], comp_length[5], comp_reported_length[5]);
+	/* Searching a composite doesn't flatten it; test() does, after
+	 * which an owning composite has only its flattened copy */
+	test_search(tvb_comp[6], "Composite 6", comp[6], comp_length[6], FALSE);
+	test(tvb_comp[6], "Composite 6", comp[6], comp_length[6], comp_reported_length[6]);
+	test_search(tvb_comp[6], "Composite 6 flattened", comp[6], comp_length[6], TRUE);
 
 	/* free memory. */
 	/* Don't free: comp[0] */
@@ -479,8 +570,10 @@ run_tests(void)
 	g_free(comp[3]);
 	g_free(comp[4]);
 	g_free(comp[5]);
+	g_free(comp[6]);
 
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
+	tvb_free(tvb_comp[6]);  /* not in that chain; frees its members too */
 }
 
 /* Note: valgrind can be used to check for tvbuff memory leaks */
@@ -204,6 +204,10 @@ extern void tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member);
 /** Create an empty composite tvbuff. */
 WS_DLL_PUBLIC tvbuff_t *tvb_new_composite(void);
 
+/** Create an empty composite tvbuff that takes ownership of its members:
+ * it isn't chained to them, and frees them when it is freed. */
+WS_DLL_PUBLIC tvbuff_t *tvb_new_owning_composite(void);
+
 /** Mark a composite tvbuff as initialized. No further appends or prepends
  * occur, data access can finally happen after this finalization. */
 WS_DLL_PUBLIC void tvb_composite_finalize(tvbuff_t *tvb);
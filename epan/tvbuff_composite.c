@@ -14,6 +14,7 @@
 #include "tvbuff.h"
 #include "tvbuff-int.h"
 #include "proto.h"	/* XXX - only used for DISSECTOR_ASSERT, probably a new header file? */
+#include "wmem/wmem.h"
 
 typedef struct {
 	GSList		*tvbs;
@@ -24,6 +25,26 @@ typedef struct {
 	guint		*start_offsets;
 	guint		*end_offsets;
 
+	/* The members as an array, filled in when the composite is
+	 * finalized, so that the member holding an offset can be found
+	 * with a binary search of end_offsets. */
+	tvbuff_t	**members;
+	guint		num_members;
+
+	/* The member found by the last lookup; sequential access
+	 * usually hits it or the one after it again. */
+	guint		last_member;
+
+	/* TRUE if the members are freed along with the composite,
+	 * rather than being in its chain. */
+	gboolean	owns_members;
+
+	/* If an owning composite is flattened while a packet is being
+	 * dissected, the scope at whose end its members are freed, and
+	 * the id of the callback that frees them. */
+	wmem_allocator_t *release_scope;
+	guint		release_cb_id;
+
 } tvb_comp_t;
 
 struct tvb_composite {
@@ -33,15 +54,46 @@ struct tvb_composite {
 };
 
 static void
-composite_free(tvbuff_t *tvb)
+composite_free_members(tvb_comp_t *composite)
 {
-	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	tvb_comp_t *composite = &composite_tvb->composite;
+	GSList	   *slist;
 
+	if (composite->owns_members) {
+		for (slist = composite->tvbs; slist != NULL; slist = slist->next)
+			tvb_free((tvbuff_t *)slist->data);
+	}
 	g_slist_free(composite->tvbs);
+	composite->tvbs = NULL;
 
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
+	g_free(composite->members);
+	composite->start_offsets = NULL;
+	composite->end_offsets = NULL;
+	composite->members = NULL;
+	composite->num_members = 0;
+}
+
+static gboolean
+composite_release_members(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_,
+    void *user_data)
+{
+	tvb_comp_t *composite = (tvb_comp_t *)user_data;
+
+	composite->release_scope = NULL;
+	composite_free_members(composite);
+	return FALSE;
+}
+
+static void
+composite_free(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+
+	if (composite->release_scope != NULL)
+		wmem_unregister_callback(composite->release_scope, composite->release_cb_id);
+	composite_free_members(composite);
 	if (tvb->real_data) {
 		/*
 		 * XXX - do this with a union?
@@ -54,42 +106,74 @@ static guint
 composite_offset(const tvbuff_t *tvb, const guint counter)
 {
 	const struct tvb_composite *composite_tvb = (const struct tvb_composite *) tvb;
-	const tvbuff_t *member = (const tvbuff_t *)composite_tvb->composite.tvbs->data;
+	const tvbuff_t *member;
 
+	/* An owning composite that has been flattened has no members left */
+	if (composite_tvb->composite.tvbs == NULL)
+		return counter;
+	member = (const tvbuff_t *)composite_tvb->composite.tvbs->data;
 	return tvb_offset_from_real_beginning_counter(member, counter);
 }
 
+/*
+ * Find the member holding abs_offset; returns num_members if abs_offset
+ * is past the end of the last member.
+ */
+static guint
+composite_find_member(tvb_comp_t *composite, const guint abs_offset)
+{
+	guint i = composite->last_member;
+	guint low, high, mid;
+
+	if (abs_offset >= composite->start_offsets[i]) {
+		if (abs_offset <= composite->end_offsets[i])
+			return i;
+		if (i + 1 < composite->num_members &&
+		    abs_offset <= composite->end_offsets[i + 1]) {
+			composite->last_member = i + 1;
+			return i + 1;
+		}
+	}
+
+	/* Find the first member that ends at or after abs_offset */
+	low = 0;
+	high = composite->num_members;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (composite->end_offsets[mid] < abs_offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low < composite->num_members)
+		composite->last_member = low;
+	return low;
+}
+
 static const guint8*
 composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -104,6 +188,19 @@ composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 		void *real_data = g_malloc(tvb->length);
 		tvb_memcpy(tvb, real_data, 0, tvb->length);
 		tvb->real_data = (const guint8 *)real_data;
+
+		/* The copy is all we need from now on, so don't keep the
+		 * members' data as well; but pointers into the members may
+		 * have been handed out for the packet being dissected, so
+		 * they're only freed at its end. */
+		if (composite->owns_members) {
+			if (wmem_in_packet_scope()) {
+				composite->release_scope = wmem_packet_scope();
+				composite->release_cb_id = wmem_register_callback(composite->release_scope,
+				    composite_release_members, composite);
+			} else
+				composite_free_members(composite);
+		}
 		return tvb->real_data + abs_offset;
 	}
 
@@ -116,33 +213,25 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	guint8 *target = (guint8 *) _target;
 
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset, member_length;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
-	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	composite = &composite_tvb->composite;
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return target;
 	}
 
+	member_tvb = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -155,19 +244,28 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 		 * then iterate across the other member tvb's, copying their portions
 		 * until we have copied all data.
 		 */
-		member_length = tvb_captured_length_remaining(member_tvb, member_offset);
-
-		/* composite_memcpy() can't handle a member_length of zero. */
-		DISSECTOR_ASSERT(member_length > 0);
-
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
-		abs_length	-= member_length;
-
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
+		guint8 *dest = target;
+
+		for (;;) {
+			member_length = tvb_captured_length_remaining(member_tvb, member_offset);
+
+			/* We can't make progress with a member_length of zero. */
+			DISSECTOR_ASSERT(member_length > 0);
+
+			if (member_length > abs_length)
+				member_length = abs_length;
+			tvb_memcpy(member_tvb, dest, member_offset, member_length);
+			dest		+= member_length;
+			abs_length	-= member_length;
+			if (abs_length == 0)
+				break;
+
+			i++;
+			DISSECTOR_ASSERT(i < composite->num_members);
+			member_tvb = composite->members[i];
+			member_offset = 0;
 		}
+		composite->last_member = i;
 
 		return target;
 	}
@@ -175,6 +273,62 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 	DISSECTOR_ASSERT_NOT_REACHED();
 }
 
+/*
+ * Search the members in turn, rather than flattening the composite to
+ * search it.
+ */
+static gint
+composite_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
+	guint	    member_offset, member_length;
+	gint	    result;
+
+	i = composite_find_member(composite, abs_offset);
+	member_offset = abs_offset - (i < composite->num_members ? composite->start_offsets[i] : 0);
+
+	for (; limit != 0 && i < composite->num_members; i++) {
+		member_length = tvb_captured_length_remaining(composite->members[i], member_offset);
+		if (member_length > limit)
+			member_length = limit;
+		result = tvb_find_guint8(composite->members[i], member_offset, member_length, needle);
+		if (result != -1)
+			return composite->start_offsets[i] + result;
+		limit -= member_length;
+		member_offset = 0;
+	}
+
+	return -1;
+}
+
+static gint
+composite_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern* pattern, guchar *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
+	guint	    member_offset, member_length;
+	gint	    result;
+
+	i = composite_find_member(composite, abs_offset);
+	member_offset = abs_offset - (i < composite->num_members ? composite->start_offsets[i] : 0);
+
+	for (; limit != 0 && i < composite->num_members; i++) {
+		member_length = tvb_captured_length_remaining(composite->members[i], member_offset);
+		if (member_length > limit)
+			member_length = limit;
+		result = tvb_ws_mempbrk_pattern_guint8(composite->members[i], member_offset, member_length, pattern, found_needle);
+		if (result != -1)
+			return composite->start_offsets[i] + result;
+		limit -= member_length;
+		member_offset = 0;
+	}
+
+	return -1;
+}
+
 static const struct tvb_ops tvb_composite_ops = {
 	sizeof(struct tvb_composite), /* size */
 
@@ -182,8 +336,8 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_guint8 XXX */
-	NULL,                 /* pbrk_guint8 XXX */
+	composite_find_guint8, /* find_guint8 */
+	composite_pbrk_guint8, /* pbrk_guint8 */
 	NULL,                 /* clone */
 };
 
@@ -205,6 +359,29 @@ tvb_new_composite(void)
 	composite->tvbs		 = NULL;
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
+	composite->last_member	 = 0;
+	composite->owns_members	 = FALSE;
+	composite->release_scope = NULL;
+	composite->release_cb_id = 0;
+
+	return tvb;
+}
+
+/*
+ *   2. An owning composite tvb isn't chained to its members; instead, it
+ *      takes them over and frees them when it is freed itself.  Each member
+ *      must therefore be the head of its own chain, and must not be freed
+ *      or added to another composite tvb by the caller.
+ */
+tvbuff_t *
+tvb_new_owning_composite(void)
+{
+	tvbuff_t *tvb = tvb_new_composite();
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+
+	composite_tvb->composite.owns_members = TRUE;
 
 	return tvb;
 }
@@ -272,10 +449,13 @@ tvb_composite_finalize(tvbuff_t *tvb)
 
 	composite->start_offsets = g_new(guint, num_members);
 	composite->end_offsets = g_new(guint, num_members);
+	composite->members = g_new(tvbuff_t *, num_members);
+	composite->num_members = num_members;
 
 	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
 		DISSECTOR_ASSERT((guint) i < num_members);
 		member_tvb = (tvbuff_t *)slist->data;
+		composite->members[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
@@ -286,7 +466,8 @@ tvb_composite_finalize(tvbuff_t *tvb)
 
 	DISSECTOR_ASSERT(composite->tvbs);
 
-	tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb); /* chain composite tvb to first member */
+	if (!composite->owns_members)
+		tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb); /* chain composite tvb to first member */
 	tvb->initialized = TRUE;
 	tvb->ds_tvb = tvb;
 }
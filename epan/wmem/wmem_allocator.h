@@ -41,6 +41,11 @@ struct _wmem_allocator_t {
     void                        *private_data;
     enum _wmem_allocator_type_t  type;
     gboolean                     in_scope;
+
+    /* Number of allocations made and bytes requested by them, for
+     * wmem_get_alloc_count() and wmem_get_alloc_bytes() */
+    guint64                      alloc_count;
+    guint64                      alloc_bytes;
 };
 
 #ifdef __cplusplus
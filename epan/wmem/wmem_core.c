@@ -43,6 +43,9 @@ wmem_alloc(wmem_allocator_t *allocator, const size_t size)
         return NULL;
     }
 
+    allocator->alloc_count++;
+    allocator->alloc_bytes += size;
+
     return allocator->walloc(allocator->private_data, size);
 }
 
@@ -95,6 +98,9 @@ wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
 
     g_assert(allocator->in_scope);
 
+    allocator->alloc_count++;
+    allocator->alloc_bytes += size;
+
     return allocator->wrealloc(allocator->private_data, ptr, size);
 }
 
@@ -118,6 +124,18 @@ wmem_gc(wmem_allocator_t *allocator)
     allocator->gc(allocator->private_data);
 }
 
+guint64
+wmem_get_alloc_count(wmem_allocator_t *allocator)
+{
+    return allocator->alloc_count;
+}
+
+guint64
+wmem_get_alloc_bytes(wmem_allocator_t *allocator)
+{
+    return allocator->alloc_bytes;
+}
+
 void
 wmem_destroy_allocator(wmem_allocator_t *allocator)
 {
@@ -144,6 +162,8 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     allocator->type      = real_type;
     allocator->callbacks = NULL;
     allocator->in_scope  = TRUE;
+    allocator->alloc_count = 0;
+    allocator->alloc_bytes = 0;
 
     switch (real_type) {
         case WMEM_ALLOCATOR_SIMPLE:
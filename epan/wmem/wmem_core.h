@@ -176,6 +176,28 @@ WS_DLL_PUBLIC
 void
 wmem_gc(wmem_allocator_t *allocator);
 
+/** Returns how many allocations and reallocations have been made from the
+ * allocator since it was created. Freeing memory doesn't change it, so the
+ * difference between two calls counts the allocations made in between.
+ *
+ * @param allocator The allocator to query.
+ * @return The number of allocations.
+ */
+WS_DLL_PUBLIC
+guint64
+wmem_get_alloc_count(wmem_allocator_t *allocator);
+
+/** Returns how many bytes have been requested from the allocator by
+ * allocations and reallocations since it was created; like
+ * wmem_get_alloc_count(), freeing memory doesn't change it.
+ *
+ * @param allocator The allocator to query.
+ * @return The number of bytes.
+ */
+WS_DLL_PUBLIC
+guint64
+wmem_get_alloc_bytes(wmem_allocator_t *allocator);
+
 /** Destroy the given allocator, freeing all memory allocated in it. Once this
  * function has been called, no memory allocated with the allocator is valid.
  *
@@ -10,6 +10,8 @@
  */
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
 #include "wmem_core.h"
@@ -18,7 +20,12 @@
 #include "wmem_map_int.h"
 #include "wmem_user_cb.h"
 
-static guint32 x; /* Used for universal integer hashing (see the HASH macro) */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WMEM_MAP_USE_SSE2
+#endif
+
+static guint64 x; /* Used for universal integer hashing (see the HASH macro) */
 
 /* Used for the wmem_strong_hash() function */
 static guint32 preseed;
@@ -27,30 +34,44 @@ static guint32 postseed;
 void
 wmem_init_hashing(void)
 {
-    x = g_random_int();
-    if G_UNLIKELY(x == 0)
-        x = 1;
+    x = ((guint64)g_random_int() << 32) | g_random_int() | 1;
 
     preseed  = g_random_int();
     postseed = g_random_int();
 }
 
-typedef struct _wmem_map_item_t {
+/*
+ * The map is an open-addressed table in the style of Abseil's "Swiss
+ * tables": keys and values are stored inline in an array of slots, and a
+ * parallel array holds one control byte per slot. A control byte is
+ * either EMPTY, DELETED or, for a used slot, the low 7 bits of the key's
+ * hash (its "H2"). Slots are probed a group at a time, so one SSE2
+ * compare (or a few integer operations elsewhere) finds every slot in the
+ * group whose key could match, and only those keys are compared with
+ * eql_func.
+ */
+typedef struct _wmem_map_slot_t {
     const void *key;
     void *value;
-    struct _wmem_map_item_t *next;
-} wmem_map_item_t;
+} wmem_map_slot_t;
 
 struct _wmem_map_t {
     guint count; /* number of items stored */
 
+    /* number of items we can still add before growing; DELETED slots
+     * don't count as free, since they lengthen probe sequences */
+    guint growth_left;
+
     /* The base-2 logarithm of the actual size of the table. We store this
      * value for efficiency in hashing, since finding the actual capacity
      * becomes just a left-shift (see the CAPACITY macro) whereas taking
      * logarithms is expensive. */
     size_t capacity;
 
-    wmem_map_item_t **table;
+    /* both NULL until the first insertion; ctrl points just past the
+     * slots, in the same allocation */
+    wmem_map_slot_t *slots;
+    guint8 *ctrl;
 
     GHashFunc  hash_func;
     GEqualFunc eql_func;
@@ -70,18 +91,153 @@ struct _wmem_map_t {
  * do the 2^x operation. */
 #define CAPACITY(MAP) (((size_t)1) << (MAP)->capacity)
 
+/* Fill the table to at most 7/8 of its capacity, which always leaves an
+ * EMPTY slot to end unsuccessful lookups. */
+#define MAX_LOAD(CAP) ((CAP) - (CAP) / 8)
+
 /* Efficient universal integer hashing:
  * https://en.wikipedia.org/wiki/Universal_hashing#Avoiding_modular_arithmetic
+ * The top 7 bits of the product are the H2 stored in the control byte,
+ * and the bits below them pick where probing starts.
  */
-#define HASH(MAP, KEY) \
-    ((guint32)(((MAP)->hash_func(KEY) * x) >> (32 - (MAP)->capacity)))
+#define HASH(MAP, KEY) ((guint64)(MAP)->hash_func(KEY) * x)
+#define H1(MAP, HASH)  ((size_t)(((HASH) << 7) >> (64 - (MAP)->capacity)))
+#define H2(HASH)       ((guint8)((HASH) >> 57))
+
+#define CTRL_EMPTY   ((guint8)0x80)
+#define CTRL_DELETED ((guint8)0xFE)
+#define IS_FULL(C)   (((C) & 0x80) == 0)
+
+/*
+ * Group probing. A bitmask has one bit set for each slot of a group that
+ * matches; GROUP_FIRST() gives the index of the lowest one, and
+ * GROUP_NEXT() clears it.
+ */
+#ifdef WMEM_MAP_USE_SSE2
+#define GROUP_WIDTH 16
+
+typedef guint32 wmem_map_bitmask_t;
+
+static inline wmem_map_bitmask_t
+group_match(const guint8 *ctrl, guint8 h2)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (wmem_map_bitmask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char)h2), group));
+}
+
+static inline wmem_map_bitmask_t
+group_match_empty(const guint8 *ctrl)
+{
+    return group_match(ctrl, CTRL_EMPTY);
+}
+
+static inline wmem_map_bitmask_t
+group_match_empty_or_deleted(const guint8 *ctrl)
+{
+    /* EMPTY and DELETED are the control bytes with the top bit set */
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (wmem_map_bitmask_t)_mm_movemask_epi8(group);
+}
+
+static inline guint
+bitmask_lowest(wmem_map_bitmask_t mask)
+{
+#if defined(__GNUC__)
+    return (guint)__builtin_ctz(mask);
+#else
+    guint i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+#else /* WMEM_MAP_USE_SSE2 */
+/* Without SSE2, we look at 8 control bytes at a time in a 64-bit integer;
+ * the bit for each slot is the top bit of its byte. */
+#define GROUP_WIDTH 8
+
+typedef guint64 wmem_map_bitmask_t;
+
+#define GROUP_LSBS G_GUINT64_CONSTANT(0x0101010101010101)
+#define GROUP_MSBS G_GUINT64_CONSTANT(0x8080808080808080)
+
+static inline guint64
+group_load(const guint8 *ctrl)
+{
+    guint64 group;
+
+    memcpy(&group, ctrl, sizeof group);
+    return GUINT64_FROM_LE(group);
+}
+
+static inline wmem_map_bitmask_t
+group_match(const guint8 *ctrl, guint8 h2)
+{
+    /* This can report a byte right after a matching one as matching too,
+     * but only if it's a used slot, so the worst that happens is an extra
+     * call to eql_func. */
+    guint64 cmp = group_load(ctrl) ^ (GROUP_LSBS * h2);
+    return (cmp - GROUP_LSBS) & ~cmp & GROUP_MSBS;
+}
+
+static inline wmem_map_bitmask_t
+group_match_empty(const guint8 *ctrl)
+{
+    /* EMPTY is the only control byte with the top bit set and bit 1 clear */
+    guint64 group = group_load(ctrl);
+    return group & (~group << 6) & GROUP_MSBS;
+}
+
+static inline wmem_map_bitmask_t
+group_match_empty_or_deleted(const guint8 *ctrl)
+{
+    return group_load(ctrl) & GROUP_MSBS;
+}
+
+static inline guint
+bitmask_lowest(wmem_map_bitmask_t mask)
+{
+#if defined(__GNUC__)
+    return (guint)__builtin_ctzll(mask) >> 3;
+#else
+    guint i = 0;
+    while (!(mask & 0x80)) {
+        mask >>= 8;
+        i++;
+    }
+    return i;
+#endif
+}
+#endif /* WMEM_MAP_USE_SSE2 */
+
+#define GROUP_NEXT(MASK) ((MASK) &= (MASK) - 1)
+
+/* Groups are aligned on GROUP_WIDTH slots, and visited in triangular order,
+ * which reaches every group of a power-of-two sized table. */
+#define PROBE_START(MAP, HASH) (H1(MAP, HASH) & ~(size_t)(GROUP_WIDTH - 1))
+#define PROBE_NEXT(MAP, POS, STEP) \
+    (((POS) + (STEP) * GROUP_WIDTH) & (CAPACITY(MAP) - 1))
+
+static void
+wmem_map_alloc_table(wmem_map_t *map, size_t capacity)
+{
+    size_t cap = ((size_t)1) << capacity;
+
+    map->capacity    = capacity;
+    map->slots       = (wmem_map_slot_t *)wmem_alloc(map->allocator,
+            cap * (sizeof(wmem_map_slot_t) + 1));
+    map->ctrl        = (guint8 *)(map->slots + cap);
+    map->growth_left = (guint)(MAX_LOAD(cap) - map->count);
+    memset(map->ctrl, CTRL_EMPTY, cap);
+}
 
 static void
 wmem_map_init_table(wmem_map_t *map)
 {
-    map->count     = 0;
-    map->capacity  = WMEM_MAP_DEFAULT_CAPACITY;
-    map->table     = wmem_alloc0_array(map->allocator, wmem_map_item_t*, CAPACITY(map));
+    map->count = 0;
+    wmem_map_alloc_table(map, WMEM_MAP_DEFAULT_CAPACITY);
 }
 
 wmem_map_t *
@@ -97,7 +253,8 @@ wmem_map_new(wmem_allocator_t *allocator,
     map->master    = allocator;
     map->allocator = allocator;
     map->count = 0;
-    map->table = NULL;
+    map->slots = NULL;
+    map->ctrl  = NULL;
 
     return map;
 }
@@ -109,7 +266,8 @@ wmem_map_reset_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event,
     wmem_map_t *map = (wmem_map_t*)user_data;
 
     map->count = 0;
-    map->table = NULL;
+    map->slots = NULL;
+    map->ctrl  = NULL;
 
     if (event == WMEM_CB_DESTROY_EVENT) {
         wmem_unregister_callback(map->master, map->master_cb_id);
@@ -143,7 +301,8 @@ wmem_map_new_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave,
     map->master    = master;
     map->allocator = slave;
     map->count = 0;
-    map->table = NULL;
+    map->slots = NULL;
+    map->ctrl  = NULL;
 
     map->master_cb_id = wmem_register_callback(master, wmem_map_destroy_cb, map);
     map->slave_cb_id  = wmem_register_callback(slave, wmem_map_reset_cb, map);
@@ -151,236 +310,235 @@ wmem_map_new_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave,
     return map;
 }
 
-static inline void
-wmem_map_grow(wmem_map_t *map)
+/* Returns the index of the slot holding key, or -1 if there isn't one */
+static inline gssize
+wmem_map_find(wmem_map_t *map, const void *key)
+{
+    wmem_map_bitmask_t mask;
+    guint64 hash;
+    size_t  pos, step;
+    guint8  h2;
+
+    /* Make sure we have a table */
+    if (map->slots == NULL) {
+        return -1;
+    }
+
+    hash = HASH(map, key);
+    h2   = H2(hash);
+    pos  = PROBE_START(map, hash);
+
+    for (step = 1; ; step++) {
+        mask = group_match(&map->ctrl[pos], h2);
+        while (mask) {
+            size_t i = pos + bitmask_lowest(mask);
+            if (map->eql_func(key, map->slots[i].key)) {
+                return (gssize)i;
+            }
+            GROUP_NEXT(mask);
+        }
+        /* a key is never placed beyond a group with an EMPTY slot */
+        if (group_match_empty(&map->ctrl[pos])) {
+            return -1;
+        }
+        pos = PROBE_NEXT(map, pos, step);
+    }
+}
+
+/* Returns the index of the first slot that a new key with this hash can go
+ * in */
+static inline size_t
+wmem_map_find_free(wmem_map_t *map, guint64 hash)
 {
-    wmem_map_item_t **old_table, *cur, *nxt;
-    size_t            old_cap, i;
-    guint             slot;
+    wmem_map_bitmask_t mask;
+    size_t pos, step;
+
+    pos = PROBE_START(map, hash);
+    for (step = 1; ; step++) {
+        mask = group_match_empty_or_deleted(&map->ctrl[pos]);
+        if (mask) {
+            return pos + bitmask_lowest(mask);
+        }
+        pos = PROBE_NEXT(map, pos, step);
+    }
+}
+
+static void
+wmem_map_rehash(wmem_map_t *map)
+{
+    wmem_map_slot_t *old_slots;
+    guint8          *old_ctrl;
+    size_t           old_cap, i, slot;
+    guint64          hash;
 
     /* store the old table and capacity */
-    old_table = map->table;
+    old_slots = map->slots;
+    old_ctrl  = map->ctrl;
     old_cap   = CAPACITY(map);
 
-    /* double the size (capacity is base-2 logarithm, so this just means
-     * increment it) and allocate new table */
-    map->capacity++;
-    map->table = wmem_alloc0_array(map->allocator, wmem_map_item_t*, CAPACITY(map));
+    /* If most of the room is taken up by DELETED slots rather than items,
+     * clearing those out is enough; otherwise double the size (capacity is
+     * base-2 logarithm, so this just means increment it) */
+    wmem_map_alloc_table(map, map->count < MAX_LOAD(old_cap) / 2 ?
+            map->capacity : map->capacity + 1);
 
     /* copy all the elements over from the old table */
     for (i=0; i<old_cap; i++) {
-        cur = old_table[i];
-        while (cur) {
-            nxt              = cur->next;
-            slot             = HASH(map, cur->key);
-            cur->next        = map->table[slot];
-            map->table[slot] = cur;
-            cur              = nxt;
+        if (IS_FULL(old_ctrl[i])) {
+            hash = HASH(map, old_slots[i].key);
+            slot = wmem_map_find_free(map, hash);
+            map->ctrl[slot]  = H2(hash);
+            map->slots[slot] = old_slots[i];
         }
     }
 
     /* free the old table */
-    wmem_free(map->allocator, old_table);
+    wmem_free(map->allocator, old_slots);
 }
 
 void *
 wmem_map_insert(wmem_map_t *map, const void *key, void *value)
 {
-    wmem_map_item_t **item;
-    void *old_val;
+    gssize   found;
+    size_t   slot;
+    guint64  hash;
+    void    *old_val;
 
     /* Make sure we have a table */
-    if (map->table == NULL) {
+    if (map->slots == NULL) {
         wmem_map_init_table(map);
     }
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
+    /* replace and return old value for this key */
+    found = wmem_map_find(map, key);
+    if (found >= 0) {
+        old_val = map->slots[found].value;
+        map->slots[found].value = value;
+        return old_val;
+    }
 
-    /* check existing items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* replace and return old value for this key */
-            old_val = (*item)->value;
-            (*item)->value = value;
-            return old_val;
+    /* insert new item, reusing a DELETED slot if we come across one first */
+    hash = HASH(map, key);
+    slot = wmem_map_find_free(map, hash);
+    if (map->ctrl[slot] == CTRL_EMPTY) {
+        /* make room if we are full */
+        if (map->growth_left == 0) {
+            wmem_map_rehash(map);
+            slot = wmem_map_find_free(map, hash);
         }
-        item = &((*item)->next);
+        map->growth_left--;
     }
 
-    /* insert new item */
-    (*item) = wmem_new(map->allocator, wmem_map_item_t);
-
-    (*item)->key   = key;
-    (*item)->value = value;
-    (*item)->next  = NULL;
+    map->ctrl[slot]        = H2(hash);
+    map->slots[slot].key   = key;
+    map->slots[slot].value = value;
 
     map->count++;
 
-    /* increase size if we are over-full */
-    if (map->count >= CAPACITY(map)) {
-        wmem_map_grow(map);
-    }
-
     /* no previous entry, return NULL */
     return NULL;
 }
 
-gboolean
-wmem_map_contains(wmem_map_t *map, const void *key)
+static inline void
+wmem_map_erase(wmem_map_t *map, size_t slot)
 {
-    wmem_map_item_t *item;
-
-    /* Make sure we have a table */
-    if (map->table == NULL) {
-        return FALSE;
-    }
-
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
-
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            return TRUE;
-        }
-        item = item->next;
+    size_t group = slot & ~(size_t)(GROUP_WIDTH - 1);
+
+    /* If the group still has an EMPTY slot, no probe sequence goes past
+     * it, so this slot can be EMPTY too; otherwise lookups must keep going
+     * past it. */
+    if (group_match_empty(&map->ctrl[group])) {
+        map->ctrl[slot] = CTRL_EMPTY;
+        map->growth_left++;
+    } else {
+        map->ctrl[slot] = CTRL_DELETED;
     }
+    map->count--;
+}
 
-    return FALSE;
+gboolean
+wmem_map_contains(wmem_map_t *map, const void *key)
+{
+    return wmem_map_find(map, key) >= 0;
 }
 
 void *
 wmem_map_lookup(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t *item;
+    gssize found;
 
-    /* Make sure we have a table */
-    if (map->table == NULL) {
+    found = wmem_map_find(map, key);
+    if (found < 0) {
         return NULL;
     }
 
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
-
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            return item->value;
-        }
-        item = item->next;
-    }
-
-    return NULL;
+    return map->slots[found].value;
 }
 
 gboolean
 wmem_map_lookup_extended(wmem_map_t *map, const void *key, const void **orig_key, void **value)
 {
-    wmem_map_item_t *item;
+    gssize found;
 
-    /* Make sure we have a table */
-    if (map->table == NULL) {
+    found = wmem_map_find(map, key);
+    if (found < 0) {
         return FALSE;
     }
 
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
-
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            if (orig_key) {
-                *orig_key = item->key;
-            }
-            if (value) {
-                *value = item->value;
-            }
-            return TRUE;
-        }
-        item = item->next;
+    if (orig_key) {
+        *orig_key = map->slots[found].key;
     }
-
-    return FALSE;
+    if (value) {
+        *value = map->slots[found].value;
+    }
+    return TRUE;
 }
 
 void *
 wmem_map_remove(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t **item, *tmp;
+    gssize found;
     void *value;
 
-    /* Make sure we have a table */
-    if (map->table == NULL) {
+    found = wmem_map_find(map, key);
+    if (found < 0) {
+        /* didn't find it */
         return NULL;
     }
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check the items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* found it */
-            tmp     = (*item);
-            value   = tmp->value;
-            (*item) = tmp->next;
-            wmem_free(map->allocator, tmp);
-            map->count--;
-            return value;
-        }
-        item = &((*item)->next);
-    }
-
-    /* didn't find it */
-    return NULL;
+    value = map->slots[found].value;
+    wmem_map_erase(map, (size_t)found);
+    return value;
 }
 
 gboolean
 wmem_map_steal(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t **item, *tmp;
+    gssize found;
 
-    /* Make sure we have a table */
-    if (map->table == NULL) {
+    found = wmem_map_find(map, key);
+    if (found < 0) {
+        /* didn't find it */
         return FALSE;
     }
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check the items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* found it */
-            tmp     = (*item);
-            (*item) = tmp->next;
-            map->count--;
-            return TRUE;
-        }
-        item = &((*item)->next);
-    }
-
-    /* didn't find it */
-    return FALSE;
+    wmem_map_erase(map, (size_t)found);
+    return TRUE;
 }
 
 wmem_list_t*
 wmem_map_get_keys(wmem_allocator_t *list_allocator, wmem_map_t *map)
 {
     size_t capacity, i;
-    wmem_map_item_t *cur;
     wmem_list_t* list = wmem_list_new(list_allocator);
 
-    if (map->table != NULL) {
+    if (map->slots != NULL) {
         capacity = CAPACITY(map);
 
         /* copy all the elements into the list over from table */
         for (i=0; i<capacity; i++) {
-            cur = map->table[i];
-            while (cur) {
-                wmem_list_prepend(list, (void*)cur->key);
-                cur = cur->next;
+            if (IS_FULL(map->ctrl[i])) {
+                wmem_list_prepend(list, (void*)map->slots[i].key);
             }
         }
     }
@@ -391,19 +549,16 @@ wmem_map_get_keys(wmem_allocator_t *list_allocator, wmem_map_t *map)
 void
 wmem_map_foreach(wmem_map_t *map, GHFunc foreach_func, gpointer user_data)
 {
-    wmem_map_item_t *cur;
-    unsigned i;
+    size_t i;
 
     /* Make sure we have a table */
-    if (map->table == NULL) {
+    if (map->slots == NULL) {
         return;
     }
 
     for (i = 0; i < CAPACITY(map); i++) {
-        cur = map->table[i];
-        while (cur) {
-            foreach_func((gpointer)cur->key, (gpointer)cur->value, user_data);
-            cur = cur->next;
+        if (IS_FULL(map->ctrl[i])) {
+            foreach_func((gpointer)map->slots[i].key, (gpointer)map->slots[i].value, user_data);
         }
     }
 }
@@ -50,6 +50,12 @@ wmem_packet_scope(void)
     return packet_scope;
 }
 
+gboolean
+wmem_in_packet_scope(void)
+{
+    return packet_scope != NULL && packet_scope->in_scope;
+}
+
 void
 wmem_enter_packet_scope(void)
 {
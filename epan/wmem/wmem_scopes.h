@@ -30,6 +30,12 @@ WS_DLL_PUBLIC
 wmem_allocator_t *
 wmem_packet_scope(void);
 
+/** TRUE between wmem_enter_packet_scope() and wmem_leave_packet_scope(),
+ * i.e. while a packet is being dissected. */
+WS_DLL_PUBLIC
+gboolean
+wmem_in_packet_scope(void);
+
 WS_DLL_LOCAL
 void
 wmem_enter_packet_scope(void);
@@ -973,6 +973,18 @@ wmem_test_map(void)
     }
     g_assert(wmem_map_size(map) == CONTAINER_ITERS);
 
+    /* removal and reinsertion, which reuses slots freed by removal */
+    for (i=0; i<CONTAINER_ITERS*4; i++) {
+        ret = wmem_map_remove(map, GINT_TO_POINTER(i));
+        g_assert(ret == GINT_TO_POINTER(i));
+        ret = wmem_map_insert(map, GINT_TO_POINTER(i + CONTAINER_ITERS), GINT_TO_POINTER(i + CONTAINER_ITERS));
+        g_assert(ret == NULL);
+        g_assert(wmem_map_size(map) == CONTAINER_ITERS);
+    }
+    for (i=0; i<CONTAINER_ITERS*5; i++) {
+        g_assert(wmem_map_contains(map, GINT_TO_POINTER(i)) == (i >= CONTAINER_ITERS*4));
+    }
+
     wmem_destroy_allocator(extra_allocator);
     wmem_destroy_allocator(allocator);
 }
@@ -206,7 +206,7 @@ WSLUA_CONSTRUCTOR Dumper_new(lua_State* L) {
     int err = 0;
     const char* filename = cross_plat_fname(fname);
 
-    d = wtap_dump_open(filename, filetype, encap, 0, FALSE, &err);
+    d = wtap_dump_open(filename, filetype, encap, 0, WTAP_UNCOMPRESSED, &err);
 
     if (! d ) {
         /* WSLUA_ERROR("Error while opening file for writing"); */
@@ -369,7 +369,7 @@ WSLUA_METHOD Dumper_new_for_current(lua_State* L) {
 
     encap = lua_pinfo->rec->rec_header.packet_header.pkt_encap;
 
-    d = wtap_dump_open(filename, filetype, encap, 0, FALSE, &err);
+    d = wtap_dump_open(filename, filetype, encap, 0, WTAP_UNCOMPRESSED, &err);
 
     if (! d ) {
         switch (err) {
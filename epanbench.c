@@ -0,0 +1,794 @@
+/* epanbench.c
+ * Replays capture files through the dissection, display filter, column
+ * and output paths of libwireshark and reports how fast each of them is,
+ * so that performance regressions can be caught.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <locale.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include <glib.h>
+
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/timestamp.h>
+#include <epan/prefs.h>
+#include <epan/column.h>
+#include <epan/print.h>
+#include <epan/dfilter/dfilter.h>
+#include <epan/wmem/wmem.h>
+
+#ifdef HAVE_PLUGINS
+#include <wsutil/plugins.h>
+#endif
+#include <wsutil/cmdarg_err.h>
+#include <wsutil/filesystem.h>
+#include <wsutil/privileges.h>
+#include <wsutil/report_message.h>
+#include <wsutil/wsjson.h>
+
+#ifndef HAVE_GETOPT_LONG
+#include "wsutil/wsgetopt.h"
+#endif
+
+#include <wiretap/wtap.h>
+
+#include "ui/failure_message.h"
+#include "epan/register.h"
+
+#define DEFAULT_FILTER	"ip || ipv6"
+#define DEFAULT_TOLERANCE	10.0	/* percent */
+
+/* Exit status when a stage is slower than in the baseline */
+#define EXIT_REGRESSION	3
+
+/* The stages we time.  All of them dissect every packet; "dissect" times
+ * the dissection itself, the others only what they add to it. */
+typedef enum {
+	STAGE_DISSECT,
+	STAGE_FILTER,
+	STAGE_COLUMNS,
+	STAGE_JSON,
+	STAGE_EK,
+	STAGE_PDML,
+	NUM_STAGES
+} bench_stage_e;
+
+static const char *stage_names[NUM_STAGES] = {
+	"dissect",
+	"filter",
+	"columns",
+	"json",
+	"ek",
+	"pdml"
+};
+
+typedef struct {
+	wtap_rec	rec;
+	guint8		*data;
+	gint64		offset;
+} bench_packet_t;
+
+/* A capture file, read into memory so that we don't time file I/O */
+typedef struct {
+	const char	*filename;
+	int		file_type_subtype;
+	bench_packet_t	*packets;
+	guint32		count;
+} bench_capture_t;
+
+struct packet_provider_data {
+	const bench_capture_t *cap;
+};
+
+/* A result from an earlier run, read back from its output */
+typedef struct {
+	gchar		*file;		/* base name of the capture file */
+	gchar		*stage;
+	double		packets_per_second;
+	double		allocs_per_packet;
+} bench_result_t;
+
+static GPtrArray *baseline;	/* of bench_result_t, or NULL */
+static double tolerance = DEFAULT_TOLERANCE;
+static guint regressions;
+
+static column_info bench_cinfo;
+static output_fields_t *bench_output_fields;
+static FILE *null_fh;
+
+static void failure_warning_message(const char *msg_format, va_list ap);
+static void failure_message_cont(const char *msg_format, va_list ap);
+static void open_failure_message(const char *filename, int err,
+	gboolean for_writing);
+static void read_failure_message(const char *filename, int err);
+static void write_failure_message(const char *filename, int err);
+
+static void
+print_usage(FILE *output)
+{
+	fprintf(output, "Usage: epanbench [options] <infile> ...\n");
+	fprintf(output, "\n");
+	fprintf(output, "  -n <passes>              dissect each file this many times per stage\n");
+	fprintf(output, "                           (default: 1)\n");
+	fprintf(output, "  -Y <display filter>      filter used by the \"filter\" stage\n");
+	fprintf(output, "                           (default: \"%s\")\n", DEFAULT_FILTER);
+	fprintf(output, "  -b <baseline file>       compare with the output of an earlier run\n");
+	fprintf(output, "  -t <percent>             how much slower, or allocating more, a stage may\n");
+	fprintf(output, "                           be than in the baseline (default: %.0f)\n", DEFAULT_TOLERANCE);
+	fprintf(output, "  -h                       display this help and exit\n");
+	fprintf(output, "\n");
+	fprintf(output, "One JSON object is written to the standard output for each file and\n");
+	fprintf(output, "stage, with the packet rate, the wmem allocations per packet and the\n");
+	fprintf(output, "peak resident set size while running it.  With -b, stages that have\n");
+	fprintf(output, "regressed are reported, and the exit status is %d.\n", EXIT_REGRESSION);
+}
+
+/* Write a string as a JSON string, quoted and escaped */
+static void
+json_puts_string(const char *str)
+{
+	const char *p;
+
+	putchar('"');
+	for (p = str; *p != '\0'; p++) {
+		switch (*p) {
+		case '"':
+		case '\\':
+			putchar('\\');
+			putchar(*p);
+			break;
+		case '\n':
+			fputs("\\n", stdout);
+			break;
+		case '\r':
+			fputs("\\r", stdout);
+			break;
+		case '\t':
+			fputs("\\t", stdout);
+			break;
+		default:
+			if ((guchar)*p < 0x20)
+				printf("\\u%04x", (guchar)*p);
+			else
+				putchar(*p);
+			break;
+		}
+	}
+	putchar('"');
+}
+
+static void
+free_result(gpointer data)
+{
+	bench_result_t *result = (bench_result_t *)data;
+
+	g_free(result->file);
+	g_free(result->stage);
+	g_free(result);
+}
+
+/*
+ * Read the output of an earlier run.  Lines that aren't results are
+ * skipped, so that a baseline can be annotated.
+ */
+static gboolean
+read_baseline(const char *filename)
+{
+	gchar		*contents;
+	gchar		**lines;
+	GError		*error = NULL;
+	jsmntok_t	*tokens;
+	bench_result_t	*result;
+	gchar		*value;
+	int		ntokens, i, j;
+
+	if (!g_file_get_contents(filename, &contents, NULL, &error)) {
+		cmdarg_err("Can't read the baseline: %s.", error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+	lines = g_strsplit(contents, "\n", -1);
+	g_free(contents);
+
+	baseline = g_ptr_array_new_with_free_func(free_result);
+	for (i = 0; lines[i] != NULL; i++) {
+		ntokens = wsjson_parse(lines[i], NULL, 0);
+		if (ntokens <= 0)
+			continue;
+		tokens = g_new(jsmntok_t, ntokens);
+		if (wsjson_parse(lines[i], tokens, ntokens) != ntokens ||
+		    tokens[0].type != JSMN_OBJECT) {
+			g_free(tokens);
+			continue;
+		}
+
+		result = g_new0(bench_result_t, 1);
+		result->packets_per_second = -1.0;
+		result->allocs_per_packet = -1.0;
+		/* our objects are flat, so keys and values alternate */
+		for (j = 1; j + 1 < ntokens; j += 2) {
+			value = g_strndup(lines[i] + tokens[j + 1].start,
+			    tokens[j + 1].end - tokens[j + 1].start);
+			if (tokens[j + 1].type == JSMN_STRING &&
+			    !wsjson_unescape_json_string(value, value)) {
+				g_free(value);
+				continue;
+			}
+			lines[i][tokens[j].end] = '\0';
+			if (strcmp(lines[i] + tokens[j].start, "file") == 0) {
+				g_free(result->file);
+				result->file = g_path_get_basename(value);
+			} else if (strcmp(lines[i] + tokens[j].start, "stage") == 0) {
+				g_free(result->stage);
+				result->stage = g_strdup(value);
+			} else if (strcmp(lines[i] + tokens[j].start, "packets_per_second") == 0) {
+				result->packets_per_second = g_ascii_strtod(value, NULL);
+			} else if (strcmp(lines[i] + tokens[j].start, "allocs_per_packet") == 0) {
+				result->allocs_per_packet = g_ascii_strtod(value, NULL);
+			}
+			g_free(value);
+		}
+		g_free(tokens);
+
+		if (result->file == NULL || result->stage == NULL ||
+		    result->packets_per_second < 0.0 || result->allocs_per_packet < 0.0) {
+			free_result(result);
+			continue;
+		}
+		g_ptr_array_add(baseline, result);
+	}
+	g_strfreev(lines);
+	return TRUE;
+}
+
+/* The baseline result for a file and stage, or NULL if there isn't one */
+static const bench_result_t *
+find_baseline(const char *filename, const char *stage)
+{
+	const bench_result_t *result;
+	gchar	*basename;
+	guint	i;
+
+	if (baseline == NULL)
+		return NULL;
+	/* by base name, so that runs from different trees can be compared */
+	basename = g_path_get_basename(filename);
+	for (i = 0; i < baseline->len; i++) {
+		result = (const bench_result_t *)g_ptr_array_index(baseline, i);
+		if (strcmp(result->file, basename) == 0 &&
+		    strcmp(result->stage, stage) == 0) {
+			g_free(basename);
+			return result;
+		}
+	}
+	g_free(basename);
+	return NULL;
+}
+
+/* Monotonic time in nanoseconds */
+static guint64
+bench_now(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER now;
+
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (guint64)(now.QuadPart / freq.QuadPart) * G_GUINT64_CONSTANT(1000000000) +
+	    (guint64)(now.QuadPart % freq.QuadPart) * G_GUINT64_CONSTANT(1000000000) / (guint64)freq.QuadPart;
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (guint64)now.tv_sec * G_GUINT64_CONSTANT(1000000000) + (guint64)now.tv_nsec;
+#endif
+}
+
+/*
+ * On Linux, we can reset the peak RSS before each stage, so that it's the
+ * peak for that stage.  Elsewhere, it's the peak since the program started.
+ */
+static void
+reset_peak_rss(void)
+{
+#ifdef __linux__
+	FILE *fh = fopen("/proc/self/clear_refs", "w");
+
+	if (fh != NULL) {
+		fputs("5", fh);
+		fclose(fh);
+	}
+#endif
+}
+
+/* Peak RSS in kB, or -1 if we don't know it */
+static gint64
+get_peak_rss(void)
+{
+#ifdef __linux__
+	FILE *fh = fopen("/proc/self/status", "r");
+	char line[256];
+	gint64 peak = -1;
+
+	if (fh != NULL) {
+		while (fgets(line, sizeof line, fh) != NULL) {
+			if (strncmp(line, "VmHWM:", 6) == 0) {
+				peak = g_ascii_strtoll(line + 6, NULL, 10);
+				break;
+			}
+		}
+		fclose(fh);
+	}
+	return peak;
+#elif defined(_WIN32)
+	return -1;
+#else
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+#ifdef __APPLE__
+	return (gint64)usage.ru_maxrss / 1024;	/* bytes on macOS */
+#else
+	return (gint64)usage.ru_maxrss;
+#endif
+#endif
+}
+
+static guint64
+get_alloc_count(epan_dissect_t *edt)
+{
+	return wmem_get_alloc_count(wmem_packet_scope()) +
+	    wmem_get_alloc_count(wmem_file_scope()) +
+	    wmem_get_alloc_count(edt->pi.pool);
+}
+
+static gboolean
+read_capture(const char *filename, bench_capture_t *cap)
+{
+	wtap		*wth;
+	int		err;
+	gchar		*err_info;
+	gint64		data_offset;
+	wtap_rec	*rec;
+	GArray		*packets;
+	bench_packet_t	pkt;
+
+	wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		cfile_open_failure_message("epanbench", filename, err, err_info);
+		return FALSE;
+	}
+
+	packets = g_array_new(FALSE, FALSE, sizeof(bench_packet_t));
+	while (wtap_read(wth, &err, &err_info, &data_offset)) {
+		rec = wtap_get_rec(wth);
+		pkt.rec = *rec;
+		pkt.rec.opt_comment = g_strdup(rec->opt_comment);
+		ws_buffer_init(&pkt.rec.options_buf, 0);
+		pkt.data = (guint8 *)g_memdup(wtap_get_buf_ptr(wth),
+		    rec->rec_type == REC_TYPE_PACKET ? rec->rec_header.packet_header.caplen : 0);
+		pkt.offset = data_offset;
+		g_array_append_val(packets, pkt);
+	}
+	if (err != 0) {
+		cfile_read_failure_message("epanbench", filename, err, err_info);
+		/* Benchmark what we did read */
+	}
+
+	cap->filename = filename;
+	cap->file_type_subtype = wtap_file_type_subtype(wth);
+	cap->count = packets->len;
+	cap->packets = (bench_packet_t *)g_array_free(packets, FALSE);
+	wtap_close(wth);
+	return TRUE;
+}
+
+static void
+free_capture(bench_capture_t *cap)
+{
+	guint32 i;
+
+	for (i = 0; i < cap->count; i++) {
+		g_free(cap->packets[i].rec.opt_comment);
+		ws_buffer_free(&cap->packets[i].rec.options_buf);
+		g_free(cap->packets[i].data);
+	}
+	g_free(cap->packets);
+}
+
+static const nstime_t *
+epanbench_get_frame_ts(struct packet_provider_data *prov, guint32 frame_num)
+{
+	if (frame_num == 0 || frame_num > prov->cap->count)
+		return NULL;
+	return &prov->cap->packets[frame_num - 1].rec.ts;
+}
+
+static epan_t *
+epanbench_epan_new(struct packet_provider_data *prov)
+{
+	static const struct packet_provider_funcs funcs = {
+		epanbench_get_frame_ts,
+		NULL,
+		NULL,
+		NULL,
+		NULL
+	};
+
+	return epan_new(prov, &funcs);
+}
+
+static void
+run_stage(const bench_capture_t *cap, bench_stage_e stage, dfilter_t *dfcode,
+	int passes)
+{
+	struct packet_provider_data prov;
+	epan_t		*session;
+	epan_dissect_t	*edt;
+	frame_data	fdata, ref_frame, prev_dis_frame;
+	const frame_data *ref, *prev_dis;
+	nstime_t	elapsed_time;
+	guint32		cum_bytes;
+	bench_packet_t	*pkt;
+	guint32		caplen, i;
+	guint64		packets = 0, allocs = 0, elapsed = 0;
+	guint64		start, start_allocs;
+	double		rate, allocs_per_packet;
+	gchar		*display_name;
+	const bench_result_t *base;
+	gboolean	regressed;
+	int		pass;
+
+	reset_peak_rss();
+
+	prov.cap = cap;
+	session = epanbench_epan_new(&prov);
+	edt = epan_dissect_new(session, TRUE, stage >= STAGE_JSON);
+
+	for (pass = 0; pass < passes; pass++) {
+		/* Each pass is like reading the file again */
+		if (pass > 0) {
+			epan_dissect_free(edt);
+			epan_free(session);
+			session = epanbench_epan_new(&prov);
+			edt = epan_dissect_new(session, TRUE, stage >= STAGE_JSON);
+		}
+		nstime_set_zero(&elapsed_time);
+		ref = NULL;
+		prev_dis = NULL;
+		cum_bytes = 0;
+
+		for (i = 0; i < cap->count; i++) {
+			pkt = &cap->packets[i];
+			if (pkt->rec.rec_type != REC_TYPE_PACKET)
+				continue;
+			caplen = pkt->rec.rec_header.packet_header.caplen;
+
+			frame_data_init(&fdata, i + 1, &pkt->rec, pkt->offset, cum_bytes);
+			frame_data_set_before_dissect(&fdata, &elapsed_time, &ref, prev_dis);
+			if (ref == &fdata) {
+				ref_frame = fdata;
+				ref = &ref_frame;
+			}
+			if (stage == STAGE_FILTER)
+				epan_dissect_prime_with_dfilter(edt, dfcode);
+
+			if (stage != STAGE_DISSECT) {
+				epan_dissect_run(edt, cap->file_type_subtype, &pkt->rec,
+				    tvb_new_real_data(pkt->data, caplen, caplen), &fdata,
+				    stage == STAGE_COLUMNS ? &bench_cinfo : NULL);
+			}
+
+			start_allocs = get_alloc_count(edt);
+			start = bench_now();
+			switch (stage) {
+			case STAGE_DISSECT:
+				epan_dissect_run(edt, cap->file_type_subtype, &pkt->rec,
+				    tvb_new_real_data(pkt->data, caplen, caplen), &fdata, NULL);
+				break;
+			case STAGE_FILTER:
+				dfilter_apply_edt(dfcode, edt);
+				break;
+			case STAGE_COLUMNS:
+				epan_dissect_fill_in_columns(edt, FALSE, TRUE);
+				break;
+			case STAGE_JSON:
+				write_json_proto_tree(bench_output_fields, print_dissections_expanded,
+				    FALSE, NULL, PF_NONE, edt, &bench_cinfo,
+				    proto_node_group_children_by_unique, null_fh);
+				break;
+			case STAGE_EK:
+				write_ek_proto_tree(bench_output_fields, FALSE, FALSE, NULL,
+				    PF_NONE, edt, &bench_cinfo, null_fh);
+				break;
+			case STAGE_PDML:
+				write_pdml_proto_tree(bench_output_fields, NULL, PF_NONE, edt,
+				    &bench_cinfo, null_fh, FALSE);
+				break;
+			default:
+				g_assert_not_reached();
+			}
+			elapsed += bench_now() - start;
+			allocs += get_alloc_count(edt) - start_allocs;
+			packets++;
+
+			frame_data_set_after_dissect(&fdata, &cum_bytes);
+			prev_dis_frame = fdata;
+			prev_dis = &prev_dis_frame;
+			epan_dissect_reset(edt);
+			frame_data_destroy(&fdata);
+		}
+	}
+
+	epan_dissect_free(edt);
+	epan_free(session);
+
+	rate = elapsed != 0 ? packets * 1e9 / elapsed : 0.0;
+	allocs_per_packet = packets != 0 ? (double)allocs / packets : 0.0;
+
+	/* the file name needn't be UTF-8, but the output has to be */
+	display_name = g_filename_display_name(cap->filename);
+	printf("{\"file\": ");
+	json_puts_string(display_name);
+	printf(", \"stage\": \"%s\", \"packets\": %" G_GUINT64_FORMAT
+	    ", \"seconds\": %.6f, \"packets_per_second\": %.1f, \"allocs_per_packet\": %.2f",
+	    stage_names[stage], packets, elapsed / 1e9, rate, allocs_per_packet);
+	if (get_peak_rss() >= 0)
+		printf(", \"peak_rss_kb\": %" G_GINT64_FORMAT, get_peak_rss());
+	else
+		printf(", \"peak_rss_kb\": null");
+
+	base = find_baseline(display_name, stage_names[stage]);
+	if (base != NULL) {
+		regressed = rate < base->packets_per_second * (1.0 - tolerance / 100.0) ||
+		    allocs_per_packet > base->allocs_per_packet * (1.0 + tolerance / 100.0);
+		printf(", \"baseline_packets_per_second\": %.1f, \"baseline_allocs_per_packet\": %.2f"
+		    ", \"regressed\": %s",
+		    base->packets_per_second, base->allocs_per_packet,
+		    regressed ? "true" : "false");
+		if (regressed) {
+			fprintf(stderr, "epanbench: %s, %s: %.1f packets/s and %.2f allocations per packet, "
+			    "against %.1f and %.2f in the baseline\n",
+			    display_name, stage_names[stage], rate, allocs_per_packet,
+			    base->packets_per_second, base->allocs_per_packet);
+			regressions++;
+		}
+	}
+	printf("}\n");
+	fflush(stdout);
+	g_free(display_name);
+}
+
+int
+main(int argc, char **argv)
+{
+	char		*init_progfile_dir_error;
+	const char	*filter = DEFAULT_FILTER;
+	const char	*baseline_file = NULL;
+	char		*end;
+	dfilter_t	*dfcode;
+	gchar		*err_msg;
+	e_prefs		*prefs_p;
+	bench_capture_t	cap;
+	int		passes = 1;
+	int		opt, i, stage;
+	int		ret = 0;
+
+	cmdarg_err_init(failure_warning_message, failure_message_cont);
+
+	/*
+	 * Get credential information for later use.
+	 */
+	init_process_policies();
+
+	/*
+	 * Attempt to get the pathname of the directory containing the
+	 * executable file.
+	 */
+	init_progfile_dir_error = init_progfile_dir(argv[0], main);
+	if (init_progfile_dir_error != NULL) {
+		fprintf(stderr, "epanbench: Can't get pathname of directory containing the epanbench program: %s.\n",
+			init_progfile_dir_error);
+		g_free(init_progfile_dir_error);
+	}
+
+	while ((opt = getopt(argc, argv, "b:hn:t:Y:")) != -1) {
+		switch (opt) {
+		case 'b':
+			baseline_file = optarg;
+			break;
+		case 'n':
+			passes = atoi(optarg);
+			if (passes < 1) {
+				cmdarg_err("The number of passes must be positive.");
+				return 1;
+			}
+			break;
+		case 't':
+			tolerance = g_ascii_strtod(optarg, &end);
+			if (end == optarg || *end != '\0' || tolerance < 0.0) {
+				cmdarg_err("The tolerance must be a non-negative percentage.");
+				return 1;
+			}
+			break;
+		case 'Y':
+			filter = optarg;
+			break;
+		case 'h':
+			print_usage(stdout);
+			return 0;
+		default:
+			print_usage(stderr);
+			return 1;
+		}
+	}
+	if (optind >= argc) {
+		print_usage(stderr);
+		return 1;
+	}
+	if (baseline_file != NULL && !read_baseline(baseline_file))
+		return 2;
+
+	init_report_message(failure_warning_message, failure_warning_message,
+			    open_failure_message, read_failure_message,
+			    write_failure_message);
+
+	timestamp_set_type(TS_RELATIVE);
+	timestamp_set_precision(TS_PREC_AUTO);
+	timestamp_set_seconds_type(TS_SECONDS_DEFAULT);
+
+	wtap_init(TRUE);
+
+	if (!epan_init(register_all_protocols, register_all_protocol_handoffs,
+	    NULL, NULL))
+		return 2;
+
+	/* set the c-language locale to the native environment. */
+	setlocale(LC_ALL, "");
+
+	/* Load libwireshark settings from the current profile. */
+	prefs_p = epan_load_settings();
+	prefs_apply_all();
+
+	build_column_format_array(&bench_cinfo, prefs_p->num_cols, TRUE);
+	bench_output_fields = output_fields_new();
+
+	if (!dfilter_compile(filter, &dfcode, &err_msg)) {
+		cmdarg_err("%s", err_msg);
+		g_free(err_msg);
+		ret = 2;
+		goto clean_exit;
+	}
+
+#ifdef _WIN32
+	null_fh = fopen("NUL", "w");
+#else
+	null_fh = fopen("/dev/null", "w");
+#endif
+	if (null_fh == NULL) {
+		cmdarg_err("Can't open the null device: %s.", g_strerror(errno));
+		ret = 2;
+		goto clean_exit;
+	}
+
+	for (i = optind; i < argc; i++) {
+		if (!read_capture(argv[i], &cap)) {
+			ret = 2;
+			continue;
+		}
+		for (stage = 0; stage < NUM_STAGES; stage++) {
+			/* An empty filter has nothing to time */
+			if (stage == STAGE_FILTER && dfcode == NULL)
+				continue;
+			run_stage(&cap, (bench_stage_e)stage, dfcode, passes);
+		}
+		free_capture(&cap);
+	}
+
+	fclose(null_fh);
+	if (ret == 0 && regressions != 0)
+		ret = EXIT_REGRESSION;
+
+clean_exit:
+	if (baseline != NULL)
+		g_ptr_array_free(baseline, TRUE);
+	dfilter_free(dfcode);
+	output_fields_free(bench_output_fields);
+	col_cleanup(&bench_cinfo);
+	epan_cleanup();
+	wtap_cleanup();
+	return ret;
+}
+
+/*
+ * General errors and warnings are reported with an console message
+ * in "epanbench".
+ */
+static void
+failure_warning_message(const char *msg_format, va_list ap)
+{
+	fprintf(stderr, "epanbench: ");
+	vfprintf(stderr, msg_format, ap);
+	fprintf(stderr, "\n");
+}
+
+/*
+ * Report additional information for an error in command-line arguments.
+ */
+static void
+failure_message_cont(const char *msg_format, va_list ap)
+{
+	vfprintf(stderr, msg_format, ap);
+	fprintf(stderr, "\n");
+}
+
+/*
+ * Open/create errors are reported with an console message in "epanbench".
+ */
+static void
+open_failure_message(const char *filename, int err, gboolean for_writing)
+{
+	fprintf(stderr, "epanbench: ");
+	fprintf(stderr, file_open_error_message(err, for_writing), filename);
+	fprintf(stderr, "\n");
+}
+
+/*
+ * Read errors are reported with an console message in "epanbench".
+ */
+static void
+read_failure_message(const char *filename, int err)
+{
+	fprintf(stderr, "epanbench: An error occurred while reading from the file \"%s\": %s.\n",
+		filename, g_strerror(err));
+}
+
+/*
+ * Write errors are reported with an console message in "epanbench".
+ */
+static void
+write_failure_message(const char *filename, int err)
+{
+	fprintf(stderr, "epanbench: An error occurred while writing to the file \"%s\": %s.\n",
+		filename, g_strerror(err));
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
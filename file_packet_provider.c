@@ -88,3 +88,12 @@ cap_file_provider_set_user_comment(struct packet_provider_data *prov, frame_data
 
   fd->flags.has_user_comment = TRUE;
 }
+
+const nstime_t *
+cap_file_provider_get_frame_shift_offset(struct packet_provider_data *prov, const frame_data *fd)
+{
+  if (prov->frames)
+    return frame_data_sequence_get_shift_offset(prov->frames, fd->num);
+
+  return NULL;
+}
@@ -53,6 +53,11 @@
 
 #include "ui/failure_message.h"
 
+typedef struct {
+  gboolean verbose;     /* report progress */
+  gboolean read_ahead;  /* read the input files ahead */
+} merge_callback_data_t;
+
 /*
  * Show the usage
  */
@@ -73,6 +78,7 @@ print_usage(FILE *output)
   fprintf(output, "                    an empty \"-I\" option will list the merge modes.\n");
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
+  fprintf(output, "  --read-ahead      read the input files ahead on other threads.\n");
   fprintf(output, "  -h                display this help and exit.\n");
   fprintf(output, "  -v                verbose output.\n");
 }
@@ -163,10 +169,18 @@ list_idb_merge_modes(void) {
 static gboolean
 merge_callback(merge_event event, int num,
                const merge_in_file_t in_files[], const guint in_file_count,
-               void *data _U_)
+               void *data)
 {
+  const merge_callback_data_t *cb_data = (const merge_callback_data_t *)data;
   guint i;
 
+  if (event == MERGE_EVENT_INPUT_FILES_OPENED && cb_data->read_ahead) {
+    for (i = 0; i < in_file_count; i++)
+      wtap_set_read_ahead(in_files[i].wth);
+  }
+  if (!cb_data->verbose)
+    return FALSE;
+
   switch (event) {
 
     case MERGE_EVENT_INPUT_FILES_OPENED:
@@ -236,10 +250,11 @@ main(int argc, char *argv[])
   static const struct option long_options[] = {
       {"help", no_argument, NULL, 'h'},
       {"version", no_argument, NULL, 'V'},
+      {"read-ahead", no_argument, NULL, 0x8100},
       {0, 0, 0, 0 }
   };
   gboolean            do_append          = FALSE;
-  gboolean            verbose            = FALSE;
+  merge_callback_data_t cb_data          = { FALSE, FALSE };
   int                 in_file_count      = 0;
   guint32             snaplen            = 0;
 #ifdef PCAP_NG_DEFAULT
@@ -345,7 +360,7 @@ main(int argc, char *argv[])
       break;
 
     case 'v':
-      verbose = TRUE;
+      cb_data.verbose = TRUE;
       break;
 
     case 'V':
@@ -361,6 +376,10 @@ main(int argc, char *argv[])
       out_filename = optarg;
       break;
 
+    case 0x8100:
+      cb_data.read_ahead = TRUE;
+      break;
+
     case '?':              /* Bad options if GNU getopt */
       switch(optopt) {
       case'F':
@@ -379,7 +398,7 @@ main(int argc, char *argv[])
   }
 
   cb.callback_func = merge_callback;
-  cb.data = NULL;
+  cb.data = &cb_data;
 
   /* check for proper args; at a minimum, must have an output
    * filename and one input file
@@ -414,13 +433,15 @@ main(int argc, char *argv[])
     status = merge_files_to_stdout(file_type,
                                    (const char *const *) &argv[optind],
                                    in_file_count, do_append, mode, snaplen,
-                                   "mergecap", verbose ? &cb : NULL,
+                                   "mergecap",
+                                   (cb_data.verbose || cb_data.read_ahead) ? &cb : NULL,
                                    &err, &err_info, &err_fileno, &err_framenum);
   } else {
     /* merge the files to the outfile */
     status = merge_files(out_filename, file_type,
                          (const char *const *) &argv[optind], in_file_count,
-                         do_append, mode, snaplen, "mergecap", verbose ? &cb : NULL,
+                         do_append, mode, snaplen, "mergecap",
+                         (cb_data.verbose || cb_data.read_ahead) ? &cb : NULL,
                          &err, &err_info, &err_fileno, &err_framenum);
   }
 
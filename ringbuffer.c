@@ -42,6 +42,7 @@
 #include <glib.h>
 
 #include "ringbuffer.h"
+#include "writecap/bulkwrite.h"
 #include <wsutil/file_util.h>
 
 
@@ -62,6 +63,9 @@ typedef struct _ringbuf_data {
   int           fd;                  /* Current ringbuffer file descriptor */
   FILE         *pdh;
   gboolean      group_read_access;   /* TRUE if files need to be opened with group read access */
+  gboolean      direct_io;           /* TRUE if files are to be written with O_DIRECT */
+  gint64        file_size;           /* Space to allocate for each file up front, or 0 */
+  wtap_compression_type compression_type; /* Compression to write files with */
 } ringbuf_data;
 
 static ringbuf_data rb_data;
@@ -119,7 +123,9 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
  * Initialize the ringbuffer data structures
  */
 int
-ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access)
+ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access,
+             gboolean direct_io, gint64 file_size,
+             wtap_compression_type compression_type)
 {
   unsigned int i;
   char        *pfx, *last_pathsep;
@@ -133,6 +139,9 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.fd = -1;
   rb_data.pdh = NULL;
   rb_data.group_read_access = group_read_access;
+  rb_data.direct_io = direct_io;
+  rb_data.file_size = file_size;
+  rb_data.compression_type = compression_type;
 
   /* just to be sure ... */
   if (num_files <= RINGBUFFER_MAX_NUM_FILES) {
@@ -209,15 +218,18 @@ const gchar *ringbuf_current_filename(void)
 }
 
 /*
- * Calls ws_fdopen() for the current ringbuffer file
+ * Calls bulkwrite_fdopen() for the current ringbuffer file
  */
 FILE *
 ringbuf_init_libpcap_fdopen(int *err)
 {
-  rb_data.pdh = ws_fdopen(rb_data.fd, "wb");
+  int open_err;
+
+  rb_data.pdh = bulkwrite_fdopen(rb_data.fd, rb_data.direct_io, rb_data.file_size,
+                                 rb_data.compression_type, &open_err);
   if (rb_data.pdh == NULL) {
     if (err != NULL) {
-      *err = errno;
+      *err = open_err;
     }
   }
   return rb_data.pdh;
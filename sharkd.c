@@ -74,6 +74,14 @@ capture_file cfile;
 static guint32 cum_bytes;
 static frame_data ref_frame;
 
+/*
+ * Frames loaded from an index go through the first pass lazily; these
+ * are the number that have, and the last of them.
+ */
+static gboolean first_pass_pending;
+static guint32 first_pass_done;
+static const frame_data *first_pass_prev;
+
 static void failure_warning_message(const char *msg_format, va_list ap);
 static void open_failure_message(const char *filename, int err,
     gboolean for_writing);
@@ -233,7 +241,8 @@ sharkd_epan_new(capture_file *cf)
     sharkd_get_frame_ts,
     cap_file_provider_get_interface_name,
     cap_file_provider_get_interface_description,
-    cap_file_provider_get_user_comment
+    cap_file_provider_get_user_comment,
+    NULL
   };
 
   return epan_new(&cf->provider, &funcs);
@@ -394,6 +403,117 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
   return err;
 }
 
+/*
+ * Load the frames from a sidecar index, rather than reading through
+ * the capture file.  What the first pass works out from the frames
+ * alone is worked out here; dissecting them is deferred until
+ * something needs to dissect frames, and then only goes as far as
+ * it needs to; see sharkd_first_pass().
+ */
+static gboolean
+load_cap_index(capture_file *cf, const char *index_name, const frame_index_key *key)
+{
+  frame_data_sequence *frames;
+  frame_data *fdata;
+  const frame_data *prev_dis = NULL;
+  guint32 count;
+  guint32 framenum;
+
+  frames = frame_data_sequence_read_index(cf->provider.wth, index_name, key, &count);
+  if (frames == NULL)
+    return FALSE;
+
+  cf->provider.frames = frames;
+  cf->count = count;
+  for (framenum = 1; framenum <= count; framenum++) {
+    fdata = frame_data_sequence_find(frames, framenum);
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                  &cf->provider.ref, prev_dis);
+    prev_dis = fdata;
+  }
+
+  first_pass_pending = TRUE;
+  first_pass_done = 0;
+  first_pass_prev = NULL;
+
+  /* We don't need the sequential I/O side at all. */
+  wtap_sequential_close(cf->provider.wth);
+  return TRUE;
+}
+
+/*
+ * Dissect the frames up to and including frame upto, or all of them if
+ * it's 0, in order, if that hasn't been done yet because the frames
+ * were loaded from an index; dissectors expect to have seen every
+ * frame before it in order, the first time around, when a frame is
+ * dissected again.
+ */
+void
+sharkd_first_pass(guint32 upto)
+{
+  capture_file *cf = &cfile;
+  guint32       framenum;
+  frame_data   *fdata;
+  Buffer        buf;
+  wtap_rec      rec;
+  int           err;
+  char         *err_info = NULL;
+  epan_dissect_t edt;
+
+  if (!first_pass_pending)
+    return;
+  if (upto == 0 || upto > cf->count)
+    upto = cf->count;
+  if (first_pass_done >= upto)
+    return;
+
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1500);
+  epan_dissect_init(&edt, cf->epan, postdissectors_want_hfids(), FALSE);
+
+  cf->provider.prev_dis = cf->provider.prev_cap = first_pass_prev;
+  for (framenum = first_pass_done + 1; framenum <= upto; framenum++) {
+    fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+
+    if (!wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, &err, &err_info)) {
+      /* Don't try again; the frames after it won't be dissected */
+      upto = cf->count;
+      break;
+    }
+
+    if (gbl_resolv_flags.mac_name || gbl_resolv_flags.network_name ||
+        gbl_resolv_flags.transport_name)
+      /* Grab any resolved addresses */
+      host_name_lookup_process();
+
+    prime_epan_dissect_with_postdissector_wanted_hfids(&edt);
+
+    epan_dissect_run(&edt, cf->cd_t, &rec,
+                     frame_tvbuff_new_buffer(&cf->provider, fdata, &buf),
+                     fdata, NULL);
+    cf->provider.prev_cap = cf->provider.prev_dis = fdata;
+
+    epan_dissect_reset(&edt);
+  }
+  first_pass_done = upto;
+  first_pass_prev = cf->provider.prev_dis;
+
+  wtap_rec_cleanup(&rec);
+  ws_buffer_free(&buf);
+  epan_dissect_cleanup(&edt);
+
+  cf->provider.prev_dis = NULL;
+  cf->provider.prev_cap = NULL;
+
+  if (first_pass_done == cf->count) {
+    first_pass_pending = FALSE;
+
+    /* Allow the protocol dissectors to free up memory that they
+     * don't need after the sequential run-through of the packets. */
+    postseq_cleanup_all_protocols();
+  }
+}
+
 cf_status_t
 cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_tempfile, int *err)
 {
@@ -434,6 +554,7 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   cf->provider.ref = NULL;
   cf->provider.prev_dis = NULL;
   cf->provider.prev_cap = NULL;
+  first_pass_pending = FALSE;
 
   cf->state = FILE_READ_IN_PROGRESS;
 
@@ -506,10 +627,36 @@ sharkd_cf_open(const char *fname, unsigned int type, gboolean is_tempfile, int *
   return cf_open(&cfile, fname, type, is_tempfile, err);
 }
 
+/*
+ * Load the capture file.  If use_index is set, the frames are loaded
+ * from a sidecar index next to the capture file if there's one that
+ * matches it; otherwise the file is read, and the index is written
+ * for the next time.
+ */
 int
-sharkd_load_cap_file(void)
+sharkd_load_cap_file(gboolean use_index)
 {
-  return load_cap_file(&cfile, 0, 0);
+  frame_index_key key;
+  char *index_name;
+  int err;
+
+  if (!use_index || !frame_index_key_for_file(cfile.filename, &key))
+    return load_cap_file(&cfile, 0, 0);
+
+  index_name = g_strdup_printf("%s.idx", cfile.filename);
+  if (load_cap_index(&cfile, index_name, &key)) {
+    g_free(index_name);
+    return 0;
+  }
+
+  err = load_cap_file(&cfile, 0, 0);
+  if (err == 0) {
+    /* Not being able to write the index isn't an error. */
+    frame_data_sequence_write_index(cfile.provider.frames, cfile.provider.wth,
+                                    index_name, &key);
+  }
+  g_free(index_name);
+  return err;
 }
 
 frame_data *
@@ -531,6 +678,8 @@ sharkd_dissect_request(guint32 framenum, guint32 frame_ref_num, guint32 prev_dis
   int err;
   char *err_info = NULL;
 
+  sharkd_first_pass(framenum);
+
   fdata = sharkd_get_frame(framenum);
   if (fdata == NULL)
     return -1;
@@ -585,6 +734,8 @@ sharkd_dissect_columns(frame_data *fdata, guint32 frame_ref_num, guint32 prev_di
   int err;
   char *err_info = NULL;
 
+  sharkd_first_pass(fdata->num);
+
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1500);
 
@@ -643,6 +794,8 @@ sharkd_retap(void)
   epan_dissect_t edt;
   column_info   *cinfo;
 
+  sharkd_first_pass(0);
+
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
 
@@ -693,58 +846,72 @@ sharkd_retap(void)
 int
 sharkd_filter(const char *dftext, guint8 **result)
 {
-  dfilter_t  *dfcode = NULL;
+  return sharkd_filter_multi(&dftext, 1, result);
+}
+
+/*
+ * Does a filter look at fields that depend on which frames the filter
+ * itself displays?  Those need the frames dissected with the filter's
+ * own previous displayed frame.
+ */
+gboolean
+sharkd_filter_uses_displayed(const dfilter_t *dfcode)
+{
+  static int hf_frame_time_delta_displayed = -1;
 
-  guint32 framenum, prev_dis_num = 0;
-  guint32 frames_count;
+  if (hf_frame_time_delta_displayed == -1)
+    hf_frame_time_delta_displayed = proto_registrar_get_id_byname("frame.time_delta_displayed");
+  return dfilter_interested_in_field(dfcode, hf_frame_time_delta_displayed);
+}
+
+/*
+ * Dissect the frames once, running several display filters over them;
+ * result[i] receives the frames passing dfcodes[i].  If own_prev_dis is
+ * set, there's one filter, and each frame's previous displayed frame is
+ * the last one that it passed; otherwise it's the frame before.
+ * Returns the number of frames filtered, less than the number of frames
+ * if one couldn't be read.
+ */
+static guint32
+sharkd_filter_frames(dfilter_t **dfcodes, int count, guint8 **result,
+                     gboolean own_prev_dis)
+{
+  guint32 framenum;
+  guint32 prev_dis_num = 0;
   Buffer buf;
   wtap_rec rec;
   int err;
   char *err_info = NULL;
-
-  guint8 *result_bits;
-  guint8  passed_bits;
+  int i;
 
   epan_dissect_t edt;
 
-  if (!dfilter_compile(dftext, &dfcode, &err_info)) {
-    g_free(err_info);
-    return -1;
-  }
-
-  frames_count = cfile.count;
-
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1500);
   epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
 
-  passed_bits = 0;
-  result_bits = (guint8 *) g_malloc(2 + (frames_count / 8));
-
-  for (framenum = 1; framenum <= frames_count; framenum++) {
+  for (framenum = 1; framenum <= cfile.count; framenum++) {
     frame_data *fdata = sharkd_get_frame(framenum);
 
-    if ((framenum & 7) == 0) {
-      result_bits[(framenum / 8) - 1] = passed_bits;
-      passed_bits = 0;
-    }
-
     if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
       break;
 
     /* frame_data_set_before_dissect */
-    epan_dissect_prime_with_dfilter(&edt, dfcode);
+    for (i = 0; i < count; i++)
+      epan_dissect_prime_with_dfilter(&edt, dfcodes[i]);
 
     fdata->flags.ref_time = FALSE;
     fdata->frame_ref_num = (framenum != 1) ? 1 : 0;
-    fdata->prev_dis_num = prev_dis_num;
+    fdata->prev_dis_num = own_prev_dis ? prev_dis_num : framenum - 1;
     epan_dissect_run(&edt, cfile.cd_t, &rec,
                      frame_tvbuff_new_buffer(&cfile.provider, fdata, &buf),
                      fdata, NULL);
 
-    if (dfilter_apply_edt(dfcode, &edt)) {
-      passed_bits |= (1 << (framenum % 8));
-      prev_dis_num = framenum;
+    for (i = 0; i < count; i++) {
+      if (dfilter_apply_edt(dfcodes[i], &edt)) {
+        result[i][framenum / 8] |= (1 << (framenum % 8));
+        prev_dis_num = framenum;
+      }
     }
 
     /* if passed or ref -> frame_data_set_after_dissect */
@@ -752,19 +919,72 @@ sharkd_filter(const char *dftext, guint8 **result)
     epan_dissect_reset(&edt);
   }
 
-  if ((framenum & 7) == 0)
-      framenum--;
-  result_bits[framenum / 8] = passed_bits;
-
   wtap_rec_cleanup(&rec);
   ws_buffer_free(&buf);
   epan_dissect_cleanup(&edt);
 
-  dfilter_free(dfcode);
+  return framenum - 1;
+}
+
+/*
+ * Run several display filters over all frames; result[i] receives the
+ * bitmap of frames passing dftexts[i].  The frames are dissected once
+ * for all the filters, except that each filter that uses fields
+ * relative to the previous displayed frame has them dissected for it
+ * alone.  Returns the number of frames filtered, or -1 if a filter
+ * doesn't compile; frames after those filtered aren't set in any bitmap.
+ */
+int
+sharkd_filter_multi(const char **dftexts, int count, guint8 **result)
+{
+  dfilter_t **dfcodes;
+  dfilter_t **shared_dfcodes;
+  guint8 **shared_result;
+  int n_shared = 0;
+  guint32 filtered;
+  int i;
+
+  dfcodes = g_new0(dfilter_t *, count);
+  for (i = 0; i < count; i++) {
+    char *err_info = NULL;
+
+    if (!dfilter_compile(dftexts[i], &dfcodes[i], &err_info)) {
+      g_free(err_info);
+      while (i-- > 0)
+        dfilter_free(dfcodes[i]);
+      g_free(dfcodes);
+      return -1;
+    }
+  }
+
+  sharkd_first_pass(0);
+
+  shared_dfcodes = g_new(dfilter_t *, count);
+  shared_result = g_new(guint8 *, count);
+  for (i = 0; i < count; i++) {
+    result[i] = (guint8 *) g_malloc0(2 + (cfile.count / 8));
+    if (!sharkd_filter_uses_displayed(dfcodes[i])) {
+      shared_dfcodes[n_shared] = dfcodes[i];
+      shared_result[n_shared] = result[i];
+      n_shared++;
+    }
+  }
+
+  filtered = cfile.count;
+  if (n_shared != 0)
+    filtered = MIN(filtered, sharkd_filter_frames(shared_dfcodes, n_shared, shared_result, FALSE));
+  for (i = 0; i < count; i++) {
+    if (sharkd_filter_uses_displayed(dfcodes[i]))
+      filtered = MIN(filtered, sharkd_filter_frames(&dfcodes[i], 1, &result[i], TRUE));
+  }
 
-  *result = result_bits;
+  g_free(shared_result);
+  g_free(shared_dfcodes);
+  for (i = 0; i < count; i++)
+    dfilter_free(dfcodes[i]);
+  g_free(dfcodes);
 
-  return framenum;
+  return (int)filtered;
 }
 
 const char *
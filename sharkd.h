@@ -18,9 +18,12 @@ typedef void (*sharkd_dissect_func_t)(epan_dissect_t *edt, proto_tree *tree, str
 
 /* sharkd.c */
 cf_status_t sharkd_cf_open(const char *fname, unsigned int type, gboolean is_tempfile, int *err);
-int sharkd_load_cap_file(void);
+int sharkd_load_cap_file(gboolean use_index);
+void sharkd_first_pass(guint32 upto);
 int sharkd_retap(void);
 int sharkd_filter(const char *dftext, guint8 **result);
+int sharkd_filter_multi(const char **dftexts, int count, guint8 **result);
+gboolean sharkd_filter_uses_displayed(const dfilter_t *dfcode);
 frame_data *sharkd_get_frame(guint32 framenum);
 int sharkd_dissect_columns(frame_data *fdata, guint32 frame_ref_num, guint32 prev_dis_num, column_info *cinfo, gboolean dissect_color);
 int sharkd_dissect_request(guint32 framenum, guint32 frame_ref_num, guint32 prev_dis_num, sharkd_dissect_func_t cb, int dissect_bytes, int dissect_columns, int dissect_tree, void *data);
@@ -23,6 +23,7 @@
 
 #include <file.h>
 #include <epan/epan_dissect.h>
+#include <epan/dfilter/dfilter.h>
 #include <epan/exceptions.h>
 #include <epan/color_filters.h>
 #include <epan/prefs.h>
@@ -39,6 +40,7 @@
 #include <epan/conversation_table.h>
 #include <epan/sequence_analysis.h>
 #include <epan/expert.h>
+#include <epan/dissector_profile.h>
 #include <epan/export_object.h>
 #include <epan/follow.h>
 #include <epan/rtd_table.h>
@@ -72,6 +74,7 @@
 struct sharkd_filter_item
 {
 	guint8 *filtered;
+	guint32 frames;		/* frames 1 to frames have been filtered */
 };
 
 static GHashTable *filter_table = NULL;
@@ -167,6 +170,373 @@ json_print_base64(const guint8 *data, size_t len)
 	putchar('"');
 }
 
+/*
+ * Display filters are split on their top-level logical operators, so
+ * that a filter edited by a client (e.g. "tcp && ip.addr == 1.2.3.4"
+ * extended to "tcp && ip.addr == 1.2.3.4 && !dns") only has to dissect
+ * the frames again for the predicates it hasn't seen before.  Results
+ * for the predicates and for the compound filters are all kept in
+ * filter_table, keyed by their normalized text.
+ */
+enum sharkd_filter_op
+{
+	SHARKD_FILTER_LEAF,
+	SHARKD_FILTER_AND,
+	SHARKD_FILTER_OR,
+	SHARKD_FILTER_NOT
+};
+
+struct sharkd_filter_node
+{
+	enum sharkd_filter_op op;
+	char *text;                          /* normalized predicate for SHARKD_FILTER_LEAF */
+	struct sharkd_filter_node *left;
+	struct sharkd_filter_node *right;    /* NULL for SHARKD_FILTER_NOT */
+};
+
+static void
+sharkd_filter_node_free(struct sharkd_filter_node *node)
+{
+	if (!node)
+		return;
+
+	sharkd_filter_node_free(node->left);
+	sharkd_filter_node_free(node->right);
+	g_free(node->text);
+	g_free(node);
+}
+
+static struct sharkd_filter_node *
+sharkd_filter_node_new(enum sharkd_filter_op op, struct sharkd_filter_node *left, struct sharkd_filter_node *right)
+{
+	struct sharkd_filter_node *node = g_new0(struct sharkd_filter_node, 1);
+
+	node->op = op;
+	node->left = left;
+	node->right = right;
+	return node;
+}
+
+static gboolean
+sharkd_filter_is_word_char(char c)
+{
+	return g_ascii_isalnum(c) || c == '_' || c == '.' || c == '-';
+}
+
+/* Length of the operator at p, given as a symbol and/or a keyword, or 0 if there is none. */
+static size_t
+sharkd_filter_match_op(const char *start, const char *p, const char *symbol, const char *word)
+{
+	size_t len;
+
+	if (symbol && !strncmp(p, symbol, strlen(symbol)))
+		return strlen(symbol);
+
+	len = strlen(word);
+	if (strncmp(p, word, len) != 0)
+		return 0;
+	if (p > start && sharkd_filter_is_word_char(p[-1]))
+		return 0;
+	if (sharkd_filter_is_word_char(p[len]))
+		return 0;
+	return len;
+}
+
+/* Copy a predicate, collapsing whitespace outside of string literals. */
+static char *
+sharkd_filter_normalize(const char *text, size_t len)
+{
+	GString *str = g_string_sized_new(len);
+	gboolean in_string = FALSE;
+	gboolean pending_space = FALSE;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		char c = text[i];
+
+		if (!in_string && g_ascii_isspace(c))
+		{
+			pending_space = (str->len != 0);
+			continue;
+		}
+
+		if (pending_space)
+		{
+			g_string_append_c(str, ' ');
+			pending_space = FALSE;
+		}
+
+		g_string_append_c(str, c);
+		if (in_string && c == '\\' && i + 1 < len)
+			g_string_append_c(str, text[++i]);
+		else if (c == '"')
+			in_string = !in_string;
+	}
+
+	return g_string_free(str, FALSE);
+}
+
+static struct sharkd_filter_node *sharkd_filter_parse_and(const char *start, const char **p);
+
+static struct sharkd_filter_node *
+sharkd_filter_parse_leaf(const char *start, const char **p)
+{
+	const char *s = *p;
+	const char *end;
+	int depth = 0;
+	struct sharkd_filter_node *node;
+
+	for (end = s; *end; end++)
+	{
+		if (*end == '"')
+		{
+			for (end++; *end && *end != '"'; end++)
+			{
+				if (*end == '\\' && end[1])
+					end++;
+			}
+			if (!*end)
+				return NULL;
+			continue;
+		}
+
+		if (*end == '(' || *end == '[' || *end == '{')
+			depth++;
+		else if (*end == ')' || *end == ']' || *end == '}')
+		{
+			if (depth == 0)
+				break;
+			depth--;
+		}
+		else if (depth == 0 &&
+			(sharkd_filter_match_op(start, end, "&&", "and") ||
+			 sharkd_filter_match_op(start, end, "||", "or")))
+			break;
+	}
+
+	node = sharkd_filter_node_new(SHARKD_FILTER_LEAF, NULL, NULL);
+	node->text = sharkd_filter_normalize(s, end - s);
+	*p = end;
+
+	if (depth != 0 || node->text[0] == '\0')
+	{
+		sharkd_filter_node_free(node);
+		return NULL;
+	}
+	return node;
+}
+
+static struct sharkd_filter_node *
+sharkd_filter_parse_unary(const char *start, const char **p)
+{
+	struct sharkd_filter_node *node;
+	size_t len;
+
+	while (g_ascii_isspace(**p))
+		(*p)++;
+
+	if (**p == '!' && (*p)[1] != '=')
+		len = 1;
+	else
+		len = sharkd_filter_match_op(start, *p, NULL, "not");
+
+	if (len != 0)
+	{
+		*p += len;
+		node = sharkd_filter_parse_unary(start, p);
+		return node ? sharkd_filter_node_new(SHARKD_FILTER_NOT, node, NULL) : NULL;
+	}
+
+	if (**p == '(')
+	{
+		(*p)++;
+		node = sharkd_filter_parse_and(start, p);
+		if (!node || **p != ')')
+		{
+			sharkd_filter_node_free(node);
+			return NULL;
+		}
+		(*p)++;
+		while (g_ascii_isspace(**p))
+			(*p)++;
+		return node;
+	}
+
+	return sharkd_filter_parse_leaf(start, p);
+}
+
+/* In the display filter grammar "or" binds tighter than "and". */
+static struct sharkd_filter_node *
+sharkd_filter_parse_or(const char *start, const char **p)
+{
+	struct sharkd_filter_node *node;
+	size_t len;
+
+	node = sharkd_filter_parse_unary(start, p);
+	while (node && (len = sharkd_filter_match_op(start, *p, "||", "or")) != 0)
+	{
+		struct sharkd_filter_node *right;
+
+		*p += len;
+		right = sharkd_filter_parse_unary(start, p);
+		if (!right)
+		{
+			sharkd_filter_node_free(node);
+			return NULL;
+		}
+		node = sharkd_filter_node_new(SHARKD_FILTER_OR, node, right);
+	}
+	return node;
+}
+
+static struct sharkd_filter_node *
+sharkd_filter_parse_and(const char *start, const char **p)
+{
+	struct sharkd_filter_node *node;
+	size_t len;
+
+	node = sharkd_filter_parse_or(start, p);
+	while (node && (len = sharkd_filter_match_op(start, *p, "&&", "and")) != 0)
+	{
+		struct sharkd_filter_node *right;
+
+		*p += len;
+		right = sharkd_filter_parse_or(start, p);
+		if (!right)
+		{
+			sharkd_filter_node_free(node);
+			return NULL;
+		}
+		node = sharkd_filter_node_new(SHARKD_FILTER_AND, node, right);
+	}
+	return node;
+}
+
+static struct sharkd_filter_node *
+sharkd_filter_parse(const char *filter)
+{
+	const char *p = filter;
+	struct sharkd_filter_node *node;
+
+	node = sharkd_filter_parse_and(filter, &p);
+	if (node && *p != '\0')
+	{
+		/* unbalanced parenthesis, or something we don't understand */
+		sharkd_filter_node_free(node);
+		return NULL;
+	}
+	return node;
+}
+
+/* Canonical text of a parsed filter, used as its key in filter_table. */
+static void
+sharkd_filter_node_key(const struct sharkd_filter_node *node, GString *key)
+{
+	switch (node->op)
+	{
+		case SHARKD_FILTER_LEAF:
+			g_string_append(key, node->text);
+			break;
+
+		case SHARKD_FILTER_NOT:
+			g_string_append(key, "!(");
+			sharkd_filter_node_key(node->left, key);
+			g_string_append_c(key, ')');
+			break;
+
+		case SHARKD_FILTER_AND:
+		case SHARKD_FILTER_OR:
+			g_string_append_c(key, '(');
+			sharkd_filter_node_key(node->left, key);
+			g_string_append(key, (node->op == SHARKD_FILTER_AND) ? ") && (" : ") || (");
+			sharkd_filter_node_key(node->right, key);
+			g_string_append_c(key, ')');
+			break;
+	}
+}
+
+static void
+sharkd_filter_node_missing(const struct sharkd_filter_node *node, GPtrArray *missing)
+{
+	guint i;
+
+	if (node->op != SHARKD_FILTER_LEAF)
+	{
+		sharkd_filter_node_missing(node->left, missing);
+		if (node->right)
+			sharkd_filter_node_missing(node->right, missing);
+		return;
+	}
+
+	if (g_hash_table_lookup(filter_table, node->text))
+		return;
+
+	for (i = 0; i < missing->len; i++)
+	{
+		if (!strcmp((const char *) g_ptr_array_index(missing, i), node->text))
+			return;
+	}
+	g_ptr_array_add(missing, node->text);
+}
+
+/*
+ * Clear the bits in a bitmap that aren't for frames 1 to frames: bit 0,
+ * the padding bits at the end, and any frames after those filtered.
+ */
+static void
+sharkd_filter_mask(guint8 *bitmap, size_t nbytes, guint32 frames)
+{
+	size_t i;
+
+	bitmap[0] &= ~1;
+	for (i = frames / 8 + 1; i < nbytes; i++)
+		bitmap[i] = 0;
+	bitmap[frames / 8] &= (guint8) ((2U << (frames % 8)) - 1);
+}
+
+/*
+ * Combine the cached bitmaps of the predicates; returns a new bitmap,
+ * and sets *frames to the number of frames it's for.
+ */
+static guint8 *
+sharkd_filter_node_eval(const struct sharkd_filter_node *node, size_t nbytes, guint32 *frames)
+{
+	struct sharkd_filter_item *l;
+	guint8 *result, *right;
+	guint32 right_frames;
+	size_t i;
+
+	switch (node->op)
+	{
+		case SHARKD_FILTER_LEAF:
+			l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, node->text);
+			*frames = l->frames;
+			return (guint8 *) g_memdup(l->filtered, (guint) nbytes);
+
+		case SHARKD_FILTER_NOT:
+			result = sharkd_filter_node_eval(node->left, nbytes, frames);
+			for (i = 0; i < nbytes; i++)
+				result[i] = ~result[i];
+			sharkd_filter_mask(result, nbytes, *frames);
+			return result;
+
+		case SHARKD_FILTER_AND:
+		case SHARKD_FILTER_OR:
+			result = sharkd_filter_node_eval(node->left, nbytes, frames);
+			right = sharkd_filter_node_eval(node->right, nbytes, &right_frames);
+			for (i = 0; i < nbytes; i++)
+				result[i] = (node->op == SHARKD_FILTER_AND) ? (result[i] & right[i]) : (result[i] | right[i]);
+			g_free(right);
+			if (right_frames < *frames)
+				*frames = right_frames;
+			sharkd_filter_mask(result, nbytes, *frames);
+			return result;
+	}
+
+	return NULL;
+}
+
 static void
 sharkd_session_filter_free(gpointer data)
 {
@@ -176,27 +546,120 @@ sharkd_session_filter_free(gpointer data)
 	g_free(l);
 }
 
+static void
+sharkd_session_filter_insert(const char *key, guint8 *filtered, guint32 frames)
+{
+	struct sharkd_filter_item *l;
+
+	l = (struct sharkd_filter_item *) g_malloc(sizeof(struct sharkd_filter_item));
+	l->filtered = filtered;
+	l->frames = frames;
+
+	g_hash_table_insert(filter_table, g_strdup(key), l);
+}
+
+/*
+ * Evaluate a parsed filter from the cached predicate bitmaps, dissecting
+ * the frames once for all the predicates not yet in the cache.
+ */
+static gboolean
+sharkd_session_filter_combine(const struct sharkd_filter_node *node, const char *key)
+{
+	GPtrArray *missing = g_ptr_array_new();
+	guint8 **filtered;
+	guint8 *result;
+	guint32 frames;
+	int ret;
+	guint i;
+
+	sharkd_filter_node_missing(node, missing);
+	if (missing->len != 0)
+	{
+		filtered = g_new0(guint8 *, missing->len);
+		ret = sharkd_filter_multi((const char **) missing->pdata, missing->len, filtered);
+		if (ret == -1)
+		{
+			/* one of the predicates doesn't make sense on its own */
+			g_free(filtered);
+			g_ptr_array_free(missing, TRUE);
+			return FALSE;
+		}
+
+		for (i = 0; i < missing->len; i++)
+			sharkd_session_filter_insert((const char *) g_ptr_array_index(missing, i), filtered[i], (guint32) ret);
+		g_free(filtered);
+	}
+	g_ptr_array_free(missing, TRUE);
+
+	result = sharkd_filter_node_eval(node, 2 + (cfile.count / 8), &frames);
+	sharkd_session_filter_insert(key, result, frames);
+	return TRUE;
+}
+
 static const guint8 *
 sharkd_session_filter_data(const char *filter)
 {
 	struct sharkd_filter_item *l;
+	struct sharkd_filter_node *node;
+	char *key;
 
-	l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, filter);
+	node = sharkd_filter_parse(filter);
+	if (node)
+	{
+		GString *str = g_string_new(NULL);
+
+		sharkd_filter_node_key(node, str);
+		key = g_string_free(str, FALSE);
+	}
+	else
+		key = sharkd_filter_normalize(filter, strlen(filter));
+
+	l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, key);
 	if (!l)
 	{
-		guint8 *filtered = NULL;
+		dfilter_t *dfcode = NULL;
+		char *err_info = NULL;
 
-		int ret = sharkd_filter(filter, &filtered);
+		gboolean uses_displayed;
 
-		if (ret == -1)
+		if (!dfilter_compile(filter, &dfcode, &err_info))
+		{
+			g_free(err_info);
+			sharkd_filter_node_free(node);
+			g_free(key);
 			return NULL;
+		}
+		uses_displayed = sharkd_filter_uses_displayed(dfcode);
+		dfilter_free(dfcode);
 
-		l = (struct sharkd_filter_item *) g_malloc(sizeof(struct sharkd_filter_item));
-		l->filtered = filtered;
+		/*
+		 * Filters on fields relative to the previous displayed frame
+		 * depend on the result of the whole filter, and so can't be
+		 * evaluated predicate by predicate.
+		 */
+		if (!node || node->op == SHARKD_FILTER_LEAF || uses_displayed ||
+			!sharkd_session_filter_combine(node, key))
+		{
+			guint8 *filtered = NULL;
+
+			int ret = sharkd_filter(filter, &filtered);
+
+			if (ret == -1)
+			{
+				sharkd_filter_node_free(node);
+				g_free(key);
+				return NULL;
+			}
+
+			sharkd_session_filter_insert(key, filtered, (guint32) ret);
+		}
 
-		g_hash_table_insert(filter_table, g_strdup(filter), l);
+		l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, key);
 	}
 
+	sharkd_filter_node_free(node);
+	g_free(key);
+
 	return l->filtered;
 }
 
@@ -543,6 +1006,8 @@ sharkd_session_process_info(void)
  *
  * Input:
  *   (m) file - file to be loaded
+ *   (o) index - if "true", load the frames from a sidecar index (file.idx)
+ *               if one matches the file, otherwise write one
  *
  * Output object with attributes:
  *   (m) err - error code
@@ -551,6 +1016,7 @@ static void
 sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 {
 	const char *tok_file = json_find_attr(buf, tokens, count, "file");
+	const char *tok_index = json_find_attr(buf, tokens, count, "index");
 	int err = 0;
 
 	fprintf(stderr, "load: filename=%s\n", tok_file);
@@ -566,7 +1032,7 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 
 	TRY
 	{
-		err = sharkd_load_cap_file();
+		err = sharkd_load_cap_file(tok_index && !strcmp(tok_index, "true"));
 	}
 	CATCH(OutOfMemoryError)
 	{
@@ -700,6 +1166,69 @@ sharkd_session_process_analyse(void)
 	g_hash_table_destroy(analyser.protocols_set);
 }
 
+static void
+sharkd_session_process_profile_cb(epan_dissect_t *edt _U_, proto_tree *tree _U_, struct epan_column_info *cinfo _U_, const GSList *data_src _U_, void *data _U_)
+{
+}
+
+/**
+ * sharkd_session_process_profile()
+ *
+ * Process profile request: dissect every frame again, measuring the time
+ * and memory used by each protocol's dissectors.
+ *
+ * Output object with attributes:
+ *   (m) frames    - count of currently loaded frames
+ *   (m) protocols - array of objects, sorted by exclusive time, with attributes:
+ *                  'proto'        - protocol filter name
+ *                  'calls'        - number of calls, including heuristic tries
+ *                  'heur_tries'   - number of calls as a heuristic dissector
+ *                  'heur_accepts' - number of heuristic calls accepting the packet
+ *                  'incl_time'    - seconds spent, including called dissectors
+ *                  'excl_time'    - seconds spent, excluding called dissectors
+ *                  'excl_bytes'   - wmem bytes allocated, excluding called dissectors
+ */
+static void
+sharkd_session_process_profile(void)
+{
+	unsigned int framenum;
+	GPtrArray *results;
+	guint i;
+
+	/* The deferred first pass isn't part of what's being measured */
+	sharkd_first_pass(0);
+
+	dissector_profile_start();
+	for (framenum = 1; framenum <= cfile.count; framenum++)
+		sharkd_dissect_request(framenum, (framenum != 1) ? 1 : 0, framenum - 1, &sharkd_session_process_profile_cb, 0, 0, 0, NULL);
+	dissector_profile_stop();
+
+	printf("{\"frames\":%u", cfile.count);
+
+	printf(",\"protocols\":[");
+	results = dissector_profile_get_results();
+	for (i = 0; i < results->len; i++)
+	{
+		const dissector_profile_t *profile = (const dissector_profile_t *)g_ptr_array_index(results, i);
+
+		if (i)
+			printf(",");
+		printf("{\"proto\":");
+		json_puts_string(proto_get_protocol_filter_name(profile->proto_id));
+		printf(",\"calls\":%" G_GINT64_MODIFIER "u", profile->calls);
+		printf(",\"heur_tries\":%" G_GINT64_MODIFIER "u", profile->heur_tries);
+		printf(",\"heur_accepts\":%" G_GINT64_MODIFIER "u", profile->heur_accepts);
+		printf(",\"incl_time\":%.9f", profile->incl_ns / 1e9);
+		printf(",\"excl_time\":%.9f", profile->excl_ns / 1e9);
+		printf(",\"excl_bytes\":%" G_GINT64_MODIFIER "u", profile->excl_bytes);
+		printf("}");
+	}
+	g_ptr_array_free(results, TRUE);
+	printf("]");
+
+	printf("}\n");
+}
+
 static column_info *
 sharkd_session_create_columns(column_info *cinfo, const char *buf, const jsmntok_t *tokens, int count)
 {
@@ -3942,6 +4471,8 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
 			sharkd_session_process_status();
 		else if (!strcmp(tok_req, "analyse"))
 			sharkd_session_process_analyse();
+		else if (!strcmp(tok_req, "profile"))
+			sharkd_session_process_profile();
 		else if (!strcmp(tok_req, "info"))
 			sharkd_session_process_info();
 		else if (!strcmp(tok_req, "check"))
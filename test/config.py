@@ -20,6 +20,7 @@ import tempfile
 commands = (
     'capinfos',
     'dumpcap',
+    'editcap',
     'mergecap',
     'rawshark',
     'text2pcap',
@@ -35,6 +36,7 @@ program_path = None
 # Strings
 cmd_capinfos = None
 cmd_dumpcap = None
+cmd_editcap = None
 cmd_mergecap = None
 cmd_rawshark = None
 cmd_tshark = None
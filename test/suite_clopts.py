@@ -11,6 +11,7 @@
 
 import config
 import os.path
+import struct
 import subprocess
 import subprocesstest
 import unittest
@@ -183,6 +184,106 @@ class case_tshark_dump_glossaries(subprocesstest.SubprocessTestCase):
         self.runProcess((config.cmd_tshark, '-G', 'plugins'), env=os.environ.copy())
         self.assertGreaterEqual(self.countOutput('dissector'), 10, 'Fewer than 10 dissector plugins found')
 
+def ip_checksum(header):
+    total = sum(struct.unpack('!{}H'.format(len(header) // 2), header))
+    while total > 0xffff:
+        total = (total & 0xffff) + (total >> 16)
+    return struct.pack('!H', ~total & 0xffff)
+
+def ipv4_udp(ttl, payload):
+    udp = struct.pack('!HHHH', 1234, 5678, 8 + len(payload), 0) + payload
+    header = struct.pack('!BBHHHBB2s4s4s', 0x45, 0, 20 + len(udp), 1, 0,
+        ttl, 17, b'\0\0', bytes((192, 0, 2, 1)), bytes((198, 51, 100, 1)))
+    return header[:10] + ip_checksum(header) + header[12:] + udp
+
+def ipv6_udp(hop_limit, payload):
+    udp = struct.pack('!HHHH', 1234, 5678, 8 + len(payload), 0) + payload
+    return struct.pack('!IHBB16s16s', 0x60000000, len(udp), 17, hop_limit,
+        bytes.fromhex('20010db8000000000000000000000001'),
+        bytes.fromhex('20010db8000000000000000000000002')) + udp
+
+def ethernet(ethertype, packet, tags=()):
+    frame = bytes.fromhex('020000000002') + bytes.fromhex('020000000001')
+    for tpid, vid in tags:
+        frame += struct.pack('!HH', tpid, vid)
+    return frame + struct.pack('!H', ethertype) + packet
+
+def write_ttl_capture(self):
+    '''Write copies of packets that differ only in TTL or hop limit, in
+    pairs, untagged, VLAN-tagged and QinQ-tagged, and a pair that doesn't
+    differ at all; return the file and which frames are TTL-only copies'''
+    payload = b'editcap duplicate'
+    vlan = ((0x8100, 10),)
+    qinq = ((0x88a8, 100), (0x8100, 10))
+    frames = []
+    ttl_copies = []
+    for ethertype, make_packet, tags in (
+            (0x0800, ipv4_udp, ()),
+            (0x0800, ipv4_udp, vlan),
+            (0x0800, ipv4_udp, qinq),
+            (0x86dd, ipv6_udp, ()),
+            (0x86dd, ipv6_udp, vlan),
+            ):
+        frames.append(ethernet(ethertype, make_packet(64, payload), tags))
+        frames.append(ethernet(ethertype, make_packet(63, payload), tags))
+        ttl_copies.append(len(frames) - 1)
+    frames.append(ethernet(0x0800, ipv4_udp(64, b'another packet')))
+    frames.append(frames[-1])
+
+    capture_file = self.filename_from_id('ttl.pcap')
+    with open(capture_file, 'wb') as cap_fd:
+        cap_fd.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for i, frame in enumerate(frames):
+            cap_fd.write(struct.pack('<IIII', 1500000000, i * 1000, len(frame), len(frame)) + frame)
+    return capture_file, frames, ttl_copies
+
+def read_pcap_frames(capture_file):
+    with open(capture_file, 'rb') as cap_fd:
+        data = cap_fd.read()
+    frames = []
+    pos = 24
+    while pos < len(data):
+        caplen = struct.unpack('<IIII', data[pos:pos + 16])[2]
+        frames.append(data[pos + 16:pos + 16 + caplen])
+        pos += 16 + caplen
+    return frames
+
+class case_editcap_dedup_clopts(subprocesstest.SubprocessTestCase):
+    def check_dedup(self, dedup_args):
+        capture_file, frames, ttl_copies = write_ttl_capture(self)
+        testout_file = self.filename_from_id(testout_pcap)
+
+        # Without --ignore-ttl, only the exact copy is a duplicate.
+        self.assertRun((config.cmd_editcap, *dedup_args, capture_file, testout_file))
+        self.assertEqual(read_pcap_frames(testout_file), frames[:-1])
+
+        # With it, so is each copy with a different TTL or hop limit,
+        # however many VLAN tags there are in front of the IP header.
+        self.assertRun((config.cmd_editcap, '--ignore-ttl', *dedup_args,
+            capture_file, testout_file))
+        self.assertEqual(read_pcap_frames(testout_file),
+            [frame for i, frame in enumerate(frames[:-1]) if i not in ttl_copies])
+
+    def test_editcap_dedup_ttl(self):
+        '''-d finds copies that differ only in TTL with --ignore-ttl'''
+        self.check_dedup(('-d',))
+
+    def test_editcap_dedup_window_ttl(self):
+        '''-D finds copies that differ only in TTL with --ignore-ttl'''
+        self.check_dedup(('-D', '2'))
+
+    def test_editcap_dedup_time_ttl(self):
+        '''-w finds copies that differ only in TTL with --ignore-ttl'''
+        self.check_dedup(('-w', '0.002'))
+
+    def test_editcap_dedup_ttl_window(self):
+        '''Copies that have fallen out of the -D window aren't duplicates'''
+        capture_file, frames, ttl_copies = write_ttl_capture(self)
+        testout_file = self.filename_from_id(testout_pcap)
+        # With a window of 1, no earlier frame is looked at.
+        self.assertRun((config.cmd_editcap, '--ignore-ttl', '-D', '1',
+            capture_file, testout_file))
+        self.assertEqual(read_pcap_frames(testout_file), frames)
 
 # Purposefully fail a test. Used for testing the test framework.
 # class case_fail_on_purpose(subprocesstest.SubprocessTestCase):
@@ -29,3 +29,114 @@ class case_dissect_http2(subprocesstest.SubprocessTestCase):
             ),
             env=config.test_env)
         self.assertTrue(self.grepOutput('DATA'))
+
+class case_dissect_recorded_fields(subprocesstest.SubprocessTestCase):
+    # When nothing needs the protocol tree itself, TShark records string
+    # and byte fields during dissection and decodes them when they're
+    # looked up, after the packet has been dissected.
+    def test_recorded_fields_display_filter(self):
+        '''Display filter on a recorded string field'''
+        capture_file = os.path.join(config.capture_dir, 'sip.pcapng')
+        self.assertRun((config.cmd_tshark,
+                '-r', capture_file,
+                '-Y', 'sip.from.user == "7323685154"',
+            ),
+            env=config.test_env)
+        self.assertEqual(self.countOutput('SIP'), 3)
+
+    def test_recorded_fields_output(self):
+        '''Field output of a recorded string field'''
+        capture_file = os.path.join(config.capture_dir, 'sip.pcapng')
+        self.assertRun((config.cmd_tshark,
+                '-r', capture_file,
+                '-T', 'fields',
+                '-e', 'sip.from.user',
+            ),
+            env=config.test_env)
+        self.assertEqual(self.countOutput('^34903$'), 2)
+        self.assertEqual(self.countOutput('^7323685154$'), 3)
+
+    def test_recorded_fields_filter_and_output(self):
+        '''Display filter and field output on recorded string fields'''
+        capture_file = os.path.join(config.capture_dir, 'sip.pcapng')
+        self.assertRun((config.cmd_tshark,
+                '-r', capture_file,
+                '-Y', 'sip.from.user contains "3490"',
+                '-T', 'fields',
+                '-e', 'sip.from.user',
+                '-e', 'sip.from.host',
+            ),
+            env=config.test_env)
+        self.assertEqual(self.countOutput('^34903\tcsp.noklab.net$'), 2)
+        self.assertFalse(self.grepOutput('7323685154'))
+
+class case_dissect_eviction(subprocesstest.SubprocessTestCase):
+    def test_eviction_lru(self):
+        '''Freeing the least recently used TCP conversation'''
+        # rsasnakeoil2.pcap has two TCP connections, so the first one
+        # is freed, with its data, once the second one starts.  TLS
+        # data can't be freed, so TLS is disabled.
+        capture_file = os.path.join(config.capture_dir, 'rsasnakeoil2.pcap')
+        self.assertRun((config.cmd_tshark,
+                '-r', capture_file,
+                '--max-conversations', '1',
+                '--disable-protocol', 'tls',
+                '-o', 'tcp.analyze_sequence_numbers:TRUE',
+                '-T', 'fields',
+                '-e', 'frame.number',
+            ),
+            env=config.test_env)
+        self.assertEqual(self.countOutput(r'^\d+$'), 58)
+        self.assertTrue(self.grepOutput(r'Conversations evicted: 0 idle, [1-9]\d* least recently used; 1 remaining, 0 kept'))
+
+    def test_eviction_kept(self):
+        '''Conversations with data that can't be freed are kept'''
+        capture_file = os.path.join(config.capture_dir, 'rsasnakeoil2.pcap')
+        self.assertRun((config.cmd_tshark,
+                '-r', capture_file,
+                '--max-conversations', '1',
+                '-T', 'fields',
+                '-e', 'tls.record.content_type',
+            ),
+            env=config.test_env)
+        self.assertTrue(self.grepOutput(r'Conversations evicted: 0 idle, 0 least recently used; 0 remaining, [1-9]\d* kept'))
+
+    def test_eviction_unchanged(self):
+        '''Enabling eviction without evicting anything doesn't change the output'''
+        capture_file = os.path.join(config.capture_dir, 'rsasnakeoil2.pcap')
+        fields = ('-T', 'fields', '-e', 'tcp.stream', '-e', 'tcp.analysis.flags', '-e', 'tcp.len')
+        plain_proc = self.assertRun((config.cmd_tshark, '-r', capture_file) + fields,
+            env=config.test_env)
+        evict_proc = self.assertRun((config.cmd_tshark, '-r', capture_file,
+                '--max-conversations', '100') + fields,
+            env=config.test_env)
+        self.assertEqual(plain_proc.stdout_str, evict_proc.stdout_str)
+        self.assertTrue(self.grepOutput('Conversations evicted: 0 idle, 0 least recently used', evict_proc))
+
+class case_dissect_second_pass_threads(subprocesstest.SubprocessTestCase):
+    def check_second_pass_threads(self, capture_name, *args):
+        capture_file = os.path.join(config.capture_dir, capture_name)
+        tshark_cmd = (config.cmd_tshark, '-r', capture_file, '-2', '-V') + args
+        serial_proc = self.assertRun(tshark_cmd, env=config.test_env)
+        threads_proc = self.assertRun(tshark_cmd + ('--second-pass-threads', '4'),
+            env=config.test_env)
+        self.assertEqual(serial_proc.stdout_str, threads_proc.stdout_str)
+
+    def test_second_pass_threads_reassembly(self):
+        '''Reading the second pass on threads doesn't change reassembled data'''
+        # Reassembled TLS and HTTP/2 data is read back from the frames
+        # it was reassembled from while the readers are reading ahead.
+        if not config.have_nghttp2:
+            self.skipTest('Requires nghttp2.')
+        key_file = os.path.join(config.key_dir, 'http2-data-reassembly.keys')
+        self.check_second_pass_threads('http2-data-reassembly.pcap',
+            '-o', 'ssl.keylog_file: {}'.format(key_file),
+            '-d', 'tcp.port==8443,ssl')
+
+    def test_second_pass_threads_pcapng(self):
+        '''Reading the second pass on threads doesn't change a pcapng file'''
+        self.check_second_pass_threads('sip.pcapng')
+
+    def test_second_pass_threads_compressed(self):
+        '''A compressed file is read on the main thread'''
+        self.check_second_pass_threads('dns+icmp.pcapng.gz')
@@ -10,8 +10,10 @@
 '''File format conversion tests'''
 
 import config
+import gzip
 import io
 import os.path
+import struct
 import subprocesstest
 import sys
 import unittest
@@ -110,3 +112,137 @@ class case_fileformat_pcapng(subprocesstest.SubprocessTestCase):
             )
         self.assertTrue(self.diffOutput(capture_proc.stdout_str, baseline_str, 'tshark', baseline_file))
 
+
+compressed_magic = {
+    # A plain gzip stream has no extra field; BGZF blocks have one
+    'gzip': b'\x1f\x8b\x08\x00',
+    'bgzf': b'\x1f\x8b\x08\x04',
+    'zstd': b'\x28\xb5\x2f\xfd',
+    'lz4': b'\x04\x22\x4d\x18',
+}
+
+def bgzf_block_sizes(self, testout_file):
+    '''Walk the blocks of a BGZF file, and return the size of the data in each'''
+    with open(testout_file, 'rb') as testout_fd:
+        data = testout_fd.read()
+    sizes = []
+    pos = 0
+    while pos < len(data):
+        self.assertEqual(data[pos:pos + 4], compressed_magic['bgzf'])
+        xlen, si1, si2, slen, bsize = struct.unpack_from('<HBBHH', data, pos + 10)
+        self.assertEqual((xlen, si1, si2, slen), (6, ord('B'), ord('C'), 2))
+        pos += bsize + 1
+        sizes.append(struct.unpack_from('<I', data, pos - 4)[0])
+    self.assertEqual(pos, len(data))
+    return sizes
+
+def write_large_pcap(self, count):
+    '''Write a pcap file big enough to take many BGZF blocks'''
+    capture_file = self.filename_from_id('large.pcap')
+    with open(capture_file, 'wb') as cap_fd:
+        cap_fd.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for i in range(count):
+            data = bytes((i * 13 + j * j) & 0xff for j in range(997))
+            cap_fd.write(struct.pack('<IIII', i, 0, len(data), len(data)) + data)
+    return capture_file
+
+def check_compressed_read(self, testout_file, compression):
+    with open(testout_file, 'rb') as testout_fd:
+        self.assertEqual(testout_fd.read(4), compressed_magic[compression])
+    # Sequentially, and with the second pass reading the packets randomly
+    for pass_args in ((), ('-2',)):
+        capture_proc = self.runProcess(subprocesstest.capture_command(config.cmd_tshark,
+                '-r', testout_file,
+                '-Tfields',
+                '-e', 'frame.number', '-e', 'frame.time_epoch', '-e', 'frame.time_delta',
+                *pass_args
+                ),
+            )
+        self.assertTrue(self.diffOutput(capture_proc.stdout_str, baseline_str, 'tshark', baseline_file))
+
+def check_editcap_compressed(self, compression):
+    capture_file = os.path.join(config.capture_dir, 'dhcp.pcap')
+    testout_file = self.filename_from_id('testout.pcap.' + compression)
+    editcap_proc = self.runProcess((config.cmd_editcap,
+        '--compress', compression,
+        capture_file, testout_file,
+        ))
+    if self.grepOutput("isn't a supported output compression type"):
+        self.skipTest('Requires {} support.'.format(compression))
+    self.assertEqual(editcap_proc.returncode, 0)
+    check_compressed_read(self, testout_file, compression)
+
+def check_dumpcap_compressed(self, compression):
+    if config.cmd_dumpcap is None:
+        self.skipTest('Requires dumpcap.')
+    testout_file = self.filename_from_id('testout.pcap.' + compression)
+    cat_dhcp_cmd = subprocesstest.cat_dhcp_command('cat')
+    capture_cmd = subprocesstest.capture_command(config.cmd_dumpcap,
+        '-i', '-',
+        '-P',
+        '-w', testout_file,
+        '--compress', compression,
+        shell=True
+    )
+    dumpcap_proc = self.runProcess(cat_dhcp_cmd + ' | ' + capture_cmd, shell=True)
+    if self.grepOutput("isn't supported on this platform"):
+        self.skipTest('Requires {} support.'.format(compression))
+    self.assertEqual(dumpcap_proc.returncode, 0)
+    check_compressed_read(self, testout_file, compression)
+
+class case_fileformat_compressed(subprocesstest.SubprocessTestCase):
+    def test_editcap_gzip(self):
+        '''Microsecond pcap direct vs gzip-compressed pcap written by editcap'''
+        # One gzip stream, not BGZF blocks
+        check_editcap_compressed(self, 'gzip')
+
+    def test_editcap_bgzf(self):
+        '''Microsecond pcap direct vs BGZF-compressed pcap written by editcap'''
+        check_editcap_compressed(self, 'bgzf')
+        # One block of data, and the empty end-of-file block
+        sizes = bgzf_block_sizes(self, self.filename_from_id('testout.pcap.bgzf'))
+        self.assertEqual(len(sizes), 2)
+        self.assertEqual(sizes[1], 0)
+
+    def test_editcap_bgzf_blocks(self):
+        '''A BGZF file of many blocks reads the same sequentially, with blocks inflated in parallel, and randomly'''
+        capture_file = write_large_pcap(self, 2000)
+        testout_file = self.filename_from_id('testout.pcap.gz')
+        self.assertRun((config.cmd_editcap,
+            '--compress', 'bgzf',
+            capture_file, testout_file,
+            ))
+        if self.grepOutput("isn't a supported output compression type"):
+            self.skipTest('Requires gzip support.')
+
+        # Full blocks, then what's left over, then the end-of-file block;
+        # it's still a gzip file that anything can decompress.
+        sizes = bgzf_block_sizes(self, testout_file)
+        self.assertGreater(len(sizes), 20)
+        self.assertEqual(len(set(sizes[:-2])), 1)
+        self.assertEqual(sizes[-1], 0)
+        with open(capture_file, 'rb') as cap_fd:
+            original = cap_fd.read()
+        with gzip.open(testout_file, 'rb') as testout_fd:
+            self.assertEqual(testout_fd.read(), original)
+
+        for pass_args in ((), ('-2',)):
+            expected = self.assertRun((config.cmd_tshark, '-r', capture_file, '-x') + pass_args)
+            testout_proc = self.assertRun((config.cmd_tshark, '-r', testout_file, '-x') + pass_args)
+            self.assertEqual(testout_proc.stdout_str, expected.stdout_str)
+
+    def test_editcap_zstd(self):
+        '''Microsecond pcap direct vs zstd-compressed pcap written by editcap'''
+        check_editcap_compressed(self, 'zstd')
+
+    def test_editcap_lz4(self):
+        '''Microsecond pcap direct vs LZ4-compressed pcap written by editcap'''
+        check_editcap_compressed(self, 'lz4')
+
+    def test_dumpcap_zstd(self):
+        '''Microsecond pcap direct vs zstd-compressed pcap written by dumpcap'''
+        check_dumpcap_compressed(self, 'zstd')
+
+    def test_dumpcap_lz4(self):
+        '''Microsecond pcap direct vs LZ4-compressed pcap written by dumpcap'''
+        check_dumpcap_compressed(self, 'lz4')
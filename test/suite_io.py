@@ -12,10 +12,17 @@
 import config
 import io
 import os.path
+import struct
 import subprocesstest
 import sys
 import unittest
 
+try:
+    import pyarrow.ipc
+    has_pyarrow = True
+except ImportError:
+    has_pyarrow = False
+
 testout_pcap = 'testout.pcap'
 baseline_file = 'io-rawshark-dhcp-pcap.txt'
 baseline_fd = io.open(os.path.join(config.baseline_dir, baseline_file), 'r', encoding='UTF-8', errors='replace')
@@ -87,3 +94,149 @@ class case_rawshark_io(subprocesstest.SubprocessTestCase):
         self.assertEqual(rawshark_returncode, 0)
         if (rawshark_returncode == 0):
             self.assertTrue(self.diffOutput(rawshark_proc.stdout_str, baseline_str, 'rawshark', baseline_file))
+
+# A minimal FlatBuffers reader, enough to walk the messages of an Arrow
+# IPC stream without pyarrow.
+def fb_u8(buf, pos):
+    return struct.unpack_from('<B', buf, pos)[0]
+
+def fb_u32(buf, pos):
+    return struct.unpack_from('<I', buf, pos)[0]
+
+def fb_i64(buf, pos):
+    return struct.unpack_from('<q', buf, pos)[0]
+
+def fb_deref(buf, pos):
+    return pos + fb_u32(buf, pos)
+
+def fb_field(buf, table, slot):
+    '''Return the position of a table field, or None if it's absent'''
+    vtable = table - struct.unpack_from('<i', buf, table)[0]
+    vtable_len = struct.unpack_from('<H', buf, vtable)[0]
+    if 4 + 2 * slot >= vtable_len:
+        return None
+    offset = struct.unpack_from('<H', buf, vtable + 4 + 2 * slot)[0]
+    return table + offset if offset else None
+
+def fb_vector(buf, table, slot):
+    '''Return the position of a vector field's elements, and its length'''
+    vector = fb_deref(buf, fb_field(buf, table, slot))
+    return vector + 4, fb_u32(buf, vector)
+
+def fb_string(buf, table, slot):
+    start, length = fb_vector(buf, table, slot)
+    return buf[start:start + length].decode('UTF-8')
+
+def read_arrow_stream(self, data):
+    '''Split an Arrow IPC stream into (header type, header, body) messages'''
+    messages = []
+    pos = 0
+    while True:
+        self.assertEqual(fb_u32(data, pos), 0xFFFFFFFF)
+        meta_len = fb_u32(data, pos + 4)
+        pos += 8
+        if meta_len == 0:
+            break
+        self.assertEqual(meta_len % 8, 0)
+        meta = data[pos:pos + meta_len]
+        message = fb_deref(meta, 0)
+        header_type = fb_u8(meta, fb_field(meta, message, 1))
+        header = fb_deref(meta, fb_field(meta, message, 2))
+        body_len_field = fb_field(meta, message, 3)
+        body_len = fb_i64(meta, body_len_field) if body_len_field is not None else 0
+        self.assertEqual(body_len % 8, 0)
+        pos += meta_len
+        messages.append((header_type, meta, header, data[pos:pos + body_len]))
+        pos += body_len
+    # The end-of-stream marker ends the data
+    self.assertEqual(pos, len(data))
+    return messages
+
+class case_tshark_arrow(subprocesstest.SubprocessTestCase):
+    fields = ('frame.number', 'sip.from.user', 'ip.src', 'ipv6.src')
+
+    def run_arrow(self):
+        capture_file = os.path.join(config.capture_dir, 'sip.pcapng')
+        testout_file = self.filename_from_id('testout.arrow')
+        field_args = ' '.join('-e {}'.format(f) for f in self.fields)
+        arrow_cmd = '"{0}" -r "{1}" -T arrow {2} > "{3}"'.format(
+            config.cmd_tshark, capture_file, field_args, testout_file)
+        arrow_proc = self.runProcess(arrow_cmd, shell=True, env=config.test_env)
+        self.assertEqual(arrow_proc.returncode, 0)
+        with open(testout_file, 'rb') as arrow_fd:
+            return arrow_fd.read()
+
+    def expected_users(self):
+        capture_file = os.path.join(config.capture_dir, 'sip.pcapng')
+        fields_proc = self.assertRun((config.cmd_tshark,
+                '-r', capture_file,
+                '-T', 'fields', '-e', 'sip.from.user',
+            ),
+            env=config.test_env)
+        return fields_proc.stdout_str.splitlines()
+
+    def test_tshark_arrow_framing(self):
+        '''A schema, one record batch and an end-of-stream marker'''
+        data = self.run_arrow()
+        expected_users = self.expected_users()
+        rows = len(expected_users)
+        messages = read_arrow_stream(self, data)
+        self.assertEqual([m[0] for m in messages], [1, 3])
+
+        # Schema: a field per -e, with the types we map them to
+        _, meta, schema, _ = messages[0]
+        start, count = fb_vector(meta, schema, 1)
+        self.assertEqual(count, len(self.fields))
+        names = []
+        types = []
+        for i in range(count):
+            field = fb_deref(meta, start + 4 * i)
+            names.append(fb_string(meta, field, 0))
+            types.append(fb_u8(meta, fb_field(meta, field, 2)))
+        self.assertEqual(tuple(names), self.fields)
+        # Int, Utf8, FixedSizeBinary, FixedSizeBinary
+        self.assertEqual(types, [2, 5, 15, 15])
+
+        # RecordBatch: a row per packet, and a node per column; one
+        # packet isn't SIP, so it has no sip.from.user, and none are IPv6
+        _, meta, batch, body = messages[1]
+        self.assertEqual(fb_i64(meta, fb_field(meta, batch, 0)), rows)
+        nodes, node_count = fb_vector(meta, batch, 1)
+        self.assertEqual(node_count, len(self.fields))
+        null_counts = []
+        for i in range(node_count):
+            self.assertEqual(fb_i64(meta, nodes + 16 * i), rows)
+            null_counts.append(fb_i64(meta, nodes + 16 * i + 8))
+        self.assertEqual(null_counts, [0, expected_users.count(''), 0, rows])
+
+        # Buffers: validity and values for frame.number, then validity,
+        # offsets and data for sip.from.user, then validity and values
+        # for ip.src and for ipv6.src
+        buffers, buffer_count = fb_vector(meta, batch, 2)
+        self.assertEqual(buffer_count, 9)
+        def buffer(i):
+            offset = fb_i64(meta, buffers + 16 * i)
+            length = fb_i64(meta, buffers + 16 * i + 8)
+            self.assertLessEqual(offset + length, len(body))
+            return body[offset:offset + length]
+        frame_numbers = struct.unpack_from('<{}I'.format(rows), buffer(1))
+        self.assertEqual(list(frame_numbers), list(range(1, rows + 1)))
+        offsets = struct.unpack_from('<{}i'.format(rows + 1), buffer(3))
+        values = buffer(4)
+        users = [values[offsets[i]:offsets[i + 1]].decode('UTF-8') for i in range(rows)]
+        self.assertEqual(users, expected_users)
+        # A null IPv6 address is 16 zero bytes
+        self.assertEqual(buffer(8)[:16 * rows], bytes(16 * rows))
+
+    @unittest.skipUnless(has_pyarrow, 'Requires pyarrow')
+    def test_tshark_arrow_pyarrow(self):
+        '''pyarrow reads the stream'''
+        data = self.run_arrow()
+        expected_users = [u if u else None for u in self.expected_users()]
+        rows = len(expected_users)
+        table = pyarrow.ipc.open_stream(data).read_all()
+        self.assertEqual(tuple(table.schema.names), self.fields)
+        self.assertEqual(table.num_rows, rows)
+        self.assertEqual(table.column('frame.number').to_pylist(), list(range(1, rows + 1)))
+        self.assertEqual(table.column('sip.from.user').to_pylist(), expected_users)
+        self.assertEqual(table.column('ipv6.src').to_pylist(), [None] * rows)
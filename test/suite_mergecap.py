@@ -12,6 +12,7 @@
 import config
 import os.path
 import re
+import struct
 import subprocesstest
 import unittest
 
@@ -291,3 +292,104 @@ class case_mergecap_pcapng(subprocesstest.SubprocessTestCase):
         # check for 11 IDBs, 88*3=264 total pkts, 86*3=258 in first IDB
         check_mergecap(self, mergecap_proc, 'pcapng', 'Per packet', 264, 11, 258)
 
+def write_timed_pcap(self, name, file_index, times):
+    '''Write a pcap file with a record at each of the given (secs, usecs)
+    times, each saying which file and record it is'''
+    capture_file = self.filename_from_id(name)
+    with open(capture_file, 'wb') as cap_fd:
+        cap_fd.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for seq, (secs, usecs) in enumerate(times):
+            data = 'file {} record {}'.format(file_index, seq).encode('ascii')
+            cap_fd.write(struct.pack('<IIII', secs, usecs, len(data), len(data)) + data)
+    return capture_file
+
+def read_pcap_records(capture_file):
+    '''Return the time stamp and data of each record in a pcap file'''
+    with open(capture_file, 'rb') as cap_fd:
+        contents = cap_fd.read()
+    records = []
+    pos = 24
+    while pos < len(contents):
+        secs, usecs, caplen, _ = struct.unpack('<IIII', contents[pos:pos + 16])
+        records.append(((secs, usecs), contents[pos + 16:pos + 16 + caplen]))
+        pos += 16 + caplen
+    return records
+
+class case_mergecap_order(subprocesstest.SubprocessTestCase):
+    def test_mergecap_interleaved_ties(self):
+        '''Records are merged in time order, and of records with the same
+        time stamp, the one from the later file goes first'''
+        file_times = (
+            ((100, 0), (100, 3), (100, 5), (100, 5), (100, 7), (101, 0)),
+            ((100, 2), (100, 3), (100, 5), (100, 6), (101, 0)),
+            ((100, 3), (100, 5), (100, 8), (101, 0)),
+        )
+        in_files = [write_timed_pcap(self, 'order{}.pcap'.format(i), i, times)
+                    for i, times in enumerate(file_times)]
+        testout_file = self.filename_from_id(testout_pcap)
+        self.assertRun((config.cmd_mergecap, '-F', 'pcap', '-w', testout_file, *in_files))
+
+        expected = sorted(
+            ((ts, -file_index, seq), ts, 'file {} record {}'.format(file_index, seq).encode('ascii'))
+            for file_index, times in enumerate(file_times)
+            for seq, ts in enumerate(times))
+        self.assertEqual(read_pcap_records(testout_file),
+            [(ts, data) for _, ts, data in expected])
+
+    def test_mergecap_identical_times(self):
+        '''Of files whose records all have the same time stamp, all of
+        the later file's records go first'''
+        in_files = [write_timed_pcap(self, 'same{}.pcap'.format(i), i, [(100, 0)] * 3)
+                    for i in range(3)]
+        testout_file = self.filename_from_id(testout_pcap)
+        self.assertRun((config.cmd_mergecap, '-F', 'pcap', '-w', testout_file, *in_files))
+        self.assertEqual([data for _, data in read_pcap_records(testout_file)],
+            ['file {} record {}'.format(file_index, seq).encode('ascii')
+             for file_index in (2, 1, 0) for seq in range(3)])
+
+def write_readahead_pcap(self, name, start, count):
+    '''Write a pcap file several read-ahead chunks long, with records
+    that straddle the chunk boundaries'''
+    patterns = [bytes((p * 13 + j * j) & 0xff for j in range(997)) for p in range(251)]
+    capture_file = self.filename_from_id(name)
+    with open(capture_file, 'wb') as cap_fd:
+        cap_fd.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for i in range(count):
+            data = patterns[(start + i) % len(patterns)]
+            cap_fd.write(struct.pack('<IIII', i, start, len(data), len(data)) + data)
+    return capture_file
+
+class case_mergecap_read_ahead(subprocesstest.SubprocessTestCase):
+    def test_mergecap_read_ahead(self):
+        '''Merging with --read-ahead gives the same file as without'''
+        # More files than the read-ahead budget covers, so that some of
+        # them are read ahead and the rest are read the usual way
+        in_files = [write_readahead_pcap(self, 'readahead{}.pcap'.format(n), n, 3000)
+                    for n in range(6)]
+        out_files = []
+        for ra_args in ((), ('--read-ahead',)):
+            testout_file = self.filename_from_id('testout{}.pcap'.format(len(out_files)))
+            self.assertRun((config.cmd_mergecap,
+                '-F', 'pcap',
+                '-w', testout_file,
+                *ra_args,
+                *in_files,
+            ))
+            with open(testout_file, 'rb') as testout_fd:
+                out_files.append(testout_fd.read())
+        self.assertEqual(len(out_files[0]), 24 + 6 * 3000 * (16 + 997))
+        self.assertEqual(out_files[0], out_files[1])
+
+    def test_tshark_read_ahead(self):
+        '''Reading with --read-ahead gives the same packets as without'''
+        capture_file = write_readahead_pcap(self, 'readahead.pcap', 0, 3000)
+        outputs = []
+        for ra_args in ((), ('--read-ahead',)):
+            tshark_proc = self.assertRun((config.cmd_tshark,
+                '-r', capture_file,
+                '-x',
+                *ra_args,
+            ))
+            outputs.append(tshark_proc.stdout_str)
+        self.assertTrue(len(outputs[0]) > 0)
+        self.assertEqual(outputs[0], outputs[1])
@@ -0,0 +1,339 @@
+#
+# -*- coding: utf-8 -*-
+# Wireshark tests
+# By Gerald Combs <gerald@wireshark.org>
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''sharkd tests'''
+
+import base64
+import config
+import glob
+import gzip
+import json
+import os.path
+import shutil
+import struct
+import subprocesstest
+import sys
+import unittest
+
+dotexe = '.exe' if sys.platform.startswith('win32') else ''
+
+def sharkd_command():
+    if config.program_path is None:
+        return None
+    cmd = os.path.join(config.program_path, 'sharkd' + dotexe)
+    if not os.path.exists(cmd):
+        return None
+    return cmd
+
+def run_sharkd(self, requests):
+    '''Run each request in sharkd's console mode, and return the replies.'''
+    req_file = self.filename_from_id('requests.txt')
+    with open(req_file, 'w') as req_fd:
+        for req in requests:
+            req_fd.write(json.dumps(req) + '\n')
+    sharkd_proc = self.assertRun('"{0}" - < "{1}"'.format(sharkd_command(), req_file),
+        env=config.test_env, shell=True)
+    replies = []
+    for line in sharkd_proc.stdout_str.splitlines():
+        if line.startswith('{') or line.startswith('['):
+            replies.append(json.loads(line))
+    return replies
+
+def copy_capture(self, name):
+    capture_file = self.filename_from_id(name)
+    shutil.copyfile(os.path.join(config.capture_dir, name), capture_file)
+    return capture_file
+
+def first_packet_time(self, capture_file, use_index):
+    capinfos_cmd = [config.cmd_capinfos, '-a']
+    if use_index:
+        capinfos_cmd.append('--use-index')
+    capinfos_cmd.append(capture_file)
+    capinfos_proc = self.assertRun(capinfos_cmd, env=config.test_env)
+    for line in capinfos_proc.stdout_str.splitlines():
+        if line.startswith('First packet time:'):
+            return line
+    self.fail('No first packet time in capinfos output')
+
+# The layout of an index; see wsutil/frame_index.h.  It's in host
+# byte order.
+index_header = struct.Struct('=6I qqiI')
+index_record = struct.Struct('=qqiIIhHII')
+
+def read_index_header(index_file):
+    with open(index_file, 'rb') as index_fd:
+        return index_header.unpack(index_fd.read(index_header.size))
+
+def shift_last_index_record(index_file, secs):
+    '''Move the last frame in an index, leaving the capture file as it is'''
+    count = read_index_header(index_file)[3]
+    with open(index_file, 'r+b') as index_fd:
+        pos = index_header.size + (count - 1) * index_record.size
+        index_fd.seek(pos)
+        record = list(index_record.unpack(index_fd.read(index_record.size)))
+        record[1] += secs
+        index_fd.seek(pos)
+        index_fd.write(index_record.pack(*record))
+
+def write_large_gzip_capture(self, count):
+    '''Write a gzipped pcap file that inflates to several fast seek spans'''
+    capture_file = self.filename_from_id('large.pcap.gz')
+    records = [struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1)]
+    for i in range(count):
+        data = bytes((i * 7 + j) & 0xff for j in range(1000))
+        records.append(struct.pack('<IIII', i, 0, len(data), len(data)) + data)
+    with gzip.open(capture_file, 'wb') as cap_fd:
+        cap_fd.write(b''.join(records))
+    return capture_file
+
+def pcapng_block(block_type, body):
+    length = 12 + len(body)
+    return struct.pack('<II', block_type, length) + body + struct.pack('<I', length)
+
+def write_syscall_capture(self):
+    '''Write a pcapng file with Sysdig event blocks among the packets'''
+    capture_file = self.filename_from_id('syscalls.pcapng')
+    blocks = [
+        pcapng_block(0x0a0d0d0a, struct.pack('<IHHq', 0x1a2b3c4d, 1, 0, -1)),
+        pcapng_block(0x00000001, struct.pack('<HHI', 1, 0, 65535)),
+    ]
+    for i in range(6):
+        ts = (1500000000 + i) * 1000000
+        if i % 2 == 0:
+            data = bytes(range(60 + i))
+            data += b'\0' * (-len(data) % 4)
+            blocks.append(pcapng_block(0x00000006, struct.pack('<IIIII',
+                0, ts >> 32, ts & 0xffffffff, 60 + i, 60 + i) + data))
+        else:
+            ts_ns = ts * 1000
+            blocks.append(pcapng_block(0x00000204, struct.pack('<HQQIH',
+                0, ts_ns, 1234, 36, 5) + b'\0' * 10))
+    with open(capture_file, 'wb') as cap_fd:
+        cap_fd.write(b''.join(blocks))
+    return capture_file
+
+@unittest.skipIf(sharkd_command() is None, 'Requires sharkd.')
+class case_sharkd_index(subprocesstest.SubprocessTestCase):
+    def test_sharkd_index_write(self):
+        '''An index is written in place of a temporary file, and used'''
+        capture_file = copy_capture(self, 'dhcp.pcap')
+        load_req = { 'req': 'load', 'file': capture_file, 'index': 'true' }
+        status_req = { 'req': 'status' }
+        for i in range(2):
+            replies = run_sharkd(self, [load_req, status_req])
+            self.assertEqual(replies[0]['err'], 0)
+            self.assertEqual(replies[1]['frames'], 4)
+            self.assertTrue(os.path.isfile(capture_file + '.idx'))
+            self.assertEqual(glob.glob(capture_file + '.idx.*'), [])
+        self.assertEqual(first_packet_time(self, capture_file, True),
+            first_packet_time(self, capture_file, False))
+
+    def test_sharkd_index_stale(self):
+        '''An index isn't used after the file changes, even if its size and mtime don't'''
+        capture_file = copy_capture(self, 'dhcp.pcap')
+        run_sharkd(self, [{ 'req': 'load', 'file': capture_file, 'index': 'true' }])
+        self.assertTrue(os.path.isfile(capture_file + '.idx'))
+        old_time = first_packet_time(self, capture_file, True)
+
+        # Move the first packet a second later, keeping the file's mtime.
+        st = os.stat(capture_file)
+        with open(capture_file, 'r+b') as cap_fd:
+            cap_fd.seek(24)
+            ts_sec = cap_fd.read(4)
+            cap_fd.seek(24)
+            cap_fd.write(struct.pack('<I', struct.unpack('<I', ts_sec)[0] + 1))
+        os.utime(capture_file, ns=(st.st_atime_ns, st.st_mtime_ns))
+        self.assertEqual(os.path.getsize(capture_file), st.st_size)
+
+        new_time = first_packet_time(self, capture_file, True)
+        self.assertNotEqual(new_time, old_time)
+        self.assertEqual(new_time, first_packet_time(self, capture_file, False))
+
+    def test_sharkd_index_used(self):
+        '''Frames come from the index, not from reading the file again'''
+        capture_file = copy_capture(self, 'dhcp.pcap')
+        load_req = { 'req': 'load', 'file': capture_file, 'index': 'true' }
+        status_req = { 'req': 'status' }
+        replies = run_sharkd(self, [load_req, status_req])
+        duration = replies[1]['duration']
+
+        # Only the index says that the last frame is later.
+        shift_last_index_record(capture_file + '.idx', 1000)
+        replies = run_sharkd(self, [load_req, status_req])
+        self.assertAlmostEqual(replies[1]['duration'], duration + 1000, places=6)
+
+    def test_sharkd_index_trailing(self):
+        '''An index with data after its records isn't used'''
+        capture_file = copy_capture(self, 'dhcp.pcap')
+        load_req = { 'req': 'load', 'file': capture_file, 'index': 'true' }
+        status_req = { 'req': 'status' }
+        replies = run_sharkd(self, [load_req, status_req])
+        duration = replies[1]['duration']
+
+        shift_last_index_record(capture_file + '.idx', 1000)
+        with open(capture_file + '.idx', 'ab') as index_fd:
+            index_fd.write(b'\0' * index_record.size)
+        replies = run_sharkd(self, [load_req, status_req])
+        self.assertAlmostEqual(replies[1]['duration'], duration, places=6)
+
+    def test_sharkd_index_non_packets(self):
+        '''capinfos counts only the packets in an index, as it does in the file'''
+        capture_file = write_syscall_capture(self)
+        replies = run_sharkd(self, [
+            { 'req': 'load', 'file': capture_file, 'index': 'true' },
+            { 'req': 'status' },
+        ])
+        self.assertEqual(replies[1]['frames'], 6)
+        self.assertTrue(os.path.isfile(capture_file + '.idx'))
+
+        outputs = []
+        for index_args in ((), ('--use-index',)):
+            capinfos_proc = self.assertRun((config.cmd_capinfos,
+                    '-c', '-d', '-s', '-a', '-e', '-u', '-o', '-S', '-z',
+                    *index_args,
+                    capture_file,
+                ),
+                env=config.test_env)
+            outputs.append(capinfos_proc.stdout_str)
+        self.assertRegex(outputs[0], r'Number of packets:\s+3\n')
+        self.assertEqual(outputs[1], outputs[0])
+
+    def test_sharkd_index_gzip(self):
+        '''The fast seek points of a compressed file are saved, and work'''
+        count = 3000
+        capture_file = write_large_gzip_capture(self, count)
+        load_req = { 'req': 'load', 'file': capture_file, 'index': 'true' }
+        run_sharkd(self, [load_req])
+        header = read_index_header(capture_file + '.idx')
+        self.assertEqual(header[3], count)
+        # A point after the header, and one for each MiB or so after that
+        self.assertGreater(header[5], 2)
+
+        frames = (count, 1, count // 2)
+        replies = run_sharkd(self, [load_req] + [
+            { 'req': 'frame', 'frame': str(i), 'bytes': 'true' } for i in frames
+        ])
+        for i, reply in zip(frames, replies[1:]):
+            expected = bytes(((i - 1) * 7 + j) & 0xff for j in range(1000))
+            self.assertEqual(base64.b64decode(reply['bytes']), expected)
+
+def frames_displayed(self, capture_file, dfilter):
+    tshark_proc = self.assertRun((config.cmd_tshark,
+            '-r', capture_file,
+            '-Y', dfilter,
+            '-T', 'fields', '-e', 'frame.number',
+        ),
+        env=config.test_env)
+    return [int(num) for num in tshark_proc.stdout_str.split()]
+
+@unittest.skipIf(sharkd_command() is None, 'Requires sharkd.')
+class case_sharkd_filter(subprocesstest.SubprocessTestCase):
+    def test_sharkd_filter_cached(self):
+        '''Filters combined from cached predicates match the frames TShark displays'''
+        capture_file = os.path.join(config.capture_dir, 'dns+icmp.pcapng.gz')
+        # The predicates are cached first, so that the rest are combined
+        # from their bitmaps.
+        dfilters = (
+            'dns', 'icmp', 'frame.len > 100',
+            '!dns', 'not icmp', '!(dns || icmp)',
+            'dns && frame.len > 100', '!dns && !icmp', 'dns || icmp',
+            '!(dns && frame.len > 100) || icmp',
+            'dns && frame.time_delta_displayed < 0.5',
+        )
+        replies = run_sharkd(self, [{ 'req': 'load', 'file': capture_file }] + [
+            { 'req': 'frames', 'filter': dfilter } for dfilter in dfilters
+        ])
+        self.assertEqual(len(replies), len(dfilters) + 1)
+        for dfilter, reply in zip(dfilters, replies[1:]):
+            self.assertEqual([frame['num'] for frame in reply],
+                frames_displayed(self, capture_file, dfilter), dfilter)
+
+def profile_calls(reply, proto):
+    for profile in reply['protocols']:
+        if profile['proto'] == proto:
+            return profile['calls']
+    return 0
+
+def write_stun_capture(self):
+    '''Write STUN Binding Requests and other UDP payloads, on unregistered
+    ports, each on its own so that STUN can only be found heuristically'''
+    stun = struct.pack('!HHI', 0x0001, 0, 0x2112a442) + bytes(range(12))
+    other = b'Not a STUN message, just text'
+    capture_file = self.filename_from_id('stun.pcap')
+    with open(capture_file, 'wb') as cap_fd:
+        cap_fd.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for i in range(8):
+            payload = stun if i % 2 == 0 else other
+            udp = struct.pack('!HHHH', 40000 + i, 50000 + i, 8 + len(payload), 0) + payload
+            ip = struct.pack('!BBHHHBBH4s4s', 0x45, 0, 20 + len(udp), i, 0, 64, 17, 0,
+                bytes((192, 0, 2, 1)), bytes((198, 51, 100, 1))) + udp
+            frame = bytes.fromhex('020000000002020000000001') + struct.pack('!H', 0x0800) + ip
+            cap_fd.write(struct.pack('<IIII', 1500000000, i, len(frame), len(frame)) + frame)
+    return capture_file
+
+def find_profile(reply, proto):
+    for profile in reply['protocols']:
+        if profile['proto'] == proto:
+            return profile
+    return None
+
+@unittest.skipIf(sharkd_command() is None, 'Requires sharkd.')
+class case_sharkd_heur(subprocesstest.SubprocessTestCase):
+    def test_sharkd_heur_adaptive_order(self):
+        '''Adaptive heuristic ordering doesn't change the dissection, and the STUN guard rejects other payloads'''
+        capture_file = write_stun_capture(self)
+        outputs = []
+        for adaptive in ('FALSE', 'TRUE'):
+            tshark_proc = self.assertRun((config.cmd_tshark,
+                    '-o', 'protocols.adaptive_heuristic_order:' + adaptive,
+                    '-r', capture_file,
+                    '-T', 'fields', '-e', 'frame.number', '-e', 'frame.protocols',
+                ),
+                env=config.test_env)
+            outputs.append(tshark_proc.stdout_str)
+            protocols = [line.split('\t')[1] for line in tshark_proc.stdout_str.splitlines()]
+            self.assertEqual(['stun' in p.split(':') for p in protocols],
+                [i % 2 == 0 for i in range(8)])
+
+            replies = run_sharkd(self, [
+                { 'req': 'setconf', 'name': 'protocols.adaptive_heuristic_order', 'value': adaptive },
+                { 'req': 'load', 'file': capture_file },
+                { 'req': 'profile' },
+            ])
+            self.assertEqual(replies[0]['err'], 0)
+            stun = find_profile(replies[2], 'stun')
+            self.assertIsNotNone(stun)
+            # The STUN frames are found through the conversations the first
+            # pass set up.  The other frames go through the UDP heuristics
+            # again, but STUN's guard turns them away without calling it.
+            self.assertEqual(stun['calls'], 4)
+            self.assertEqual(stun['heur_tries'], 0)
+        self.assertEqual(outputs[1], outputs[0])
+
+@unittest.skipIf(sharkd_command() is None, 'Requires sharkd.')
+class case_sharkd_profile(subprocesstest.SubprocessTestCase):
+    def test_sharkd_profile(self):
+        '''Each frame is dissected once while profiling'''
+        capture_file = os.path.join(config.capture_dir, 'dhcp.pcap')
+        replies = run_sharkd(self, [
+            { 'req': 'load', 'file': capture_file },
+            { 'req': 'profile' },
+        ])
+        self.assertEqual(replies[1]['frames'], 4)
+        self.assertEqual(profile_calls(replies[1], 'udp'), 4)
+        for profile in replies[1]['protocols']:
+            self.assertGreaterEqual(profile['incl_time'], profile['excl_time'])
+
+    def test_sharkd_profile_index(self):
+        '''The deferred first pass of frames loaded from an index isn't profiled'''
+        capture_file = copy_capture(self, 'dhcp.pcap')
+        load_req = { 'req': 'load', 'file': capture_file, 'index': 'true' }
+        run_sharkd(self, [load_req])
+        self.assertTrue(os.path.isfile(capture_file + '.idx'))
+        replies = run_sharkd(self, [load_req, { 'req': 'profile' }])
+        self.assertEqual(replies[1]['frames'], 4)
+        self.assertEqual(profile_calls(replies[1], 'udp'), 4)
@@ -20,6 +20,10 @@ class case_unittests(subprocesstest.SubprocessTestCase):
         '''exntest'''
         self.assertRun(os.path.join(config.program_path, 'exntest'))
 
+    def test_unit_file_wrappers_test(self):
+        '''file_wrappers_test'''
+        self.assertRun(os.path.join(config.program_path, 'file_wrappers_test'))
+
     def test_unit_oids_test(self):
         '''oids_test'''
         self.assertRun(os.path.join(config.program_path, 'oids_test'))
@@ -28,6 +32,10 @@ class case_unittests(subprocesstest.SubprocessTestCase):
         '''reassemble_test'''
         self.assertRun(os.path.join(config.program_path, 'reassemble_test'))
 
+    def test_unit_spsc_ring_test(self):
+        '''spsc_ring_test'''
+        self.assertRun(os.path.join(config.program_path, 'spsc_ring_test'))
+
     def test_unit_tvbtest(self):
         '''tvbtest'''
         self.assertRun(os.path.join(config.program_path, 'tvbtest'))
@@ -104,3 +104,31 @@ class testBytesEther(dftest.DFTest):
     def test_contains_4(self):
         dfilter = "ipx.src.node contains aa:e3"
         self.assertDFilterCount(dfilter, 0)
+
+    # "field ==/!= constant" on an Ethernet address compiles to
+    # FIELD_CMP_BYTES; ordering goes through the registers
+
+    def test_field_cmp_eq_1(self):
+        dfilter = "eth.dst == ff:ff:ff:ff:ff:ff"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_eq_2(self):
+        dfilter = "eth.src == ff:ff:ff:ff:ff:ff"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_ne_1(self):
+        dfilter = "eth.src != ff:ff:ff:ff:ff:ff"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_ne_2(self):
+        dfilter = "eth.dst != ff:ff:ff:ff:ff:ff"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_gt(self):
+        dfilter = "eth.src > 00:aa:00:a3:e3:00"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES", False)
+        self.assertDFilterCount(dfilter, 1)
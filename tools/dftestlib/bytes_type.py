@@ -15,3 +15,31 @@ class testBytes(dftest.DFTest):
     def test_ipv6_2(self):
         dfilter = "arp.dst.hw == 00:00"
         self.assertDFilterCount(dfilter, 0)
+
+    # "field ==/!= constant" on a bytes field compiles to FIELD_CMP_BYTES
+
+    def test_field_cmp_eq_1(self):
+        dfilter = "arp.dst.hw == 00:64"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_eq_2(self):
+        dfilter = "arp.dst.hw == 00:64:00"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_ne_1(self):
+        dfilter = "arp.dst.hw != 00:00"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_ne_2(self):
+        dfilter = "arp.dst.hw != 00:64"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_absent(self):
+        # There's no IP, so even "!=" doesn't match
+        dfilter = "ip.src != 10.0.0.1"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 0)
@@ -12,6 +12,7 @@ from dftestlib import util
 # The binaries to use. We assume we are running
 # from the top of the wireshark distro
 TSHARK = os.path.join(os.getenv("WS_BIN_PATH", "."), "tshark")
+DFTEST = os.path.join(os.getenv("WS_BIN_PATH", "."), "dftest")
 
 class DFTest(unittest.TestCase):
     """Base class for all tests in this dfilter-test collection."""
@@ -70,6 +71,30 @@ class DFTest(unittest.TestCase):
         msg = "Expected %d, got: %s" % (expected_count, output)
         self.assertEqual(len(lines), expected_count, msg)
 
+    def runDFTest(self, dfilter):
+        # Compile the filter and dump its instructions
+        cmdv = [DFTEST, dfilter]
+
+        (status, output) = util.exec_cmdv(cmdv)
+        return status, output
+
+    def assertDFilterInsn(self, dfilter, opcode, expected=True):
+        """Compile a display filter and expect its code to use, or
+        if expected is False not to use, a certain instruction."""
+
+        (status, output) = self.runDFTest(dfilter)
+
+        # dftest must succeed
+        self.assertEqual(status, util.SUCCESS, output)
+
+        # The instructions follow the "Instructions:" line, one per
+        # line, as "<number> <opcode>..."
+        insns = output.split("Instructions:", 1)[-1]
+        opcodes = [L.split()[1] for L in insns.split("\n") if len(L.split()) > 1]
+
+        msg = "Expected %s%s in: %s" % ("" if expected else "no ", opcode, output)
+        self.assertEqual(opcode in opcodes, expected, msg)
+
     def assertDFilterFail(self, dfilter):
         """Run a display filter and expect tshark to fail"""
 
@@ -150,3 +150,51 @@ class testInteger(dftest.DFTest):
     def test_bool_ne_2(self):
         dfilter = "ip.flags.df != 0"
         self.assertDFilterCount(dfilter, 0)
+
+    def test_u_bitwise_and_1(self):
+        dfilter = "ip.version & 4"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_u_bitwise_and_2(self):
+        dfilter = "ip.version & 3"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_s_bitwise_and_1(self):
+        dfilter = "ntp.precision & 1"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_s_bitwise_and_2(self):
+        dfilter = "ntp.precision & 2"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_const_lhs_1(self):
+        dfilter = "4 == ip.version"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_not_not_1(self):
+        dfilter = "not not ip.version == 4"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_not_not_2(self):
+        dfilter = "!!ip.version == 6"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_uint_1(self):
+        dfilter = "ip.version == 4"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_UINT")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_uint_2(self):
+        dfilter = "ip.version > 4"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_UINT")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_sint_1(self):
+        dfilter = "ntp.precision <= -11"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_SINT")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_sint_2(self):
+        dfilter = "ntp.precision < -11"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_SINT")
+        self.assertDFilterCount(dfilter, 0)
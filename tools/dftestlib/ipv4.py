@@ -131,3 +131,97 @@ class testIPv4(dftest.DFTest):
     def test_count_2(self):
          dfilter = "count(ip.addr) == 2"
          self.assertDFilterCount(dfilter, 2)
+
+    # "field <op> constant" on an IPv4 field compiles to FIELD_CMP_IPV4
+
+    def test_field_cmp_eq_1(self):
+        dfilter = "ip.src == 172.25.100.14"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_eq_2(self):
+        dfilter = "ip.src == 10.0.0.1"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_ne_1(self):
+        dfilter = "ip.src != 172.25.100.14"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_ne_2(self):
+        dfilter = "ip.src != 10.0.0.1"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_field_cmp_gt_1(self):
+        dfilter = "ip.dst > 198.95.230.10"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_gt_2(self):
+        dfilter = "ip.dst > 198.95.230.20"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_ge_1(self):
+        dfilter = "ip.dst >= 198.95.230.20"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_ge_2(self):
+        dfilter = "ip.dst >= 198.95.230.200"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_lt_1(self):
+        dfilter = "ip.src < 172.25.100.140"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_lt_2(self):
+        dfilter = "ip.src < 172.25.100.14"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_le_1(self):
+        dfilter = "ip.src <= 172.25.100.14"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_le_2(self):
+        dfilter = "ip.src <= 172.25.100.10"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_bitwise_and_1(self):
+        dfilter = "ip.src & 255.0.0.0"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_field_cmp_bitwise_and_2(self):
+        dfilter = "ip.src & 0.0.0.0"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_cidr_eq_1(self):
+        dfilter = "ip.src == 172.25.0.0/16"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_field_cmp_cidr_eq_2(self):
+        dfilter = "ip.src == 10.0.0.0/8"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4")
+        self.assertDFilterCount(dfilter, 0)
+
+    # Anything else goes through the registers
+
+    def test_field_cmp_not_field_1(self):
+        dfilter = "ip.src == ip.dst"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_IPV4", False)
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_field_cmp_not_field_2(self):
+        dfilter = "ip.src[0:2] == ac:19"
+        self.assertDFilterInsn(dfilter, "FIELD_CMP_BYTES", False)
+        self.assertDFilterCount(dfilter, 1)
@@ -131,6 +131,7 @@ fuzzshark_epan_new(void)
 		fuzzshark_get_frame_ts,
 		NULL,
 		NULL,
+		NULL,
 		NULL
 	};
 
@@ -26,6 +26,8 @@
 
 #ifdef _WIN32
 # include <winsock2.h>
+# include <io.h>     /* for _setmode */
+# include <fcntl.h>  /* for O_BINARY */
 #endif
 
 #ifndef _WIN32
@@ -90,11 +92,13 @@
 #include <epan/epan_dissect.h>
 #include <epan/tap.h>
 #include <epan/stat_tap_ui.h>
+#include <epan/conversation.h>
 #include <epan/conversation_table.h>
 #include <epan/srt_table.h>
 #include <epan/rtd_table.h>
 #include <epan/ex-opt.h>
 #include <epan/exported_pdu.h>
+#include <epan/reassemble.h>
 
 #include "capture_opts.h"
 
@@ -145,6 +149,12 @@
 #ifdef HAVE_JSONGLIB
 #define LONGOPT_ELASTIC_MAPPING_FILTER (65536+1002)
 #endif
+#define LONGOPT_SECOND_PASS_THREADS (65536+1003)
+#define LONGOPT_CONVERSATION_TIMEOUT (65536+1004)
+#define LONGOPT_MAX_CONVERSATIONS (65536+1005)
+#define LONGOPT_REASSEMBLY_MAX_AGE (65536+1006)
+#define LONGOPT_MAX_REASSEMBLIES (65536+1007)
+#define LONGOPT_READ_AHEAD (65536+1008)
 
 #if 0
 #define tshark_debug(...) g_warning(__VA_ARGS__)
@@ -160,6 +170,9 @@ static frame_data prev_dis_frame;
 static frame_data prev_cap_frame;
 
 static gboolean perform_two_pass_analysis;
+static guint second_pass_threads = 0;
+static gboolean read_ahead = FALSE;
+static gboolean evict_state = FALSE;
 static guint32 epan_auto_reset_count = 0;
 static gboolean epan_auto_reset = FALSE;
 
@@ -172,7 +185,8 @@ typedef enum {
   WRITE_FIELDS, /* User defined list of fields */
   WRITE_JSON,   /* JSON */
   WRITE_JSON_RAW,   /* JSON only raw hex */
-  WRITE_EK      /* JSON bulk insert to Elasticsearch */
+  WRITE_EK,     /* JSON bulk insert to Elasticsearch */
+  WRITE_ARROW   /* User defined list of fields, as an Apache Arrow stream */
   /* Add CSV and the like here */
 } output_action_e;
 
@@ -182,6 +196,8 @@ static gboolean print_packet_info; /* TRUE if we're to print packet information
 static gboolean print_summary;     /* TRUE if we're to print packet summary information */
 static gboolean print_details;     /* TRUE if we're to print packet details information */
 static gboolean print_hex;         /* TRUE if we're to print hex/ascci information */
+static gboolean prime_output_fields; /* TRUE if "-T fields" or "-T arrow" can use an invisible, primed tree */
+static arrow_writer_t *arrow_writer; /* for "-T arrow" */
 static gboolean line_buffered;
 static gboolean really_quiet = FALSE;
 static gchar* delimiter_char = " ";
@@ -235,6 +251,7 @@ static char *output_file_name;
 #endif /* HAVE_LIBPCAP */
 
 static void reset_epan_mem(capture_file *cf, epan_dissect_t *edt, gboolean tree, gboolean visual);
+static epan_dissect_t *tshark_epan_dissect_new(capture_file *cf, gboolean tree, gboolean visual);
 static gboolean process_cap_file(capture_file *, char *, int, gboolean, int, gint64);
 static gboolean process_packet_single_pass(capture_file *cf,
     epan_dissect_t *edt, gint64 offset, wtap_rec *rec,
@@ -316,6 +333,47 @@ list_read_capture_types(void) {
   g_free(captypes);
 }
 
+/*
+ * Handle "--conversation-timeout [<type>:]<seconds>"; without a type,
+ * the timeout applies to every endpoint type.
+ */
+static gboolean
+set_conversation_timeout(const char *arg)
+{
+  const char *colon = strchr(arg, ':');
+  endpoint_type etype;
+  gchar *type_name;
+  gboolean ok;
+
+  if (colon == NULL) {
+    conversation_set_idle_timeout_all(get_positive_int(arg, "conversation timeout"));
+    return TRUE;
+  }
+
+  type_name = g_strndup(arg, colon - arg);
+  ok = conversation_endpoint_type_from_name(type_name, &etype);
+  if (ok)
+    conversation_set_idle_timeout(etype, get_positive_int(colon + 1, "conversation timeout"));
+  else
+    cmdarg_err("\"%s\" isn't a valid endpoint type for --conversation-timeout.", type_name);
+  g_free(type_name);
+  return ok;
+}
+
+static void
+print_eviction_stats(void)
+{
+  conversation_eviction_stats_t conv_stats;
+  reassembly_eviction_stats_t reas_stats;
+
+  conversation_get_eviction_stats(&conv_stats);
+  reassembly_get_eviction_stats(&reas_stats);
+  fprintf(stderr, "Conversations evicted: %" G_GUINT64_FORMAT " idle, %" G_GUINT64_FORMAT " least recently used; %u remaining, %" G_GUINT64_FORMAT " kept\n",
+          conv_stats.idle_evicted, conv_stats.lru_evicted, conv_stats.current, conv_stats.kept);
+  fprintf(stderr, "Reassemblies evicted: %" G_GUINT64_FORMAT " incomplete, %" G_GUINT64_FORMAT " reassembled\n",
+          reas_stats.incomplete_evicted, reas_stats.reassembled_evicted);
+}
+
 static void
 print_usage(FILE *output)
 {
@@ -364,11 +422,22 @@ print_usage(FILE *output)
   /*fprintf(output, "\n");*/
   fprintf(output, "Input file:\n");
   fprintf(output, "  -r <infile>              set the filename to read from (- to read from stdin)\n");
+  fprintf(output, "  --read-ahead             read the file ahead on other threads\n");
 
   fprintf(output, "\n");
   fprintf(output, "Processing:\n");
   fprintf(output, "  -2                       perform a two-pass analysis\n");
   fprintf(output, "  -M <packet count>        perform session auto reset\n");
+  fprintf(output, "  --second-pass-threads <n>\n");
+  fprintf(output, "                           read records for the second pass on n threads\n");
+  fprintf(output, "                           (requires -2)\n");
+  fprintf(output, "  --conversation-timeout [<type>:]<seconds>\n");
+  fprintf(output, "                           free conversations (of an endpoint type, e.g. udp)\n");
+  fprintf(output, "                           idle for more than <seconds> of capture time\n");
+  fprintf(output, "  --max-conversations <n>  free the least recently used conversations beyond n\n");
+  fprintf(output, "  --reassembly-max-age <n> free reassemblies not added to in the last n frames\n");
+  fprintf(output, "  --max-reassemblies <n>   free the oldest incomplete reassemblies beyond n\n");
+  fprintf(output, "                           per reassembly table\n");
   fprintf(output, "  -R <read filter>         packet Read filter in Wireshark display filter syntax\n");
   fprintf(output, "                           (requires -2)\n");
   fprintf(output, "  -Y <display filter>      packet displaY filter in Wireshark display filter\n");
@@ -402,7 +471,7 @@ print_usage(FILE *output)
   fprintf(output, "  -P                       print packet summary even when writing to a file\n");
   fprintf(output, "  -S <separator>           the line separator to print between packets\n");
   fprintf(output, "  -x                       add output of hex and ASCII dump (Packet Bytes)\n");
-  fprintf(output, "  -T pdml|ps|psml|json|jsonraw|ek|tabs|text|fields|?\n");
+  fprintf(output, "  -T pdml|ps|psml|json|jsonraw|ek|tabs|text|fields|arrow|?\n");
   fprintf(output, "                           format of text output (def: text)\n");
   fprintf(output, "  -j <protocolfilter>      protocols layers filter if -T ek|pdml|json selected\n");
   fprintf(output, "                           (e.g. \"ip ip.flags text\", filter does not expand child\n");
@@ -687,6 +756,12 @@ main(int argc, char *argv[])
     {"export-objects", required_argument, NULL, LONGOPT_EXPORT_OBJECTS},
     {"color", no_argument, NULL, LONGOPT_COLOR},
     {"no-duplicate-keys", no_argument, NULL, LONGOPT_NO_DUPLICATE_KEYS},
+    {"second-pass-threads", required_argument, NULL, LONGOPT_SECOND_PASS_THREADS},
+    {"conversation-timeout", required_argument, NULL, LONGOPT_CONVERSATION_TIMEOUT},
+    {"max-conversations", required_argument, NULL, LONGOPT_MAX_CONVERSATIONS},
+    {"reassembly-max-age", required_argument, NULL, LONGOPT_REASSEMBLY_MAX_AGE},
+    {"max-reassemblies", required_argument, NULL, LONGOPT_MAX_REASSEMBLIES},
+    {"read-ahead", no_argument, NULL, LONGOPT_READ_AHEAD},
 #ifdef HAVE_JSONGLIB
     {"elastic-mapping-filter", required_argument, NULL, LONGOPT_ELASTIC_MAPPING_FILTER},
 #endif
@@ -1324,6 +1399,10 @@ main(int argc, char *argv[])
         output_action = WRITE_FIELDS;
         print_details = TRUE;   /* Need full tree info */
         print_summary = FALSE;  /* Don't allow summary */
+      } else if (strcmp(optarg, "arrow") == 0) {
+        output_action = WRITE_ARROW;
+        print_details = TRUE;   /* Need full tree info */
+        print_summary = FALSE;  /* Don't allow summary */
       } else if (strcmp(optarg, "json") == 0) {
         output_action = WRITE_JSON;
         print_details = TRUE;   /* Need details */
@@ -1341,6 +1420,8 @@ main(int argc, char *argv[])
         cmdarg_err("Invalid -T parameter \"%s\"; it must be one of:", optarg);                   /* x */
         cmdarg_err_cont("\t\"fields\"  The values of fields specified with the -e option, in a form\n"
                         "\t          specified by the -E option.\n"
+                        "\t\"arrow\"   The values of fields specified with the -e option, as an\n"
+                        "\t          Apache Arrow IPC stream with a column for each field.\n"
                         "\t\"pdml\"    Packet Details Markup Language, an XML-based format for the\n"
                         "\t          details of a decoded packet. This information is equivalent to\n"
                         "\t          the packet details printed with the -V flag.\n"
@@ -1470,6 +1551,31 @@ main(int argc, char *argv[])
       no_duplicate_keys = TRUE;
       node_children_grouper = proto_node_group_children_by_json_key;
       break;
+    case LONGOPT_SECOND_PASS_THREADS:
+      second_pass_threads = get_positive_int(optarg, "second pass thread count");
+      break;
+    case LONGOPT_CONVERSATION_TIMEOUT:
+      if (!set_conversation_timeout(optarg)) {
+        exit_status = INVALID_OPTION;
+        goto clean_exit;
+      }
+      evict_state = TRUE;
+      break;
+    case LONGOPT_MAX_CONVERSATIONS:
+      conversation_set_max_conversations(get_positive_int(optarg, "maximum number of conversations"));
+      evict_state = TRUE;
+      break;
+    case LONGOPT_REASSEMBLY_MAX_AGE:
+      reassembly_set_max_age(get_positive_int(optarg, "maximum reassembly age"));
+      evict_state = TRUE;
+      break;
+    case LONGOPT_MAX_REASSEMBLIES:
+      reassembly_set_max_incomplete(get_positive_int(optarg, "maximum number of reassemblies"));
+      evict_state = TRUE;
+      break;
+    case LONGOPT_READ_AHEAD:
+      read_ahead = TRUE;
+      break;
     default:
     case '?':        /* Bad flag - print usage message */
       switch(optopt) {
@@ -1501,14 +1607,14 @@ main(int argc, char *argv[])
   }
 
   /* If we specified output fields, but not the output field type... */
-  if ((WRITE_FIELDS != output_action && WRITE_XML != output_action && WRITE_JSON != output_action && WRITE_EK != output_action) && 0 != output_fields_num_fields(output_fields)) {
+  if ((WRITE_FIELDS != output_action && WRITE_ARROW != output_action && WRITE_XML != output_action && WRITE_JSON != output_action && WRITE_EK != output_action) && 0 != output_fields_num_fields(output_fields)) {
         cmdarg_err("Output fields were specified with \"-e\", "
-            "but \"-Tek, -Tfields, -Tjson or -Tpdml\" was not specified.");
+            "but \"-Tarrow, -Tek, -Tfields, -Tjson or -Tpdml\" was not specified.");
         exit_status = INVALID_OPTION;
         goto clean_exit;
-  } else if (WRITE_FIELDS == output_action && 0 == output_fields_num_fields(output_fields)) {
-        cmdarg_err("\"-Tfields\" was specified, but no fields were "
-                    "specified with \"-e\".");
+  } else if ((WRITE_FIELDS == output_action || WRITE_ARROW == output_action) && 0 == output_fields_num_fields(output_fields)) {
+        cmdarg_err("\"-T%s\" was specified, but no fields were "
+                    "specified with \"-e\".", WRITE_ARROW == output_action ? "arrow" : "fields");
 
         exit_status = INVALID_OPTION;
         goto clean_exit;
@@ -1628,6 +1734,18 @@ main(int argc, char *argv[])
     goto clean_exit;
   }
 
+  if (second_pass_threads != 0 && !perform_two_pass_analysis) {
+    cmdarg_err("--second-pass-threads requires -2.");
+    exit_status = INVALID_OPTION;
+    goto clean_exit;
+  }
+
+  if (evict_state && perform_two_pass_analysis) {
+    cmdarg_err("Conversations and reassemblies can't be evicted with -2.");
+    exit_status = INVALID_OPTION;
+    goto clean_exit;
+  }
+
 #ifdef HAVE_LIBPCAP
   if (caps_queries) {
     /* We're supposed to list the link-layer/timestamp types for an interface;
@@ -1839,6 +1957,23 @@ main(int argc, char *argv[])
       goto clean_exit;
     }
   }
+
+  /* "-T fields" and "-T arrow" don't need the labels of a visible tree
+     unless they're writing protocols; it's much cheaper to only have the
+     fields they're writing in the tree. */
+  prime_output_fields = (output_action == WRITE_FIELDS || output_action == WRITE_ARROW) &&
+                        output_fields_can_prime(output_fields);
+
+#ifdef _WIN32
+  if (output_action == WRITE_ARROW) {
+    /* Put the standard output in binary mode. */
+    if (_setmode(1, O_BINARY) == -1) {
+      cmdarg_err("Cannot put standard output in binary mode: %s", g_strerror(errno));
+      exit_status = INIT_FAILED;
+      goto clean_exit;
+    }
+  }
+#endif
 #ifdef HAVE_LIBPCAP
   /* We currently don't support taps, or printing dissected packets,
      if we're writing to a pipe. */
@@ -2032,6 +2167,8 @@ main(int argc, char *argv[])
       exit_status = INVALID_FILE;
       goto clean_exit;
     }
+    if (read_ahead)
+      wtap_set_read_ahead(cfile.provider.wth);
 
     /* Start statistics taps; we do so after successfully opening the
        capture file, so we know we have something to compute stats
@@ -2232,6 +2369,8 @@ main(int argc, char *argv[])
 
   draw_tap_listeners(TRUE);
   funnel_dump_all_text_windows();
+  if (evict_state && !really_quiet)
+    print_eviction_stats();
   epan_free(cfile.epan);
   epan_cleanup();
   extcap_cleanup();
@@ -2389,6 +2528,7 @@ tshark_epan_new(capture_file *cf)
     cap_file_provider_get_interface_name,
     cap_file_provider_get_interface_description,
     NULL,
+    NULL,
   };
 
   return epan_new(&cf->provider, &funcs);
@@ -2698,7 +2838,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = tshark_epan_dissect_new(cf, create_proto_tree, print_packet_info && print_details);
 
     while (to_read-- && cf->provider.wth) {
       wtap_cleareof(cf->provider.wth);
@@ -3000,6 +3140,10 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    /* "-T arrow" looks the fields up, so it always needs them primed */
+    if (prime_output_fields || output_action == WRITE_ARROW)
+      output_fields_prime_edt(output_fields, edt);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -3061,6 +3205,241 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
   return passed || fdata->flags.dependent_of_displayed;
 }
 
+/*
+ * Read-ahead for the second pass of a two-pass analysis.
+ *
+ * The first pass has already settled all cross-frame state, so the
+ * records for the second pass can be fetched from the file in any
+ * order.  Dissection itself still has to happen on the main thread
+ * and in frame order, as the epan state is global; what we spread
+ * across threads is the wtap_seek_read() work, which is where the
+ * second pass spends its time waiting on I/O.
+ *
+ * Reader thread N handles frames N+1, N+1+n_threads, ...  and parks
+ * each record in slot (framenum - 1) % n_slots; a reader may only
+ * refill a slot once the main thread has consumed the frame that was
+ * previously held in it, so at most n_slots records are in memory.
+ */
+#define SECOND_PASS_SLOTS_PER_THREAD 16
+
+typedef struct {
+  wtap_rec  rec;
+  Buffer    buf;
+  guint32   framenum;     /* frame held in this slot, 0 if none yet */
+  gboolean  read_ok;
+  int       err;
+  gchar    *err_info;
+} second_pass_slot_t;
+
+typedef struct second_pass_prefetch second_pass_prefetch_t;
+
+typedef struct {
+  second_pass_prefetch_t *pf;
+  wtap     *wth;          /* opened for this reader alone */
+  guint32   first_frame;
+  GThread  *tid;
+} second_pass_reader_t;
+
+struct second_pass_prefetch {
+  capture_file         *cf;
+  guint                 n_threads;
+  guint                 n_slots;
+  second_pass_slot_t   *slots;
+  second_pass_reader_t *readers;
+  GMutex                mtx;
+  GCond                 cond;
+  guint32               next_consume; /* frame the main thread wants next */
+  gboolean              stop;
+};
+
+static gpointer
+second_pass_reader_thread(gpointer data)
+{
+  second_pass_reader_t   *reader = (second_pass_reader_t *)data;
+  second_pass_prefetch_t *pf = reader->pf;
+  second_pass_slot_t     *slot;
+  frame_data             *fdata;
+  guint32                 framenum;
+  gboolean                read_ok;
+  int                     err;
+  gchar                  *err_info;
+
+  for (framenum = reader->first_frame; framenum <= pf->cf->count;
+       framenum += pf->n_threads) {
+    slot = &pf->slots[(framenum - 1) % pf->n_slots];
+
+    g_mutex_lock(&pf->mtx);
+    while (!pf->stop && framenum >= pf->next_consume + pf->n_slots)
+      g_cond_wait(&pf->cond, &pf->mtx);
+    if (pf->stop) {
+      g_mutex_unlock(&pf->mtx);
+      break;
+    }
+    g_mutex_unlock(&pf->mtx);
+
+    /* The slot is ours until we hand it over below. */
+    fdata = frame_data_sequence_find(pf->cf->provider.frames, framenum);
+    err = 0;
+    err_info = NULL;
+    read_ok = wtap_seek_read(reader->wth, fdata->file_off, &slot->rec,
+                             &slot->buf, &err, &err_info);
+
+    g_mutex_lock(&pf->mtx);
+    slot->framenum = framenum;
+    slot->read_ok = read_ok;
+    slot->err = err;
+    slot->err_info = err_info;
+    g_cond_broadcast(&pf->cond);
+    g_mutex_unlock(&pf->mtx);
+
+    /* The main thread stops at the first frame it can't read. */
+    if (!read_ok)
+      break;
+  }
+  return NULL;
+}
+
+static second_pass_prefetch_t *
+second_pass_prefetch_start(capture_file *cf, guint n_threads)
+{
+  second_pass_prefetch_t      *pf;
+  wtapng_iface_descriptions_t *idb_inf;
+  guint                        n_interfaces, i;
+  int                          err;
+  gchar                       *err_info;
+
+  /*
+   * Seeking in a compressed file without the fast seek points that the
+   * first pass built up means inflating everything in front of the
+   * seek target, so handles of our own wouldn't buy us anything there.
+   */
+  if (wtap_iscompressed(cf->provider.wth))
+    return NULL;
+
+  pf = g_new0(second_pass_prefetch_t, 1);
+  pf->cf = cf;
+  pf->readers = g_new0(second_pass_reader_t, n_threads);
+
+  /*
+   * Each reader gets a handle of its own; the main thread still reads
+   * from the handle the first pass used while dissecting, e.g. for the
+   * data of frames that reassembled data refers to.  A freshly opened
+   * handle only knows about the interfaces described before the first
+   * packet, so if the file has more than that (e.g. a pcapng file with
+   * IDBs further in), we make do with the handles we already have, and
+   * read on the main thread if we have none.
+   */
+  idb_inf = wtap_file_get_idb_info(cf->provider.wth);
+  n_interfaces = idb_inf->interface_data->len;
+  g_free(idb_inf);
+
+  pf->n_threads = 0;
+  for (i = 0; i < n_threads; i++) {
+    wtap *wth = wtap_open_offline(cf->filename, cf->open_type, &err, &err_info, TRUE);
+
+    if (wth == NULL) {
+      g_free(err_info);
+      break;
+    }
+    idb_inf = wtap_file_get_idb_info(wth);
+    if (idb_inf->interface_data->len != n_interfaces) {
+      g_free(idb_inf);
+      wtap_close(wth);
+      break;
+    }
+    g_free(idb_inf);
+    pf->readers[i].wth = wth;
+    pf->n_threads++;
+  }
+  if (pf->n_threads == 0) {
+    g_free(pf->readers);
+    g_free(pf);
+    return NULL;
+  }
+  tshark_debug("tshark: second pass reading with %u thread(s)", pf->n_threads);
+
+  pf->n_slots = pf->n_threads * SECOND_PASS_SLOTS_PER_THREAD;
+  pf->slots = g_new0(second_pass_slot_t, pf->n_slots);
+  for (i = 0; i < pf->n_slots; i++) {
+    wtap_rec_init(&pf->slots[i].rec);
+    ws_buffer_init(&pf->slots[i].buf, 1500);
+  }
+
+  g_mutex_init(&pf->mtx);
+  g_cond_init(&pf->cond);
+  pf->next_consume = 1;
+
+  for (i = 0; i < pf->n_threads; i++) {
+    pf->readers[i].pf = pf;
+    pf->readers[i].first_frame = i + 1;
+    pf->readers[i].tid = g_thread_new("Second pass read",
+                                      second_pass_reader_thread, &pf->readers[i]);
+  }
+  return pf;
+}
+
+/*
+ * Wait for the record for framenum to be read; on success, the record
+ * and its data stay valid until second_pass_prefetch_release() is
+ * called for that frame.
+ */
+static gboolean
+second_pass_prefetch_get(second_pass_prefetch_t *pf, guint32 framenum,
+                         wtap_rec **rec, Buffer **buf, int *err, gchar **err_info)
+{
+  second_pass_slot_t *slot = &pf->slots[(framenum - 1) % pf->n_slots];
+
+  g_mutex_lock(&pf->mtx);
+  while (slot->framenum != framenum)
+    g_cond_wait(&pf->cond, &pf->mtx);
+  g_mutex_unlock(&pf->mtx);
+
+  if (!slot->read_ok) {
+    *err = slot->err;
+    *err_info = slot->err_info;
+    slot->err_info = NULL;
+    return FALSE;
+  }
+  *rec = &slot->rec;
+  *buf = &slot->buf;
+  return TRUE;
+}
+
+static void
+second_pass_prefetch_release(second_pass_prefetch_t *pf, guint32 framenum)
+{
+  g_mutex_lock(&pf->mtx);
+  pf->next_consume = framenum + 1;
+  g_cond_broadcast(&pf->cond);
+  g_mutex_unlock(&pf->mtx);
+}
+
+static void
+second_pass_prefetch_stop(second_pass_prefetch_t *pf)
+{
+  guint i;
+
+  g_mutex_lock(&pf->mtx);
+  pf->stop = TRUE;
+  g_cond_broadcast(&pf->cond);
+  g_mutex_unlock(&pf->mtx);
+
+  for (i = 0; i < pf->n_threads; i++) {
+    g_thread_join(pf->readers[i].tid);
+    wtap_close(pf->readers[i].wth);
+  }
+  for (i = 0; i < pf->n_slots; i++) {
+    wtap_rec_cleanup(&pf->slots[i].rec);
+    ws_buffer_free(&pf->slots[i].buf);
+    g_free(pf->slots[i].err_info);
+  }
+  g_cond_clear(&pf->cond);
+  g_mutex_clear(&pf->mtx);
+  g_free(pf->slots);
+  g_free(pf->readers);
+  g_free(pf);
+}
+
 static gboolean
 process_cap_file(capture_file *cf, char *save_file, int out_file_type,
     gboolean out_file_name_res, int max_packet_count, gint64 max_byte_count)
@@ -3119,10 +3498,10 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
         if (strcmp(save_file, "-") == 0) {
           /* Write to the standard output. */
           pdh = wtap_dump_open_stdout(out_file_type, linktype,
-              snapshot_length, FALSE /* compressed */, &err);
+              snapshot_length, WTAP_UNCOMPRESSED, &err);
         } else {
           pdh = wtap_dump_open(save_file, out_file_type, linktype,
-              snapshot_length, FALSE /* compressed */, &err);
+              snapshot_length, WTAP_UNCOMPRESSED, &err);
         }
     }
     else {
@@ -3130,10 +3509,10 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
         if (strcmp(save_file, "-") == 0) {
           /* Write to the standard output. */
           pdh = wtap_dump_open_stdout_ng(out_file_type, linktype,
-              snapshot_length, FALSE /* compressed */, shb_hdrs, idb_inf, nrb_hdrs, &err);
+              snapshot_length, WTAP_UNCOMPRESSED, shb_hdrs, idb_inf, nrb_hdrs, &err);
         } else {
           pdh = wtap_dump_open_ng(save_file, out_file_type, linktype,
-              snapshot_length, FALSE /* compressed */, shb_hdrs, idb_inf, nrb_hdrs, &err);
+              snapshot_length, WTAP_UNCOMPRESSED, shb_hdrs, idb_inf, nrb_hdrs, &err);
         }
     }
 
@@ -3168,6 +3547,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
 
   if (perform_two_pass_analysis) {
     frame_data *fdata;
+    second_pass_prefetch_t *prefetch = NULL;
 
     tshark_debug("tshark: perform_two_pass_analysis, do_dissection=%s", do_dissection ? "TRUE" : "FALSE");
 
@@ -3195,7 +3575,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
 
       /* We're not going to display the protocol tree on this pass,
          so it's not going to be "visible". */
-      edt = epan_dissect_new(cf->epan, create_proto_tree, FALSE);
+      edt = tshark_epan_dissect_new(cf, create_proto_tree, FALSE);
     }
 
     tshark_debug("tshark: reading records for first pass");
@@ -3274,22 +3654,34 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
          printing packet details, which is true if we're printing stuff
          ("print_packet_info" is true) and we're in verbose mode
          ("packet_details" is true). */
-      edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+      edt = tshark_epan_dissect_new(cf, create_proto_tree, print_packet_info && print_details);
     }
 
+    if (second_pass_threads != 0 && cf->count != 0)
+      prefetch = second_pass_prefetch_start(cf, second_pass_threads);
+
     for (framenum = 1; err == 0 && framenum <= cf->count; framenum++) {
+      wtap_rec *prec = &rec;
+      Buffer   *pbuf = &buf;
+      gboolean  read_ok;
+
       fdata = frame_data_sequence_find(cf->provider.frames, framenum);
-      if (wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, &err,
-                         &err_info)) {
+      if (prefetch != NULL)
+        read_ok = second_pass_prefetch_get(prefetch, framenum, &prec, &pbuf,
+                                           &err, &err_info);
+      else
+        read_ok = wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf,
+                                 &err, &err_info);
+      if (read_ok) {
         tshark_debug("tshark: invoking process_packet_second_pass() for frame #%d", framenum);
-        if (process_packet_second_pass(cf, edt, fdata, &rec, &buf,
+        if (process_packet_second_pass(cf, edt, fdata, prec, pbuf,
                                        tap_flags)) {
           /* Either there's no read filtering or this packet passed the
              filter, so, if we're writing to a capture file, write
              this packet out. */
           if (pdh != NULL) {
             tshark_debug("tshark: writing packet #%d to outfile", framenum);
-            if (!wtap_dump(pdh, &rec, ws_buffer_start_ptr(&buf), &err, &err_info)) {
+            if (!wtap_dump(pdh, prec, ws_buffer_start_ptr(pbuf), &err, &err_info)) {
               /* Error writing to a capture file */
               tshark_debug("tshark: error writing to a capture file (%d)", err);
 
@@ -3307,6 +3699,13 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
           }
         }
       }
+      if (prefetch != NULL)
+        second_pass_prefetch_release(prefetch, framenum);
+    }
+
+    if (prefetch != NULL) {
+      second_pass_prefetch_stop(prefetch);
+      prefetch = NULL;
     }
 
     if (edt) {
@@ -3356,7 +3755,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
          printing packet details, which is true if we're printing stuff
          ("print_packet_info" is true) and we're in verbose mode
          ("packet_details" is true). */
-      edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+      edt = tshark_epan_dissect_new(cf, create_proto_tree, print_packet_info && print_details);
     }
 
     while (wtap_read(cf->provider.wth, &err, &err_info, &data_offset)) {
@@ -3516,6 +3915,10 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    /* "-T arrow" looks the fields up, so it always needs them primed */
+    if (prime_output_fields || output_action == WRITE_ARROW)
+      output_fields_prime_edt(output_fields, edt);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -3605,6 +4008,10 @@ write_preamble(capture_file *cf)
     write_fields_preamble(output_fields, stdout);
     return !ferror(stdout);
 
+  case WRITE_ARROW:
+    arrow_writer = write_arrow_preamble(output_fields, &cf->cinfo, stdout);
+    return !ferror(stdout);
+
   case WRITE_JSON:
   case WRITE_JSON_RAW:
     write_json_preamble(stdout);
@@ -3958,6 +4365,10 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
     }
     break;
 
+  case WRITE_ARROW:
+    write_arrow_proto_tree(arrow_writer, edt, &cf->cinfo);
+    return !ferror(stdout);
+
   case WRITE_JSON:
     if (print_summary)
       g_assert_not_reached();
@@ -4018,6 +4429,11 @@ write_finale(void)
     write_fields_finale(output_fields, stdout);
     return !ferror(stdout);
 
+  case WRITE_ARROW:
+    write_arrow_finale(arrow_writer);
+    arrow_writer = NULL;
+    return !ferror(stdout);
+
   case WRITE_JSON:
   case WRITE_JSON_RAW:
     write_json_finale(stdout);
@@ -4158,6 +4574,34 @@ write_failure_message(const char *filename, int err)
              filename, g_strerror(err));
 }
 
+/*
+ * Can field values be decoded only when a filter, a custom column or
+ * "-T fields" looks them up, rather than as the fields are added?
+ * Only if nothing we do reads values straight out of the tree.
+ */
+static gboolean
+can_record_fields(void)
+{
+  return (!print_details || prime_output_fields) &&
+    (output_action == WRITE_TEXT || output_action == WRITE_FIELDS ||
+     output_action == WRITE_ARROW) &&
+    !(union_of_tap_listener_flags() & TL_REQUIRES_PROTO_TREE);
+}
+
+static epan_dissect_t *
+tshark_epan_dissect_new(capture_file *cf, gboolean tree, gboolean visual)
+{
+  epan_dissect_t *edt;
+
+  if (prime_output_fields)
+    visual = FALSE;
+  edt = epan_dissect_new(cf->epan, tree, visual);
+
+  if (!visual && can_record_fields())
+    epan_dissect_record_fields(edt, TRUE);
+  return edt;
+}
+
 static void reset_epan_mem(capture_file *cf,epan_dissect_t *edt, gboolean tree, gboolean visual)
 {
   if (!epan_auto_reset || (cf->count < epan_auto_reset_count))
@@ -4169,7 +4613,11 @@ static void reset_epan_mem(capture_file *cf,epan_dissect_t *edt, gboolean tree,
   epan_free(cf->epan);
 
   cf->epan = tshark_epan_new(cf);
+  if (prime_output_fields)
+    visual = FALSE;
   epan_dissect_init(edt, cf->epan, tree, visual);
+  if (!visual && can_record_fields())
+    epan_dissect_record_fields(edt, TRUE);
   cf->count = 0;
 }
 
@@ -0,0 +1,109 @@
+/* tap-dissectorprofile.c
+ * Report of the time and memory used by each protocol's dissectors
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* This module provides dissector profiling for tshark */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+#include <epan/dissector_profile.h>
+
+void register_tap_listener_dissectorprofile(void);
+
+static void
+dissectorprofile_draw(void *arg _U_)
+{
+	GPtrArray *results;
+	dissector_profile_t *profile;
+	guint64 total_ns = 0;
+	guint i;
+
+	results = dissector_profile_get_results();
+	for (i = 0; i < results->len; i++) {
+		profile = (dissector_profile_t *)g_ptr_array_index(results, i);
+		total_ns += profile->excl_ns;
+	}
+
+	printf("\n");
+	printf("=================================================================================================\n");
+	printf("Dissector Profile\n");
+	printf("Times are in milliseconds; \"Incl\" includes the dissectors called, \"Excl\" doesn't.\n\n");
+	printf("%-20s %10s %10s %10s %11s %11s %7s %13s\n",
+		"Protocol", "Calls", "Heur tries", "Heur hits",
+		"Incl time", "Excl time", "Excl %", "Excl bytes");
+	for (i = 0; i < results->len; i++) {
+		profile = (dissector_profile_t *)g_ptr_array_index(results, i);
+		printf("%-20s %10" G_GINT64_MODIFIER "u %10" G_GINT64_MODIFIER "u %10" G_GINT64_MODIFIER "u %11.3f %11.3f %6.2f%% %13" G_GINT64_MODIFIER "u\n",
+			proto_get_protocol_filter_name(profile->proto_id),
+			profile->calls, profile->heur_tries, profile->heur_accepts,
+			profile->incl_ns / 1e6, profile->excl_ns / 1e6,
+			total_ns ? 100.0 * profile->excl_ns / total_ns : 0.0,
+			profile->excl_bytes);
+	}
+	printf("=================================================================================================\n");
+
+	g_ptr_array_free(results, TRUE);
+}
+
+static void
+dissectorprofile_init(const char *opt_arg, void *userdata _U_)
+{
+	GString *error_string;
+
+	if (strcmp("dissector,profile", opt_arg) != 0) {
+		fprintf(stderr, "tshark: invalid \"-z dissector,profile\" argument\n");
+		exit(1);
+	}
+
+	/* We only need the draw callback, to print the report at the end */
+	error_string = register_tap_listener("frame", NULL, NULL, TL_REQUIRES_NOTHING, NULL, NULL, dissectorprofile_draw);
+	if (error_string) {
+		fprintf(stderr, "tshark: Couldn't register dissector,profile tap: %s\n",
+			error_string->str);
+		g_string_free(error_string, TRUE);
+		exit(1);
+	}
+
+	dissector_profile_start();
+}
+
+static stat_tap_ui dissectorprofile_ui = {
+	REGISTER_STAT_GROUP_GENERIC,
+	NULL,
+	"dissector,profile",
+	dissectorprofile_init,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_dissectorprofile(void)
+{
+	register_stat_tap_ui(&dissectorprofile_ui, NULL);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -59,23 +59,56 @@
     }
 
 static void
-modify_time_perform(frame_data *fd, int neg, nstime_t *offset, int settozero)
+modify_time_perform(frame_data_sequence *frames, frame_data *fd, int neg, nstime_t *offset, int settozero)
 {
+    const nstime_t *old_shift_offset = frame_data_sequence_get_shift_offset(frames, fd->num);
+    nstime_t *new_shift_offset;
+    nstime_t shift_offset;
+
+    if (old_shift_offset != NULL)
+        nstime_copy(&shift_offset, old_shift_offset);
+    else
+        nstime_set_zero(&shift_offset);
+
     /* The actual shift */
     if (settozero == SHIFT_SETTOZERO) {
-        nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-        nstime_set_zero(&(fd->shift_offset));
+        nstime_subtract(&(fd->abs_ts), &shift_offset);
+        nstime_set_zero(&shift_offset);
     }
 
     if (neg == SHIFT_POS) {
         nstime_add(&(fd->abs_ts), offset);
-        nstime_add(&(fd->shift_offset), offset);
+        nstime_add(&shift_offset, offset);
     } else if (neg == SHIFT_NEG) {
         nstime_subtract(&(fd->abs_ts), offset);
-        nstime_subtract(&(fd->shift_offset), offset);
+        nstime_subtract(&shift_offset, offset);
     } else {
         fprintf(stderr, "Modify_time_perform: neg = %d?\n", neg);
     }
+
+    /*
+     * Don't allocate the shift offset table for a frame that isn't
+     * shifted, e.g. for a zero shift or the undoing of all shifts.
+     */
+    if (old_shift_offset != NULL || !nstime_is_zero(&shift_offset)) {
+        new_shift_offset = frame_data_sequence_shift_offset(frames, fd->num);
+        if (new_shift_offset != NULL)
+            nstime_copy(new_shift_offset, &shift_offset);
+    }
+}
+
+/*
+ * Get the real time (abs_ts - shift_offset) of a frame.  Frames that
+ * were never shifted have no entry in the shift offset table.
+ */
+static void
+original_time(frame_data_sequence *frames, frame_data *fd, nstime_t *ot)
+{
+    const nstime_t *shift_offset = frame_data_sequence_get_shift_offset(frames, fd->num);
+
+    nstime_copy(ot, &(fd->abs_ts));
+    if (shift_offset != NULL)
+        nstime_subtract(ot, shift_offset);
 }
 
 /*
@@ -290,7 +323,7 @@ time_shift_all(capture_file *cf, const gchar *offset_text)
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->provider.frames, i)) == NULL)
             continue;   /* Shouldn't happen */
-        modify_time_perform(fd, neg ? SHIFT_NEG : SHIFT_POS, &offset, SHIFT_KEEPOFFSET);
+        modify_time_perform(cf->provider.frames, fd, neg ? SHIFT_NEG : SHIFT_POS, &offset, SHIFT_KEEPOFFSET);
     }
     packet_list_queue_draw();
 
@@ -317,7 +350,7 @@ time_shift_settime(capture_file *cf, guint packet_num, const gchar *time_text)
      */
     if ((packetfd = frame_data_sequence_find(cf->provider.frames, packet_num)) == NULL)
         return "No packets found.";
-    nstime_delta(&packet_time, &(packetfd->abs_ts), &(packetfd->shift_offset));
+    original_time(cf->provider.frames, packetfd, &packet_time);
 
     if ((err_str = time_string_to_nstime(time_text, &packet_time, &set_time)) != NULL)
         return err_str;
@@ -334,7 +367,7 @@ time_shift_settime(capture_file *cf, guint packet_num, const gchar *time_text)
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->provider.frames, i)) == NULL)
             continue;   /* Shouldn't happen */
-        modify_time_perform(fd, SHIFT_POS, &diff_time, SHIFT_SETTOZERO);
+        modify_time_perform(cf->provider.frames, fd, SHIFT_POS, &diff_time, SHIFT_SETTOZERO);
     }
 
     packet_list_queue_draw();
@@ -345,7 +378,7 @@ const gchar *
 time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text, guint packet2_num, const gchar *time2_text)
 {
     nstime_t    nt1, nt2, ot1, ot2, nt3;
-    nstime_t    dnt, dot, d3t;
+    nstime_t    dnt, dot, d3t, nulltime;
     frame_data  *fd, *packet1fd, *packet2fd;
     guint32     i;
     const gchar *err_str;
@@ -375,8 +408,7 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
      */
     if ((packet1fd = frame_data_sequence_find(cf->provider.frames, packet1_num)) == NULL)
         return "No frames found.";
-    nstime_copy(&ot1, &(packet1fd->abs_ts));
-    nstime_subtract(&ot1, &(packet1fd->shift_offset));
+    original_time(cf->provider.frames, packet1fd, &ot1);
 
     if ((err_str = time_string_to_nstime(time1_text, &ot1, &nt1)) != NULL)
         return err_str;
@@ -387,8 +419,7 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
      */
     if ((packet2fd = frame_data_sequence_find(cf->provider.frames, packet2_num)) == NULL)
         return "No frames found.";
-    nstime_copy(&ot2, &(packet2fd->abs_ts));
-    nstime_subtract(&ot2, &(packet2fd->shift_offset));
+    original_time(cf->provider.frames, packet2fd, &ot2);
 
     if ((err_str = time_string_to_nstime(time2_text, &ot2, &nt2)) != NULL)
         return err_str;
@@ -403,13 +434,14 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
     if (!frame_data_sequence_find(cf->provider.frames, 1))
         return "No frames found."; /* Shouldn't happen */
 
+    nulltime.secs = nulltime.nsecs = 0;
+
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->provider.frames, i)) == NULL)
             continue;   /* Shouldn't happen */
 
         /* Set everything back to the original time */
-        nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-        nstime_set_zero(&(fd->shift_offset));
+        modify_time_perform(cf->provider.frames, fd, SHIFT_POS, &nulltime, SHIFT_SETTOZERO);
 
         /* Add the difference to each packet */
         calcNT3(&ot1, &(fd->abs_ts), &nt1, &nt3, &dot, &dnt);
@@ -417,7 +449,7 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
         nstime_copy(&d3t, &nt3);
         nstime_subtract(&d3t, &(fd->abs_ts));
 
-        modify_time_perform(fd, SHIFT_POS, &d3t, SHIFT_SETTOZERO);
+        modify_time_perform(cf->provider.frames, fd, SHIFT_POS, &d3t, SHIFT_SETTOZERO);
     }
 
     packet_list_queue_draw();
@@ -442,7 +474,7 @@ time_shift_undo(capture_file *cf)
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->provider.frames, i)) == NULL)
             continue;   /* Shouldn't happen */
-        modify_time_perform(fd, SHIFT_NEG, &nulltime, SHIFT_SETTOZERO);
+        modify_time_perform(cf->provider.frames, fd, SHIFT_NEG, &nulltime, SHIFT_SETTOZERO);
     }
     packet_list_queue_draw();
     return NULL;
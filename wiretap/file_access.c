@@ -2139,6 +2139,80 @@ wtap_dump_can_compress(int file_type_subtype _U_)
 }
 #endif
 
+/*
+ * Types of compression we know of, and whether we can write them;
+ * the compressed-file writer is built only if we have zlib.
+ */
+static const struct {
+	wtap_compression_type type;
+	const char *name;
+	gboolean can_write;
+} compression_types[] = {
+#ifdef HAVE_ZLIB
+	{ WTAP_GZIP_COMPRESSED, "gzip", TRUE },
+	{ WTAP_BGZF_COMPRESSED, "bgzf", TRUE },
+#else
+	{ WTAP_GZIP_COMPRESSED, "gzip", FALSE },
+	{ WTAP_BGZF_COMPRESSED, "bgzf", FALSE },
+#endif
+#if defined(HAVE_ZLIB) && defined(HAVE_ZSTD)
+	{ WTAP_ZSTD_COMPRESSED, "zstd", TRUE },
+#else
+	{ WTAP_ZSTD_COMPRESSED, "zstd", FALSE },
+#endif
+#if defined(HAVE_ZLIB) && defined(HAVE_LZ4) && defined(HAVE_LZ4FRAME_H)
+	{ WTAP_LZ4_COMPRESSED, "lz4", TRUE },
+#else
+	{ WTAP_LZ4_COMPRESSED, "lz4", FALSE },
+#endif
+};
+
+gboolean
+wtap_can_write_compression_type(wtap_compression_type compression_type)
+{
+	guint i;
+
+	if (compression_type == WTAP_UNCOMPRESSED)
+		return TRUE;
+	for (i = 0; i < G_N_ELEMENTS(compression_types); i++) {
+		if (compression_types[i].type == compression_type)
+			return compression_types[i].can_write;
+	}
+	return FALSE;
+}
+
+gboolean
+wtap_name_to_compression_type(const char *name,
+    wtap_compression_type *compression_typep)
+{
+	guint i;
+
+	if (strcmp(name, "none") == 0) {
+		*compression_typep = WTAP_UNCOMPRESSED;
+		return TRUE;
+	}
+	for (i = 0; i < G_N_ELEMENTS(compression_types); i++) {
+		if (strcmp(name, compression_types[i].name) == 0) {
+			*compression_typep = compression_types[i].type;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+GSList *
+wtap_get_all_output_compression_type_names_list(void)
+{
+	GSList *names = NULL;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(compression_types); i++) {
+		if (compression_types[i].can_write)
+			names = g_slist_append(names, (gpointer)compression_types[i].name);
+	}
+	return names;
+}
+
 gboolean
 wtap_dump_has_name_resolution(int file_type_subtype)
 {
@@ -2164,17 +2238,17 @@ wtap_dump_supports_comment_types(int file_type_subtype, guint32 comment_types)
 	return FALSE;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean comressed, int *err);
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err);
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err);
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err);
+					wtap_compression_type compression_type, int *err);
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, wtap_compression_type compression_type, int *err);
 
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd);
 static int wtap_dump_file_close(wtap_dumper *wdh);
 
 static wtap_dumper *
-wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean compressed,
+wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
                       GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
                       GArray* nrb_hdrs, int *err)
 {
@@ -2184,11 +2258,11 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate a data structure for the output stream. */
-	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compressed, err);
+	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compression_type, err);
 	if (wdh == NULL)
 		return NULL;	/* couldn't allocate it */
 
@@ -2249,21 +2323,21 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 
 wtap_dumper *
 wtap_dump_open(const char *filename, int file_type_subtype, int encap,
-	       int snaplen, gboolean compressed, int *err)
+	       int snaplen, wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_ng(filename, file_type_subtype, encap,snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_open_ng(filename, file_type_subtype, encap,snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
-		  int snaplen, gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+		  int snaplen, wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
 		  GArray* nrb_hdrs, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2279,7 +2353,7 @@ wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		/* Get rid of the file we created; we couldn't finish
 		   opening it. */
 		wtap_dump_file_close(wdh);
@@ -2293,15 +2367,15 @@ wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
 wtap_dumper *
 wtap_dump_open_tempfile(char **filenamep, const char *pfx,
 			int file_type_subtype, int encap,
-			int snaplen, gboolean compressed, int *err)
+			int snaplen, wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_tempfile_ng(filenamep, pfx, file_type_subtype, encap,snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_open_tempfile_ng(filenamep, pfx, file_type_subtype, encap,snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 			   int file_type_subtype, int encap,
-			   int snaplen, gboolean compressed,
+			   int snaplen, wtap_compression_type compression_type,
 			   GArray* shb_hdrs,
 			   wtapng_iface_descriptions_t *idb_inf,
 			   GArray* nrb_hdrs, int *err)
@@ -2315,7 +2389,7 @@ wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 	*filenamep = NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2341,7 +2415,7 @@ wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		/* Get rid of the file we created; we couldn't finish
 		   opening it. */
 		wtap_dump_file_close(wdh);
@@ -2354,21 +2428,21 @@ wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 
 wtap_dumper *
 wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snaplen,
-		 gboolean compressed, int *err)
+		 wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_fdopen_ng(fd, file_type_subtype, encap, snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_fdopen_ng(fd, file_type_subtype, encap, snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
-		    gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+		    wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
 		    GArray* nrb_hdrs, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2384,7 +2458,7 @@ wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		wtap_dump_file_close(wdh);
 		g_free(wdh);
 		return NULL;
@@ -2394,14 +2468,14 @@ wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
 
 wtap_dumper *
 wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen,
-		      gboolean compressed, int *err)
+		      wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_stdout_ng(file_type_subtype, encap, snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_open_stdout_ng(file_type_subtype, encap, snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
-			 gboolean compressed, GArray* shb_hdrs,
+			 wtap_compression_type compression_type, GArray* shb_hdrs,
 			 wtapng_iface_descriptions_t *idb_inf,
 			 GArray* nrb_hdrs, int *err)
 {
@@ -2435,7 +2509,7 @@ wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
 #endif
 
 	wdh = wtap_dump_fdopen_ng(new_fd, file_type_subtype, encap, snaplen,
-	    compressed, shb_hdrs, idb_inf, nrb_hdrs, err);
+	    compression_type, shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL) {
 		/* Failed; close the new FD */
 		ws_close(new_fd);
@@ -2445,7 +2519,7 @@ wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
 }
 
 static gboolean
-wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int *err)
+wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err)
 {
 	if (!wtap_dump_can_open(file_type_subtype)) {
 		/* Invalid type, or type we don't know how to write. */
@@ -2469,7 +2543,9 @@ wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int
 		return FALSE;
 
 	/* if compression is wanted, do we support this for this file_type_subtype? */
-	if(compressed && !wtap_dump_can_compress(file_type_subtype)) {
+	if(compression_type != WTAP_UNCOMPRESSED &&
+	    (!wtap_dump_can_compress(file_type_subtype) ||
+	     !wtap_can_write_compression_type(compression_type))) {
 		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
 		return FALSE;
 	}
@@ -2479,7 +2555,7 @@ wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int
 }
 
 static wtap_dumper *
-wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, gboolean compressed, int *err)
+wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type, int *err)
 {
 	wtap_dumper *wdh;
 
@@ -2492,20 +2568,20 @@ wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, gboolean comp
 	wdh->file_type_subtype = file_type_subtype;
 	wdh->snaplen = snaplen;
 	wdh->encap = encap;
-	wdh->compressed = compressed;
+	wdh->compression_type = compression_type;
 	wdh->wslua_data = NULL;
 	return wdh;
 }
 
 static gboolean
-wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err)
+wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, wtap_compression_type compression_type, int *err)
 {
 	int fd;
 	gboolean cant_seek;
 
 	/* Can we do a seek on the file descriptor?
 	   If not, note that fact. */
-	if(compressed) {
+	if(compression_type != WTAP_UNCOMPRESSED) {
 		cant_seek = TRUE;
 	} else {
 		fd = ws_fileno((FILE *)wdh->fh);
@@ -2551,7 +2627,7 @@ void
 wtap_dump_flush(wtap_dumper *wdh)
 {
 #ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
 		gzwfile_flush((GZWFILE_T)wdh->fh);
 	} else
 #endif
@@ -2626,8 +2702,8 @@ gboolean wtap_dump_get_needs_reload(wtap_dumper *wdh) {
 static WFILE_T
 wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 {
-	if(wdh->compressed) {
-		return gzwfile_open(filename);
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		return gzwfile_open(filename, wdh->compression_type);
 	} else {
 		return ws_fopen(filename, "wb");
 	}
@@ -2645,8 +2721,8 @@ wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
 static WFILE_T
 wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 {
-	if(wdh->compressed) {
-		return gzwfile_fdopen(fd);
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		return gzwfile_fdopen(fd, wdh->compression_type);
 	} else {
 		return ws_fdopen(fd, "wb");
 	}
@@ -2666,7 +2742,7 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 	size_t nwritten;
 
 #ifdef HAVE_ZLIB
-	if (wdh->compressed) {
+	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		nwritten = gzwfile_write((GZWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
 		/*
 		 * gzwfile_write() returns 0 on error.
@@ -2700,7 +2776,7 @@ static int
 wtap_dump_file_close(wtap_dumper *wdh)
 {
 #ifdef HAVE_ZLIB
-	if(wdh->compressed)
+	if(wdh->compression_type != WTAP_UNCOMPRESSED)
 		return gzwfile_close((GZWFILE_T)wdh->fh);
 	else
 #endif
@@ -2711,7 +2787,7 @@ gint64
 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
 #ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
@@ -2732,7 +2808,7 @@ wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
 #ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
@@ -21,12 +21,27 @@
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif /* HAVE_MMAP */
 
 #ifdef HAVE_ZLIB
 #define ZLIB_CONST
 #include <zlib.h>
 #endif /* HAVE_ZLIB */
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#if defined(HAVE_LZ4) && defined(HAVE_LZ4FRAME_H)
+#define USE_LZ4
+#include <lz4frame.h>
+#endif
+
 /*
  * See RFC 1952:
  *
@@ -34,6 +49,16 @@
  *
  * for a description of the gzip file format.
  *
+ * See RFC 8478:
+ *
+ *      https://tools.ietf.org/html/rfc8478
+ *
+ * for a description of the Zstandard format, and
+ *
+ *      https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+ *
+ * for a description of the LZ4 frame format.
+ *
  * Some other compressed file formats we might want to support:
  *
  *      XZ format: http://tukaani.org/xz/
@@ -52,6 +77,12 @@
 const char *compressed_file_extension_table[] = {
 #ifdef HAVE_ZLIB
     "gz",
+#endif
+#ifdef HAVE_ZSTD
+    "zst",
+#endif
+#ifdef USE_LZ4
+    "lz4",
 #endif
     NULL
 };
@@ -65,10 +96,62 @@ typedef enum {
     UNCOMPRESSED,  /* uncompressed - copy input directly */
 #ifdef HAVE_ZLIB
     ZLIB,          /* decompress a zlib stream */
-    GZIP_AFTER_HEADER
+    GZIP_AFTER_HEADER,
+    BGZF,          /* inflate BGZF blocks on worker threads */
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD,          /* decompress a zstd frame */
+#endif
+#ifdef USE_LZ4
+    LZ4,           /* decompress an LZ4 frame */
 #endif
 } compression_t;
 
+/*
+ * Magic numbers at the start of zstd and LZ4 frames; we look for them
+ * even if we can't decompress them, so we can say why we can't read
+ * the file.
+ */
+static const guint8 zstd_magic[4] = { 0x28, 0xB5, 0x2F, 0xFD };
+static const guint8 lz4_magic[4] = { 0x04, 0x22, 0x4D, 0x18 };
+
+#ifdef HAVE_ZLIB
+/*
+ * BGZF files are gzip files made up of independent gzip members ("blocks")
+ * of at most 64 KiB each, whose headers have an extra field, with the
+ * subfield ID "BC", giving the size of the block.  Any gzip reader can
+ * read them, but, as the blocks don't depend on each other and we can
+ * find where each one ends without inflating it, we can also inflate
+ * several of them at once, and seek to the start of any block without
+ * a saved inflate window.
+ *
+ * That's what we write when writing compressed files.
+ */
+#define BGZF_MAX_BLOCK_SIZE     65536   /* maximum size of a block, compressed or not */
+#define BGZF_BLOCK_DATA_SIZE    65280   /* uncompressed data we put in a block we write */
+#define BGZF_HEADER_SIZE        18      /* gzip header with just the BC extra subfield */
+#define BGZF_TRAILER_SIZE       8       /* CRC-32 and uncompressed size */
+#define BGZF_JOBS_PER_THREAD    4       /* blocks to read ahead per worker thread */
+#define BGZF_MAX_JOBS           32      /* most blocks one file reads ahead */
+
+struct bgzf_reader;
+#endif
+
+#ifdef HAVE_PREAD
+/*
+ * When reading a file sequentially, we can have worker threads read the
+ * chunks of it that follow the current position, several at once, so
+ * that we're not waiting for the disk (or the network, for a file on a
+ * file server) every time we need more data.
+ */
+#define READAHEAD_CHUNK_SIZE    (1024 * 1024)   /* size of each read */
+#define READAHEAD_CHUNKS        4               /* reads in flight per file */
+#define READAHEAD_MAX_CHUNKS    16              /* chunks for all files together */
+#define READAHEAD_THREADS       4               /* workers shared by all files */
+
+struct readahead;
+#endif
+
 struct wtap_reader_buf {
     guint8 *buf;  /* buffer */
     guint8 *next; /* next byte to deliver from buffer */
@@ -106,6 +189,27 @@ struct wtap_reader {
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+    guint8 *out_buf;            /* our own output buffer; out can point elsewhere */
+#ifdef HAVE_MMAP
+    /* memory-mapped uncompressed file, for random access */
+    gboolean want_map;          /* TRUE if we should try to map the file */
+    guint8 *map;                /* the mapping, or NULL if not mapped */
+    gint64 map_size;            /* size of the mapping */
+#endif
+#ifdef HAVE_ZLIB
+    /* BGZF read-ahead */
+    gboolean bgzf_wanted;       /* TRUE if we should inflate BGZF blocks ahead */
+    struct bgzf_reader *bgzf;   /* read-ahead state, or NULL */
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx *zstd_dctx;       /* zstd decompression context, or NULL */
+#endif
+#ifdef USE_LZ4
+    LZ4F_dctx *lz4_dctx;        /* LZ4 frame decompression context, or NULL */
+#endif
+#ifdef HAVE_PREAD
+    struct readahead *readahead; /* read-ahead state, or NULL */
+#endif
 };
 
 /* Current read offset within a buffer. */
@@ -144,6 +248,257 @@ buf_reset(struct wtap_reader_buf *buf)
     buf->avail = 0;
 }
 
+#ifdef HAVE_PREAD
+struct readahead_chunk {
+    struct readahead *ra;       /* stream it's being read for */
+    guint8 *data;
+    int fd;                     /* descriptor to read from */
+    gint64 offset;              /* offset of the data in the file */
+    guint len;                  /* bytes read; less than a chunk at the end of the file */
+    int err;                    /* errno, if the read failed */
+    gboolean done;              /* TRUE once a worker has read it */
+};
+
+struct readahead {
+    GMutex mutex;
+    GCond cond;                 /* signalled when a chunk has been read */
+    struct readahead_chunk chunks[READAHEAD_CHUNKS];  /* ring of chunks, delivered in order */
+    guint nchunks;              /* chunks we got out of the budget */
+    guint head;                 /* chunk being delivered */
+    guint queued;               /* chunks submitted but not yet used up */
+    gint64 pos;                 /* offset of the next byte to deliver */
+    gint64 next_offset;         /* offset of the next chunk to submit */
+    gboolean at_end;            /* a chunk came up short, so stop submitting */
+};
+
+/* Read a chunk; runs on a worker thread. */
+static void
+readahead_job(gpointer data, gpointer user_data _U_)
+{
+    struct readahead_chunk *chunk = (struct readahead_chunk *)data;
+    struct readahead *ra = chunk->ra;
+    guint got = 0;
+    ssize_t ret;
+    int err = 0;
+
+    while (got < READAHEAD_CHUNK_SIZE) {
+        ret = pread(chunk->fd, chunk->data + got, READAHEAD_CHUNK_SIZE - got,
+                    (off_t)(chunk->offset + got));
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            err = errno;
+            break;
+        }
+        if (ret == 0)
+            break;
+        got += (guint)ret;
+    }
+
+    g_mutex_lock(&ra->mutex);
+    chunk->len = got;
+    chunk->err = err;
+    chunk->done = TRUE;
+    g_cond_broadcast(&ra->cond);
+    g_mutex_unlock(&ra->mutex);
+}
+
+/*
+ * As with BGZF, the worker threads are shared by all the files being
+ * read, and so is a budget of chunks, so that merging many files with
+ * read-ahead doesn't start a set of threads and allocate several
+ * megabytes for each; a file that finds the budget used up is just
+ * read the usual way.
+ */
+static GMutex readahead_budget_mutex;
+static guint readahead_chunks_free = READAHEAD_MAX_CHUNKS;
+
+static GThreadPool *
+readahead_get_pool(void)
+{
+    static gsize pool = 0;
+
+    if (g_once_init_enter(&pool)) {
+        g_once_init_leave(&pool, (gsize)g_thread_pool_new(readahead_job,
+                                                          NULL, READAHEAD_THREADS,
+                                                          FALSE, NULL));
+    }
+    return (GThreadPool *)pool;
+}
+
+/* Take up to "wanted" chunks out of the budget; returns how many we got. */
+static guint
+readahead_budget_take(guint wanted)
+{
+    guint got;
+
+    g_mutex_lock(&readahead_budget_mutex);
+    got = wanted < readahead_chunks_free ? wanted : readahead_chunks_free;
+    readahead_chunks_free -= got;
+    g_mutex_unlock(&readahead_budget_mutex);
+    return got;
+}
+
+static void
+readahead_budget_give(guint count)
+{
+    g_mutex_lock(&readahead_budget_mutex);
+    readahead_chunks_free += count;
+    g_mutex_unlock(&readahead_budget_mutex);
+}
+
+/* Wait for the reads in flight to finish, and forget about them. */
+static void
+readahead_discard(FILE_T state)
+{
+    struct readahead *ra = state->readahead;
+    guint i;
+
+    if (ra == NULL)
+        return;
+    g_mutex_lock(&ra->mutex);
+    for (i = 0; i < ra->queued; i++) {
+        while (!ra->chunks[(ra->head + i) % ra->nchunks].done)
+            g_cond_wait(&ra->cond, &ra->mutex);
+    }
+    g_mutex_unlock(&ra->mutex);
+    ra->head = 0;
+    ra->queued = 0;
+}
+
+static void
+readahead_free(FILE_T state)
+{
+    struct readahead *ra = state->readahead;
+    guint i;
+
+    if (ra == NULL)
+        return;
+    readahead_discard(state);
+    g_mutex_clear(&ra->mutex);
+    g_cond_clear(&ra->cond);
+    for (i = 0; i < ra->nchunks; i++)
+        g_free(ra->chunks[i].data);
+    readahead_budget_give(ra->nchunks);
+    g_free(ra);
+    state->readahead = NULL;
+}
+
+/*
+ * Get the chunk with the data at state->raw_pos, waiting for it to be
+ * read if need be; the chunk whose data was delivered last isn't reused
+ * until now.  At the end of the file, that's a chunk with no data left.
+ * Returns NULL, with errno set, on a read error.
+ */
+static struct readahead_chunk *
+readahead_next(FILE_T state)
+{
+    struct readahead *ra = state->readahead;
+    struct readahead_chunk *chunk;
+    gboolean looked_again = FALSE;
+
+    for (;;) {
+        /* if we've been moved elsewhere in the file, start over there */
+        if (ra->pos != state->raw_pos) {
+            readahead_discard(state);
+            ra->pos = state->raw_pos;
+        }
+        if (ra->queued == 0) {
+            ra->next_offset = ra->pos;
+            ra->at_end = FALSE;
+        }
+
+        /* keep the workers busy */
+        while (ra->queued < ra->nchunks && !ra->at_end) {
+            chunk = &ra->chunks[(ra->head + ra->queued) % ra->nchunks];
+            chunk->fd = state->fd;
+            chunk->offset = ra->next_offset;
+            chunk->done = FALSE;
+            ra->next_offset += READAHEAD_CHUNK_SIZE;
+            ra->queued++;
+            g_thread_pool_push(readahead_get_pool(), chunk, NULL);
+        }
+
+        chunk = &ra->chunks[ra->head];
+        g_mutex_lock(&ra->mutex);
+        while (!chunk->done)
+            g_cond_wait(&ra->cond, &ra->mutex);
+        g_mutex_unlock(&ra->mutex);
+
+        if (chunk->err != 0) {
+            int err = chunk->err;
+
+            readahead_discard(state);
+            errno = err;
+            return NULL;
+        }
+        if (chunk->len < READAHEAD_CHUNK_SIZE)
+            ra->at_end = TRUE;
+
+        if (ra->pos < chunk->offset + chunk->len)
+            return chunk;
+        if (chunk->len == READAHEAD_CHUNK_SIZE) {
+            /* used it all up; on to the next one */
+            ra->head = (ra->head + 1) % ra->nchunks;
+            ra->queued--;
+            continue;
+        }
+
+        /* we're at what was the end of the file when the chunk was
+           read; look again, in case the file has grown since */
+        if (looked_again)
+            return chunk;
+        readahead_discard(state);
+        looked_again = TRUE;
+    }
+}
+
+/* Copy data that's been read ahead; returns what ws_read() would. */
+static ssize_t
+readahead_read(FILE_T state, guint8 *buf, guint count)
+{
+    struct readahead *ra = state->readahead;
+    struct readahead_chunk *chunk;
+    guint offset, n;
+
+    chunk = readahead_next(state);
+    if (chunk == NULL)
+        return -1;
+    offset = (guint)(ra->pos - chunk->offset);
+    n = chunk->len - offset < count ? chunk->len - offset : count;
+    memcpy(buf, chunk->data + offset, n);
+    ra->pos += n;
+    return (ssize_t)n;
+}
+
+/* Point the output buffer at data that's been read ahead. */
+static int
+readahead_fill(FILE_T state)
+{
+    struct readahead *ra = state->readahead;
+    struct readahead_chunk *chunk;
+    guint offset;
+
+    chunk = readahead_next(state);
+    if (chunk == NULL) {
+        state->err = errno;
+        state->err_info = NULL;
+        return -1;
+    }
+    offset = (guint)(ra->pos - chunk->offset);
+
+    /* the chunk isn't reused until we're next called */
+    state->out.buf = chunk->data;
+    state->out.next = chunk->data + offset;
+    state->out.avail = chunk->len - offset;
+    if (state->out.avail == 0)
+        state->eof = TRUE;
+    state->raw_pos += state->out.avail;
+    ra->pos += state->out.avail;
+    return 0;
+}
+#endif /* HAVE_PREAD */
+
 static int
 buf_read(FILE_T state, struct wtap_reader_buf *buf)
 {
@@ -169,7 +524,12 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
         to_read = space_left;
     }
 
-    ret = ws_read(state->fd, read_ptr, to_read);
+#ifdef HAVE_PREAD
+    if (state->readahead != NULL)
+        ret = readahead_read(state, read_ptr, to_read);
+    else
+#endif
+        ret = ws_read(state->fd, read_ptr, to_read);
     if (ret < 0) {
         state->err = errno;
         state->err_info = NULL;
@@ -194,6 +554,109 @@ fill_in_buffer(FILE_T state)
     return 0;
 }
 
+/* Get at least n bytes into the input buffer, unless the file ends
+   first, moving what's already there to the start of the buffer so
+   that there's room for the rest. */
+static int
+fill_in_buffer_to(FILE_T state, guint n)
+{
+    while (state->in.avail < n && !state->eof) {
+        if (state->err != 0)
+            return -1;
+        if (state->in.next != state->in.buf) {
+            memmove(state->in.buf, state->in.next, state->in.avail);
+            state->in.next = state->in.buf;
+        }
+        if (buf_read(state, &state->in) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+#ifdef HAVE_MMAP
+/*
+ * For an uncompressed file opened for random access, rather than
+ * read()ing into the output buffer, we map the file and point the
+ * output buffer at a window of the mapping, so that reading copies
+ * straight out of the page cache and seeking is pointer arithmetic.
+ *
+ * The window keeps the offsets within the "buffer" small enough
+ * for the unsigned ints used for them; it's slid as we move
+ * around the file.
+ */
+#define MAP_WINDOW  (G_GINT64_CONSTANT(1) << 30)
+
+/*
+ * Map the file, or, if it's already mapped and has grown since,
+ * remap it to cover the new data.  Returns FALSE if the file can't
+ * be mapped or hasn't grown.
+ *
+ * If the file is truncated while it's mapped, touching the pages past
+ * the new end raises SIGBUS; see map_check().
+ */
+static gboolean
+map_file(FILE_T state)
+{
+    ws_statb64 st;
+    void *map;
+
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return FALSE;
+    if (st.st_size <= state->map_size || (guint64)st.st_size > G_MAXSIZE)
+        return FALSE;
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, state->fd, 0);
+    if (map == MAP_FAILED)
+        return FALSE;
+    if (state->map != NULL)
+        munmap(state->map, (size_t)state->map_size);
+    state->map = (guint8 *)map;
+    state->map_size = st.st_size;
+    return TRUE;
+}
+
+/*
+ * Make sure the file hasn't been truncated since we mapped it, and, if
+ * it has, stop using the mapping and carry on from the same place with
+ * read(), which just sees the end of the file.  It's called whenever
+ * we're about to take data from a different part of the mapping, after
+ * a seek or when the window is slid, so the file would have to be
+ * truncated between that and copying out the record being read.
+ */
+static void
+map_check(FILE_T state)
+{
+    ws_statb64 st;
+
+    if (ws_fstat64(state->fd, &st) == 0 && st.st_size >= state->map_size)
+        return;
+    munmap(state->map, (size_t)state->map_size);
+    state->map = NULL;
+    state->map_size = 0;
+    state->want_map = FALSE;
+    state->out.buf = state->out_buf;
+    buf_reset(&state->out);
+    state->raw_pos = state->pos;
+    (void)ws_lseek64(state->fd, state->pos, SEEK_SET);
+}
+
+/* Point the output buffer at the window of the mapping around state->pos. */
+static void
+map_window(FILE_T state)
+{
+    gint64 base, end;
+
+    base = state->pos > MAP_WINDOW / 2 ? state->pos - MAP_WINDOW / 2 : 0;
+    end = base + MAP_WINDOW < state->map_size ? base + MAP_WINDOW : state->map_size;
+    state->out.buf = state->map + base;
+    state->out.next = state->map + state->pos;
+    state->out.avail = state->pos < end ? (guint)(end - state->pos) : 0;
+
+    /* as if we'd read the window into the buffer, raw_pos is just past
+       the data in it; the uncompressed seek code relies on that */
+    state->raw_pos = state->pos + state->out.avail;
+}
+#endif /* HAVE_MMAP */
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -596,10 +1059,406 @@ DIAG_ON(cast-qual)
 }
 #endif
 
+#ifdef HAVE_ZLIB
+struct bgzf_job {
+    struct bgzf_reader *bgzf;   /* reader the job belongs to */
+    guint8 *raw;                /* deflate data and gzip trailer of the block */
+    guint raw_len;
+    guint8 *data;               /* inflated data */
+    guint data_len;
+    gint64 in_pos;              /* offset of the block in the file */
+    gboolean dont_check_crc;
+    gboolean done;              /* TRUE once a worker has inflated it */
+    const char *err_info;       /* why it couldn't be inflated, if it couldn't */
+};
+
+struct bgzf_reader {
+    GMutex mutex;
+    GCond cond;                 /* signalled when a job is done */
+    struct bgzf_job *jobs;      /* ring of jobs, delivered in order; their
+                                   buffers are allocated when first used */
+    guint n_jobs;
+    guint head;                 /* next job to deliver */
+    guint queued;               /* jobs submitted but not yet delivered */
+    gint64 next_in;             /* offset of the next block header */
+    gboolean at_end;            /* no more BGZF blocks to submit */
+};
+
+/* Inflate a BGZF block; runs on a worker thread. */
+static void
+bgzf_inflate_job(gpointer data, gpointer user_data _U_)
+{
+    struct bgzf_job *job = (struct bgzf_job *)data;
+    struct bgzf_reader *bgzf = job->bgzf;
+    const guint8 *trailer = job->raw + job->raw_len - BGZF_TRAILER_SIZE;
+    const char *err_info = NULL;
+    z_stream strm;
+    int ret;
+
+    memset(&strm, 0, sizeof strm);
+    if (inflateInit2(&strm, -15) != Z_OK) {
+        err_info = "can't allocate inflate state";
+    } else {
+        strm.next_in = job->raw;
+        strm.avail_in = job->raw_len - BGZF_TRAILER_SIZE;
+        strm.next_out = job->data;
+        strm.avail_out = BGZF_MAX_BLOCK_SIZE;
+        ret = inflate(&strm, Z_FINISH);
+        job->data_len = BGZF_MAX_BLOCK_SIZE - strm.avail_out;
+        inflateEnd(&strm);
+
+        if (ret != Z_STREAM_END)
+            err_info = "invalid BGZF block";
+        else if (!job->dont_check_crc &&
+                 pletoh32(trailer) != (guint32)crc32(0L, job->data, job->data_len))
+            err_info = "bad CRC";
+        else if (pletoh32(trailer + 4) != job->data_len)
+            err_info = "length field wrong";
+    }
+
+    g_mutex_lock(&bgzf->mutex);
+    job->err_info = err_info;
+    job->done = TRUE;
+    g_cond_broadcast(&bgzf->cond);
+    g_mutex_unlock(&bgzf->mutex);
+}
+
+/*
+ * The worker threads are shared by all the files being read, so that
+ * opening many files at once doesn't start a set of threads for each.
+ */
+static guint bgzf_num_threads;
+
+static GThreadPool *
+bgzf_get_pool(void)
+{
+    static gsize pool = 0;
+
+    if (g_once_init_enter(&pool)) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+        bgzf_num_threads = g_get_num_processors();
+#else
+        bgzf_num_threads = 4;
+#endif
+        g_once_init_leave(&pool, (gsize)g_thread_pool_new(bgzf_inflate_job,
+                                                          NULL, (gint)bgzf_num_threads,
+                                                          FALSE, NULL));
+    }
+    return (GThreadPool *)pool;
+}
+
+/* Size of a BGZF block given its BC subfield, or 0 if it can't be one. */
+static guint
+bgzf_block_size(guint16 si, guint16 slen, guint16 bsize)
+{
+    if (si != ('B' | ('C' << 8)) || slen != 2)
+        return 0;
+    if ((guint)bsize + 1 < BGZF_HEADER_SIZE + BGZF_TRAILER_SIZE)
+        return 0;
+    return (guint)bsize + 1;
+}
+
+/* Copy raw bytes from the input; returns how many we got, or -1 on error. */
+static int
+gz_read_raw(FILE_T state, guint8 *buf, guint len)
+{
+    guint got = 0, n;
+
+    while (got < len) {
+        if (state->in.avail == 0) {
+            if (fill_in_buffer(state) == -1)
+                return -1;
+            if (state->in.avail == 0)
+                break;
+        }
+        n = state->in.avail > len - got ? len - got : state->in.avail;
+        memcpy(buf + got, state->in.next, n);
+        state->in.next += n;
+        state->in.avail -= n;
+        got += n;
+    }
+    return (int)got;
+}
+
+/* Wait for the jobs in flight to finish, and forget about them. */
+static void
+bgzf_discard(FILE_T state)
+{
+    struct bgzf_reader *bgzf = state->bgzf;
+    guint i;
+
+    if (bgzf == NULL)
+        return;
+    g_mutex_lock(&bgzf->mutex);
+    for (i = 0; i < bgzf->queued; i++) {
+        while (!bgzf->jobs[(bgzf->head + i) % bgzf->n_jobs].done)
+            g_cond_wait(&bgzf->cond, &bgzf->mutex);
+    }
+    g_mutex_unlock(&bgzf->mutex);
+    bgzf->head = 0;
+    bgzf->queued = 0;
+    bgzf->at_end = FALSE;
+    state->out.buf = state->out_buf;
+}
+
+static void
+bgzf_free(FILE_T state)
+{
+    struct bgzf_reader *bgzf = state->bgzf;
+    guint i;
+
+    if (bgzf == NULL)
+        return;
+    bgzf_discard(state);
+    g_mutex_clear(&bgzf->mutex);
+    g_cond_clear(&bgzf->cond);
+    for (i = 0; i < bgzf->n_jobs; i++) {
+        g_free(bgzf->jobs[i].raw);
+        g_free(bgzf->jobs[i].data);
+    }
+    g_free(bgzf->jobs);
+    g_free(bgzf);
+    state->bgzf = NULL;
+}
+
+/*
+ * Switch to inflating BGZF blocks ahead, starting with the block whose
+ * header is at hdr_start.  Returns FALSE if we can't, in which case
+ * the caller just inflates the block itself.
+ */
+static gboolean
+bgzf_begin(FILE_T state, gint64 hdr_start)
+{
+    struct bgzf_reader *bgzf = state->bgzf;
+    guint i;
+
+    if (ws_lseek64(state->fd, hdr_start, SEEK_SET) == -1)
+        return FALSE;
+
+    if (bgzf == NULL) {
+        bgzf = g_new0(struct bgzf_reader, 1);
+        g_mutex_init(&bgzf->mutex);
+        g_cond_init(&bgzf->cond);
+        bgzf_get_pool();
+        bgzf->n_jobs = MIN(bgzf_num_threads * BGZF_JOBS_PER_THREAD, BGZF_MAX_JOBS);
+        bgzf->jobs = g_new0(struct bgzf_job, bgzf->n_jobs);
+        for (i = 0; i < bgzf->n_jobs; i++)
+            bgzf->jobs[i].bgzf = bgzf;
+        state->bgzf = bgzf;
+    }
+
+    bgzf->head = 0;
+    bgzf->queued = 0;
+    bgzf->at_end = FALSE;
+    bgzf->next_in = hdr_start;
+
+    state->raw_pos = hdr_start;
+    buf_reset(&state->in);
+    state->eof = FALSE;
+    state->compression = BGZF;
+    state->is_compressed = TRUE;
+    return TRUE;
+}
+
+/* Read the next BGZF block and hand it to a worker; FALSE if there isn't one. */
+static gboolean
+bgzf_submit(FILE_T state)
+{
+    struct bgzf_reader *bgzf = state->bgzf;
+    struct bgzf_job *job;
+    guint8 hdr[BGZF_HEADER_SIZE];
+    guint bsize;
+
+    if (bgzf->at_end || bgzf->queued == bgzf->n_jobs)
+        return FALSE;
+
+    /* if what follows isn't a BGZF block, we stop here and, once
+       the blocks we have are delivered, go back and let gz_head()
+       deal with it */
+    if (gz_read_raw(state, hdr, BGZF_HEADER_SIZE) != BGZF_HEADER_SIZE ||
+        hdr[0] != 31 || hdr[1] != 139 || hdr[2] != 8 || hdr[3] != 4 ||
+        pletoh16(&hdr[10]) != 6 ||
+        (bsize = bgzf_block_size(pletoh16(&hdr[12]), pletoh16(&hdr[14]),
+                                 pletoh16(&hdr[16]))) == 0) {
+        bgzf->at_end = TRUE;
+        return FALSE;
+    }
+
+    job = &bgzf->jobs[(bgzf->head + bgzf->queued) % bgzf->n_jobs];
+    if (job->raw == NULL) {
+        job->raw = (guint8 *)g_malloc(BGZF_MAX_BLOCK_SIZE);
+        job->data = (guint8 *)g_malloc(BGZF_MAX_BLOCK_SIZE);
+    }
+    job->raw_len = bsize - BGZF_HEADER_SIZE;
+    if (gz_read_raw(state, job->raw, job->raw_len) != (int)job->raw_len) {
+        bgzf->at_end = TRUE;
+        return FALSE;
+    }
+    job->in_pos = bgzf->next_in;
+    job->dont_check_crc = state->dont_check_crc;
+    job->done = FALSE;
+    job->err_info = NULL;
+    bgzf->next_in += bsize;
+    bgzf->queued++;
+    g_thread_pool_push(bgzf_get_pool(), job, NULL);
+    return TRUE;
+}
+
+/* Deliver the next inflated BGZF block into the output buffer. */
+static int
+bgzf_fill(FILE_T state)
+{
+    struct bgzf_reader *bgzf = state->bgzf;
+    struct bgzf_job *job;
+
+    /* keep the workers busy; reading ahead may have hit the end of
+       the file, but that's not the end of the data until we've
+       delivered everything we read */
+    while (bgzf_submit(state))
+        ;
+    if (state->err != 0)
+        return -1;
+    state->eof = FALSE;
+
+    if (bgzf->queued == 0) {
+        /* no more blocks; go back to whatever follows them, and
+           look at it afresh */
+        if (ws_lseek64(state->fd, bgzf->next_in, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+            return -1;
+        }
+        state->raw_pos = bgzf->next_in;
+        buf_reset(&state->in);
+        state->eof = FALSE;
+        bgzf_discard(state);
+        buf_reset(&state->out);
+        state->compression = UNKNOWN;
+        return 0;
+    }
+
+    job = &bgzf->jobs[bgzf->head];
+    g_mutex_lock(&bgzf->mutex);
+    while (!job->done)
+        g_cond_wait(&bgzf->cond, &bgzf->mutex);
+    g_mutex_unlock(&bgzf->mutex);
+    bgzf->head = (bgzf->head + 1) % bgzf->n_jobs;
+    bgzf->queued--;
+
+    if (job->err_info != NULL) {
+        state->err = WTAP_ERR_DECOMPRESS;
+        state->err_info = job->err_info;
+        return -1;
+    }
+
+    /* the start of every block is a seek point */
+    if (state->fast_seek)
+        fast_seek_header(state, job->in_pos, state->pos, BGZF);
+
+    /* the job's buffer isn't reused until we're next called */
+    state->out.buf = job->data;
+    state->out.next = job->data;
+    state->out.avail = job->data_len;
+    return 0;
+}
+#endif /* HAVE_ZLIB */
+
+#ifdef HAVE_ZSTD
+/* Decompress zstd data into buf until it's full or the frame ends. */
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    size_t ret;
+
+    output.dst = buf;
+    output.size = count;
+    output.pos = 0;
+    while (output.pos < output.size) {
+        /* get more input for ZSTD_decompressStream() */
+        if (state->in.avail == 0 && fill_in_buffer(state) == -1)
+            break;
+        if (state->in.avail == 0) {
+            /* EOF in the middle of a frame */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            break;
+        }
+
+        input.src = state->in.next;
+        input.size = state->in.avail;
+        input.pos = 0;
+        ret = ZSTD_decompressStream(state->zstd_dctx, &output, &input);
+        state->in.next += input.pos;
+        state->in.avail -= (guint)input.pos;
+        if (ZSTD_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = ZSTD_getErrorName(ret);
+            break;
+        }
+        if (ret == 0) {
+            /* end of the frame; look for another one, once this
+               output is used up */
+            state->compression = UNKNOWN;
+            break;
+        }
+    }
+
+    state->out.next = buf;
+    state->out.avail = (guint)output.pos;
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef USE_LZ4
+/* Decompress LZ4 frame data into buf until it's full or the frame ends. */
+static void
+lz4_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    size_t in_size, out_size, ret;
+    unsigned int got = 0;
+
+    while (got < count) {
+        /* get more input for LZ4F_decompress() */
+        if (state->in.avail == 0 && fill_in_buffer(state) == -1)
+            break;
+        if (state->in.avail == 0) {
+            /* EOF in the middle of a frame */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            break;
+        }
+
+        in_size = state->in.avail;
+        out_size = count - got;
+        ret = LZ4F_decompress(state->lz4_dctx, buf + got, &out_size,
+                              state->in.next, &in_size, NULL);
+        state->in.next += in_size;
+        state->in.avail -= (guint)in_size;
+        got += (unsigned int)out_size;
+        if (LZ4F_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = LZ4F_getErrorName(ret);
+            break;
+        }
+        if (ret == 0) {
+            /* end of the frame; look for another one, once this
+               output is used up */
+            state->compression = UNKNOWN;
+            break;
+        }
+    }
+
+    state->out.next = buf;
+    state->out.avail = got;
+}
+#endif /* USE_LZ4 */
+
 static int
 gz_head(FILE_T state)
 {
     guint already_read;
+    gint64 hdr_start;
 
     /* get some data in the input buffer */
     if (state->in.avail == 0) {
@@ -609,6 +1468,69 @@ gz_head(FILE_T state)
             return 0;
     }
 
+    /* make sure we have enough to check for the zstd and LZ4 magic
+       numbers */
+    if (fill_in_buffer_to(state, 4) == -1)
+        return -1;
+    hdr_start = state->raw_pos - state->in.avail;
+
+    /* look for a zstd frame */
+    if (state->in.avail >= 4 && memcmp(state->in.next, zstd_magic, 4) == 0) {
+#ifdef HAVE_ZSTD
+        if (state->zstd_dctx == NULL) {
+            state->zstd_dctx = ZSTD_createDCtx();
+            if (state->zstd_dctx == NULL) {
+                state->err = ENOMEM;
+                state->err_info = NULL;
+                return -1;
+            }
+        }
+#if ZSTD_VERSION_NUMBER >= 10400
+        ZSTD_DCtx_reset(state->zstd_dctx, ZSTD_reset_session_only);
+#else
+        /* ZSTD_DCtx_reset() is experimental before zstd 1.4.0 */
+        ZSTD_initDStream(state->zstd_dctx);
+#endif
+        state->compression = ZSTD;
+        state->is_compressed = TRUE;
+
+        /* frames are independent, so the start of each is a seek point */
+        if (state->fast_seek)
+            fast_seek_header(state, hdr_start, state->pos, ZSTD);
+        return 0;
+#else
+        state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
+        state->err_info = "reading zstd-compressed files isn't supported";
+        return -1;
+#endif
+    }
+
+    /* look for an LZ4 frame */
+    if (state->in.avail >= 4 && memcmp(state->in.next, lz4_magic, 4) == 0) {
+#ifdef USE_LZ4
+        if (state->lz4_dctx == NULL) {
+            if (LZ4F_isError(LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION))) {
+                state->lz4_dctx = NULL;
+                state->err = ENOMEM;
+                state->err_info = NULL;
+                return -1;
+            }
+        }
+        LZ4F_resetDecompressionContext(state->lz4_dctx);
+        state->compression = LZ4;
+        state->is_compressed = TRUE;
+
+        /* frames are independent, so the start of each is a seek point */
+        if (state->fast_seek)
+            fast_seek_header(state, hdr_start, state->pos, LZ4);
+        return 0;
+#else
+        state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
+        state->err_info = "reading LZ4-compressed files isn't supported";
+        return -1;
+#endif
+    }
+
     /* look for the gzip magic header bytes 31 and 139 */
     if (state->in.next[0] == 31) {
         state->in.avail--;
@@ -621,6 +1543,7 @@ gz_head(FILE_T state)
             guint8 flags;
             guint16 len;
             guint16 hcrc;
+            guint bgzf_size = 0;
 
             /* we have a gzip header, woo hoo! */
             state->in.avail--;
@@ -663,9 +1586,20 @@ gz_head(FILE_T state)
                 if (gz_next2(state, &len) == -1)
                     return -1;
 
-                /* skip the extra field */
-                if (gz_skipn(state, len) == -1)
-                    return -1;
+                if (len == 6) {
+                    /* might be just a BGZF "BC" subfield */
+                    guint16 si, slen, bsize;
+
+                    if (gz_next2(state, &si) == -1 ||
+                        gz_next2(state, &slen) == -1 ||
+                        gz_next2(state, &bsize) == -1)
+                        return -1;
+                    bgzf_size = bgzf_block_size(si, slen, bsize);
+                } else {
+                    /* skip the extra field */
+                    if (gz_skipn(state, len) == -1)
+                        return -1;
+                }
             }
             if (flags & 8) {
                 /* file name */
@@ -684,6 +1618,12 @@ gz_head(FILE_T state)
                 /* XXX - check the CRC? */
             }
 
+            /* if it's a BGZF block, and it's worth it, inflate it and the
+               blocks after it on worker threads */
+            if (bgzf_size != 0 && flags == 4 && state->bgzf_wanted &&
+                bgzf_begin(state, hdr_start))
+                return 0;
+
             /* set up for decompression */
             inflateReset(&(state->strm));
             state->strm.adler = crc32(0L, Z_NULL, 0);
@@ -701,6 +1641,7 @@ gz_head(FILE_T state)
 #endif /* Z_BLOCK */
             return 0;
 #else /* HAVE_ZLIB */
+            (void)hdr_start;
             state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
             state->err_info = "reading gzip-compressed files isn't supported";
             return -1;
@@ -719,6 +1660,17 @@ gz_head(FILE_T state)
        input to output -- this assumes that the output buffer is larger than
        the input buffer, which also assures space for gzungetc() */
     state->raw = state->pos;
+#ifdef HAVE_MMAP
+    /* if we can map the file, do raw i/o from the mapping instead */
+    if (state->want_map && !state->is_compressed && state->start == 0 &&
+        (state->map != NULL || map_file(state))) {
+        buf_reset(&state->in);
+        map_window(state);
+        state->compression = UNCOMPRESSED;
+        return 0;
+    }
+#endif
+    state->out.buf = state->out_buf;
     state->out.next = state->out.buf;
     /* not a compressed file -- copy everything we've read into the
        input buffer to the output buffer and fall to raw i/o */
@@ -744,13 +1696,48 @@ fill_out_buffer(FILE_T state)
             return 0;
     }
     if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef HAVE_MMAP
+        if (state->map != NULL)
+            map_check(state);
+        if (state->map != NULL) {
+            /* slide the window; if we've run off the end of the
+               mapping, the file may have grown since we mapped it */
+            if (state->pos >= state->map_size)
+                map_file(state);
+            map_window(state);
+            if (state->out.avail == 0)
+                state->eof = TRUE;
+            return 0;
+        }
+#endif
+#ifdef HAVE_PREAD
+        if (state->readahead != NULL)
+            return readahead_fill(state);
+#endif
         if (buf_read(state, &state->out) < 0)
             return -1;
     }
 #ifdef HAVE_ZLIB
     else if (state->compression == ZLIB) {      /* decompress */
+        state->out.buf = state->out_buf;
         zlib_read(state, state->out.buf, state->size << 1);
     }
+    else if (state->compression == BGZF) {      /* inflated on worker threads */
+        if (bgzf_fill(state) == -1)
+            return -1;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    else if (state->compression == ZSTD) {
+        state->out.buf = state->out_buf;
+        zstd_read(state, state->out.buf, state->size << 1);
+    }
+#endif
+#ifdef USE_LZ4
+    else if (state->compression == LZ4) {
+        state->out.buf = state->out_buf;
+        lz4_read(state, state->out.buf, state->size << 1);
+    }
 #endif
     return 0;
 }
@@ -794,6 +1781,9 @@ gz_skip(FILE_T state, gint64 len)
 static void
 gz_reset(FILE_T state)
 {
+#ifdef HAVE_ZLIB
+    bgzf_discard(state);          /* forget any blocks being read ahead */
+#endif
     buf_reset(&state->out);       /* no output data available */
     state->eof = FALSE;           /* not at end of file */
     state->compression = UNKNOWN; /* look for gzip header */
@@ -808,7 +1798,7 @@ gz_reset(FILE_T state)
 FILE_T
 file_fdopen(int fd)
 {
-#ifdef _STATBUF_ST_BLKSIZE      /* XXX, _STATBUF_ST_BLKSIZE portable? */
+#if defined(_STATBUF_ST_BLKSIZE) || defined(HAVE_ZLIB)     /* XXX, _STATBUF_ST_BLKSIZE portable? */
     ws_statb64 st;
 #endif
     int want = GZBUFSIZE;
@@ -859,6 +1849,7 @@ file_fdopen(int fd)
     state->in.next = state->in.buf;
     state->in.avail = 0;
     state->out.buf = (unsigned char *)g_try_malloc(((gsize)want) << 1);
+    state->out_buf = state->out.buf;
     state->out.next = state->out.buf;
     state->out.avail = 0;
     state->size = want;
@@ -887,6 +1878,12 @@ file_fdopen(int fd)
 
     /* for now, assume we should check the crc */
     state->dont_check_crc = FALSE;
+
+    /* we read BGZF blocks ahead only if we can seek back to what
+       follows them, and only until we're told we're being used for
+       random access */
+    if (ws_fstat64(fd, &st) >= 0 && S_ISREG(st.st_mode))
+        state->bgzf_wanted = TRUE;
 #endif
     /* return stream */
     return state;
@@ -944,10 +1941,116 @@ file_open(const char *path)
     return ft;
 }
 
+void
+file_set_read_ahead(FILE_T stream)
+{
+#ifdef HAVE_PREAD
+    ws_statb64 st;
+    struct readahead *ra;
+    guint nchunks, i;
+
+    /* only worth it for a file we're reading straight through; we can't
+       pread() from a pipe, and a mapping is already as good as it gets */
+    if (stream->readahead != NULL || ws_fstat64(stream->fd, &st) == -1 ||
+        !S_ISREG(st.st_mode))
+        return;
+#ifdef HAVE_MMAP
+    if (stream->want_map)
+        return;
+#endif
+
+    /* the chunk being delivered isn't reused until we're done with it,
+       so with fewer than two there'd be nothing read ahead */
+    nchunks = readahead_budget_take(READAHEAD_CHUNKS);
+    if (nchunks < 2) {
+        readahead_budget_give(nchunks);
+        return;
+    }
+
+    ra = g_new0(struct readahead, 1);
+    g_mutex_init(&ra->mutex);
+    g_cond_init(&ra->cond);
+    ra->nchunks = nchunks;
+    for (i = 0; i < nchunks; i++) {
+        ra->chunks[i].ra = ra;
+        ra->chunks[i].data = (guint8 *)g_malloc(READAHEAD_CHUNK_SIZE);
+    }
+    ra->pos = stream->raw_pos;
+    stream->readahead = ra;
+#else
+    (void)stream;
+#endif
+}
+
 void
 file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
 {
     stream->fast_seek = seek;
+#ifdef HAVE_MMAP
+    stream->want_map = random_flag;
+#endif
+#ifdef HAVE_ZLIB
+    /* reading ahead doesn't help random access */
+    if (random_flag)
+        stream->bgzf_wanted = FALSE;
+#endif
+}
+
+gsize
+file_fast_seek_point_size(void)
+{
+    return sizeof(struct fast_seek_point);
+}
+
+/*
+ * Check fast seek points saved from another run before using them: they
+ * must be ones that we could have gathered, in order.
+ */
+gboolean
+file_fast_seek_points_valid(const guint8 *points, guint32 count)
+{
+    struct fast_seek_point point;
+    gint64 prev_out = -1;
+    guint32 i;
+
+    for (i = 0; i < count; i++) {
+        memcpy(&point, points + (gsize)i * sizeof point, sizeof point);
+        if (point.in < 0 || point.out <= prev_out)
+            return FALSE;
+        switch (point.compression) {
+
+        case UNCOMPRESSED:
+            break;
+
+#ifdef HAVE_ZLIB
+        case ZLIB:
+#ifdef HAVE_INFLATEPRIME
+            if (point.data.zlib.bits < 0 || point.data.zlib.bits > 7)
+                return FALSE;
+#endif
+            break;
+
+        case GZIP_AFTER_HEADER:
+        case BGZF:
+            break;
+#endif
+
+#ifdef HAVE_ZSTD
+        case ZSTD:
+            break;
+#endif
+
+#ifdef USE_LZ4
+        case LZ4:
+            break;
+#endif
+
+        default:
+            return FALSE;
+        }
+        prev_out = point.out;
+    }
+    return TRUE;
 }
 
 gint64
@@ -991,6 +2094,17 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         offset += file->skip;
     }
     file->seek_pending = FALSE;
+#ifdef HAVE_MMAP
+    /* When reading from a mapping, seeking within it doesn't go
+       through the code below that clears end-of-file; clear it
+       here so that we'll notice if the file has grown.  Also make
+       sure it hasn't shrunk, before we read from wherever we're
+       going. */
+    if (file->map != NULL) {
+        file->eof = FALSE;
+        map_check(file);
+    }
+#endif
 
     /*
      * Are we moving at all?
@@ -1080,7 +2194,20 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off = here->in;
 #endif
             off2 = here->out;
-        } else if (here->compression == GZIP_AFTER_HEADER) {
+        } else if (here->compression == GZIP_AFTER_HEADER ||
+                   here->compression == BGZF) {
+            off = here->in;
+            off2 = here->out;
+        } else
+#endif
+#ifdef HAVE_ZSTD
+        if (here->compression == ZSTD) {
+            off = here->in;
+            off2 = here->out;
+        } else
+#endif
+#ifdef USE_LZ4
+        if (here->compression == LZ4) {
             off = here->in;
             off2 = here->out;
         } else
@@ -1090,6 +2217,9 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off = here->in + (off2 - here->out);
         }
 
+#ifdef HAVE_ZLIB
+        bgzf_discard(file);
+#endif
         if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
             *err = errno;
             return -1;
@@ -1135,6 +2265,21 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             inflateReset(strm);
             strm->adler = crc32(0L, Z_NULL, 0);
             file->compression = ZLIB;
+        } else if (here->compression == BGZF) {
+            /* at the start of a block; read its header again */
+            file->compression = UNKNOWN;
+        } else
+#endif
+#ifdef HAVE_ZSTD
+        if (here->compression == ZSTD) {
+            /* at the start of a frame; look at it afresh */
+            file->compression = UNKNOWN;
+        } else
+#endif
+#ifdef USE_LZ4
+        if (here->compression == LZ4) {
+            /* at the start of a frame; look at it afresh */
+            file->compression = UNKNOWN;
         } else
 #endif
             file->compression = here->compression;
@@ -1168,11 +2313,21 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         && (file->fast_seek != NULL))
     {
         /*
-         * Yes.  Just seek there within the file.
+         * Yes.  Just seek there within the file; if we're reading
+         * from a mapping of the file, the descriptor's offset isn't
+         * used, so there's nothing to do other than update our
+         * position.
          */
-        if (ws_lseek64(file->fd, offset - file->out.avail, SEEK_CUR) == -1) {
-            *err = errno;
-            return -1;
+#ifdef HAVE_MMAP
+        if (file->map == NULL)
+#endif
+        {
+            /* read-ahead doesn't move the descriptor's offset, so
+               seek relative to where we know we are */
+            if (ws_lseek64(file->fd, file->raw_pos + (offset - file->out.avail), SEEK_SET) == -1) {
+                *err = errno;
+                return -1;
+            }
         }
         file->raw_pos += (offset - file->out.avail);
         buf_reset(&file->out);
@@ -1500,6 +2655,10 @@ file_clearerr(FILE_T stream)
 void
 file_fdclose(FILE_T file)
 {
+#ifdef HAVE_PREAD
+    /* don't leave reads of the descriptor in flight */
+    readahead_discard(file);
+#endif
     ws_close(file->fd);
     file->fd = -1;
 }
@@ -1521,11 +2680,28 @@ file_close(FILE_T file)
     int fd = file->fd;
 
     /* free memory and close file */
+#ifdef HAVE_ZLIB
+    bgzf_free(file);
+#endif
+#ifdef HAVE_PREAD
+    readahead_free(file);
+#endif
+#ifdef HAVE_MMAP
+    if (file->map != NULL)
+        munmap(file->map, (size_t)file->map_size);
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_freeDCtx(file->zstd_dctx);
+#endif
+#ifdef USE_LZ4
+    if (file->lz4_dctx != NULL)
+        LZ4F_freeDecompressionContext(file->lz4_dctx);
+#endif
     if (file->size) {
 #ifdef HAVE_ZLIB
         inflateEnd(&(file->strm));
 #endif
-        g_free(file->out.buf);
+        g_free(file->out_buf);
         g_free(file->in.buf);
     }
     g_free(file->fast_seek_cur);
@@ -1542,24 +2718,41 @@ file_close(FILE_T file)
 }
 
 #ifdef HAVE_ZLIB
-/* internal gzip file state data structure for writing */
+/*
+ * Uncompressed data we put in each zstd or LZ4 frame we write.  Frames
+ * are independent of each other, so, as with BGZF blocks, a reader can
+ * start decompressing at the start of any of them.
+ */
+#define FRAME_DATA_SIZE         (1024 * 1024)
+
+#if defined(HAVE_ZSTD) && !defined(ZSTD_CLEVEL_DEFAULT)
+#define ZSTD_CLEVEL_DEFAULT     3
+#endif
+
+/* internal compressed file state data structure for writing */
 struct wtap_writer {
     int fd;                 /* file descriptor */
+    wtap_compression_type compression_type; /* what we're writing */
     gint64 pos;             /* current position in uncompressed data */
     guint size;          /* buffer size, zero if not allocated yet */
-    guint want;          /* requested buffer size, default is GZBUFSIZE */
-    unsigned char *in;      /* input buffer */
-    unsigned char *out;     /* output buffer (double-sized when reading) */
-    unsigned char *next;    /* next output data to deliver or write */
+    guint want;          /* requested buffer size */
+    unsigned char *in;      /* input buffer; for BGZF, zstd and LZ4, the data for the next block or frame */
+    unsigned char *out;     /* output buffer; for BGZF, zstd and LZ4, a compressed block or frame */
+    unsigned char *next;    /* next output data to write, for gzip */
+    size_t out_size;        /* size of the output buffer */
+    guint have;             /* amount of data in the input buffer, for BGZF, zstd and LZ4 */
     int level;              /* compression level */
     int strategy;           /* compression strategy */
     int err;                /* error code */
     /* zlib deflate stream */
     z_stream strm;          /* stream structure in-place (not a pointer) */
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *zstd_cctx;   /* zstd compression context */
+#endif
 };
 
 GZWFILE_T
-gzwfile_open(const char *path)
+gzwfile_open(const char *path, wtap_compression_type compression_type)
 {
     int fd;
     GZWFILE_T state;
@@ -1568,7 +2761,7 @@ gzwfile_open(const char *path)
     fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
     if (fd == -1)
         return NULL;
-    state = gzwfile_fdopen(fd);
+    state = gzwfile_fdopen(fd, compression_type);
     if (state == NULL) {
         save_errno = errno;
         ws_close(fd);
@@ -1578,7 +2771,7 @@ gzwfile_open(const char *path)
 }
 
 GZWFILE_T
-gzwfile_fdopen(int fd)
+gzwfile_fdopen(int fd, wtap_compression_type compression_type)
 {
     GZWFILE_T state;
 
@@ -1587,8 +2780,22 @@ gzwfile_fdopen(int fd)
     if (state == NULL)
         return NULL;
     state->fd = fd;
+    state->compression_type = compression_type;
     state->size = 0;            /* no buffers allocated yet */
-    state->want = GZBUFSIZE;    /* requested buffer size */
+    switch (compression_type) {
+
+    case WTAP_GZIP_COMPRESSED:
+        state->want = GZBUFSIZE;
+        break;
+
+    case WTAP_BGZF_COMPRESSED:
+        state->want = BGZF_BLOCK_DATA_SIZE;
+        break;
+
+    default:
+        state->want = FRAME_DATA_SIZE;
+        break;
+    }
 
     state->level = Z_DEFAULT_COMPRESSION;
     state->strategy = Z_DEFAULT_STRATEGY;
@@ -1596,24 +2803,49 @@ gzwfile_fdopen(int fd)
     /* initialize stream */
     state->err = Z_OK;              /* clear error */
     state->pos = 0;                 /* no uncompressed data yet */
+    state->have = 0;                /* no input data yet */
     state->strm.avail_in = 0;       /* no input data yet */
 
     /* return stream */
     return state;
 }
 
-/* Initialize state for writing a gzip file.  Mark initialization by setting
-   state->size to non-zero.  Return -1, and set state->err, on failure;
-   return 0 on success. */
+/* Initialize state for writing a compressed file.  Mark initialization by
+   setting state->size to non-zero.  Return -1, and set state->err, on
+   failure; return 0 on success. */
 static int
 gz_init(GZWFILE_T state)
 {
     int ret;
     z_streamp strm = &(state->strm);
 
-    /* allocate input and output buffers */
+    /* allocate input and output buffers; for a block or frame, the
+       latter is big enough for the input buffer's worth of data
+       compressed */
+    switch (state->compression_type) {
+
+    case WTAP_GZIP_COMPRESSED:
+        state->out_size = state->want;
+        break;
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        state->out_size = ZSTD_compressBound(state->want);
+        break;
+#endif
+
+#ifdef USE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        state->out_size = LZ4F_compressFrameBound(state->want, NULL);
+        break;
+#endif
+
+    default:
+        state->out_size = BGZF_MAX_BLOCK_SIZE;
+        break;
+    }
     state->in = (unsigned char *)g_try_malloc(state->want);
-    state->out = (unsigned char *)g_try_malloc(state->want);
+    state->out = (unsigned char *)g_try_malloc(state->out_size);
     if (state->in == NULL || state->out == NULL) {
         g_free(state->out);
         g_free(state->in);
@@ -1621,12 +2853,35 @@ gz_init(GZWFILE_T state)
         return -1;
     }
 
-    /* allocate deflate memory, set up for gzip compression */
+#ifdef HAVE_ZSTD
+    if (state->compression_type == WTAP_ZSTD_COMPRESSED) {
+        state->zstd_cctx = ZSTD_createCCtx();
+        if (state->zstd_cctx == NULL) {
+            g_free(state->out);
+            g_free(state->in);
+            state->err = ENOMEM;
+            return -1;
+        }
+        state->size = state->want;
+        return 0;
+    }
+#endif
+    if (state->compression_type != WTAP_GZIP_COMPRESSED &&
+        state->compression_type != WTAP_BGZF_COMPRESSED) {
+        /* LZ4 frames need no state kept between them */
+        state->size = state->want;
+        return 0;
+    }
+
+    /* allocate deflate memory, set up for gzip compression, or, for
+       BGZF, raw deflate; we write the gzip header and trailer of each
+       BGZF block ourselves */
     strm->zalloc = Z_NULL;
     strm->zfree = Z_NULL;
     strm->opaque = Z_NULL;
     ret = deflateInit2(strm, state->level, Z_DEFLATED,
-                       15 + 16, 8, state->strategy);
+                       state->compression_type == WTAP_GZIP_COMPRESSED ? 15 + 16 : -15,
+                       8, state->strategy);
     if (ret != Z_OK) {
         g_free(state->out);
         g_free(state->in);
@@ -1712,11 +2967,11 @@ gz_comp(GZWFILE_T state, int flush)
     return 0;
 }
 
-/* Write out len bytes from buf.  Return 0, and set state->err, on
-   failure or on an attempt to write 0 bytes (in which case state->err
-   is Z_OK); return the number of bytes written on success. */
-unsigned
-gzwfile_write(GZWFILE_T state, const void *buf, guint len)
+/* Write out len bytes from buf as part of a gzip stream.  Return 0, and
+   set state->err, on failure; return the number of bytes written on
+   success. */
+static unsigned
+gz_write(GZWFILE_T state, const void *buf, guint len)
 {
     guint put = len;
     guint n;
@@ -1724,18 +2979,6 @@ gzwfile_write(GZWFILE_T state, const void *buf, guint len)
 
     strm = &(state->strm);
 
-    /* check that there's no error */
-    if (state->err != Z_OK)
-        return 0;
-
-    /* if len is zero, avoid unnecessary operations */
-    if (len == 0)
-        return 0;
-
-    /* allocate memory if this is the first time through */
-    if (state->size == 0 && gz_init(state) == -1)
-        return 0;
-
     /* for small len, copy to input buffer, otherwise compress directly */
     if (len < state->size) {
         /* copy to input buffer, compress when full */
@@ -1783,8 +3026,175 @@ DIAG_ON(cast-qual)
     return (int)put;
 }
 
+/* Write a compressed block or frame to the output file.  Return -1, and
+   set state->err, on failure; return 0 on success. */
+static int
+block_write_out(GZWFILE_T state, size_t len)
+{
+    ssize_t got;
+
+    got = ws_write(state->fd, state->out, (unsigned int)len);
+    if (got < 0) {
+        state->err = errno;
+        return -1;
+    }
+    if ((size_t)got != len) {
+        state->err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
+    state->have = 0;
+    return 0;
+}
+
+/* Compress whatever is in the input buffer into a zstd or LZ4 frame, and
+   write it to the output file.  Return -1, and set state->err, on failure;
+   return 0 on success. */
+static int
+frame_comp(GZWFILE_T state)
+{
+    size_t len;
+
+    switch (state->compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        len = ZSTD_compressCCtx(state->zstd_cctx, state->out, state->out_size,
+                                state->in, state->have, ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(len)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        break;
+#endif
+
+#ifdef USE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        len = LZ4F_compressFrame(state->out, state->out_size,
+                                 state->in, state->have, NULL);
+        if (LZ4F_isError(len)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        break;
+#endif
+
+    default:
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    return block_write_out(state, len);
+}
+
+/* Compress whatever is in the input buffer into a BGZF block, or a zstd
+   or LZ4 frame, and write it to the output file.  Return -1, and set
+   state->err, if there is an error writing to the output file; return 0
+   on success.  An empty input buffer gives an empty block, which is
+   what BGZF files end with. */
+static int
+block_comp(GZWFILE_T state)
+{
+    int ret;
+    guint bsize;
+    guint32 crc;
+    z_streamp strm = &(state->strm);
+    unsigned char *out;
+
+    /* allocate memory if this is the first time through */
+    if (state->size == 0 && gz_init(state) == -1)
+        return -1;
+    if (state->compression_type != WTAP_BGZF_COMPRESSED)
+        return frame_comp(state);
+    out = state->out;
+
+    /* compress the block; BGZF_BLOCK_DATA_SIZE is chosen so that even
+       incompressible data fits */
+    deflateReset(strm);
+    strm->next_in = state->in;
+    strm->avail_in = state->have;
+    strm->next_out = out + BGZF_HEADER_SIZE;
+    strm->avail_out = BGZF_MAX_BLOCK_SIZE - BGZF_HEADER_SIZE - BGZF_TRAILER_SIZE;
+    ret = deflate(strm, Z_FINISH);
+    if (ret != Z_STREAM_END) {
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    bsize = (guint)(strm->next_out - out) + BGZF_TRAILER_SIZE;
+
+    /* gzip header, with the BC extra subfield giving the block size */
+    out[0] = 31;                /* ID1 */
+    out[1] = 139;               /* ID2 */
+    out[2] = 8;                 /* CM = deflate */
+    out[3] = 4;                 /* FLG = FEXTRA */
+    phtolel(&out[4], 0);        /* MTIME */
+    out[8] = 0;                 /* XFL */
+    out[9] = 255;               /* OS = unknown */
+    phtoles(&out[10], 6);       /* XLEN */
+    out[12] = 'B';              /* SI1 */
+    out[13] = 'C';              /* SI2 */
+    phtoles(&out[14], 2);       /* SLEN */
+    phtoles(&out[16], bsize - 1);
+
+    /* gzip trailer */
+    crc = (guint32)crc32(0L, state->in, state->have);
+    phtolel(&out[bsize - 8], crc);
+    phtolel(&out[bsize - 4], state->have);
+
+    return block_write_out(state, bsize);
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is Z_OK); return the number of bytes written on success. */
+unsigned
+gzwfile_write(GZWFILE_T state, const void *buf, guint len)
+{
+    guint put = len;
+    guint n;
+
+    /* check that there's no error */
+    if (state->err != Z_OK)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    /* allocate memory if this is the first time through */
+    if (state->size == 0 && gz_init(state) == -1)
+        return 0;
+
+    if (state->compression_type == WTAP_GZIP_COMPRESSED)
+        return gz_write(state, buf, len);
+
+    /* copy to input buffer, compress a block or frame when full */
+    do {
+        n = state->size - state->have;
+        if (n > len)
+            n = len;
+        memcpy(state->in + state->have, buf, n);
+        state->have += n;
+        state->pos += n;
+        buf = (const char *)buf + n;
+        len -= n;
+        if (state->have == state->size && block_comp(state) == -1)
+            return 0;
+    } while (len);
+
+    /* input was all buffered or compressed (put will fit in int) */
+    return (int)put;
+}
+
 /* Flush out what we've written so far.  Returns -1, and sets state->err,
-   on failure; returns 0 on success. */
+   on failure; returns 0 on success.
+
+   A reader can only decompress whole BGZF blocks and zstd and LZ4
+   frames, so, for those, this ends the current one early; a writer
+   that flushes after every record should write plain gzip, which
+   flushes within the one deflate stream. */
 int
 gzwfile_flush(GZWFILE_T state)
 {
@@ -1792,8 +3202,14 @@ gzwfile_flush(GZWFILE_T state)
     if (state->err != Z_OK)
         return -1;
 
-    /* compress remaining data with Z_SYNC_FLUSH */
-    gz_comp(state, Z_SYNC_FLUSH);
+    if (state->compression_type == WTAP_GZIP_COMPRESSED) {
+        /* compress remaining data with Z_SYNC_FLUSH */
+        gz_comp(state, Z_SYNC_FLUSH);
+    } else {
+        /* compress remaining data into a block or frame of its own */
+        if (state->have != 0)
+            block_comp(state);
+    }
     if (state->err != Z_OK)
         return -1;
     return 0;
@@ -1806,12 +3222,29 @@ gzwfile_close(GZWFILE_T state)
 {
     int ret = 0;
 
-    /* flush, free memory, and close file */
-    if (gz_comp(state, Z_FINISH) == -1 && ret == 0)
-        ret = state->err;
-    (void)deflateEnd(&(state->strm));
-    g_free(state->out);
-    g_free(state->in);
+    /* flush, write the empty end-of-file block if it's BGZF, free
+       memory, and close file */
+    if (state->compression_type == WTAP_GZIP_COMPRESSED) {
+        if (gz_comp(state, Z_FINISH) == -1)
+            ret = state->err;
+    } else {
+        if (state->have != 0 && block_comp(state) == -1)
+            ret = state->err;
+        if (ret == 0 && state->compression_type == WTAP_BGZF_COMPRESSED &&
+            block_comp(state) == -1)
+            ret = state->err;
+    }
+    if (state->size != 0) {
+        if (state->compression_type == WTAP_GZIP_COMPRESSED ||
+            state->compression_type == WTAP_BGZF_COMPRESSED)
+            (void)deflateEnd(&(state->strm));
+#ifdef HAVE_ZSTD
+        if (state->compression_type == WTAP_ZSTD_COMPRESSED)
+            ZSTD_freeCCtx(state->zstd_cctx);
+#endif
+        g_free(state->out);
+        g_free(state->in);
+    }
     state->err = Z_OK;
     if (ws_close(state->fd) == -1 && ret == 0)
         ret = errno;
@@ -16,10 +16,13 @@
 
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
+extern void file_set_read_ahead(FILE_T stream);
 extern void file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek);
+extern gsize file_fast_seek_point_size(void);
+extern gboolean file_fast_seek_points_valid(const guint8 *points, guint32 count);
 WS_DLL_PUBLIC gint64 file_seek(FILE_T stream, gint64 offset, int whence, int *err);
 WS_DLL_PUBLIC gint64 file_tell(FILE_T stream);
-extern gint64 file_tell_raw(FILE_T stream);
+WS_DLL_PUBLIC gint64 file_tell_raw(FILE_T stream);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 WS_DLL_PUBLIC gboolean file_iscompressed(FILE_T stream);
 WS_DLL_PUBLIC int file_read(void *buf, unsigned int count, FILE_T file);
@@ -36,8 +39,8 @@ extern void file_close(FILE_T file);
 #ifdef HAVE_ZLIB
 typedef struct wtap_writer *GZWFILE_T;
 
-extern GZWFILE_T gzwfile_open(const char *path);
-extern GZWFILE_T gzwfile_fdopen(int fd);
+extern GZWFILE_T gzwfile_open(const char *path, wtap_compression_type compression_type);
+extern GZWFILE_T gzwfile_fdopen(int fd, wtap_compression_type compression_type);
 extern guint gzwfile_write(GZWFILE_T state, const void *buf, guint len);
 extern int gzwfile_flush(GZWFILE_T state);
 extern int gzwfile_close(GZWFILE_T state);
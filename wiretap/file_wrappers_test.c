@@ -0,0 +1,234 @@
+/* file_wrappers_test.c
+ * Tests for random access to capture files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#ifdef HAVE_MMAP
+#include <unistd.h>
+#endif
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+
+#include <wsutil/file_util.h>
+
+#define RECORD_LEN      1000
+#define RECORD_OFFSET(i) (24 + (gint64)(i) * (16 + RECORD_LEN))
+
+/* Append records first through last - 1 to a pcap file */
+static void
+write_records(FILE *fp, guint32 first, guint32 last)
+{
+    guint32 hdr[4];
+    guint8 data[RECORD_LEN];
+    guint32 i;
+
+    for (i = first; i < last; i++) {
+        hdr[0] = i;             /* ts_sec */
+        hdr[1] = 0;             /* ts_usec */
+        hdr[2] = RECORD_LEN;    /* incl_len */
+        hdr[3] = RECORD_LEN;    /* orig_len */
+        memset(data, i & 0xff, sizeof data);
+        g_assert_cmpuint(fwrite(hdr, sizeof hdr, 1, fp), ==, 1);
+        g_assert_cmpuint(fwrite(data, sizeof data, 1, fp), ==, 1);
+    }
+}
+
+/* Create a pcap file with records 0 through count - 1 */
+static gchar *
+create_file(guint32 count)
+{
+    struct {
+        guint32 magic;
+        guint16 version_major;
+        guint16 version_minor;
+        gint32  thiszone;
+        guint32 sigfigs;
+        guint32 snaplen;
+        guint32 network;
+    } file_hdr = { 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1 };  /* in host byte order */
+    gchar *path;
+    FILE *fp;
+    int fd;
+
+    fd = g_file_open_tmp("file_wrappers_test-XXXXXX.pcap", &path, NULL);
+    g_assert_cmpint(fd, !=, -1);
+    fp = ws_fdopen(fd, "wb");
+    g_assert_nonnull(fp);
+    g_assert_cmpuint(fwrite(&file_hdr, sizeof file_hdr, 1, fp), ==, 1);
+    write_records(fp, 0, count);
+    g_assert_cmpint(fclose(fp), ==, 0);
+    return path;
+}
+
+/*
+ * Read record i at random, and check that it's the right record and
+ * that the random stream's raw position is after its current position,
+ * and, if it's mapped, just past the mapped data: the end of the file.
+ */
+static void
+check_seek_read(wtap *wth, guint32 i, gint64 file_size, gboolean mapped)
+{
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info;
+    gint64 raw_pos;
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, RECORD_LEN);
+    g_assert_true(wtap_seek_read(wth, RECORD_OFFSET(i), &rec, &buf, &err, &err_info));
+    g_assert_cmpuint(rec.rec_header.packet_header.caplen, ==, RECORD_LEN);
+    g_assert_cmpuint(ws_buffer_start_ptr(&buf)[0], ==, i & 0xff);
+    g_assert_cmpuint(ws_buffer_start_ptr(&buf)[RECORD_LEN - 1], ==, i & 0xff);
+
+    raw_pos = file_tell_raw(wth->random_fh);
+    g_assert_cmpint(raw_pos, >=, file_tell(wth->random_fh));
+    g_assert_cmpint(raw_pos, <=, file_size);
+#ifdef HAVE_MMAP
+    if (mapped)
+        g_assert_cmpint(raw_pos, ==, file_size);
+#else
+    (void)mapped;
+#endif
+
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+}
+
+/* Records are read in any order, backwards and forwards */
+static void
+test_file_wrappers_random(void)
+{
+    static const guint32 order[] = { 0, 999, 500, 10, 998, 1, 500, 501, 0 };
+    gchar *path;
+    wtap *wth;
+    int err;
+    gchar *err_info;
+    guint i;
+
+    path = create_file(1000);
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert_nonnull(wth);
+
+    for (i = 0; i < G_N_ELEMENTS(order); i++)
+        check_seek_read(wth, order[i], RECORD_OFFSET(1000), TRUE);
+
+    wtap_close(wth);
+    ws_unlink(path);
+    g_free(path);
+}
+
+/* Records added to the file after it's opened can be read */
+static void
+test_file_wrappers_grow(void)
+{
+    gchar *path;
+    wtap *wth;
+    FILE *fp;
+    int err;
+    gchar *err_info;
+
+    path = create_file(100);
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert_nonnull(wth);
+    check_seek_read(wth, 50, RECORD_OFFSET(100), TRUE);
+
+    fp = ws_fopen(path, "ab");
+    g_assert_nonnull(fp);
+    write_records(fp, 100, 200);
+    g_assert_cmpint(fclose(fp), ==, 0);
+
+    check_seek_read(wth, 150, RECORD_OFFSET(200), TRUE);
+    check_seek_read(wth, 99, RECORD_OFFSET(200), TRUE);
+    check_seek_read(wth, 199, RECORD_OFFSET(200), TRUE);
+
+    wtap_close(wth);
+    ws_unlink(path);
+    g_free(path);
+}
+
+#ifdef HAVE_MMAP
+/*
+ * Records cut off the end of the file after it's mapped can't be read,
+ * but trying doesn't touch the pages past the new end, which would
+ * raise SIGBUS, and the records that are left can still be read.
+ */
+static void
+test_file_wrappers_truncate(void)
+{
+    gchar *path;
+    wtap *wth;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info = NULL;
+
+    path = create_file(1000);
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert_nonnull(wth);
+    check_seek_read(wth, 900, RECORD_OFFSET(1000), TRUE);
+
+    g_assert_cmpint(truncate(path, RECORD_OFFSET(500)), ==, 0);
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, RECORD_LEN);
+    g_assert_false(wtap_seek_read(wth, RECORD_OFFSET(900), &rec, &buf, &err, &err_info));
+    g_free(err_info);
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+
+    check_seek_read(wth, 499, RECORD_OFFSET(500), FALSE);
+    check_seek_read(wth, 0, RECORD_OFFSET(500), FALSE);
+
+    wtap_close(wth);
+    ws_unlink(path);
+    g_free(path);
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/wiretap/file_wrappers/random", test_file_wrappers_random);
+    g_test_add_func("/wiretap/file_wrappers/grow", test_file_wrappers_grow);
+#ifdef HAVE_MMAP
+    g_test_add_func("/wiretap/file_wrappers/truncate", test_file_wrappers_truncate);
+#endif
+
+    wtap_init(FALSE);
+
+    result = g_test_run();
+
+    wtap_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -201,21 +201,105 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * The files that have a record available, kept as a binary min-heap,
+ * so that, when merging many files, finding the one with the earliest
+ * record takes O(log N) comparisons rather than O(N).
+ */
+typedef struct {
+    int         *files;     /* indices into in_files[] */
+    int          count;     /* number of files in the heap */
+    gboolean     filled;    /* TRUE once we've read a record from every file */
+} merge_heap_t;
+
+/*
+ * Returns TRUE if the record available from in_files[a] should be
+ * written before the one from in_files[b].
+ *
+ * Records with no time stamp are treated as earlier than all other
+ * records.  Yes, this means you won't get a chronological merge of
+ * those records, but you obviously *can't* get that.  Of two of them,
+ * the one from the earlier file goes first; of two records with the
+ * same time stamp, the one from the later file goes first, as it did
+ * when we picked records by scanning all the files.
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_heap_is_earlier(merge_in_file_t in_files[], int a, int b)
 {
-    if (l->secs > r->secs) {  /* left is later */
-        return FALSE;
-    } else if (l->secs < r->secs) { /* left is earlier */
+    wtap_rec *rec_a = wtap_get_rec(in_files[a].wth);
+    wtap_rec *rec_b = wtap_get_rec(in_files[b].wth);
+    int cmp;
+
+    if (!(rec_a->presence_flags & WTAP_HAS_TS)) {
+        if (!(rec_b->presence_flags & WTAP_HAS_TS))
+            return a < b;
         return TRUE;
-    } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
+    }
+    if (!(rec_b->presence_flags & WTAP_HAS_TS))
         return FALSE;
+    cmp = nstime_cmp(&rec_a->ts, &rec_b->ts);
+    if (cmp == 0)
+        return a > b;
+    return cmp < 0;
+}
+
+/* Move the file at position pos in the heap up to where it belongs. */
+static void
+merge_heap_sift_up(merge_heap_t *heap, merge_in_file_t in_files[], int pos)
+{
+    int file = heap->files[pos];
+
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+
+        if (!merge_heap_is_earlier(in_files, file, heap->files[parent]))
+            break;
+        heap->files[pos] = heap->files[parent];
+        pos = parent;
     }
-    /* either one < two or one == two
-     * either way, return one
-     */
+    heap->files[pos] = file;
+}
+
+/* Move the file at position pos in the heap down to where it belongs. */
+static void
+merge_heap_sift_down(merge_heap_t *heap, merge_in_file_t in_files[], int pos)
+{
+    int file = heap->files[pos];
+
+    for (;;) {
+        int child = 2 * pos + 1;
+
+        if (child >= heap->count)
+            break;
+        if (child + 1 < heap->count &&
+            merge_heap_is_earlier(in_files, heap->files[child + 1], heap->files[child]))
+            child++;
+        if (!merge_heap_is_earlier(in_files, heap->files[child], file))
+            break;
+        heap->files[pos] = heap->files[child];
+        pos = child;
+    }
+    heap->files[pos] = file;
+}
+
+/*
+ * Read the next record from in_file, if it needs one.  Returns FALSE,
+ * with *err set, on a read error.
+ */
+static gboolean
+merge_read_next(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+    gint64 data_offset;
+
+    if (in_file->state != RECORD_NOT_PRESENT)
+        return TRUE;
+    if (!wtap_read(in_file->wth, err, err_info, &data_offset)) {
+        if (*err != 0) {
+            in_file->state = GOT_ERROR;
+            return FALSE;
+        }
+        in_file->state = AT_EOF;
+    } else
+        in_file->state = RECORD_PRESENT;
     return TRUE;
 }
 
@@ -233,6 +317,7 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  *
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
+ * @param heap heap of files with a record available
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -241,64 +326,49 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  */
 static merge_in_file_t *
 merge_read_packet(int in_file_count, merge_in_file_t in_files[],
-                  int *err, gchar **err_info)
+                  merge_heap_t *heap, int *err, gchar **err_info)
 {
     int i;
-    int ei = -1;
-    nstime_t tv = { sizeof(time_t) > sizeof(int) ? LONG_MAX : INT_MAX, INT_MAX };
-    wtap_rec *rec;
+    int ei;
 
-    /*
-     * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
-     */
-    for (i = 0; i < in_file_count; i++) {
-        gint64 data_offset;
-
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, err, err_info, &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
-        }
-
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = wtap_get_rec(in_files[i].wth);
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
-                break;
-            }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
+    if (!heap->filled) {
+        /*
+         * First time through; get a record from each file, and put
+         * the ones that have one into the heap.
+         */
+        for (i = 0; i < in_file_count; i++) {
+            if (!merge_read_next(&in_files[i], err, err_info))
+                return &in_files[i];
+            if (in_files[i].state == RECORD_PRESENT) {
+                heap->files[heap->count] = i;
+                merge_heap_sift_up(heap, in_files, heap->count);
+                heap->count++;
             }
         }
+        heap->filled = TRUE;
+    } else if (heap->count != 0) {
+        /*
+         * The file at the top of the heap is the one we returned the
+         * last record from; read its next record, and put it back
+         * where it now belongs, or drop it if it's at EOF.
+         */
+        ei = heap->files[0];
+        if (!merge_read_next(&in_files[ei], err, err_info))
+            return &in_files[ei];
+        if (in_files[ei].state == AT_EOF) {
+            heap->count--;
+            heap->files[0] = heap->files[heap->count];
+        }
+        if (heap->count != 0)
+            merge_heap_sift_down(heap, in_files, 0);
     }
 
-    if (ei == -1) {
+    if (heap->count == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
     }
+    ei = heap->files[0];
 
     /* We'll need to read another packet from this file. */
     in_files[ei].state = RECORD_NOT_PRESENT;
@@ -825,6 +895,11 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     int                 count = 0;
     gboolean            stop_flag = FALSE;
     wtap_rec *rec,      snap_rec;
+    merge_heap_t        heap;
+
+    heap.files = g_new(int, in_file_count);
+    heap.count = 0;
+    heap.filled = FALSE;
 
     for (;;) {
         *err = 0;
@@ -834,7 +909,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                                                err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
+            in_file = merge_read_packet(in_file_count, in_files, &heap, err,
                                         err_info);
         }
 
@@ -903,6 +978,8 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         }
     }
 
+    g_free(heap.files);
+
     if (cb)
         cb->callback_func(MERGE_EVENT_DONE, count, in_files, in_file_count, cb->data);
 
@@ -1001,12 +1078,12 @@ merge_files(const gchar* out_filename, const int file_type,
         merge_debug("merge_files: IDB merge operation complete, got %u IDBs", idb_inf ? idb_inf->interface_data->len : 0);
 
         pdh = wtap_dump_open_ng(out_filename, file_type, frame_type, snaplen,
-                                FALSE /* compressed */, shb_hdrs, idb_inf,
+                                WTAP_UNCOMPRESSED, shb_hdrs, idb_inf,
                                 NULL, err);
     }
     else {
         pdh = wtap_dump_open(out_filename, file_type, frame_type, snaplen,
-                             FALSE /* compressed */, err);
+                             WTAP_UNCOMPRESSED, err);
     }
 
     if (pdh == NULL) {
@@ -1105,12 +1182,12 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
 
         pdh = wtap_dump_open_tempfile_ng(out_filenamep, pfx, file_type,
                                          frame_type, snaplen,
-                                         FALSE /* compressed */,
+                                         WTAP_UNCOMPRESSED,
                                          shb_hdrs, idb_inf, NULL, err);
     }
     else {
         pdh = wtap_dump_open_tempfile(out_filenamep, pfx, file_type, frame_type,
-                                      snaplen, FALSE /* compressed */, err);
+                                      snaplen, WTAP_UNCOMPRESSED, err);
     }
 
     if (pdh == NULL) {
@@ -1203,12 +1280,12 @@ merge_files_to_stdout(const int file_type, const char *const *in_filenames,
         merge_debug("merge_files: IDB merge operation complete, got %u IDBs", idb_inf ? idb_inf->interface_data->len : 0);
 
         pdh = wtap_dump_open_stdout_ng(file_type, frame_type, snaplen,
-                                       FALSE /* compressed */, shb_hdrs,
+                                       WTAP_UNCOMPRESSED, shb_hdrs,
                                        idb_inf, NULL, err);
     }
     else {
         pdh = wtap_dump_open_stdout(file_type, frame_type, snaplen,
-                                    FALSE /* compressed */, err);
+                                    WTAP_UNCOMPRESSED, err);
     }
 
     if (pdh == NULL) {
@@ -1157,6 +1157,53 @@ g_fast_seek_item_free(gpointer data, gpointer user_data _U_)
 	g_free(data);
 }
 
+void
+wtap_set_read_ahead(wtap *wth)
+{
+	if (wth->fh != NULL)
+		file_set_read_ahead(wth->fh);
+}
+
+guint8 *
+wtap_get_fast_seek_points(wtap *wth, guint32 *size, guint32 *count)
+{
+	gsize point_size = file_fast_seek_point_size();
+	guint8 *points;
+	guint i;
+
+	*size = (guint32)point_size;
+	*count = 0;
+	if (wth->fast_seek == NULL || wth->fast_seek->len == 0)
+		return NULL;
+
+	points = (guint8 *)g_malloc(point_size * wth->fast_seek->len);
+	for (i = 0; i < wth->fast_seek->len; i++)
+		memcpy(points + i * point_size, wth->fast_seek->pdata[i], point_size);
+	*count = wth->fast_seek->len;
+	return points;
+}
+
+gboolean
+wtap_set_fast_seek_points(wtap *wth, const guint8 *points, guint32 size,
+    guint32 count)
+{
+	guint32 i;
+
+	if (wth->fast_seek == NULL || size != file_fast_seek_point_size() ||
+	    !file_fast_seek_points_valid(points, count))
+		return FALSE;
+
+	/*
+	 * The random stream shares the array, and finds points in it as
+	 * it seeks, so replace its contents rather than the array.
+	 */
+	g_ptr_array_foreach(wth->fast_seek, g_fast_seek_item_free, NULL);
+	g_ptr_array_set_size(wth->fast_seek, 0);
+	for (i = 0; i < count; i++)
+		g_ptr_array_add(wth->fast_seek, g_memdup(points + (gsize)i * size, (guint)size));
+	return TRUE;
+}
+
 /*
  * Close the file descriptors for the sequential and random streams, but
  * don't discard any information about those streams.  Used on Windows if
@@ -1785,6 +1785,49 @@ wtap_block_t wtap_file_get_nrb(wtap *wth);
 WS_DLL_PUBLIC
 GArray* wtap_file_get_nrb_for_new_file(wtap *wth);
 
+/**
+ * Read the file ahead of the sequential side, several large reads at a
+ * time, on other threads, so that reading overlaps with processing the
+ * records already read.  Worth it for a large file on slow storage that's
+ * read from start to end; it has no effect on pipes.
+ *
+ * @param wth The wiretap session.
+ */
+WS_DLL_PUBLIC
+void wtap_set_read_ahead(wtap *wth);
+
+/**
+ * Get the fast seek points that reading a compressed file has gathered
+ * so far, so that they can be saved and given to
+ * wtap_set_fast_seek_points() when the same file is opened again,
+ * rather than having to read through it to gather them again.  They're
+ * in host byte order, and are only meaningful to the same build of
+ * wiretap.
+ *
+ * @param wth The wiretap session.
+ * @param size Set to the size of each point.
+ * @param count Set to the number of points.
+ * @return The points, to be freed with g_free(), or NULL if there are none.
+ */
+WS_DLL_PUBLIC
+guint8 *wtap_get_fast_seek_points(wtap *wth, guint32 *size, guint32 *count);
+
+/**
+ * Replace the fast seek points of a file just opened with ones saved by
+ * wtap_get_fast_seek_points(), so that random access to it doesn't have
+ * to decompress it from the start.
+ *
+ * @param wth The wiretap session.
+ * @param points The points.
+ * @param size The size of each point.
+ * @param count The number of points.
+ * @return FALSE, leaving the file's points as they were, if the points
+ * aren't ones that this build of wiretap could have gathered.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_set_fast_seek_points(wtap *wth, const guint8 *points,
+    guint32 size, guint32 count);
+
 /*** close the file descriptors for the current file ***/
 WS_DLL_PUBLIC
 void wtap_fdclose(wtap *wth);
@@ -1812,6 +1855,17 @@ gboolean wtap_dump_can_open(int filetype);
 WS_DLL_PUBLIC
 int wtap_dump_file_encap_type(const GArray *file_encaps);
 
+/**
+ * Types of compression for a file, including "none".
+ */
+typedef enum {
+    WTAP_UNCOMPRESSED,
+    WTAP_GZIP_COMPRESSED,
+    WTAP_ZSTD_COMPRESSED,
+    WTAP_LZ4_COMPRESSED,
+    WTAP_BGZF_COMPRESSED    /* gzip as independent blocks, for parallel and random access */
+} wtap_compression_type;
+
 /**
  * Return TRUE if we can write this capture file format out in
  * compressed form, FALSE if not.
@@ -1819,6 +1873,28 @@ int wtap_dump_file_encap_type(const GArray *file_encaps);
 WS_DLL_PUBLIC
 gboolean wtap_dump_can_compress(int filetype);
 
+/**
+ * Return TRUE if we can write files compressed with this type of
+ * compression, FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_can_write_compression_type(wtap_compression_type compression_type);
+
+/**
+ * Look up a type of compression by its short name, e.g. "gzip" or "zstd".
+ * Return TRUE, and set *compression_typep, if we know of it, FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_name_to_compression_type(const char *name,
+    wtap_compression_type *compression_typep);
+
+/**
+ * Return a list of the short names of the types of compression we can
+ * write; free it with g_slist_free().
+ */
+WS_DLL_PUBLIC
+GSList *wtap_get_all_output_compression_type_names_list(void);
+
 /**
  * Return TRUE if this capture file format supports storing name
  * resolution information in it, FALSE if not.
@@ -1835,7 +1911,7 @@ gboolean wtap_dump_supports_comment_types(int filetype, guint32 comment_types);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int encap,
-    int snaplen, gboolean compressed, int *err);
+    int snaplen, wtap_compression_type compression_type, int *err);
 
 /**
  * @brief Opens a new capture file for writing.
@@ -1848,7 +1924,7 @@ wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int enc
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use when writing, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1857,12 +1933,12 @@ wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int enc
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
-    int snaplen, gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+    int snaplen, wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
     GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_tempfile(char **filenamep, const char *pfx,
-    int file_type_subtype, int encap, int snaplen, gboolean compressed,
+    int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
     int *err);
 
 /**
@@ -1878,7 +1954,7 @@ wtap_dumper* wtap_dump_open_tempfile(char **filenamep, const char *pfx,
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use when writing, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1887,13 +1963,13 @@ wtap_dumper* wtap_dump_open_tempfile(char **filenamep, const char *pfx,
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
-    int file_type_subtype, int encap, int snaplen, gboolean compressed,
+    int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
     GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
     GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snaplen,
-    gboolean compressed, int *err);
+    wtap_compression_type compression_type, int *err);
 
 /**
  * @brief Creates a dumper for an existing file descriptor.
@@ -1906,7 +1982,7 @@ wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snap
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use when writing, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1915,12 +1991,12 @@ wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snap
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
-                gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+                wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
                 GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen,
-    gboolean compressed, int *err);
+    wtap_compression_type compression_type, int *err);
 
 /**
  * @brief Creates a dumper for the standard output.
@@ -1932,7 +2008,7 @@ wtap_dumper* wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use when writing, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1941,7 +2017,7 @@ wtap_dumper* wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
-                gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+                wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
                 GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
@@ -0,0 +1,499 @@
+/* bulkwrite.c
+ * Our routines for writing capture files in large chunks, optionally
+ * bypassing the page cache.
+ *
+ * Capture files are written a few bytes at a time, with several fwrite()
+ * calls per packet; here we give the stream a buffer big enough that
+ * the file is written in large chunks, so that writing takes far fewer
+ * system calls.
+ *
+ * With O_DIRECT, the chunks go straight to the device, rather than piling
+ * up in the page cache until the kernel writes them all back at once,
+ * which can hold up the capture for long enough to drop packets.
+ *
+ * Files can also be compressed as they're written, with zstd or LZ4.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+/*
+ * Required with GNU libc to get fopencookie(), O_DIRECT, and
+ * fallocate().
+ */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#ifdef HAVE_DIRECT_IO
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#include <glib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#if defined(HAVE_LZ4) && defined(HAVE_LZ4FRAME_H)
+#define USE_LZ4
+#include <lz4frame.h>
+#endif
+
+#include <wsutil/file_util.h>
+
+#include "bulkwrite.h"
+
+#if defined(HAVE_FOPENCOOKIE) && (defined(HAVE_ZSTD) || defined(USE_LZ4))
+#define HAVE_COMPRESSED_WRITE
+#endif
+
+#ifdef HAVE_DIRECT_IO
+/*
+ * O_DIRECT writes have to start at a file offset and a memory address
+ * that are multiples of the file system's block size, and be a multiple
+ * of it long; this is a multiple of the block size of every file system
+ * we're likely to see.
+ */
+#define BULKWRITE_ALIGN         4096
+
+typedef struct {
+        int      fd;
+        gboolean preallocated;  /* space past the end of the file was allocated */
+        guint8  *buf;           /* BULKWRITE_ALIGN-aligned */
+        size_t   buf_size;
+        size_t   buf_used;
+        off_t    offset;        /* file offset of the start of the buffer */
+} bulkwrite_t;
+
+/* Write out the first "len" bytes of the buffer */
+static gboolean
+bulkwrite_flush(bulkwrite_t *bw, size_t len)
+{
+        size_t  done = 0;
+        ssize_t nwritten;
+
+        while (done < len) {
+                nwritten = pwrite(bw->fd, bw->buf + done, len - done,
+                                  bw->offset + (off_t)done);
+                if (nwritten == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        return FALSE;
+                }
+                if (nwritten == 0) {
+                        errno = ENOSPC;
+                        return FALSE;
+                }
+                done += (size_t)nwritten;
+        }
+
+        bw->offset += (off_t)len;
+        bw->buf_used -= len;
+        memmove(bw->buf, bw->buf + len, bw->buf_used);
+        return TRUE;
+}
+
+/*
+ * stdio hands us what's in its buffer when the buffer fills up or the
+ * stream is flushed; we write out all the whole blocks of it, and keep
+ * the rest for next time.
+ */
+static ssize_t
+bulkwrite_write(void *cookie, const char *data, size_t size)
+{
+        bulkwrite_t *bw = (bulkwrite_t *)cookie;
+        size_t       copied = 0;
+        size_t       chunk;
+        size_t       len;
+
+        while (copied < size) {
+                chunk = MIN(size - copied, bw->buf_size - bw->buf_used);
+                memcpy(bw->buf + bw->buf_used, data + copied, chunk);
+                bw->buf_used += chunk;
+                copied += chunk;
+
+                len = bw->buf_used & ~(size_t)(BULKWRITE_ALIGN - 1);
+                if (len > 0 && !bulkwrite_flush(bw, len))
+                        return -1;
+        }
+        return (ssize_t)size;
+}
+
+static int
+bulkwrite_close(void *cookie)
+{
+        bulkwrite_t *bw = (bulkwrite_t *)cookie;
+        int          flags;
+        int          err = 0;
+
+        /* The last block is only partly filled, so it can't go through O_DIRECT */
+        if (bw->buf_used > 0) {
+                flags = fcntl(bw->fd, F_GETFL);
+                if (flags == -1 || fcntl(bw->fd, F_SETFL, flags & ~O_DIRECT) == -1 ||
+                    !bulkwrite_flush(bw, bw->buf_used))
+                        err = errno;
+        }
+
+        /* Give back the space we allocated but didn't use */
+        if (err == 0 && bw->preallocated && ftruncate(bw->fd, bw->offset) == -1)
+                err = errno;
+
+        if (ws_close(bw->fd) == -1 && err == 0)
+                err = errno;
+        free(bw->buf);
+        g_free(bw);
+
+        if (err != 0) {
+                errno = err;
+                return -1;
+        }
+        return 0;
+}
+
+static const cookie_io_functions_t bulkwrite_io_functions = {
+        NULL,                   /* read */
+        bulkwrite_write,
+        NULL,                   /* seek */
+        bulkwrite_close
+};
+
+/*
+ * Turn on O_DIRECT for a file, if it's a regular file, we're at a
+ * suitable offset in it, and its file system supports O_DIRECT.
+ */
+static gboolean
+bulkwrite_set_direct(int fd, off_t *offset)
+{
+        struct stat statb;
+        int         flags;
+
+        if (fstat(fd, &statb) == -1 || !S_ISREG(statb.st_mode))
+                return FALSE;
+        *offset = lseek(fd, 0, SEEK_CUR);
+        if (*offset == -1 || *offset % BULKWRITE_ALIGN != 0)
+                return FALSE;
+        flags = fcntl(fd, F_GETFL);
+        if (flags == -1 || fcntl(fd, F_SETFL, flags | O_DIRECT) == -1)
+                return FALSE;
+        return TRUE;
+}
+
+static FILE *
+bulkwrite_fdopen_direct(int fd, off_t offset, gint64 prealloc_size, int *err)
+{
+        bulkwrite_t *bw;
+        void        *buf;
+        FILE        *fh;
+
+        /* Room for a whole buffer's worth on top of the partial block kept back */
+        *err = posix_memalign(&buf, BULKWRITE_ALIGN, BULKWRITE_BUFFER_SIZE + BULKWRITE_ALIGN);
+        if (*err != 0)
+                return NULL;
+
+        bw = g_new0(bulkwrite_t, 1);
+        bw->fd = fd;
+        bw->buf = (guint8 *)buf;
+        bw->buf_size = BULKWRITE_BUFFER_SIZE + BULKWRITE_ALIGN;
+        bw->offset = offset;
+
+        fh = fopencookie(bw, "wb", bulkwrite_io_functions);
+        if (fh == NULL) {
+                *err = errno;
+                free(buf);
+                g_free(bw);
+                return NULL;
+        }
+        setvbuf(fh, NULL, _IOFBF, BULKWRITE_BUFFER_SIZE);
+
+        /*
+         * Allocating the space up front keeps the file from being
+         * fragmented, and the file system from having to allocate space
+         * while we're writing; it's not worth failing over.
+         */
+        if (prealloc_size > 0 &&
+            fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, (off_t)prealloc_size) == 0)
+                bw->preallocated = TRUE;
+
+        return fh;
+}
+#endif /* HAVE_DIRECT_IO */
+
+#ifdef HAVE_COMPRESSED_WRITE
+/*
+ * zstd's fastest level; the data is compressed as it's captured, so
+ * keeping up matters more than the last few percent of the file size.
+ */
+#define BULKWRITE_ZSTD_LEVEL    1
+
+/*
+ * A compressed file is a sequence of zstd or LZ4 frames, each holding
+ * BULKWRITE_BUFFER_SIZE bytes of the capture file, as wiretap writes
+ * them, so that it can be read randomly as well as by the standard
+ * tools.
+ */
+typedef struct {
+        int                     fd;
+        wtap_compression_type   compression_type;
+        guint8                 *in;            /* data for the next frame */
+        size_t                  in_used;
+        guint8                 *out;           /* the compressed frame */
+        size_t                  out_size;
+#ifdef HAVE_ZSTD
+        ZSTD_CCtx              *zstd_cctx;
+#endif
+} compresswrite_t;
+
+/* Compress what's in the input buffer into a frame, and write it out */
+static gboolean
+compresswrite_flush(compresswrite_t *cw)
+{
+        size_t  len;
+        size_t  done = 0;
+        ssize_t nwritten;
+
+        switch (cw->compression_type) {
+
+#ifdef HAVE_ZSTD
+        case WTAP_ZSTD_COMPRESSED:
+                len = ZSTD_compressCCtx(cw->zstd_cctx, cw->out, cw->out_size,
+                                        cw->in, cw->in_used, BULKWRITE_ZSTD_LEVEL);
+                if (ZSTD_isError(len)) {
+                        /* This "shouldn't happen". */
+                        errno = EINVAL;
+                        return FALSE;
+                }
+                break;
+#endif
+
+#ifdef USE_LZ4
+        case WTAP_LZ4_COMPRESSED:
+                len = LZ4F_compressFrame(cw->out, cw->out_size,
+                                         cw->in, cw->in_used, NULL);
+                if (LZ4F_isError(len)) {
+                        /* This "shouldn't happen". */
+                        errno = EINVAL;
+                        return FALSE;
+                }
+                break;
+#endif
+
+        default:
+                /* This "shouldn't happen". */
+                errno = EINVAL;
+                return FALSE;
+        }
+
+        while (done < len) {
+                nwritten = ws_write(cw->fd, cw->out + done, (unsigned int)(len - done));
+                if (nwritten == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        return FALSE;
+                }
+                if (nwritten == 0) {
+                        errno = ENOSPC;
+                        return FALSE;
+                }
+                done += (size_t)nwritten;
+        }
+
+        cw->in_used = 0;
+        return TRUE;
+}
+
+/*
+ * Data is only compressed a whole frame at a time, so a flush of the
+ * stream leaves what's been written since the last frame unwritten.
+ */
+static ssize_t
+compresswrite_write(void *cookie, const char *data, size_t size)
+{
+        compresswrite_t *cw = (compresswrite_t *)cookie;
+        size_t           copied = 0;
+        size_t           chunk;
+
+        while (copied < size) {
+                chunk = MIN(size - copied, BULKWRITE_BUFFER_SIZE - cw->in_used);
+                memcpy(cw->in + cw->in_used, data + copied, chunk);
+                cw->in_used += chunk;
+                copied += chunk;
+
+                if (cw->in_used == BULKWRITE_BUFFER_SIZE && !compresswrite_flush(cw))
+                        return -1;
+        }
+        return (ssize_t)size;
+}
+
+static void
+compresswrite_free(compresswrite_t *cw)
+{
+#ifdef HAVE_ZSTD
+        if (cw->zstd_cctx != NULL)
+                ZSTD_freeCCtx(cw->zstd_cctx);
+#endif
+        g_free(cw->out);
+        g_free(cw->in);
+        g_free(cw);
+}
+
+static int
+compresswrite_close(void *cookie)
+{
+        compresswrite_t *cw = (compresswrite_t *)cookie;
+        int              err = 0;
+
+        if (cw->in_used > 0 && !compresswrite_flush(cw))
+                err = errno;
+        if (ws_close(cw->fd) == -1 && err == 0)
+                err = errno;
+        compresswrite_free(cw);
+
+        if (err != 0) {
+                errno = err;
+                return -1;
+        }
+        return 0;
+}
+
+static const cookie_io_functions_t compresswrite_io_functions = {
+        NULL,                   /* read */
+        compresswrite_write,
+        NULL,                   /* seek */
+        compresswrite_close
+};
+
+static FILE *
+bulkwrite_fdopen_compressed(int fd, wtap_compression_type compression_type,
+                            int *err)
+{
+        compresswrite_t *cw;
+        FILE            *fh;
+
+        cw = g_new0(compresswrite_t, 1);
+        cw->fd = fd;
+        cw->compression_type = compression_type;
+        switch (compression_type) {
+
+#ifdef HAVE_ZSTD
+        case WTAP_ZSTD_COMPRESSED:
+                cw->out_size = ZSTD_compressBound(BULKWRITE_BUFFER_SIZE);
+                cw->zstd_cctx = ZSTD_createCCtx();
+                if (cw->zstd_cctx == NULL) {
+                        *err = ENOMEM;
+                        compresswrite_free(cw);
+                        return NULL;
+                }
+                break;
+#endif
+
+#ifdef USE_LZ4
+        case WTAP_LZ4_COMPRESSED:
+                cw->out_size = LZ4F_compressFrameBound(BULKWRITE_BUFFER_SIZE, NULL);
+                break;
+#endif
+
+        default:
+                *err = EINVAL;
+                compresswrite_free(cw);
+                return NULL;
+        }
+        cw->in = (guint8 *)g_try_malloc(BULKWRITE_BUFFER_SIZE);
+        cw->out = (guint8 *)g_try_malloc(cw->out_size);
+        if (cw->in == NULL || cw->out == NULL) {
+                *err = ENOMEM;
+                compresswrite_free(cw);
+                return NULL;
+        }
+
+        fh = fopencookie(cw, "wb", compresswrite_io_functions);
+        if (fh == NULL) {
+                *err = errno;
+                compresswrite_free(cw);
+                return NULL;
+        }
+        return fh;
+}
+#endif /* HAVE_COMPRESSED_WRITE */
+
+gboolean
+bulkwrite_can_compress(wtap_compression_type compression_type)
+{
+        switch (compression_type) {
+
+        case WTAP_UNCOMPRESSED:
+                return TRUE;
+
+#ifdef HAVE_FOPENCOOKIE
+#ifdef HAVE_ZSTD
+        case WTAP_ZSTD_COMPRESSED:
+                return TRUE;
+#endif
+#ifdef USE_LZ4
+        case WTAP_LZ4_COMPRESSED:
+                return TRUE;
+#endif
+#endif /* HAVE_FOPENCOOKIE */
+
+        default:
+                return FALSE;
+        }
+}
+
+FILE *
+bulkwrite_fdopen(int fd, gboolean direct, gint64 prealloc_size,
+                 wtap_compression_type compression_type, int *err)
+{
+        FILE *fh;
+#ifdef HAVE_DIRECT_IO
+        off_t offset;
+#endif
+
+        if (compression_type != WTAP_UNCOMPRESSED) {
+#ifdef HAVE_COMPRESSED_WRITE
+                return bulkwrite_fdopen_compressed(fd, compression_type, err);
+#else
+                *err = EINVAL;
+                return NULL;
+#endif
+        }
+
+#ifdef HAVE_DIRECT_IO
+        if (direct && bulkwrite_set_direct(fd, &offset))
+                return bulkwrite_fdopen_direct(fd, offset, prealloc_size, err);
+#else
+        (void)direct;
+        (void)prealloc_size;
+#endif
+
+        fh = ws_fdopen(fd, "wb");
+        if (fh == NULL) {
+                *err = errno;
+                return NULL;
+        }
+        setvbuf(fh, NULL, _IOFBF, BULKWRITE_BUFFER_SIZE);
+        return fh;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 expandtab:
+ * :indentSize=8:tabSize=8:noTabs=true:
+ */
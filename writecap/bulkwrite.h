@@ -0,0 +1,65 @@
+/* bulkwrite.h
+ * Declarations of our routines for writing capture files in large chunks
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __BULKWRITE_H__
+#define __BULKWRITE_H__
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "wiretap/wtap.h"
+
+/* The size of the buffer packets are collected in before being written */
+#define BULKWRITE_BUFFER_SIZE   (1024 * 1024)
+
+/** Open a stream, with a buffer of BULKWRITE_BUFFER_SIZE bytes, for
+   writing a capture file to a file descriptor; closing the stream closes
+   the file descriptor.
+
+   If "direct" is TRUE, and the platform and the file system allow it,
+   the file is written with O_DIRECT, bypassing the page cache.  The data
+   is then written only in whole blocks, except when the stream is closed,
+   so a flush leaves up to a block of data unwritten.
+
+   If "prealloc_size" is greater than 0, and "direct" is TRUE, space for
+   that many bytes is allocated for the file before anything is written;
+   any of it that's left over is freed when the stream is closed.
+
+   If "compression_type" isn't WTAP_UNCOMPRESSED, the file is compressed
+   as it's written, one BULKWRITE_BUFFER_SIZE frame at a time, and
+   "direct" and "prealloc_size" are ignored.  A flush then leaves the
+   data written since the last frame unwritten.
+
+   Returns the stream on success, NULL on failure.
+   Sets "*err" to an error code on failure */
+extern FILE *
+bulkwrite_fdopen(int fd, gboolean direct, gint64 prealloc_size,
+                 wtap_compression_type compression_type, int *err);
+
+/** Returns TRUE if bulkwrite_fdopen() can write files compressed with
+   "compression_type", FALSE if not */
+extern gboolean
+bulkwrite_can_compress(wtap_compression_type compression_type);
+
+#endif /* __BULKWRITE_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 expandtab:
+ * :indentSize=8:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,127 @@
+/* frame_index.c
+ * Routines for sidecar frame index files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <fcntl.h>
+
+#include "frame_index.h"
+#include "crc32.h"
+#include "file_util.h"
+
+#define FRAME_INDEX_CRC_CHUNK   65536
+
+/*
+ * The CRC covers the whole file, so that an index isn't used for a file
+ * that's been rewritten in place; reading the file without parsing it
+ * costs far less than the dissection the index saves.
+ */
+gboolean
+frame_index_key_for_file(const char *path, frame_index_key *key)
+{
+	ws_statb64 statb;
+	guint8 *buf;
+	guint32 crc;
+	int fd;
+	int len;
+
+	fd = ws_open(path, O_RDONLY|O_BINARY, 0000);
+	if (fd == -1)
+		return FALSE;
+	if (ws_fstat64(fd, &statb) != 0) {
+		ws_close(fd);
+		return FALSE;
+	}
+
+	buf = (guint8 *)g_malloc(FRAME_INDEX_CRC_CHUNK);
+	/* crc32_ccitt_seed() returns the complement of the running CRC */
+	crc = ~CRC32_CCITT_SEED;
+	while ((len = (int)ws_read(fd, buf, FRAME_INDEX_CRC_CHUNK)) > 0)
+		crc = crc32_ccitt_seed(buf, (guint)len, ~crc);
+	g_free(buf);
+	ws_close(fd);
+	if (len < 0)
+		return FALSE;
+
+	memset(key, 0, sizeof *key);
+	key->file_size = (gint64)statb.st_size;
+	key->file_mtime = (gint64)statb.st_mtime;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+	key->file_mtime_nsecs = (gint32)statb.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+	key->file_mtime_nsecs = (gint32)statb.st_mtimespec.tv_nsec;
+#endif
+	key->file_crc = crc;
+	return TRUE;
+}
+
+GMappedFile *
+frame_index_map(const char *path, const frame_index_key *key,
+    frame_index *index)
+{
+	GMappedFile *mapped;
+	const guint8 *contents;
+	gsize length;
+	frame_index_header hdr;
+	guint64 records_len;
+
+	mapped = g_mapped_file_new(path, FALSE, NULL);
+	if (mapped == NULL)
+		return NULL;
+
+	contents = (const guint8 *)g_mapped_file_get_contents(mapped);
+	length = g_mapped_file_get_length(mapped);
+	if (length < sizeof hdr) {
+		g_mapped_file_unref(mapped);
+		return NULL;
+	}
+	memcpy(&hdr, contents, sizeof hdr);
+
+	/*
+	 * The records and the fast seek points must fill the rest of the
+	 * file exactly; anything else means it was truncated, or written
+	 * by something else.
+	 */
+	records_len = (guint64)hdr.count * sizeof(frame_index_record);
+	if (hdr.magic != FRAME_INDEX_MAGIC || hdr.version != FRAME_INDEX_VERSION ||
+	    hdr.record_size != sizeof(frame_index_record) ||
+	    hdr.seek_point_size % 8 != 0 ||
+	    memcmp(&hdr.key, key, sizeof *key) != 0 ||
+	    (guint64)length - sizeof hdr !=
+	    records_len + (guint64)hdr.seek_point_count * hdr.seek_point_size) {
+		g_mapped_file_unref(mapped);
+		return NULL;
+	}
+
+	/*
+	 * The header and the records are multiples of 8 bytes long, and
+	 * so are the fast seek points, so they're all aligned.
+	 */
+	index->records = (const frame_index_record *)(contents + sizeof hdr);
+	index->count = hdr.count;
+	index->seek_points = contents + sizeof hdr + records_len;
+	index->seek_point_size = hdr.seek_point_size;
+	index->seek_point_count = hdr.seek_point_count;
+	return mapped;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,119 @@
+/* frame_index.h
+ * Definitions for sidecar frame index files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __FRAME_INDEX_H__
+#define __FRAME_INDEX_H__
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * An index holds, for each frame of a capture file, what frame_data_init()
+ * would fill in from the record, so that the file can be reopened, or
+ * summarized, without reading through all of its records.  It lives in
+ * a sidecar file next to the capture file.
+ *
+ * Records that aren't packets, such as system calls, have frames, and
+ * so records in the index, too; rec_type says which is which.
+ *
+ * It's a cache, written in host byte order; the header identifies the
+ * capture file by its size, its modification time, to the nanosecond
+ * where the file system has it, and a CRC of all of its contents, and
+ * an index that doesn't match is ignored.  The header is followed by
+ * one record per frame, and then by the fast seek points that reading
+ * the file gathered, if it's compressed, in the form wiretap gives
+ * them; see wtap_get_fast_seek_points().
+ */
+#define FRAME_INDEX_MAGIC       0x57534958      /* "WSIX" */
+#define FRAME_INDEX_VERSION     4
+
+#define FRAME_INDEX_HAS_TS              0x0001
+#define FRAME_INDEX_HAS_PHDR_COMMENT    0x0002
+
+typedef struct {
+	gint64  file_size;
+	gint64  file_mtime;
+	gint32  file_mtime_nsecs;
+	guint32 file_crc;
+} frame_index_key;
+
+typedef struct {
+	guint32 magic;
+	guint32 version;
+	guint32 record_size;
+	guint32 count;
+	guint32 seek_point_size;
+	guint32 seek_point_count;
+	frame_index_key key;
+} frame_index_header;
+
+typedef struct {
+	gint64  file_off;
+	gint64  secs;
+	gint32  nsecs;
+	guint32 pkt_len;
+	guint32 cap_len;
+	gint16  tsprec;
+	guint16 flags;
+	guint32 rec_type;       /* REC_TYPE_ */
+	guint32 reserved;       /* zero */
+} frame_index_record;
+
+/* The contents of a mapped index */
+typedef struct {
+	const frame_index_record *records;
+	guint32 count;
+	const guint8 *seek_points;
+	guint32 seek_point_size;
+	guint32 seek_point_count;
+} frame_index;
+
+/**
+ * Get the key identifying the current contents of a capture file.
+ *
+ * @return FALSE if the file can't be read.
+ */
+WS_DLL_PUBLIC
+gboolean frame_index_key_for_file(const char *path, frame_index_key *key);
+
+/**
+ * Map an index, if it's an index for a capture file with the specified
+ * key.
+ *
+ * @return the mapping, with its records and fast seek points in *index,
+ * or NULL if there's no usable index.  They're valid until the mapping
+ * is freed with g_mapped_file_unref().
+ */
+WS_DLL_PUBLIC
+GMappedFile *frame_index_map(const char *path, const frame_index_key *key,
+    frame_index *index);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_INDEX_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
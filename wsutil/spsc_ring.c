@@ -0,0 +1,181 @@
+/* spsc_ring.c
+ * A ring buffer of variable-length records, for passing data from one
+ * thread to another without locks
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "spsc_ring.h"
+
+/*
+ * Each record starts with a header; a header that marks a wrap says
+ * that the next record is at the start of the ring, because it didn't
+ * fit at the end.
+ */
+typedef struct {
+	guint32 len;
+	guint32 wrap;
+} spsc_record_t;
+
+#define SPSC_RECORD_SIZE(len)   (sizeof(spsc_record_t) + (((len) + 7) & ~7U))
+
+/* Keep the producer's and the consumer's fields in separate cache lines */
+#define SPSC_CACHE_LINE         64
+
+/*
+ * The positions are byte counts that only ever go up, modulo 2^32; a
+ * position's offset in the ring is the count modulo the ring's size.
+ */
+struct spsc_ring {
+	guint8  *buf;
+	guint32  size;                  /* a power of 2 */
+	guint32  mask;
+	char     pad0[SPSC_CACHE_LINE];
+
+	/* Written by the producer */
+	gint     head;                  /* end of the committed records */
+	guint32  head_records;          /* number of records committed */
+	guint32  reserved;              /* size of the reserved record, with any wrap */
+	guint32  tail_cache;            /* the tail, as last seen */
+	char     pad1[SPSC_CACHE_LINE];
+
+	/* Written by the consumer */
+	gint     tail;                  /* end of the released records */
+	gint     tail_records;          /* number of records released */
+	guint32  read;                  /* end of the consumed records */
+	guint32  read_records;          /* number of records consumed */
+	guint32  peeked;                /* size of the peeked-at record, with any wrap */
+	guint32  head_cache;            /* the head, as last seen */
+	char     pad2[SPSC_CACHE_LINE];
+};
+
+spsc_ring_t *
+spsc_ring_new(gsize size)
+{
+	spsc_ring_t *ring;
+	guint32 ring_size = 4096;
+
+	while (ring_size < size && ring_size < G_MAXUINT32 / 4)
+		ring_size <<= 1;
+
+	ring = g_new0(spsc_ring_t, 1);
+	ring->buf = (guint8 *)g_malloc(ring_size);
+	ring->size = ring_size;
+	ring->mask = ring_size - 1;
+	return ring;
+}
+
+void
+spsc_ring_free(spsc_ring_t *ring)
+{
+	g_free(ring->buf);
+	g_free(ring);
+}
+
+void *
+spsc_ring_reserve(spsc_ring_t *ring, guint32 len)
+{
+	guint32 head = (guint32)ring->head;
+	guint32 offset = head & ring->mask;
+	guint32 to_end = ring->size - offset;
+	guint32 need;
+	spsc_record_t *rec;
+
+	if (len > ring->size - sizeof(spsc_record_t))
+		return NULL;
+	need = (guint32)SPSC_RECORD_SIZE(len);
+	if (need > to_end) {
+		/* Skip the end of the ring */
+		need += to_end;
+	}
+	if (ring->size - (head - ring->tail_cache) < need) {
+		ring->tail_cache = (guint32)g_atomic_int_get(&ring->tail);
+		if (ring->size - (head - ring->tail_cache) < need)
+			return NULL;
+	}
+
+	if (need > (guint32)SPSC_RECORD_SIZE(len)) {
+		rec = (spsc_record_t *)(ring->buf + offset);
+		rec->wrap = 1;
+		offset = 0;
+	}
+	rec = (spsc_record_t *)(ring->buf + offset);
+	rec->len = len;
+	rec->wrap = 0;
+	ring->reserved = need;
+	return rec + 1;
+}
+
+void
+spsc_ring_commit(spsc_ring_t *ring)
+{
+	ring->head_records++;
+	/* This publishes the record's contents, as it's a full barrier */
+	g_atomic_int_set(&ring->head, (gint)((guint32)ring->head + ring->reserved));
+	ring->reserved = 0;
+}
+
+void
+spsc_ring_used(spsc_ring_t *ring, guint32 *bytes, guint32 *records)
+{
+	*bytes = (guint32)ring->head - (guint32)g_atomic_int_get(&ring->tail);
+	*records = ring->head_records - (guint32)g_atomic_int_get(&ring->tail_records);
+}
+
+void *
+spsc_ring_peek(spsc_ring_t *ring, guint32 *len)
+{
+	guint32 offset;
+	spsc_record_t *rec;
+
+	if (ring->read == ring->head_cache) {
+		ring->head_cache = (guint32)g_atomic_int_get(&ring->head);
+		if (ring->read == ring->head_cache)
+			return NULL;
+	}
+
+	offset = ring->read & ring->mask;
+	rec = (spsc_record_t *)(ring->buf + offset);
+	ring->peeked = 0;
+	if (rec->wrap) {
+		ring->peeked = ring->size - offset;
+		rec = (spsc_record_t *)ring->buf;
+	}
+	ring->peeked += (guint32)SPSC_RECORD_SIZE(rec->len);
+	*len = rec->len;
+	return rec + 1;
+}
+
+void
+spsc_ring_consume(spsc_ring_t *ring)
+{
+	ring->read += ring->peeked;
+	ring->read_records++;
+	ring->peeked = 0;
+}
+
+void
+spsc_ring_release(spsc_ring_t *ring)
+{
+	g_atomic_int_set(&ring->tail_records, (gint)ring->read_records);
+	g_atomic_int_set(&ring->tail, (gint)ring->read);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
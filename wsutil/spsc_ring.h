@@ -0,0 +1,110 @@
+/* spsc_ring.h
+ * A ring buffer of variable-length records, for passing data from one
+ * thread to another without locks
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * One thread, the producer, writes records into the ring, and one other
+ * thread, the consumer, reads them, in the same order.  Records are
+ * written and read in place; a record is contiguous in memory, and is
+ * 8-byte aligned.
+ *
+ * The producer calls spsc_ring_reserve() to get space for a record and
+ * spsc_ring_commit() to make it visible to the consumer.  The consumer
+ * calls spsc_ring_peek() and spsc_ring_consume() for each record, and,
+ * after a batch of records, spsc_ring_release() to let the producer
+ * reuse their space.
+ *
+ * Neither side waits; if the producer has to wait for the consumer, or
+ * vice versa, it's up to the caller to arrange that.
+ */
+typedef struct spsc_ring spsc_ring_t;
+
+/**
+ * Create a ring.
+ *
+ * @param size the minimum size of the ring, in bytes; it's rounded up to
+ * a power of 2.  Each record takes 8 bytes more than its length, rounded
+ * up to a multiple of 8.
+ */
+WS_DLL_PUBLIC
+spsc_ring_t *spsc_ring_new(gsize size);
+
+/** Free a ring, and any records in it. */
+WS_DLL_PUBLIC
+void spsc_ring_free(spsc_ring_t *ring);
+
+/**
+ * Producer: get space for a record of len bytes.
+ *
+ * @return a pointer to the space, or NULL if there isn't enough free
+ * space in the ring
+ */
+WS_DLL_PUBLIC
+void *spsc_ring_reserve(spsc_ring_t *ring, guint32 len);
+
+/** Producer: hand the record just reserved to the consumer. */
+WS_DLL_PUBLIC
+void spsc_ring_commit(spsc_ring_t *ring);
+
+/**
+ * Producer: the number of bytes and records in the ring that the
+ * consumer hasn't released yet.
+ */
+WS_DLL_PUBLIC
+void spsc_ring_used(spsc_ring_t *ring, guint32 *bytes, guint32 *records);
+
+/**
+ * Consumer: get the next record, without taking it out of the ring.
+ *
+ * @return a pointer to the record, with its length in *len, or NULL if
+ * there are no more records
+ */
+WS_DLL_PUBLIC
+void *spsc_ring_peek(spsc_ring_t *ring, guint32 *len);
+
+/** Consumer: move past the record just peeked at. */
+WS_DLL_PUBLIC
+void spsc_ring_consume(spsc_ring_t *ring);
+
+/**
+ * Consumer: give the space of the records consumed so far back to the
+ * producer.  Their contents mustn't be used after this.
+ */
+WS_DLL_PUBLIC
+void spsc_ring_release(spsc_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SPSC_RING_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,247 @@
+/* spsc_ring_test.c
+ * Tests for the single-producer, single-consumer ring buffer
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "spsc_ring.h"
+
+/* Odd lengths, so that records are padded, and land all over the ring */
+static const guint32 record_lens[] = { 1, 13, 7, 301, 0, 3, 1021, 57, 9, 511 };
+
+#define RECORD_LEN(seq)         record_lens[(seq) % G_N_ELEMENTS(record_lens)]
+
+/* What a record takes in the ring; see spsc_ring.h */
+#define RECORD_SIZE(len)        (8 + (((len) + 7) & ~7U))
+
+static void
+fill_record(guint8 *data, guint32 seq, guint32 len)
+{
+	guint32 i;
+
+	for (i = 0; i < len; i++)
+		data[i] = (guint8)(seq * 31 + i);
+}
+
+static void
+check_record(const guint8 *data, guint32 seq, guint32 len)
+{
+	guint32 i;
+
+	for (i = 0; i < len; i++)
+		g_assert_cmpuint(data[i], ==, (guint8)(seq * 31 + i));
+}
+
+/* Write record seq; returns FALSE if the ring is full */
+static gboolean
+produce(spsc_ring_t *ring, guint32 seq)
+{
+	guint8 *data;
+
+	data = (guint8 *)spsc_ring_reserve(ring, RECORD_LEN(seq));
+	if (data == NULL)
+		return FALSE;
+	g_assert_cmpuint(GPOINTER_TO_SIZE(data) % 8, ==, 0);
+	fill_record(data, seq, RECORD_LEN(seq));
+	spsc_ring_commit(ring);
+	return TRUE;
+}
+
+/* Read record seq; returns FALSE if the ring is empty */
+static gboolean
+consume(spsc_ring_t *ring, guint32 seq)
+{
+	guint8 *data;
+	guint32 len;
+
+	data = (guint8 *)spsc_ring_peek(ring, &len);
+	if (data == NULL)
+		return FALSE;
+	g_assert_cmpuint(GPOINTER_TO_SIZE(data) % 8, ==, 0);
+	g_assert_cmpuint(len, ==, RECORD_LEN(seq));
+	check_record(data, seq, len);
+	spsc_ring_consume(ring);
+	return TRUE;
+}
+
+/*
+ * Records of odd lengths go round the ring many times, so that they
+ * often don't fit at the end and have to be wrapped to the start.
+ */
+static void
+test_spsc_ring_wrap(void)
+{
+	spsc_ring_t *ring = spsc_ring_new(4096);
+	guint32 produced = 0, consumed = 0;
+	guint32 bytes, records;
+	int round;
+
+	for (round = 0; round < 1000; round++) {
+		/* a few records at a time, so that the ends move separately */
+		while (produced - consumed < 5 && produce(ring, produced))
+			produced++;
+		spsc_ring_used(ring, &bytes, &records);
+		g_assert_cmpuint(records, ==, produced - consumed);
+		g_assert_cmpuint(bytes, <=, 4096);
+
+		if (!consume(ring, consumed))
+			g_assert_not_reached();
+		consumed++;
+		if (round % 3 == 0) {
+			while (consumed < produced && consume(ring, consumed))
+				consumed++;
+		}
+		spsc_ring_release(ring);
+	}
+	while (consumed < produced && consume(ring, consumed))
+		consumed++;
+	g_assert_cmpuint(consumed, ==, produced);
+	g_assert_null(spsc_ring_peek(ring, &records));
+	/* well past the size of the ring */
+	g_assert_cmpuint(produced, >, 1000);
+
+	spsc_ring_free(ring);
+}
+
+/*
+ * A full ring takes no more records until the consumer releases some;
+ * consuming them isn't enough.  A record that doesn't fit at the end
+ * needs room there for the wrap marker as well as room at the start.
+ */
+static void
+test_spsc_ring_full(void)
+{
+	spsc_ring_t *ring = spsc_ring_new(4096);
+	const guint32 len = 13;
+	const guint32 per_ring = 4096 / RECORD_SIZE(len);
+	guint8 *data, *last = NULL;
+	guint32 bytes, records, got, i;
+
+	/* 170 records of 24 bytes, leaving 16 bytes at the end */
+	for (i = 0; i < per_ring; i++) {
+		data = (guint8 *)spsc_ring_reserve(ring, len);
+		g_assert_nonnull(data);
+		memset(data, (int)i, len);
+		spsc_ring_commit(ring);
+		last = data;
+	}
+	g_assert_null(spsc_ring_reserve(ring, len));
+	spsc_ring_used(ring, &bytes, &records);
+	g_assert_cmpuint(bytes, ==, per_ring * RECORD_SIZE(len));
+	g_assert_cmpuint(records, ==, per_ring);
+
+	/* consumed, but not released */
+	data = (guint8 *)spsc_ring_peek(ring, &got);
+	g_assert_nonnull(data);
+	g_assert_cmpuint(got, ==, len);
+	g_assert_cmpuint(data[0], ==, 0);
+	spsc_ring_consume(ring);
+	g_assert_null(spsc_ring_reserve(ring, len));
+
+	/* the 16 bytes at the end, and the 24 released, are just enough */
+	spsc_ring_release(ring);
+	data = (guint8 *)spsc_ring_reserve(ring, len);
+	g_assert_nonnull(data);
+	g_assert_true(data < last);
+	memset(data, (int)per_ring, len);
+	spsc_ring_commit(ring);
+	spsc_ring_used(ring, &bytes, &records);
+	g_assert_cmpuint(bytes, ==, 4096);
+	g_assert_cmpuint(records, ==, per_ring);
+
+	/* completely full now; not even an empty record fits */
+	g_assert_null(spsc_ring_reserve(ring, 0));
+
+	/* the consumer follows the wrap marker to the start */
+	for (i = 1; i <= per_ring; i++) {
+		data = (guint8 *)spsc_ring_peek(ring, &got);
+		g_assert_nonnull(data);
+		g_assert_cmpuint(got, ==, len);
+		g_assert_cmpuint(data[0], ==, (guint8)i);
+		g_assert_cmpuint(data[len - 1], ==, (guint8)i);
+		spsc_ring_consume(ring);
+	}
+	g_assert_null(spsc_ring_peek(ring, &got));
+	spsc_ring_release(ring);
+	spsc_ring_used(ring, &bytes, &records);
+	g_assert_cmpuint(bytes, ==, 0);
+	g_assert_cmpuint(records, ==, 0);
+
+	/* too big ever to fit */
+	g_assert_null(spsc_ring_reserve(ring, 4096));
+
+	spsc_ring_free(ring);
+}
+
+#define THREAD_RECORDS  200000
+
+static gpointer
+producer_thread(gpointer data)
+{
+	spsc_ring_t *ring = (spsc_ring_t *)data;
+	guint32 seq;
+
+	for (seq = 0; seq < THREAD_RECORDS; seq++) {
+		while (!produce(ring, seq))
+			g_thread_yield();
+	}
+	return NULL;
+}
+
+/* Records get from one thread to another intact and in order */
+static void
+test_spsc_ring_threads(void)
+{
+	spsc_ring_t *ring = spsc_ring_new(8192);
+	GThread *producer;
+	guint32 seq;
+
+	producer = g_thread_new("spsc_ring_test producer", producer_thread, ring);
+	for (seq = 0; seq < THREAD_RECORDS; seq++) {
+		while (!consume(ring, seq)) {
+			spsc_ring_release(ring);
+			g_thread_yield();
+		}
+		if (seq % 16 == 15)
+			spsc_ring_release(ring);
+	}
+	g_thread_join(producer);
+	spsc_ring_release(ring);
+	g_assert_null(spsc_ring_peek(ring, &seq));
+
+	spsc_ring_free(ring);
+}
+
+int
+main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/wsutil/spsc_ring/wrap", test_spsc_ring_wrap);
+	g_test_add_func("/wsutil/spsc_ring/full", test_spsc_ring_full);
+	g_test_add_func("/wsutil/spsc_ring/threads", test_spsc_ring_threads);
+
+	return g_test_run();
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */